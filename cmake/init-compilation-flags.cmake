@@ -29,6 +29,13 @@ if(UNDEFINED_SANITIZER)
 endif()
 cmake_print_variables(ADDRESS_SANITIZER UNDEFINED_SANITIZER)
 
+# the runtime and the generated code must agree on it, kphp2cpp passes it to the generated code build as well
+option(KPHP_ARRAY_CTRL_BYTES "Probe the array hash tables by SIMD groups of one byte control tags")
+if(KPHP_ARRAY_CTRL_BYTES)
+    add_definitions(-DKPHP_ARRAY_CTRL_BYTES=1)
+endif()
+cmake_print_variables(KPHP_ARRAY_CTRL_BYTES)
+
 option(KPHP_TESTS "Build the tests" ON)
 cmake_print_variables(KPHP_TESTS)
 
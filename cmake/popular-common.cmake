@@ -19,6 +19,10 @@ prepend(POPULAR_COMMON_SOURCES ${COMMON_DIR}/
         secure-bzero.cpp
         crc32_${HOST}.cpp
         crc32c_${HOST}.cpp
+        string-hash.cpp
+        string-hash-${HOST}.cpp
+        numeric-vector.cpp
+        numeric-vector-${HOST}.cpp
         parallel/counter.cpp
         parallel/maximum.cpp
         parallel/thread-id.cpp
@@ -0,0 +1,56 @@
+// Compiler for PHP (aka KPHP)
+// Copyright (c) 2020 LLC «V Kontakte»
+// Distributed under the GPL v3 License, see LICENSE.notice.txt
+
+#include <gtest/gtest.h>
+#include <vector>
+
+#include "common/algorithms/probe-group.h"
+
+namespace {
+
+std::vector<size_t> matched_slots(uint64_t mask) {
+  std::vector<size_t> slots;
+  for (; mask; mask &= mask - 1) {
+    slots.push_back(vk::probe_group::lowest_slot(mask));
+  }
+  return slots;
+}
+
+} // namespace
+
+TEST(algorithms_probe_group, match) {
+  uint8_t ctrl[vk::probe_group::SIZE + 3] = {0};
+  ctrl[0] = 0x81;
+  ctrl[3] = 0x85;
+  ctrl[4] = 0x81;
+  ctrl[15] = 0x81;
+  ctrl[16] = 0x81;
+
+  const vk::probe_group group{ctrl};
+  ASSERT_EQ(matched_slots(group.match(0x81)), (std::vector<size_t>{0, 4, 15}));
+  ASSERT_EQ(matched_slots(group.match(0x85)), (std::vector<size_t>{3}));
+  ASSERT_EQ(group.match(0x86), 0);
+  ASSERT_EQ(matched_slots(group.match(0)).size(), vk::probe_group::SIZE - 4);
+
+  // the group may start at any unaligned byte
+  const vk::probe_group shifted{ctrl + 3};
+  ASSERT_EQ(matched_slots(shifted.match(0x81)), (std::vector<size_t>{1, 12, 13}));
+}
+
+TEST(algorithms_probe_group, slots_before) {
+  uint8_t ctrl[vk::probe_group::SIZE] = {0};
+  ctrl[1] = 0x90;
+  ctrl[6] = 0x90;
+  ctrl[9] = 0x90;
+  for (size_t i = 0; i != 8; ++i) {
+    ctrl[i] |= i != 1 && i != 6 ? 0x80 : 0;
+  }
+
+  const vk::probe_group group{ctrl};
+  // the first empty slot is 8, the matches after it are not reachable by the probing
+  const uint64_t empty = group.match(0);
+  ASSERT_EQ(vk::probe_group::lowest_slot(empty), 8);
+  ASSERT_EQ(matched_slots(vk::probe_group::slots_before(group.match(0x90), empty)), (std::vector<size_t>{1, 6}));
+  ASSERT_EQ(vk::probe_group::slots_before(group.match(0x90), group.match(0x80)), 0);
+}
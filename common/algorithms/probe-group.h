@@ -0,0 +1,82 @@
+// Compiler for PHP (aka KPHP)
+// Copyright (c) 2020 LLC «V Kontakte»
+// Distributed under the GPL v3 License, see LICENSE.notice.txt
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+namespace vk {
+
+// A group of one byte control tags of consecutive slots of an open addressing table.
+// The whole group is compared with a tag in a couple of instructions,
+// so the probing touches the table entries only for the slots with the matching tags.
+class probe_group {
+public:
+  static constexpr size_t SIZE = 16;
+
+  // group slot i corresponds to the bits [i * MASK_STRIDE, (i + 1) * MASK_STRIDE) of a mask
+#if defined(__SSE2__) || !defined(__aarch64__)
+  static constexpr int MASK_STRIDE = 1;
+#else
+  static constexpr int MASK_STRIDE = 4;
+#endif
+
+  // ctrl may be unaligned
+  explicit probe_group(const uint8_t *ctrl) noexcept {
+#if defined(__SSE2__)
+    ctrl_ = _mm_loadu_si128(reinterpret_cast<const __m128i *>(ctrl));
+#elif defined(__aarch64__)
+    ctrl_ = vld1q_u8(ctrl);
+#else
+    for (size_t i = 0; i != SIZE; ++i) {
+      ctrl_[i] = ctrl[i];
+    }
+#endif
+  }
+
+  uint64_t match(uint8_t tag) const noexcept {
+#if defined(__SSE2__)
+    return static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(ctrl_, _mm_set1_epi8(static_cast<char>(tag)))));
+#elif defined(__aarch64__)
+    // there is no movemask on neon, narrow every 0xff/0x00 byte to a nibble instead
+    const uint8x16_t eq = vceqq_u8(ctrl_, vdupq_n_u8(tag));
+    const uint8x8_t nibbles = vshrn_n_u16(vreinterpretq_u16_u8(eq), 4);
+    return vget_lane_u64(vreinterpret_u64_u8(nibbles), 0) & 0x8888888888888888ULL;
+#else
+    uint64_t mask = 0;
+    for (size_t i = 0; i != SIZE; ++i) {
+      mask |= static_cast<uint64_t>(ctrl_[i] == tag) << i;
+    }
+    return mask;
+#endif
+  }
+
+  // the slot index of the lowest set mask bit, mask must be non zero
+  static size_t lowest_slot(uint64_t mask) noexcept {
+    return static_cast<size_t>(__builtin_ctzll(mask)) / MASK_STRIDE;
+  }
+
+  // keeps only the bits of the slots before the lowest set bit of the limit mask, limit must be non zero
+  static uint64_t slots_before(uint64_t mask, uint64_t limit) noexcept {
+    return mask & ((limit & -limit) - 1);
+  }
+
+private:
+#if defined(__SSE2__)
+  __m128i ctrl_;
+#elif defined(__aarch64__)
+  uint8x16_t ctrl_;
+#else
+  uint8_t ctrl_[SIZE];
+#endif
+};
+
+} // namespace vk
@@ -2,21 +2,31 @@ prepend(COMMON_TESTS_SOURCES ${COMMON_DIR}/
         algorithms/compare-test.cpp
         algorithms/contains-test.cpp
         algorithms/hashes-test.cpp
+        algorithms/probe-group-test.cpp
         algorithms/projections-test.cpp
         algorithms/simd-int-to-string-test.cpp
         algorithms/string-algorithms-test.cpp
         allocators/freelist-test.cpp
         allocators/lockfree-slab-test.cpp
+        containers/timing-wheel-test.cpp
         crc32c-test.cpp
         crypto/aes256-test.cpp
         parallel/counter-test.cpp
         parallel/limit-counter-test.cpp
         parallel/maximum-test.cpp
         smart_iterators/smart-iterators-test.cpp
+        numeric-vector-test.cpp
+        string-hash-test.cpp
         smart_ptrs/tagged-ptr-test.cpp
         type_traits/list_of_types_test.cpp
+        ucontext/ucontext-portable-test.cpp
         wrappers/span-test.cpp
         wrappers/string_view-test.cpp)
 
-set(COMMON_TESTS_LIBS vk::common_src vk::net_src vk::binlog_src vk::unicode -l:libzstd.a rt crypto z)
+set(COMMON_TESTS_LIBS vk::common_src vk::net_src vk::binlog_src vk::unicode -l:libzstd.a -l:libbrotlienc.a -l:libbrotlicommon.a rt crypto z)
 vk_add_unittest(common "${COMMON_TESTS_LIBS}" ${COMMON_TESTS_SOURCES})
+
+vk_add_benchmark(common-ucontext-portable "${COMMON_TESTS_LIBS}" ${COMMON_DIR}/ucontext/ucontext-portable-benchmark.cpp)
+vk_add_benchmark(common-string-hash "${COMMON_TESTS_LIBS}" ${COMMON_DIR}/string-hash-benchmark.cpp)
+vk_add_benchmark(common-numeric-vector "${COMMON_TESTS_LIBS}" ${COMMON_DIR}/numeric-vector-benchmark.cpp)
+vk_add_benchmark(common-timing-wheel "${COMMON_TESTS_LIBS}" ${COMMON_DIR}/containers/timing-wheel-benchmark.cpp)
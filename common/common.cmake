@@ -15,6 +15,7 @@ prepend(COMMON_MAIN_SOURCES ${COMMON_DIR}/
         crypto/aes256.cpp
         crypto/aes256-generic.cpp
         crypto/aes256-${HOST}.cpp
+        ucontext/ucontext-portable-${HOST}.cpp
 
         fast-backtrace.cpp
         string-processing.cpp
@@ -0,0 +1,198 @@
+// Compiler for PHP (aka KPHP)
+// Copyright (c) 2020 LLC «V Kontakte»
+// Distributed under the GPL v3 License, see LICENSE.notice.txt
+
+#include <benchmark/benchmark.h>
+
+#include <random>
+#include <vector>
+
+#include "common/container_of.h"
+#include "common/containers/timing-wheel.h"
+
+namespace {
+
+// the timeouts of the waits, in ms: most of them are answered long before they expire
+constexpr int64_t MAX_TIMEOUT = 10000;
+
+struct wheel_timer {
+  vk::timing_wheel_node node{};
+};
+
+class wheel_queue {
+public:
+  using timer_t = wheel_timer;
+
+  explicit wheel_queue(size_t) {
+  }
+
+  static bool active(const wheel_timer &timer) {
+    return timer.node.slot != 0;
+  }
+
+  static int64_t expires(const wheel_timer &timer) {
+    return timer.node.expires;
+  }
+
+  void arm(wheel_timer *timer, int64_t expires) {
+    wheel_.insert(&timer->node, expires);
+  }
+
+  void cancel(wheel_timer *timer) {
+    wheel_.remove(&timer->node);
+  }
+
+  wheel_timer *pop_expired(int64_t now) {
+    wheel_.advance(now);
+    vk::timing_wheel_node *node = wheel_.first_expired();
+    if (!node) {
+      return nullptr;
+    }
+    wheel_.remove(node);
+    return container_of(node, wheel_timer, node);
+  }
+
+private:
+  vk::timing_wheel wheel_{0};
+};
+
+// the binary heap with the positions stored in the timers, as the event timers were kept before
+struct heap_timer {
+  int h_idx{0};
+  int64_t expires{0};
+};
+
+class heap_queue {
+public:
+  using timer_t = heap_timer;
+
+  explicit heap_queue(size_t max_size) :
+    heap_(max_size + 1) {
+  }
+
+  static bool active(const heap_timer &timer) {
+    return timer.h_idx != 0;
+  }
+
+  static int64_t expires(const heap_timer &timer) {
+    return timer.expires;
+  }
+
+  void arm(heap_timer *et, int64_t expires) {
+    et->expires = expires;
+    int i = et->h_idx;
+    if (!i) {
+      i = ++size_;
+    }
+    sift(et, i);
+  }
+
+  void cancel(heap_timer *et) {
+    const int i = et->h_idx;
+    if (!i) {
+      return;
+    }
+    et->h_idx = 0;
+    heap_timer *last = heap_[size_--];
+    if (i <= size_ && last != et) {
+      sift(last, i);
+    }
+  }
+
+  heap_timer *pop_expired(int64_t now) {
+    if (!size_ || heap_[1]->expires > now) {
+      return nullptr;
+    }
+    heap_timer *et = heap_[1];
+    cancel(et);
+    return et;
+  }
+
+private:
+  void sift(heap_timer *et, int i) {
+    while (i > 1 && heap_[i >> 1]->expires > et->expires) {
+      heap_[i] = heap_[i >> 1];
+      heap_[i]->h_idx = i;
+      i >>= 1;
+    }
+    for (int j = 2 * i; j <= size_; j = 2 * i) {
+      if (j < size_ && heap_[j + 1]->expires < heap_[j]->expires) {
+        j++;
+      }
+      if (heap_[j]->expires >= et->expires) {
+        break;
+      }
+      heap_[i] = heap_[j];
+      heap_[i]->h_idx = i;
+      i = j;
+    }
+    heap_[i] = et;
+    et->h_idx = i;
+  }
+
+  std::vector<heap_timer *> heap_;
+  int size_{0};
+};
+
+// each iteration is one ms tick: the waits answered in it are cancelled, the expired ones are popped,
+// and every finished wait is replaced with a new one, so the number of concurrent timers stays the same
+template<class Queue>
+void run_churn_benchmark(benchmark::State &state) {
+  using timer_t = typename Queue::timer_t;
+  const auto concurrent = static_cast<size_t>(state.range(0));
+  Queue queue{concurrent};
+  std::vector<timer_t> timers(concurrent);
+  std::mt19937_64 gen{42};
+  std::vector<std::vector<timer_t *>> answers(MAX_TIMEOUT + 1);
+  int64_t now = 0;
+  auto start_wait = [&](timer_t *timer) {
+    const int64_t timeout = 1 + static_cast<int64_t>(gen() % MAX_TIMEOUT);
+    queue.arm(timer, now + timeout);
+    // 90% of the waits are answered before the timeout
+    if (gen() % 10) {
+      const int64_t answer_delay = 1 + static_cast<int64_t>(gen() % timeout);
+      answers[(now + answer_delay) % answers.size()].push_back(timer);
+    }
+  };
+  for (auto &timer : timers) {
+    start_wait(&timer);
+  }
+
+  int64_t churn = 0;
+  for (auto _ : state) {
+    now++;
+    auto &answered = answers[now % answers.size()];
+    for (timer_t *timer : answered) {
+      // the wait could expire and be restarted after the answer was planned
+      if (Queue::active(*timer) && Queue::expires(*timer) > now) {
+        queue.cancel(timer);
+        start_wait(timer);
+        churn++;
+      }
+    }
+    answered.clear();
+    while (timer_t *timer = queue.pop_expired(now)) {
+      start_wait(timer);
+      churn++;
+    }
+  }
+  state.SetItemsProcessed(churn);
+}
+
+void concurrent_timers(benchmark::internal::Benchmark *b) {
+  b->Arg(1000)->Arg(10000)->Arg(100000)->Arg(1000000);
+}
+
+} // namespace
+
+static void BM_timer_churn_timing_wheel(benchmark::State &state) {
+  run_churn_benchmark<wheel_queue>(state);
+}
+BENCHMARK(BM_timer_churn_timing_wheel)->Apply(concurrent_timers);
+
+static void BM_timer_churn_binary_heap(benchmark::State &state) {
+  run_churn_benchmark<heap_queue>(state);
+}
+BENCHMARK(BM_timer_churn_binary_heap)->Apply(concurrent_timers);
+
+BENCHMARK_MAIN();
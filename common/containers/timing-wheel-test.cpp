@@ -0,0 +1,186 @@
+// Compiler for PHP (aka KPHP)
+// Copyright (c) 2020 LLC «V Kontakte»
+// Distributed under the GPL v3 License, see LICENSE.notice.txt
+
+#include "common/containers/timing-wheel.h"
+
+#include <algorithm>
+#include <map>
+#include <random>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "common/container_of.h"
+
+namespace {
+
+struct test_timer {
+  vk::timing_wheel_node node{};
+  int id{0};
+};
+
+std::vector<int> pop_expired(vk::timing_wheel &wheel) {
+  std::vector<int> ids;
+  while (vk::timing_wheel_node *node = wheel.first_expired()) {
+    wheel.remove(node);
+    ids.push_back(container_of(node, test_timer, node)->id);
+  }
+  std::sort(ids.begin(), ids.end());
+  return ids;
+}
+
+} // namespace
+
+TEST(timing_wheel, expire_in_order) {
+  vk::timing_wheel wheel{1000};
+  test_timer timers[4];
+  const int64_t ticks[4] = {1005, 1001, 1100, 1005};
+  for (int i = 0; i < 4; i++) {
+    timers[i].id = i;
+    wheel.insert(&timers[i].node, ticks[i]);
+  }
+  ASSERT_EQ(wheel.size(), 4);
+  ASSERT_EQ(wheel.first_expired(), nullptr);
+
+  wheel.advance(1000);
+  ASSERT_TRUE(pop_expired(wheel).empty());
+  wheel.advance(1001);
+  ASSERT_EQ(pop_expired(wheel), (std::vector<int>{1}));
+  wheel.advance(1004);
+  ASSERT_TRUE(pop_expired(wheel).empty());
+  wheel.advance(1099);
+  ASSERT_EQ(pop_expired(wheel), (std::vector<int>{0, 3}));
+  wheel.advance(5000);
+  ASSERT_EQ(pop_expired(wheel), (std::vector<int>{2}));
+  ASSERT_EQ(wheel.size(), 0);
+  ASSERT_EQ(wheel.now(), 5000);
+}
+
+TEST(timing_wheel, insert_past_and_move) {
+  vk::timing_wheel wheel{100};
+  test_timer timer;
+  wheel.insert(&timer.node, 50);
+  ASSERT_EQ(wheel.first_expired(), &timer.node);
+
+  // an active node is moved, not added twice
+  wheel.insert(&timer.node, 300);
+  ASSERT_EQ(wheel.size(), 1);
+  ASSERT_EQ(wheel.first_expired(), nullptr);
+  wheel.advance(299);
+  ASSERT_EQ(wheel.first_expired(), nullptr);
+  wheel.advance(300);
+  ASSERT_EQ(wheel.first_expired(), &timer.node);
+}
+
+TEST(timing_wheel, cancel) {
+  vk::timing_wheel wheel{0};
+  test_timer near, far;
+  wheel.insert(&near.node, 10);
+  wheel.insert(&far.node, 1 << 20);
+  wheel.remove(&near.node);
+  wheel.remove(&far.node);
+  ASSERT_EQ(near.node.slot, 0);
+  ASSERT_EQ(wheel.size(), 0);
+  // removing an inactive node is a no-op
+  wheel.remove(&near.node);
+
+  bool exact = false;
+  ASSERT_EQ(wheel.next_event(&exact), int64_t{vk::timing_wheel::NO_EVENT});
+  wheel.advance(1 << 21);
+  ASSERT_EQ(wheel.first_expired(), nullptr);
+}
+
+TEST(timing_wheel, next_event) {
+  vk::timing_wheel wheel{0};
+  test_timer near, far;
+  wheel.insert(&near.node, 10);
+  wheel.insert(&far.node, 1000);
+
+  bool exact = false;
+  ASSERT_EQ(wheel.next_event(&exact), 10);
+  ASSERT_TRUE(exact);
+  wheel.advance(10);
+  ASSERT_EQ(wheel.next_event(&exact), 10);
+  ASSERT_TRUE(exact);
+  pop_expired(wheel);
+
+  // the far timer is cascaded at the boundary of its higher level slot first
+  int64_t next = wheel.next_event(&exact);
+  ASSERT_FALSE(exact);
+  ASSERT_LE(next, 1000);
+  while (!exact) {
+    wheel.advance(next);
+    ASSERT_EQ(wheel.first_expired(), nullptr);
+    next = wheel.next_event(&exact);
+  }
+  ASSERT_EQ(next, 1000);
+}
+
+TEST(timing_wheel, overflow) {
+  const int64_t start = (int64_t{1} << 30) - 5;
+  vk::timing_wheel wheel{start};
+  test_timer timers[3];
+  const int64_t ticks[3] = {start + 3, start + 10, start + (int64_t{3} << 30)};
+  for (int i = 0; i < 3; i++) {
+    timers[i].id = i;
+    wheel.insert(&timers[i].node, ticks[i]);
+  }
+  for (int i = 0; i < 3; i++) {
+    wheel.advance(ticks[i] - 1);
+    ASSERT_TRUE(pop_expired(wheel).empty());
+    wheel.advance(ticks[i]);
+    ASSERT_EQ(pop_expired(wheel), (std::vector<int>{i}));
+  }
+}
+
+TEST(timing_wheel, random_against_reference) {
+  std::mt19937_64 rng{42};
+  vk::timing_wheel wheel{123456};
+  std::vector<test_timer> timers(2000);
+  std::multimap<int64_t, int> reference;
+  for (int i = 0; i < static_cast<int>(timers.size()); i++) {
+    timers[i].id = i;
+  }
+
+  for (int step = 0; step < 3000; step++) {
+    for (int j = 0; j < 10; j++) {
+      test_timer &timer = timers[rng() % timers.size()];
+      if (timer.node.slot) {
+        reference.erase(std::find_if(reference.begin(), reference.end(), [&](const std::pair<const int64_t, int> &p) {
+          return p.second == timer.id;
+        }));
+      }
+      if (rng() % 4 == 0) {
+        wheel.remove(&timer.node);
+      } else {
+        const int64_t delay = rng() % 2 ? rng() % 100 : rng() % (int64_t{1} << (rng() % 36));
+        wheel.insert(&timer.node, wheel.now() + delay);
+        reference.emplace(wheel.now() + delay, timer.id);
+      }
+    }
+    ASSERT_EQ(wheel.size(), static_cast<int>(reference.size()));
+
+    const int64_t now = wheel.now() + (rng() % 8 == 0 ? rng() % (int64_t{1} << 32) : rng() % 300);
+    wheel.advance(now);
+    std::vector<int> expected;
+    while (!reference.empty() && reference.begin()->first <= now) {
+      expected.push_back(reference.begin()->second);
+      reference.erase(reference.begin());
+    }
+    std::sort(expected.begin(), expected.end());
+    ASSERT_EQ(pop_expired(wheel), expected);
+
+    bool exact = false;
+    const int64_t next = wheel.next_event(&exact);
+    if (reference.empty()) {
+      ASSERT_EQ(next, int64_t{vk::timing_wheel::NO_EVENT});
+    } else {
+      ASSERT_GT(next, now);
+      ASSERT_LE(next, reference.begin()->first);
+      if (exact) {
+        ASSERT_EQ(next, reference.begin()->first);
+      }
+    }
+  }
+}
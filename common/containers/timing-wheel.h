@@ -0,0 +1,229 @@
+// Compiler for PHP (aka KPHP)
+// Copyright (c) 2020 LLC «V Kontakte»
+// Distributed under the GPL v3 License, see LICENSE.notice.txt
+
+#pragma once
+
+#include <cassert>
+#include <cstdint>
+#include <limits>
+
+namespace vk {
+
+// is embedded into a timer, so the wheel never allocates
+struct timing_wheel_node {
+  timing_wheel_node *prev;
+  timing_wheel_node *next;
+  int64_t expires;
+  // 0 if the node isn't in a wheel
+  int slot;
+};
+
+// A hierarchical timing wheel of intrusive timers: the insertion and the removal are O(1).
+// The time is measured in integer ticks; a timer expires when the wheel is advanced to its tick or later.
+// The far timers are kept in the higher levels with the coarser slots and are cascaded down as the time goes,
+// each timer is moved at most LEVELS times.
+class timing_wheel {
+public:
+  static constexpr int LEVEL_BITS = 6;
+  static constexpr int LEVEL_SIZE = 1 << LEVEL_BITS;
+  static constexpr int LEVELS = 5;
+  static constexpr int64_t NO_EVENT = std::numeric_limits<int64_t>::max();
+
+  explicit timing_wheel(int64_t now = 0) noexcept {
+    reset(now);
+  }
+
+  timing_wheel(const timing_wheel &) = delete;
+  timing_wheel &operator=(const timing_wheel &) = delete;
+
+  // forgets all the timers without touching them
+  void reset(int64_t now) noexcept {
+    for (auto &head : heads_) {
+      head.prev = head.next = &head;
+    }
+    for (auto &bits : occupied_) {
+      bits = 0;
+    }
+    now_ = now;
+    size_ = 0;
+  }
+
+  int64_t now() const noexcept {
+    return now_;
+  }
+
+  int size() const noexcept {
+    return size_;
+  }
+
+  // a timer with the tick not after now() expires at once; a node already in the wheel is moved
+  void insert(timing_wheel_node *node, int64_t expires) noexcept {
+    if (node->slot) {
+      unlink(node);
+    } else {
+      size_++;
+    }
+    node->expires = expires;
+    place(node);
+  }
+
+  void remove(timing_wheel_node *node) noexcept {
+    if (node->slot) {
+      unlink(node);
+      size_--;
+    }
+  }
+
+  // moves the timers with the ticks not after the given one to the expired list
+  void advance(int64_t now) noexcept {
+    while (now_ < now) {
+      const int64_t next = next_tick();
+      if (next > now) {
+        now_ = now;
+        break;
+      }
+      now_ = next;
+      process_tick();
+    }
+  }
+
+  // the expired timers stay in the wheel until they are removed
+  timing_wheel_node *first_expired() const noexcept {
+    const timing_wheel_node &head = heads_[EXPIRED_SLOT];
+    return head.next != &head ? head.next : nullptr;
+  }
+
+  // the tick the wheel has to be advanced to for the next timer to expire, or to be cascaded (then exact is false);
+  // now() if there are expired timers, NO_EVENT if the wheel is empty
+  int64_t next_event(bool *exact) const noexcept {
+    *exact = true;
+    if (first_expired()) {
+      return now_;
+    }
+    return next_tick(exact);
+  }
+
+  template<class F>
+  void for_each(F &&f) const noexcept {
+    for (int slot = 1; slot < SLOTS; slot++) {
+      const timing_wheel_node *head = &heads_[slot];
+      for (timing_wheel_node *node = head->next; node != head; node = node->next) {
+        f(node);
+      }
+    }
+  }
+
+private:
+  // the wheel slot of level l and index i is l * LEVEL_SIZE + i + 1
+  static constexpr int EXPIRED_SLOT = LEVELS * LEVEL_SIZE + 1;
+  // the timers after the current rotation of the highest level
+  static constexpr int OVERFLOW_SLOT = EXPIRED_SLOT + 1;
+  static constexpr int SLOTS = OVERFLOW_SLOT + 1;
+  static constexpr int WHEEL_BITS = LEVEL_BITS * LEVELS;
+
+  static int64_t level_mask(int level) noexcept {
+    return (int64_t{1} << (LEVEL_BITS * level)) - 1;
+  }
+
+  static int level_index(int64_t tick, int level) noexcept {
+    return static_cast<int>((tick >> (LEVEL_BITS * level)) & (LEVEL_SIZE - 1));
+  }
+
+  void link(timing_wheel_node *node, int slot) noexcept {
+    timing_wheel_node *head = &heads_[slot];
+    node->prev = head->prev;
+    node->next = head;
+    head->prev->next = node;
+    head->prev = node;
+    node->slot = slot;
+    if (slot < EXPIRED_SLOT) {
+      occupied_[(slot - 1) / LEVEL_SIZE] |= uint64_t{1} << ((slot - 1) % LEVEL_SIZE);
+    }
+  }
+
+  void unlink(timing_wheel_node *node) noexcept {
+    const int slot = node->slot;
+    assert(0 < slot && slot < SLOTS);
+    node->prev->next = node->next;
+    node->next->prev = node->prev;
+    node->prev = node->next = nullptr;
+    node->slot = 0;
+    const timing_wheel_node *head = &heads_[slot];
+    if (slot < EXPIRED_SLOT && head->next == head) {
+      occupied_[(slot - 1) / LEVEL_SIZE] &= ~(uint64_t{1} << ((slot - 1) % LEVEL_SIZE));
+    }
+  }
+
+  // a timer goes to the level of the highest bits group in which its tick differs from now,
+  // so the slot is always ahead of the current index of the level
+  void place(timing_wheel_node *node) noexcept {
+    const int64_t tick = node->expires;
+    if (tick <= now_) {
+      link(node, EXPIRED_SLOT);
+      return;
+    }
+    if ((tick >> WHEEL_BITS) != (now_ >> WHEEL_BITS)) {
+      link(node, OVERFLOW_SLOT);
+      return;
+    }
+    const int level = (63 - __builtin_clzll(static_cast<uint64_t>(tick ^ now_))) / LEVEL_BITS;
+    link(node, level * LEVEL_SIZE + level_index(tick, level) + 1);
+  }
+
+  void cascade(int slot) noexcept {
+    timing_wheel_node *head = &heads_[slot];
+    if (head->next == head) {
+      return;
+    }
+    timing_wheel_node *node = head->next;
+    head->prev->next = nullptr;
+    head->prev = head->next = head;
+    if (slot < EXPIRED_SLOT) {
+      occupied_[(slot - 1) / LEVEL_SIZE] &= ~(uint64_t{1} << ((slot - 1) % LEVEL_SIZE));
+    }
+    while (node) {
+      timing_wheel_node *next = node->next;
+      place(node);
+      node = next;
+    }
+  }
+
+  void process_tick() noexcept {
+    if ((now_ & level_mask(LEVELS)) == 0) {
+      cascade(OVERFLOW_SLOT);
+    }
+    for (int level = LEVELS - 1; level >= 0; level--) {
+      if ((now_ & level_mask(level)) == 0) {
+        cascade(level * LEVEL_SIZE + level_index(now_, level) + 1);
+      }
+    }
+  }
+
+  // the first tick after now at which a slot has to be processed
+  int64_t next_tick(bool *exact = nullptr) const noexcept {
+    for (int level = 0; level < LEVELS; level++) {
+      const int index = level_index(now_, level);
+      const uint64_t ahead = index == LEVEL_SIZE - 1 ? 0 : occupied_[level] & (~uint64_t{0} << (index + 1));
+      if (ahead) {
+        if (exact) {
+          *exact = level == 0;
+        }
+        const int64_t rotation_start = now_ & ~level_mask(level + 1);
+        return rotation_start | (static_cast<int64_t>(__builtin_ctzll(ahead)) << (LEVEL_BITS * level));
+      }
+    }
+    if (exact) {
+      *exact = false;
+    }
+    const timing_wheel_node &overflow = heads_[OVERFLOW_SLOT];
+    return overflow.next != &overflow ? (now_ | level_mask(LEVELS)) + 1 : NO_EVENT;
+  }
+
+  timing_wheel_node heads_[SLOTS];
+  uint64_t occupied_[LEVELS];
+  int64_t now_;
+  int size_;
+};
+
+} // namespace vk
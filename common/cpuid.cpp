@@ -16,6 +16,12 @@ const kdb_cpuid_t *kdb_cpuid() {
   }
   int a;
   asm volatile("cpuid\n\t" : "=a"(a), "=b"(cached.x86_64.ebx), "=c"(cached.x86_64.ecx), "=d"(cached.x86_64.edx) : "0"(1));
+  int max_leaf, b, c, d;
+  asm volatile("cpuid\n\t" : "=a"(max_leaf), "=b"(b), "=c"(c), "=d"(d) : "0"(0));
+  cached.x86_64.leaf7_ebx = 0;
+  if (max_leaf >= 7) {
+    asm volatile("cpuid\n\t" : "=a"(a), "=b"(cached.x86_64.leaf7_ebx), "=c"(c), "=d"(d) : "0"(7), "2"(0));
+  }
   cached.type = KDB_CPUID_X86_64;
 #elif defined(__aarch64__)
   if (cached.type) {
@@ -30,3 +36,21 @@ const kdb_cpuid_t *kdb_cpuid() {
 
   return &cached;
 }
+
+int kdb_cpuid_has_avx2(const kdb_cpuid_t *p) {
+#if defined(__x86_64__)
+  assert(p->type == KDB_CPUID_X86_64);
+  const int osxsave = p->x86_64.ecx & (1 << 27);
+  const int avx = p->x86_64.ecx & (1 << 28);
+  const int avx2 = p->x86_64.leaf7_ebx & (1 << 5);
+  if (!osxsave || !avx || !avx2) {
+    return 0;
+  }
+  unsigned int xcr0_lo, xcr0_hi;
+  asm volatile("xgetbv\n\t" : "=a"(xcr0_lo), "=d"(xcr0_hi) : "c"(0));
+  return (xcr0_lo & 6) == 6;
+#else
+  (void)p;
+  return 0;
+#endif
+}
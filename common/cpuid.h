@@ -13,10 +13,14 @@ typedef struct {
   union {
     struct {
       int ebx, ecx, edx;
+      // structured extended feature flags (leaf 7)
+      int leaf7_ebx;
     } x86_64;
   };
 } kdb_cpuid_t;
 
 const kdb_cpuid_t *kdb_cpuid ();
+// avx2 is supported by the cpu and the OS saves the ymm registers on context switches
+int kdb_cpuid_has_avx2 (const kdb_cpuid_t *p);
 
 #endif
@@ -0,0 +1,156 @@
+// Compiler for PHP (aka KPHP)
+// Copyright (c) 2020 LLC «V Kontakte»
+// Distributed under the GPL v3 License, see LICENSE.notice.txt
+
+#include "common/numeric-vector.h"
+
+#include <algorithm>
+#include <arm_neon.h>
+#include <cassert>
+
+#include "common/cpuid.h"
+
+namespace {
+
+constexpr size_t lanes = 2;
+
+bool any_lane(uint64x2_t mask) {
+  return vmaxvq_u32(vreinterpretq_u32_u64(mask)) != 0;
+}
+
+// min and max of the doubles equal to each other are the same values, except for -0.0 and 0.0,
+// the sequential loop keeps the first one of them
+double first_equal(const double *p, size_t n, double value) {
+  return value == 0.0 ? p[double_vector_find_neon(p, n, value)] : value;
+}
+
+} // namespace
+
+int64_t int64_vector_sum_neon(const int64_t *p, size_t n) {
+  int64x2_t sum_0 = vdupq_n_s64(0);
+  int64x2_t sum_1 = vdupq_n_s64(0);
+  size_t i = 0;
+  for (; i + 2 * lanes <= n; i += 2 * lanes) {
+    sum_0 = vaddq_s64(sum_0, vld1q_s64(p + i));
+    sum_1 = vaddq_s64(sum_1, vld1q_s64(p + i + lanes));
+  }
+  return static_cast<int64_t>(static_cast<uint64_t>(vaddvq_s64(vaddq_s64(sum_0, sum_1))) + static_cast<uint64_t>(int64_vector_sum_scalar(p + i, n - i)));
+}
+
+int64_t int64_vector_min_neon(const int64_t *p, size_t n) {
+  if (n < lanes) {
+    return int64_vector_min_scalar(p, n);
+  }
+  int64x2_t result = vld1q_s64(p);
+  size_t i = lanes;
+  for (; i + lanes <= n; i += lanes) {
+    const int64x2_t x = vld1q_s64(p + i);
+    result = vbslq_s64(vcgtq_s64(result, x), x, result);
+  }
+  const int64_t head = std::min(vgetq_lane_s64(result, 0), vgetq_lane_s64(result, 1));
+  return i == n ? head : std::min(head, int64_vector_min_scalar(p + i, n - i));
+}
+
+int64_t int64_vector_max_neon(const int64_t *p, size_t n) {
+  if (n < lanes) {
+    return int64_vector_max_scalar(p, n);
+  }
+  int64x2_t result = vld1q_s64(p);
+  size_t i = lanes;
+  for (; i + lanes <= n; i += lanes) {
+    const int64x2_t x = vld1q_s64(p + i);
+    result = vbslq_s64(vcgtq_s64(x, result), x, result);
+  }
+  const int64_t head = std::max(vgetq_lane_s64(result, 0), vgetq_lane_s64(result, 1));
+  return i == n ? head : std::max(head, int64_vector_max_scalar(p + i, n - i));
+}
+
+size_t int64_vector_find_neon(const int64_t *p, size_t n, int64_t value) {
+  const int64x2_t v = vdupq_n_s64(value);
+  size_t i = 0;
+  for (; i + 2 * lanes <= n; i += 2 * lanes) {
+    const uint64x2_t eq_0 = vceqq_s64(vld1q_s64(p + i), v);
+    const uint64x2_t eq_1 = vceqq_s64(vld1q_s64(p + i + lanes), v);
+    if (any_lane(vorrq_u64(eq_0, eq_1))) {
+      break;
+    }
+  }
+  return i + int64_vector_find_scalar(p + i, n - i, value);
+}
+
+double double_vector_min_neon(const double *p, size_t n) {
+  if (n < lanes) {
+    return double_vector_min_scalar(p, n);
+  }
+  float64x2_t result = vld1q_f64(p);
+  uint64x2_t ordered = vceqq_f64(result, result);
+  size_t i = lanes;
+  for (; i + lanes <= n; i += lanes) {
+    const float64x2_t x = vld1q_f64(p + i);
+    ordered = vandq_u64(ordered, vceqq_f64(x, x));
+    result = vminq_f64(result, x);
+  }
+  double head = vminvq_f64(result);
+  for (; i != n; ++i) {
+    if (p[i] < head || p[i] != p[i]) {
+      head = p[i];
+    }
+  }
+  // with a NaN the result depends on the order of the comparisons, repeat them one by one
+  if (vminvq_u32(vreinterpretq_u32_u64(ordered)) == 0 || head != head) {
+    return double_vector_min_scalar(p, n);
+  }
+  return first_equal(p, n, head);
+}
+
+double double_vector_max_neon(const double *p, size_t n) {
+  if (n < lanes) {
+    return double_vector_max_scalar(p, n);
+  }
+  float64x2_t result = vld1q_f64(p);
+  uint64x2_t ordered = vceqq_f64(result, result);
+  size_t i = lanes;
+  for (; i + lanes <= n; i += lanes) {
+    const float64x2_t x = vld1q_f64(p + i);
+    ordered = vandq_u64(ordered, vceqq_f64(x, x));
+    result = vmaxq_f64(result, x);
+  }
+  double head = vmaxvq_f64(result);
+  for (; i != n; ++i) {
+    if (head < p[i] || p[i] != p[i]) {
+      head = p[i];
+    }
+  }
+  if (vminvq_u32(vreinterpretq_u32_u64(ordered)) == 0 || head != head) {
+    return double_vector_max_scalar(p, n);
+  }
+  return first_equal(p, n, head);
+}
+
+size_t double_vector_find_neon(const double *p, size_t n, double value) {
+  const float64x2_t v = vdupq_n_f64(value);
+  size_t i = 0;
+  for (; i + 2 * lanes <= n; i += 2 * lanes) {
+    const uint64x2_t eq_0 = vceqq_f64(vld1q_f64(p + i), v);
+    const uint64x2_t eq_1 = vceqq_f64(vld1q_f64(p + i + lanes), v);
+    if (any_lane(vorrq_u64(eq_0, eq_1))) {
+      break;
+    }
+  }
+  return i + double_vector_find_scalar(p + i, n - i, value);
+}
+
+void numeric_vector_init() __attribute__ ((constructor(101)));
+void numeric_vector_init() {
+  const kdb_cpuid_t *p = kdb_cpuid();
+  assert(p->type == KDB_CPUID_AARCH64);
+
+  // advanced SIMD is mandatory for armv8-a
+  int64_vector_sum = int64_vector_sum_neon;
+  int64_vector_min = int64_vector_min_neon;
+  int64_vector_max = int64_vector_max_neon;
+  int64_vector_find = int64_vector_find_neon;
+  double_vector_min = double_vector_min_neon;
+  double_vector_max = double_vector_max_neon;
+  double_vector_find = double_vector_find_neon;
+}
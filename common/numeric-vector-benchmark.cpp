@@ -0,0 +1,74 @@
+// Compiler for PHP (aka KPHP)
+// Copyright (c) 2020 LLC «V Kontakte»
+// Distributed under the GPL v3 License, see LICENSE.notice.txt
+
+#include <benchmark/benchmark.h>
+
+#include <random>
+#include <vector>
+
+#include "common/numeric-vector.h"
+
+namespace {
+
+template<class T>
+std::vector<T> make_values(size_t n) {
+  std::mt19937_64 gen{42};
+  std::vector<T> values(n);
+  for (auto &value : values) {
+    value = static_cast<T>(gen() % 1000000);
+  }
+  return values;
+}
+
+template<class T, class F>
+void run_reduce_benchmark(benchmark::State &state, F &&func) {
+  const auto values = make_values<T>(state.range(0));
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(func(values.data(), values.size()));
+  }
+  state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * values.size()));
+}
+
+// the value is missing, so the whole vector is scanned
+template<class T, class F>
+void run_find_benchmark(benchmark::State &state, F &&func) {
+  const auto values = make_values<T>(state.range(0));
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(func(values.data(), values.size(), static_cast<T>(-1)));
+  }
+  state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * values.size()));
+}
+
+} // namespace
+
+#define NUMERIC_VECTOR_BENCHMARKS(suffix)                                                                          \
+  static void BM_int64_vector_sum##suffix(benchmark::State &state) {                                              \
+    run_reduce_benchmark<int64_t>(state, int64_vector_sum##suffix);                                               \
+  }                                                                                                               \
+  BENCHMARK(BM_int64_vector_sum##suffix)->Range(16, 1 << 16);                                                     \
+  static void BM_int64_vector_max##suffix(benchmark::State &state) {                                              \
+    run_reduce_benchmark<int64_t>(state, int64_vector_max##suffix);                                               \
+  }                                                                                                               \
+  BENCHMARK(BM_int64_vector_max##suffix)->Range(16, 1 << 16);                                                     \
+  static void BM_int64_vector_find##suffix(benchmark::State &state) {                                             \
+    run_find_benchmark<int64_t>(state, int64_vector_find##suffix);                                               \
+  }                                                                                                               \
+  BENCHMARK(BM_int64_vector_find##suffix)->Range(16, 1 << 16);                                                    \
+  static void BM_double_vector_max##suffix(benchmark::State &state) {                                             \
+    run_reduce_benchmark<double>(state, double_vector_max##suffix);                                               \
+  }                                                                                                               \
+  BENCHMARK(BM_double_vector_max##suffix)->Range(16, 1 << 16);                                                    \
+  static void BM_double_vector_find##suffix(benchmark::State &state) {                                            \
+    run_find_benchmark<double>(state, double_vector_find##suffix);                                                \
+  }                                                                                                               \
+  BENCHMARK(BM_double_vector_find##suffix)->Range(16, 1 << 16);
+
+NUMERIC_VECTOR_BENCHMARKS(_scalar)
+#if defined(__x86_64__)
+NUMERIC_VECTOR_BENCHMARKS(_avx2)
+#elif defined(__aarch64__)
+NUMERIC_VECTOR_BENCHMARKS(_neon)
+#endif
+
+BENCHMARK_MAIN();
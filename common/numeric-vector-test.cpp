@@ -0,0 +1,108 @@
+// Compiler for PHP (aka KPHP)
+// Copyright (c) 2020 LLC «V Kontakte»
+// Distributed under the GPL v3 License, see LICENSE.notice.txt
+
+#include "common/numeric-vector.h"
+
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <random>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+namespace {
+
+struct implementation {
+  numeric_vector_reduce_func_t<int64_t> int64_sum;
+  numeric_vector_reduce_func_t<int64_t> int64_min;
+  numeric_vector_reduce_func_t<int64_t> int64_max;
+  numeric_vector_find_func_t<int64_t> int64_find;
+  numeric_vector_reduce_func_t<double> double_min;
+  numeric_vector_reduce_func_t<double> double_max;
+  numeric_vector_find_func_t<double> double_find;
+};
+
+std::vector<implementation> available_implementations() {
+  std::vector<implementation> result{
+    {int64_vector_sum, int64_vector_min, int64_vector_max, int64_vector_find, double_vector_min, double_vector_max, double_vector_find}
+  };
+#if defined(__x86_64__)
+  if (__builtin_cpu_supports("avx2")) {
+    result.push_back({int64_vector_sum_avx2, int64_vector_min_avx2, int64_vector_max_avx2, int64_vector_find_avx2,
+                      double_vector_min_avx2, double_vector_max_avx2, double_vector_find_avx2});
+  }
+#elif defined(__aarch64__)
+  result.push_back({int64_vector_sum_neon, int64_vector_min_neon, int64_vector_max_neon, int64_vector_find_neon,
+                    double_vector_min_neon, double_vector_max_neon, double_vector_find_neon});
+#endif
+  return result;
+}
+
+bool same_bits(double lhs, double rhs) {
+  return std::memcmp(&lhs, &rhs, sizeof(double)) == 0;
+}
+
+} // namespace
+
+TEST(numeric_vector, int64_kernels) {
+  std::mt19937_64 gen{1};
+  std::vector<int64_t> values(300);
+  for (auto &value : values) {
+    // few distinct values for the find and the extremes for the sum overflow
+    value = gen() % 4 ? static_cast<int64_t>(gen() % 50) - 25 : static_cast<int64_t>(gen());
+  }
+  for (const auto &impl : available_implementations()) {
+    for (size_t n = 0; n <= values.size(); ++n) {
+      ASSERT_EQ(impl.int64_sum(values.data(), n), int64_vector_sum_scalar(values.data(), n)) << n;
+      if (n) {
+        ASSERT_EQ(impl.int64_min(values.data(), n), int64_vector_min_scalar(values.data(), n)) << n;
+        ASSERT_EQ(impl.int64_max(values.data(), n), int64_vector_max_scalar(values.data(), n)) << n;
+      }
+      for (int64_t value = -26; value <= 26; ++value) {
+        ASSERT_EQ(impl.int64_find(values.data(), n, value), int64_vector_find_scalar(values.data(), n, value)) << n << " " << value;
+      }
+    }
+  }
+}
+
+TEST(numeric_vector, int64_sum_wraps_around) {
+  // 10 * (2^63 - 1) = -10 (mod 2^64)
+  const std::vector<int64_t> values(10, std::numeric_limits<int64_t>::max());
+  for (const auto &impl : available_implementations()) {
+    ASSERT_EQ(impl.int64_sum(values.data(), values.size()), -10);
+  }
+}
+
+TEST(numeric_vector, double_kernels) {
+  const double nan = std::numeric_limits<double>::quiet_NaN();
+  const double inf = std::numeric_limits<double>::infinity();
+  const double specials[] = {0.0, -0.0, nan, inf, -inf, 1.5, -1.5};
+
+  std::mt19937_64 gen{2};
+  for (const auto &impl : available_implementations()) {
+    for (size_t n = 1; n <= 40; ++n) {
+      for (int round = 0; round != 50; ++round) {
+        std::vector<double> values(n);
+        for (auto &value : values) {
+          value = gen() % 3 ? specials[gen() % (round % 5 ? 2 : 7)] : static_cast<double>(gen() % 7) - 3;
+        }
+        ASSERT_TRUE(same_bits(impl.double_min(values.data(), n), double_vector_min_scalar(values.data(), n))) << n << " " << round;
+        ASSERT_TRUE(same_bits(impl.double_max(values.data(), n), double_vector_max_scalar(values.data(), n))) << n << " " << round;
+        for (double value : specials) {
+          ASSERT_EQ(impl.double_find(values.data(), n, value), double_vector_find_scalar(values.data(), n, value)) << n << " " << round;
+        }
+      }
+    }
+  }
+}
+
+TEST(numeric_vector, double_min_max_keep_first_zero) {
+  const std::vector<double> values{1.0, 0.0, 2.0, 3.0, -0.0, 4.0, 5.0, 6.0, 7.0};
+  for (const auto &impl : available_implementations()) {
+    ASSERT_FALSE(std::signbit(impl.double_min(values.data(), values.size())));
+    ASSERT_FALSE(std::signbit(impl.double_min(values.data() + 1, values.size() - 1)));
+    ASSERT_TRUE(std::signbit(impl.double_min(values.data() + 2, values.size() - 2)));
+  }
+}
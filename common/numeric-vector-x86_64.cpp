@@ -0,0 +1,196 @@
+// Compiler for PHP (aka KPHP)
+// Copyright (c) 2020 LLC «V Kontakte»
+// Distributed under the GPL v3 License, see LICENSE.notice.txt
+
+#include "common/numeric-vector.h"
+
+#include <algorithm>
+#include <cassert>
+#include <immintrin.h>
+
+#include "common/cpuid.h"
+
+namespace {
+
+constexpr size_t lanes = 4;
+
+template<class T>
+__attribute__((target("avx2")))
+T horizontal_select(__m256i v, bool (*better)(T, T)) {
+  alignas(32) T values[lanes];
+  _mm256_store_si256(reinterpret_cast<__m256i *>(values), v);
+  T result = values[0];
+  for (size_t i = 1; i != lanes; ++i) {
+    if (better(values[i], result)) {
+      result = values[i];
+    }
+  }
+  return result;
+}
+
+bool int64_less(int64_t lhs, int64_t rhs) {
+  return lhs < rhs;
+}
+
+bool int64_greater(int64_t lhs, int64_t rhs) {
+  return rhs < lhs;
+}
+
+bool double_less(double lhs, double rhs) {
+  return lhs < rhs;
+}
+
+bool double_greater(double lhs, double rhs) {
+  return rhs < lhs;
+}
+
+// min and max of the doubles equal to each other are the same values, except for -0.0 and 0.0,
+// the sequential loop keeps the first one of them
+double first_equal(const double *p, size_t n, double value) {
+  return value == 0.0 ? p[double_vector_find_avx2(p, n, value)] : value;
+}
+
+} // namespace
+
+__attribute__((target("avx2")))
+int64_t int64_vector_sum_avx2(const int64_t *p, size_t n) {
+  __m256i sum_0 = _mm256_setzero_si256();
+  __m256i sum_1 = _mm256_setzero_si256();
+  size_t i = 0;
+  for (; i + 2 * lanes <= n; i += 2 * lanes) {
+    sum_0 = _mm256_add_epi64(sum_0, _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p + i)));
+    sum_1 = _mm256_add_epi64(sum_1, _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p + i + lanes)));
+  }
+  const __m256i sum_256 = _mm256_add_epi64(sum_0, sum_1);
+  const __m128i sum = _mm_add_epi64(_mm256_castsi256_si128(sum_256), _mm256_extracti128_si256(sum_256, 1));
+  return static_cast<int64_t>(static_cast<uint64_t>(_mm_cvtsi128_si64(sum)) + static_cast<uint64_t>(_mm_extract_epi64(sum, 1)) +
+                              static_cast<uint64_t>(int64_vector_sum_scalar(p + i, n - i)));
+}
+
+__attribute__((target("avx2")))
+int64_t int64_vector_min_avx2(const int64_t *p, size_t n) {
+  if (n < lanes) {
+    return int64_vector_min_scalar(p, n);
+  }
+  __m256i result = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+  size_t i = lanes;
+  for (; i + lanes <= n; i += lanes) {
+    const __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p + i));
+    result = _mm256_blendv_epi8(result, x, _mm256_cmpgt_epi64(result, x));
+  }
+  const int64_t head = horizontal_select<int64_t>(result, int64_less);
+  return i == n ? head : std::min(head, int64_vector_min_scalar(p + i, n - i));
+}
+
+__attribute__((target("avx2")))
+int64_t int64_vector_max_avx2(const int64_t *p, size_t n) {
+  if (n < lanes) {
+    return int64_vector_max_scalar(p, n);
+  }
+  __m256i result = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+  size_t i = lanes;
+  for (; i + lanes <= n; i += lanes) {
+    const __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p + i));
+    result = _mm256_blendv_epi8(result, x, _mm256_cmpgt_epi64(x, result));
+  }
+  const int64_t head = horizontal_select<int64_t>(result, int64_greater);
+  return i == n ? head : std::max(head, int64_vector_max_scalar(p + i, n - i));
+}
+
+__attribute__((target("avx2")))
+size_t int64_vector_find_avx2(const int64_t *p, size_t n, int64_t value) {
+  const __m256i v = _mm256_set1_epi64x(value);
+  size_t i = 0;
+  for (; i + 2 * lanes <= n; i += 2 * lanes) {
+    const __m256i eq_0 = _mm256_cmpeq_epi64(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(p + i)), v);
+    const __m256i eq_1 = _mm256_cmpeq_epi64(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(p + i + lanes)), v);
+    if (const int mask = _mm256_movemask_pd(_mm256_castsi256_pd(_mm256_or_si256(eq_0, eq_1)))) {
+      const int mask_0 = _mm256_movemask_pd(_mm256_castsi256_pd(eq_0));
+      return i + (mask_0 ? __builtin_ctz(mask_0) : lanes + __builtin_ctz(mask));
+    }
+  }
+  return i + int64_vector_find_scalar(p + i, n - i, value);
+}
+
+__attribute__((target("avx2")))
+double double_vector_min_avx2(const double *p, size_t n) {
+  if (n < lanes) {
+    return double_vector_min_scalar(p, n);
+  }
+  __m256d result = _mm256_loadu_pd(p);
+  __m256d nan = _mm256_cmp_pd(result, result, _CMP_UNORD_Q);
+  size_t i = lanes;
+  for (; i + lanes <= n; i += lanes) {
+    const __m256d x = _mm256_loadu_pd(p + i);
+    nan = _mm256_or_pd(nan, _mm256_cmp_pd(x, x, _CMP_UNORD_Q));
+    result = _mm256_min_pd(result, x);
+  }
+  double head = horizontal_select<double>(_mm256_castpd_si256(result), double_less);
+  for (; i != n; ++i) {
+    if (p[i] < head || p[i] != p[i]) {
+      head = p[i];
+    }
+  }
+  // with a NaN the result depends on the order of the comparisons, repeat them one by one
+  if (_mm256_movemask_pd(nan) || head != head) {
+    return double_vector_min_scalar(p, n);
+  }
+  return first_equal(p, n, head);
+}
+
+__attribute__((target("avx2")))
+double double_vector_max_avx2(const double *p, size_t n) {
+  if (n < lanes) {
+    return double_vector_max_scalar(p, n);
+  }
+  __m256d result = _mm256_loadu_pd(p);
+  __m256d nan = _mm256_cmp_pd(result, result, _CMP_UNORD_Q);
+  size_t i = lanes;
+  for (; i + lanes <= n; i += lanes) {
+    const __m256d x = _mm256_loadu_pd(p + i);
+    nan = _mm256_or_pd(nan, _mm256_cmp_pd(x, x, _CMP_UNORD_Q));
+    result = _mm256_max_pd(result, x);
+  }
+  double head = horizontal_select<double>(_mm256_castpd_si256(result), double_greater);
+  for (; i != n; ++i) {
+    if (head < p[i] || p[i] != p[i]) {
+      head = p[i];
+    }
+  }
+  if (_mm256_movemask_pd(nan) || head != head) {
+    return double_vector_max_scalar(p, n);
+  }
+  return first_equal(p, n, head);
+}
+
+__attribute__((target("avx2")))
+size_t double_vector_find_avx2(const double *p, size_t n, double value) {
+  const __m256d v = _mm256_set1_pd(value);
+  size_t i = 0;
+  for (; i + 2 * lanes <= n; i += 2 * lanes) {
+    const __m256d eq_0 = _mm256_cmp_pd(_mm256_loadu_pd(p + i), v, _CMP_EQ_OQ);
+    const __m256d eq_1 = _mm256_cmp_pd(_mm256_loadu_pd(p + i + lanes), v, _CMP_EQ_OQ);
+    if (const int mask = _mm256_movemask_pd(_mm256_or_pd(eq_0, eq_1))) {
+      const int mask_0 = _mm256_movemask_pd(eq_0);
+      return i + (mask_0 ? __builtin_ctz(mask_0) : lanes + __builtin_ctz(mask));
+    }
+  }
+  return i + double_vector_find_scalar(p + i, n - i, value);
+}
+
+void numeric_vector_init() __attribute__ ((constructor(101)));
+void numeric_vector_init() {
+  const kdb_cpuid_t *p = kdb_cpuid();
+  assert(p->type == KDB_CPUID_X86_64);
+
+  // the baseline sse4.2 build handles the scalar loops well enough, only the 256-bit versions pay off
+  if (kdb_cpuid_has_avx2(p)) {
+    int64_vector_sum = int64_vector_sum_avx2;
+    int64_vector_min = int64_vector_min_avx2;
+    int64_vector_max = int64_vector_max_avx2;
+    int64_vector_find = int64_vector_find_avx2;
+    double_vector_min = double_vector_min_avx2;
+    double_vector_max = double_vector_max_avx2;
+    double_vector_find = double_vector_find_avx2;
+  }
+}
@@ -0,0 +1,79 @@
+// Compiler for PHP (aka KPHP)
+// Copyright (c) 2020 LLC «V Kontakte»
+// Distributed under the GPL v3 License, see LICENSE.notice.txt
+
+#include "common/numeric-vector.h"
+
+// constant initialized, so they are safe to use from any static constructor;
+// numeric-vector-${HOST}.cpp replaces them with the best available implementations
+numeric_vector_reduce_func_t<int64_t> int64_vector_sum = int64_vector_sum_scalar;
+numeric_vector_reduce_func_t<int64_t> int64_vector_min = int64_vector_min_scalar;
+numeric_vector_reduce_func_t<int64_t> int64_vector_max = int64_vector_max_scalar;
+numeric_vector_find_func_t<int64_t> int64_vector_find = int64_vector_find_scalar;
+numeric_vector_reduce_func_t<double> double_vector_min = double_vector_min_scalar;
+numeric_vector_reduce_func_t<double> double_vector_max = double_vector_max_scalar;
+numeric_vector_find_func_t<double> double_vector_find = double_vector_find_scalar;
+
+int64_t int64_vector_sum_scalar(const int64_t *p, size_t n) {
+  uint64_t sum = 0;
+  for (size_t i = 0; i != n; ++i) {
+    sum += static_cast<uint64_t>(p[i]);
+  }
+  return static_cast<int64_t>(sum);
+}
+
+int64_t int64_vector_min_scalar(const int64_t *p, size_t n) {
+  int64_t result = p[0];
+  for (size_t i = 1; i != n; ++i) {
+    if (p[i] < result) {
+      result = p[i];
+    }
+  }
+  return result;
+}
+
+int64_t int64_vector_max_scalar(const int64_t *p, size_t n) {
+  int64_t result = p[0];
+  for (size_t i = 1; i != n; ++i) {
+    if (result < p[i]) {
+      result = p[i];
+    }
+  }
+  return result;
+}
+
+size_t int64_vector_find_scalar(const int64_t *p, size_t n, int64_t value) {
+  size_t i = 0;
+  while (i != n && p[i] != value) {
+    ++i;
+  }
+  return i;
+}
+
+double double_vector_min_scalar(const double *p, size_t n) {
+  double result = p[0];
+  for (size_t i = 1; i != n; ++i) {
+    if (p[i] < result) {
+      result = p[i];
+    }
+  }
+  return result;
+}
+
+double double_vector_max_scalar(const double *p, size_t n) {
+  double result = p[0];
+  for (size_t i = 1; i != n; ++i) {
+    if (result < p[i]) {
+      result = p[i];
+    }
+  }
+  return result;
+}
+
+size_t double_vector_find_scalar(const double *p, size_t n, double value) {
+  size_t i = 0;
+  while (i != n && p[i] != value) {
+    ++i;
+  }
+  return i;
+}
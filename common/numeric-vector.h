@@ -0,0 +1,56 @@
+// Compiler for PHP (aka KPHP)
+// Copyright (c) 2020 LLC «V Kontakte»
+// Distributed under the GPL v3 License, see LICENSE.notice.txt
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Kernels over the element buffers of array<int64_t> and array<double> vectors (see runtime/array_functions.h).
+// Each of them returns exactly what the plain loop over the elements in the index order does,
+// so the SIMD implementations may be used without any change of the PHP semantics:
+// the integer sum wraps around, min/max return the first of the equal elements (it matters for -0.0 and 0.0),
+// a NaN makes the double min/max fall back to the ordered comparisons.
+
+template<class T>
+using numeric_vector_reduce_func_t = T (*)(const T *p, size_t n);
+// returns the index of the first element equal to value or n
+template<class T>
+using numeric_vector_find_func_t = size_t (*)(const T *p, size_t n, T value);
+
+// the best implementations for the current cpu, chosen on startup; min/max require n > 0
+extern numeric_vector_reduce_func_t<int64_t> int64_vector_sum;
+extern numeric_vector_reduce_func_t<int64_t> int64_vector_min;
+extern numeric_vector_reduce_func_t<int64_t> int64_vector_max;
+extern numeric_vector_find_func_t<int64_t> int64_vector_find;
+extern numeric_vector_reduce_func_t<double> double_vector_min;
+extern numeric_vector_reduce_func_t<double> double_vector_max;
+extern numeric_vector_find_func_t<double> double_vector_find;
+
+// the reference element by element implementations
+int64_t int64_vector_sum_scalar(const int64_t *p, size_t n);
+int64_t int64_vector_min_scalar(const int64_t *p, size_t n);
+int64_t int64_vector_max_scalar(const int64_t *p, size_t n);
+size_t int64_vector_find_scalar(const int64_t *p, size_t n, int64_t value);
+double double_vector_min_scalar(const double *p, size_t n);
+double double_vector_max_scalar(const double *p, size_t n);
+size_t double_vector_find_scalar(const double *p, size_t n, double value);
+
+#if defined(__x86_64__)
+int64_t int64_vector_sum_avx2(const int64_t *p, size_t n);
+int64_t int64_vector_min_avx2(const int64_t *p, size_t n);
+int64_t int64_vector_max_avx2(const int64_t *p, size_t n);
+size_t int64_vector_find_avx2(const int64_t *p, size_t n, int64_t value);
+double double_vector_min_avx2(const double *p, size_t n);
+double double_vector_max_avx2(const double *p, size_t n);
+size_t double_vector_find_avx2(const double *p, size_t n, double value);
+#elif defined(__aarch64__)
+int64_t int64_vector_sum_neon(const int64_t *p, size_t n);
+int64_t int64_vector_min_neon(const int64_t *p, size_t n);
+int64_t int64_vector_max_neon(const int64_t *p, size_t n);
+size_t int64_vector_find_neon(const int64_t *p, size_t n, int64_t value);
+double double_vector_min_neon(const double *p, size_t n);
+double double_vector_max_neon(const double *p, size_t n);
+size_t double_vector_find_neon(const double *p, size_t n, double value);
+#endif
@@ -10,6 +10,7 @@
 #include <type_traits>
 
 #include "common/sanitizer.h"
+#include "common/string-hash.h"
 
 constexpr int STRLEN_WARNING_FLAG = 1 << 30;
 constexpr int STRLEN_OBJECT = -3;
@@ -71,18 +72,22 @@ private:
 inline int64_t string_hash(const char *p, size_t l) __attribute__ ((always_inline)) ubsan_supp("alignment");
 
 int64_t string_hash(const char *p, size_t l) {
-  constexpr uint64_t HASH_MUL = 1915239017;
-  uint64_t hash = 2147483648U;
+  uint64_t hash = STRING_HASH_INIT;
 
   size_t prev = (l & 3);
   for (size_t i = 0; i < prev; i++) {
-    hash = hash * HASH_MUL + p[i];
+    hash = hash * STRING_HASH_MUL + p[i];
   }
 
-  const auto *p_uint = reinterpret_cast<const uint32_t *>(p + prev);
   l >>= 2;
-  while (l-- > 0) {
-    hash = hash * HASH_MUL + *p_uint++;
+  if (l >= STRING_HASH_DISPATCH_MIN_WORDS) {
+    // long keys (urls, confdata names, etc.) go to the vectorized implementation, see common/string-hash.h
+    hash = string_hash_words(hash, p + prev, l);
+  } else {
+    const auto *p_uint = reinterpret_cast<const uint32_t *>(p + prev);
+    while (l-- > 0) {
+      hash = hash * STRING_HASH_MUL + *p_uint++;
+    }
   }
   const auto result = static_cast<int64_t>(hash);
   // to ensure that there is no way to get the -9223372036854775808L during code generation
@@ -189,11 +194,11 @@ bool php_try_to_int(const char *s, size_t l, int64_t *val) {
 
 //returns len of raw string representation or -1 on error
 inline int string_raw_len(int src_len) {
-  if (src_len < 0 || src_len >= (1 << 30) - 13) {
+  if (src_len < 0 || src_len >= (1 << 30) - 21) {
     return -1;
   }
 
-  return src_len + 13;
+  return src_len + 21;
 }
 
 //returns len of raw string representation and writes it to dest or returns -1 on error
@@ -206,8 +211,12 @@ inline int string_raw(char *dest, int dest_len, const char *src, int src_len) {
   dest_int[0] = src_len;
   dest_int[1] = src_len;
   dest_int[2] = ExtraRefCnt::for_global_const;
-  memcpy(dest + 3 * sizeof(int), src, src_len);
-  dest[3 * sizeof(int) + src_len] = '\0';
+  // the precomputed hash, constant strings are read only and can't memoize it at runtime
+  const int64_t hash = string_hash(src, src_len);
+  memcpy(dest + 3 * sizeof(int), &hash, sizeof(hash));
+  const int header_len = 3 * sizeof(int) + sizeof(hash);
+  memcpy(dest + header_len, src, src_len);
+  dest[header_len + src_len] = '\0';
 
   return raw_len;
 }
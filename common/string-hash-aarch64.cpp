@@ -0,0 +1,60 @@
+// Compiler for PHP (aka KPHP)
+// Copyright (c) 2020 LLC «V Kontakte»
+// Distributed under the GPL v3 License, see LICENSE.notice.txt
+
+#include "common/string-hash.h"
+
+#include <arm_neon.h>
+#include <cassert>
+
+#include "common/cpuid.h"
+
+namespace {
+
+template<size_t Shift, size_t... I>
+constexpr std::array<uint32_t, sizeof...(I)> make_powers_part(std::index_sequence<I...>) {
+  return {{static_cast<uint32_t>(string_hash_block_powers[I] >> Shift)...}};
+}
+
+alignas(16) constexpr auto powers_lo = make_powers_part<0>(std::make_index_sequence<STRING_HASH_BLOCK_WORDS>{});
+alignas(16) constexpr auto powers_hi = make_powers_part<32>(std::make_index_sequence<STRING_HASH_BLOCK_WORDS>{});
+
+} // namespace
+
+// word * power = word * power_lo + ((word * power_hi) << 32)  (mod 2^64),
+// both parts are accumulated with the widening multiply-add, the shift is applied once per block
+uint64_t string_hash_words_neon(uint64_t hash, const char *p, size_t words_count) {
+  constexpr size_t lanes = 4;
+  constexpr size_t vectors_per_block = STRING_HASH_BLOCK_WORDS / lanes;
+
+  uint32x4_t vpowers_lo[vectors_per_block];
+  uint32x4_t vpowers_hi[vectors_per_block];
+  for (size_t i = 0; i < vectors_per_block; ++i) {
+    vpowers_lo[i] = vld1q_u32(&powers_lo[i * lanes]);
+    vpowers_hi[i] = vld1q_u32(&powers_hi[i * lanes]);
+  }
+
+  for (; words_count >= STRING_HASH_BLOCK_WORDS; words_count -= STRING_HASH_BLOCK_WORDS) {
+    uint64x2_t sum_lo = vdupq_n_u64(0);
+    uint64x2_t sum_hi = vdupq_n_u64(0);
+    for (size_t i = 0; i < vectors_per_block; ++i, p += lanes * sizeof(uint32_t)) {
+      const uint32x4_t words = vreinterpretq_u32_u8(vld1q_u8(reinterpret_cast<const uint8_t *>(p)));
+      sum_lo = vmlal_u32(sum_lo, vget_low_u32(words), vget_low_u32(vpowers_lo[i]));
+      sum_lo = vmlal_high_u32(sum_lo, words, vpowers_lo[i]);
+      sum_hi = vmlal_u32(sum_hi, vget_low_u32(words), vget_low_u32(vpowers_hi[i]));
+      sum_hi = vmlal_high_u32(sum_hi, words, vpowers_hi[i]);
+    }
+    const uint64_t block_sum = vaddvq_u64(vaddq_u64(sum_lo, vshlq_n_u64(sum_hi, 32)));
+    hash = hash * STRING_HASH_BLOCK_MUL + block_sum;
+  }
+  return string_hash_words_scalar(hash, p, words_count);
+}
+
+void string_hash_init() __attribute__ ((constructor(101)));
+void string_hash_init() {
+  const kdb_cpuid_t *p = kdb_cpuid();
+  assert(p->type == KDB_CPUID_AARCH64);
+
+  // advanced SIMD is mandatory for armv8-a
+  string_hash_words = string_hash_words_neon;
+}
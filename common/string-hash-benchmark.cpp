@@ -0,0 +1,101 @@
+// Compiler for PHP (aka KPHP)
+// Copyright (c) 2020 LLC «V Kontakte»
+// Distributed under the GPL v3 License, see LICENSE.notice.txt
+
+#include <benchmark/benchmark.h>
+
+#include <random>
+#include <string>
+#include <vector>
+
+#include "common/php-functions.h"
+#include "common/string-hash.h"
+
+namespace {
+
+// keys with lengths uniformly distributed in [min_len, max_len]
+std::vector<std::string> make_keys(size_t min_len, size_t max_len) {
+  std::mt19937 gen{42};
+  std::uniform_int_distribution<size_t> len_dist{min_len, max_len};
+  std::uniform_int_distribution<int> char_dist{'0', 'z'};
+  std::vector<std::string> keys(1024);
+  for (auto &key : keys) {
+    key.resize(len_dist(gen));
+    for (char &c : key) {
+      c = static_cast<char>(char_dist(gen));
+    }
+  }
+  return keys;
+}
+
+template<class F>
+void run_hash_benchmark(benchmark::State &state, F &&hash_func) {
+  const auto keys = make_keys(state.range(0), state.range(1));
+  size_t bytes = 0;
+  for (const auto &key : keys) {
+    bytes += key.size();
+  }
+  for (auto _ : state) {
+    for (const auto &key : keys) {
+      benchmark::DoNotOptimize(hash_func(key.data(), key.size()));
+    }
+  }
+  state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * bytes));
+  state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * keys.size()));
+}
+
+template<string_hash_words_func_t words_func>
+int64_t string_hash_with(const char *p, size_t l) {
+  uint64_t hash = STRING_HASH_INIT;
+  const size_t prev = (l & 3);
+  for (size_t i = 0; i < prev; i++) {
+    hash = hash * STRING_HASH_MUL + p[i];
+  }
+  return static_cast<int64_t>(words_func(hash, p + prev, l >> 2));
+}
+
+// {min_len, max_len}: short array keys, identifiers, confdata names, urls, long blobs
+void key_lengths(benchmark::internal::Benchmark *b) {
+  b->Args({2, 16})->Args({8, 40})->Args({24, 96})->Args({48, 256})->Args({1024, 4096});
+}
+
+} // namespace
+
+static void BM_string_hash_scalar(benchmark::State &state) {
+  run_hash_benchmark(state, string_hash_with<string_hash_words_scalar>);
+}
+BENCHMARK(BM_string_hash_scalar)->Apply(key_lengths);
+
+static void BM_string_hash_unrolled(benchmark::State &state) {
+  run_hash_benchmark(state, string_hash_with<string_hash_words_unrolled>);
+}
+BENCHMARK(BM_string_hash_unrolled)->Apply(key_lengths);
+
+#if defined(__x86_64__)
+static void BM_string_hash_sse42(benchmark::State &state) {
+  run_hash_benchmark(state, string_hash_with<string_hash_words_sse42>);
+}
+BENCHMARK(BM_string_hash_sse42)->Apply(key_lengths);
+
+static void BM_string_hash_avx2(benchmark::State &state) {
+  if (!__builtin_cpu_supports("avx2")) {
+    state.SkipWithError("avx2 is not supported");
+    return;
+  }
+  run_hash_benchmark(state, string_hash_with<string_hash_words_avx2>);
+}
+BENCHMARK(BM_string_hash_avx2)->Apply(key_lengths);
+#elif defined(__aarch64__)
+static void BM_string_hash_neon(benchmark::State &state) {
+  run_hash_benchmark(state, string_hash_with<string_hash_words_neon>);
+}
+BENCHMARK(BM_string_hash_neon)->Apply(key_lengths);
+#endif
+
+// what array<T> actually calls: inline chain for short keys, dispatched implementation for long ones
+static void BM_string_hash(benchmark::State &state) {
+  run_hash_benchmark(state, string_hash);
+}
+BENCHMARK(BM_string_hash)->Apply(key_lengths);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,90 @@
+// Compiler for PHP (aka KPHP)
+// Copyright (c) 2020 LLC «V Kontakte»
+// Distributed under the GPL v3 License, see LICENSE.notice.txt
+
+#include "common/string-hash.h"
+
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "common/php-functions.h"
+
+namespace {
+
+// the original string_hash() implementation
+int64_t reference_string_hash(const char *p, size_t l) {
+  uint64_t hash = 2147483648U;
+  size_t prev = (l & 3);
+  for (size_t i = 0; i < prev; i++) {
+    hash = hash * 1915239017 + p[i];
+  }
+  for (p += prev, l >>= 2; l; --l, p += 4) {
+    uint32_t word;
+    std::memcpy(&word, p, sizeof(word));
+    hash = hash * 1915239017 + word;
+  }
+  const auto result = static_cast<int64_t>(hash);
+  return (result != std::numeric_limits<int64_t>::min()) * result;
+}
+
+std::vector<char> random_buffer(size_t size) {
+  std::mt19937 gen{123};
+  std::uniform_int_distribution<int> dist{0, 255};
+  std::vector<char> result(size);
+  for (char &c : result) {
+    c = static_cast<char>(dist(gen));
+  }
+  return result;
+}
+
+std::vector<string_hash_words_func_t> available_implementations() {
+  std::vector<string_hash_words_func_t> result{string_hash_words_scalar, string_hash_words_unrolled, string_hash_words};
+#if defined(__x86_64__)
+  if (__builtin_cpu_supports("sse4.2")) {
+    result.emplace_back(string_hash_words_sse42);
+  }
+  if (__builtin_cpu_supports("avx2")) {
+    result.emplace_back(string_hash_words_avx2);
+  }
+#elif defined(__aarch64__)
+  result.emplace_back(string_hash_words_neon);
+#endif
+  return result;
+}
+
+} // namespace
+
+TEST(string_hash, known_values) {
+  ASSERT_EQ(string_hash("", 0), 2147483648);
+  ASSERT_EQ(string_hash("a", 1), reference_string_hash("a", 1));
+  const char *url = "https://example.com/some/long/path/to/the/resource?with=query&and=more&parameters=1";
+  ASSERT_EQ(string_hash(url, std::strlen(url)), reference_string_hash(url, std::strlen(url)));
+}
+
+TEST(string_hash, same_as_reference) {
+  const auto buffer = random_buffer(2048 + 8);
+  for (size_t offset = 0; offset < 4; ++offset) {
+    for (size_t len = 0; len + offset < buffer.size(); len += (len < 300 ? 1 : 37)) {
+      ASSERT_EQ(string_hash(buffer.data() + offset, len), reference_string_hash(buffer.data() + offset, len))
+                << "offset " << offset << ", len " << len;
+    }
+  }
+}
+
+TEST(string_hash, words_implementations) {
+  const auto buffer = random_buffer(1024 + 8);
+  const uint64_t seeds[] = {STRING_HASH_INIT, 0, std::numeric_limits<uint64_t>::max()};
+  for (auto words_impl : available_implementations()) {
+    for (uint64_t seed : seeds) {
+      for (size_t offset = 0; offset < 4; ++offset) {
+        for (size_t words_count = 0; 4 * words_count + offset < buffer.size(); ++words_count) {
+          ASSERT_EQ(words_impl(seed, buffer.data() + offset, words_count), string_hash_words_scalar(seed, buffer.data() + offset, words_count))
+                    << "offset " << offset << ", words " << words_count;
+        }
+      }
+    }
+  }
+}
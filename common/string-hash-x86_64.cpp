@@ -0,0 +1,86 @@
+// Compiler for PHP (aka KPHP)
+// Copyright (c) 2020 LLC «V Kontakte»
+// Distributed under the GPL v3 License, see LICENSE.notice.txt
+
+#include "common/string-hash.h"
+
+#include <cassert>
+#include <immintrin.h>
+
+#include "common/cpuid.h"
+
+// There is no 64x64 bit vector multiplication before AVX-512, but words are 32-bit, so
+//   word * power = word * power_lo + ((word * power_hi) << 32)  (mod 2^64)
+// is two 32x32->64 bit multiplications; the shift is applied once per block to the sum of the high parts.
+
+__attribute__((target("sse4.2")))
+uint64_t string_hash_words_sse42(uint64_t hash, const char *p, size_t words_count) {
+  constexpr size_t lanes = 2;
+  constexpr size_t vectors_per_block = STRING_HASH_BLOCK_WORDS / lanes;
+
+  __m128i powers_lo[vectors_per_block];
+  __m128i powers_hi[vectors_per_block];
+  for (size_t i = 0; i < vectors_per_block; ++i) {
+    powers_lo[i] = _mm_load_si128(reinterpret_cast<const __m128i *>(&string_hash_block_powers[i * lanes]));
+    powers_hi[i] = _mm_srli_epi64(powers_lo[i], 32);
+  }
+
+  for (; words_count >= STRING_HASH_BLOCK_WORDS; words_count -= STRING_HASH_BLOCK_WORDS) {
+    __m128i sum_lo = _mm_setzero_si128();
+    __m128i sum_hi = _mm_setzero_si128();
+    for (size_t i = 0; i < vectors_per_block; i += 2, p += 4 * sizeof(uint32_t)) {
+      const __m128i words = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+      const __m128i words_0 = _mm_cvtepu32_epi64(words);
+      const __m128i words_1 = _mm_cvtepu32_epi64(_mm_srli_si128(words, 8));
+      sum_lo = _mm_add_epi64(sum_lo, _mm_mul_epu32(words_0, powers_lo[i]));
+      sum_hi = _mm_add_epi64(sum_hi, _mm_mul_epu32(words_0, powers_hi[i]));
+      sum_lo = _mm_add_epi64(sum_lo, _mm_mul_epu32(words_1, powers_lo[i + 1]));
+      sum_hi = _mm_add_epi64(sum_hi, _mm_mul_epu32(words_1, powers_hi[i + 1]));
+    }
+    const __m128i sum = _mm_add_epi64(sum_lo, _mm_slli_epi64(sum_hi, 32));
+    const uint64_t block_sum = _mm_cvtsi128_si64(sum) + _mm_extract_epi64(sum, 1);
+    hash = hash * STRING_HASH_BLOCK_MUL + block_sum;
+  }
+  return string_hash_words_scalar(hash, p, words_count);
+}
+
+__attribute__((target("avx2")))
+uint64_t string_hash_words_avx2(uint64_t hash, const char *p, size_t words_count) {
+  constexpr size_t lanes = 4;
+  constexpr size_t vectors_per_block = STRING_HASH_BLOCK_WORDS / lanes;
+
+  __m256i powers_lo[vectors_per_block];
+  __m256i powers_hi[vectors_per_block];
+  for (size_t i = 0; i < vectors_per_block; ++i) {
+    powers_lo[i] = _mm256_load_si256(reinterpret_cast<const __m256i *>(&string_hash_block_powers[i * lanes]));
+    powers_hi[i] = _mm256_srli_epi64(powers_lo[i], 32);
+  }
+
+  for (; words_count >= STRING_HASH_BLOCK_WORDS; words_count -= STRING_HASH_BLOCK_WORDS) {
+    __m256i sum_lo = _mm256_setzero_si256();
+    __m256i sum_hi = _mm256_setzero_si256();
+    for (size_t i = 0; i < vectors_per_block; ++i, p += lanes * sizeof(uint32_t)) {
+      const __m256i words = _mm256_cvtepu32_epi64(_mm_loadu_si128(reinterpret_cast<const __m128i *>(p)));
+      sum_lo = _mm256_add_epi64(sum_lo, _mm256_mul_epu32(words, powers_lo[i]));
+      sum_hi = _mm256_add_epi64(sum_hi, _mm256_mul_epu32(words, powers_hi[i]));
+    }
+    const __m256i sum_256 = _mm256_add_epi64(sum_lo, _mm256_slli_epi64(sum_hi, 32));
+    const __m128i sum = _mm_add_epi64(_mm256_castsi256_si128(sum_256), _mm256_extracti128_si256(sum_256, 1));
+    const uint64_t block_sum = _mm_cvtsi128_si64(sum) + _mm_extract_epi64(sum, 1);
+    hash = hash * STRING_HASH_BLOCK_MUL + block_sum;
+  }
+  return string_hash_words_scalar(hash, p, words_count);
+}
+
+void string_hash_init() __attribute__ ((constructor(101)));
+void string_hash_init() {
+  const kdb_cpuid_t *p = kdb_cpuid();
+  assert(p->type == KDB_CPUID_X86_64);
+
+  if (p->x86_64.ecx & (1 << 20)) {
+    string_hash_words = string_hash_words_sse42;
+    if (kdb_cpuid_has_avx2(p)) {
+      string_hash_words = string_hash_words_avx2;
+    }
+  }
+}
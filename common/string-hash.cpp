@@ -0,0 +1,39 @@
+// Compiler for PHP (aka KPHP)
+// Copyright (c) 2020 LLC «V Kontakte»
+// Distributed under the GPL v3 License, see LICENSE.notice.txt
+
+#include "common/string-hash.h"
+
+#include <cstring>
+
+namespace {
+
+inline uint32_t load_word(const char *p) {
+  uint32_t word;
+  std::memcpy(&word, p, sizeof(word));
+  return word;
+}
+
+} // namespace
+
+// constant initialized, so it's safe to use from any static constructor;
+// string-hash-${HOST}.cpp replaces it with the best available implementation
+string_hash_words_func_t string_hash_words = string_hash_words_unrolled;
+
+uint64_t string_hash_words_scalar(uint64_t hash, const char *p, size_t words_count) {
+  for (; words_count; --words_count, p += sizeof(uint32_t)) {
+    hash = hash * STRING_HASH_MUL + load_word(p);
+  }
+  return hash;
+}
+
+uint64_t string_hash_words_unrolled(uint64_t hash, const char *p, size_t words_count) {
+  for (; words_count >= STRING_HASH_BLOCK_WORDS; words_count -= STRING_HASH_BLOCK_WORDS) {
+    uint64_t block_sum = 0;
+    for (size_t i = 0; i < STRING_HASH_BLOCK_WORDS; ++i, p += sizeof(uint32_t)) {
+      block_sum += load_word(p) * string_hash_block_powers[i];
+    }
+    hash = hash * STRING_HASH_BLOCK_MUL + block_sum;
+  }
+  return string_hash_words_scalar(hash, p, words_count);
+}
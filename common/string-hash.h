@@ -0,0 +1,62 @@
+// Compiler for PHP (aka KPHP)
+// Copyright (c) 2020 LLC «V Kontakte»
+// Distributed under the GPL v3 License, see LICENSE.notice.txt
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+
+// string_hash() (see common/php-functions.h) is a chain of
+//   hash = hash * STRING_HASH_MUL + word
+// over the 32-bit little-endian words of a string. Unrolled over a block of N words it turns into
+//   hash = hash * MUL^N + (word[0] * MUL^(N-1) + word[1] * MUL^(N-2) + ... + word[N-1])
+// where all the products are independent, so they can be computed in parallel, including SIMD lanes.
+// Every implementation here produces exactly the same values as the plain chain.
+
+constexpr uint64_t STRING_HASH_MUL = 1915239017;
+constexpr uint64_t STRING_HASH_INIT = 2147483648U;
+
+// words per block in the parallel implementations
+constexpr size_t STRING_HASH_BLOCK_WORDS = 16;
+// string_hash() keeps the inlined chain for shorter strings, the call and setup don't pay off below ~128 bytes
+constexpr size_t STRING_HASH_DISPATCH_MIN_WORDS = 2 * STRING_HASH_BLOCK_WORDS;
+
+constexpr uint64_t string_hash_mul_power(size_t n) {
+  uint64_t result = 1;
+  while (n--) {
+    result *= STRING_HASH_MUL;
+  }
+  return result;
+}
+
+template<size_t... I>
+constexpr std::array<uint64_t, sizeof...(I)> make_string_hash_block_powers(std::index_sequence<I...>) {
+  return {{string_hash_mul_power(sizeof...(I) - 1 - I)...}};
+}
+
+// [i] is the multiplier of the i-th word of a block
+alignas(32) constexpr std::array<uint64_t, STRING_HASH_BLOCK_WORDS> string_hash_block_powers =
+  make_string_hash_block_powers(std::make_index_sequence<STRING_HASH_BLOCK_WORDS>{});
+// the multiplier of the hash accumulated before a block
+constexpr uint64_t STRING_HASH_BLOCK_MUL = string_hash_mul_power(STRING_HASH_BLOCK_WORDS);
+
+// continues the hash over words_count 32-bit words starting at p, p may be unaligned
+using string_hash_words_func_t = uint64_t (*)(uint64_t hash, const char *p, size_t words_count);
+
+// the best implementation for the current cpu, chosen on startup
+extern string_hash_words_func_t string_hash_words;
+
+// the reference one word at a time chain
+uint64_t string_hash_words_scalar(uint64_t hash, const char *p, size_t words_count);
+// portable block implementation, relies on the multiplier ILP
+uint64_t string_hash_words_unrolled(uint64_t hash, const char *p, size_t words_count);
+
+#if defined(__x86_64__)
+uint64_t string_hash_words_sse42(uint64_t hash, const char *p, size_t words_count);
+uint64_t string_hash_words_avx2(uint64_t hash, const char *p, size_t words_count);
+#elif defined(__aarch64__)
+uint64_t string_hash_words_neon(uint64_t hash, const char *p, size_t words_count);
+#endif
@@ -0,0 +1,96 @@
+// Compiler for PHP (aka KPHP)
+// Copyright (c) 2020 LLC «V Kontakte»
+// Distributed under the GPL v3 License, see LICENSE.notice.txt
+
+#include "common/ucontext/ucontext-portable.h"
+
+#include <cassert>
+#include <cstdint>
+
+#include "common/sanitizer.h"
+
+// Saved frame layout (from ucontext_t_portable::sp upwards), 176 bytes:
+//   [0]   x19..x28
+//   [80]  x29 (fp), x30 (lr)
+//   [96]  d8..d15
+//   [160] fpcr
+asm(R"(
+  .text
+  .p2align 4
+  .globl swapcontext_portable
+  .type swapcontext_portable, %function
+swapcontext_portable:
+  sub sp, sp, #176
+  stp x19, x20, [sp, #0]
+  stp x21, x22, [sp, #16]
+  stp x23, x24, [sp, #32]
+  stp x25, x26, [sp, #48]
+  stp x27, x28, [sp, #64]
+  stp x29, x30, [sp, #80]
+  stp d8, d9, [sp, #96]
+  stp d10, d11, [sp, #112]
+  stp d12, d13, [sp, #128]
+  stp d14, d15, [sp, #144]
+  mrs x2, fpcr
+  str x2, [sp, #160]
+  mov x2, sp
+  str x2, [x0]
+  ldr x2, [x1]
+  mov sp, x2
+.Lrestore_context_portable:
+  ldr x2, [sp, #160]
+  msr fpcr, x2
+  ldp x19, x20, [sp, #0]
+  ldp x21, x22, [sp, #16]
+  ldp x23, x24, [sp, #32]
+  ldp x25, x26, [sp, #48]
+  ldp x27, x28, [sp, #64]
+  ldp x29, x30, [sp, #80]
+  ldp d8, d9, [sp, #96]
+  ldp d10, d11, [sp, #112]
+  ldp d12, d13, [sp, #128]
+  ldp d14, d15, [sp, #144]
+  add sp, sp, #176
+  ret
+  .size swapcontext_portable, .-swapcontext_portable
+
+  .p2align 4
+  .globl setcontext_portable
+  .type setcontext_portable, %function
+setcontext_portable:
+  ldr x2, [x0]
+  mov sp, x2
+  b .Lrestore_context_portable
+  .size setcontext_portable, .-setcontext_portable
+
+  .p2align 4
+  .type makecontext_portable_trampoline, %function
+makecontext_portable_trampoline:
+  blr x19
+  brk #0
+  .size makecontext_portable_trampoline, .-makecontext_portable_trampoline
+)");
+
+extern "C" void makecontext_portable_trampoline();
+
+void makecontext_portable(ucontext_t_portable *ucp, void (*func)(), void *stack, size_t stack_size) {
+  assert(stack_size >= 256);
+  ucp->uc_stack.ss_sp = stack;
+  ucp->uc_stack.ss_size = stack_size;
+  ucp->uc_stack.ss_flags = 0;
+  // the stack may be reused after a context that has never returned, drop the stale asan poisoning
+  ASAN_UNPOISON_MEMORY_REGION(stack, stack_size);
+
+  auto top = (reinterpret_cast<uintptr_t>(stack) + stack_size) & ~uintptr_t{15};
+  auto *frame = reinterpret_cast<uint64_t *>(top) - 22;
+  for (int i = 0; i < 22; ++i) {
+    frame[i] = 0;
+  }
+  uint64_t fpcr = 0;
+  asm volatile("mrs %0, fpcr" : "=r"(fpcr));
+  frame[0] = reinterpret_cast<uint64_t>(func); // x19
+  frame[10] = 0; // x29, terminates the frame chain
+  frame[11] = reinterpret_cast<uint64_t>(&makecontext_portable_trampoline); // x30
+  frame[20] = fpcr;
+  ucp->sp = frame;
+}
@@ -0,0 +1,59 @@
+// Compiler for PHP (aka KPHP)
+// Copyright (c) 2020 LLC «V Kontakte»
+// Distributed under the GPL v3 License, see LICENSE.notice.txt
+
+#include <benchmark/benchmark.h>
+
+#include <ucontext.h>
+#include <vector>
+
+#include "common/ucontext/ucontext-portable.h"
+
+namespace {
+
+std::vector<char> fiber_stack(1 << 16);
+
+ucontext_t glibc_main_context;
+ucontext_t glibc_fiber_context;
+
+void glibc_fiber_func() {
+  while (true) {
+    swapcontext(&glibc_fiber_context, &glibc_main_context);
+  }
+}
+
+ucontext_t_portable portable_main_context;
+ucontext_t_portable portable_fiber_context;
+
+void portable_fiber_func() {
+  while (true) {
+    swapcontext_portable(&portable_fiber_context, &portable_main_context);
+  }
+}
+
+} // namespace
+
+// each iteration is a round trip: two context switches
+static void BM_glibc_swapcontext(benchmark::State &state) {
+  getcontext(&glibc_fiber_context);
+  glibc_fiber_context.uc_stack.ss_sp = fiber_stack.data();
+  glibc_fiber_context.uc_stack.ss_size = fiber_stack.size();
+  glibc_fiber_context.uc_link = nullptr;
+  makecontext(&glibc_fiber_context, &glibc_fiber_func, 0);
+
+  for (auto _ : state) {
+    swapcontext(&glibc_main_context, &glibc_fiber_context);
+  }
+}
+BENCHMARK(BM_glibc_swapcontext);
+
+static void BM_portable_swapcontext(benchmark::State &state) {
+  makecontext_portable(&portable_fiber_context, &portable_fiber_func, fiber_stack.data(), fiber_stack.size());
+
+  for (auto _ : state) {
+    swapcontext_portable(&portable_main_context, &portable_fiber_context);
+  }
+}
+BENCHMARK(BM_portable_swapcontext);
+
+BENCHMARK_MAIN();
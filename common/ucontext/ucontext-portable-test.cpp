@@ -0,0 +1,70 @@
+// Compiler for PHP (aka KPHP)
+// Copyright (c) 2020 LLC «V Kontakte»
+// Distributed under the GPL v3 License, see LICENSE.notice.txt
+
+#include "common/ucontext/ucontext-portable.h"
+
+#include <cstdint>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+namespace {
+
+ucontext_t_portable main_context;
+ucontext_t_portable fiber_context;
+std::vector<char> fiber_stack(1 << 16);
+
+int fiber_iterations = 0;
+bool fiber_stack_is_used = false;
+double fiber_accumulator = 0;
+
+void fiber_func() {
+  while (true) {
+    char local = 0;
+    fiber_stack_is_used = fiber_stack.data() <= &local && &local < fiber_stack.data() + fiber_stack.size();
+    fiber_accumulator += 0.5;
+    ++fiber_iterations;
+    swapcontext_portable(&fiber_context, &main_context);
+  }
+}
+
+void fiber_finish_func() {
+  ++fiber_iterations;
+  setcontext_portable(&main_context);
+}
+
+} // namespace
+
+TEST(ucontext_portable, ping_pong) {
+  fiber_iterations = 0;
+  fiber_accumulator = 0;
+  makecontext_portable(&fiber_context, &fiber_func, fiber_stack.data(), fiber_stack.size());
+  ASSERT_EQ(fiber_context.uc_stack.ss_sp, fiber_stack.data());
+  ASSERT_EQ(fiber_context.uc_stack.ss_size, fiber_stack.size());
+
+  double local_accumulator = 0;
+  for (int i = 1; i <= 1000; ++i) {
+    local_accumulator += 0.5;
+    swapcontext_portable(&main_context, &fiber_context);
+    ASSERT_EQ(fiber_iterations, i);
+    ASSERT_TRUE(fiber_stack_is_used);
+  }
+  ASSERT_EQ(fiber_accumulator, local_accumulator);
+}
+
+TEST(ucontext_portable, setcontext) {
+  fiber_iterations = 0;
+  makecontext_portable(&fiber_context, &fiber_finish_func, fiber_stack.data(), fiber_stack.size());
+  swapcontext_portable(&main_context, &fiber_context);
+  ASSERT_EQ(fiber_iterations, 1);
+}
+
+TEST(ucontext_portable, stack_alignment) {
+  // misaligned stack base/size must still produce an aligned frame
+  makecontext_portable(&fiber_context, &fiber_func, fiber_stack.data() + 3, fiber_stack.size() - 7);
+  ASSERT_EQ(reinterpret_cast<uintptr_t>(fiber_context.sp) % 16, 0);
+  fiber_iterations = 0;
+  swapcontext_portable(&main_context, &fiber_context);
+  ASSERT_EQ(fiber_iterations, 1);
+}
@@ -0,0 +1,87 @@
+// Compiler for PHP (aka KPHP)
+// Copyright (c) 2020 LLC «V Kontakte»
+// Distributed under the GPL v3 License, see LICENSE.notice.txt
+
+#include "common/ucontext/ucontext-portable.h"
+
+#include <cassert>
+#include <cstdint>
+
+#include "common/sanitizer.h"
+
+// Saved frame layout (from ucontext_t_portable::sp upwards):
+//   [0]  mxcsr, [4] x87 control word
+//   [8]  r15, [16] r14, [24] r13, [32] r12, [40] rbx, [48] rbp
+//   [56] return address
+asm(R"(
+  .text
+  .p2align 4
+  .globl swapcontext_portable
+  .type swapcontext_portable, @function
+swapcontext_portable:
+  pushq %rbp
+  pushq %rbx
+  pushq %r12
+  pushq %r13
+  pushq %r14
+  pushq %r15
+  subq $8, %rsp
+  stmxcsr (%rsp)
+  fnstcw 4(%rsp)
+  movq %rsp, (%rdi)
+  movq (%rsi), %rsp
+.Lrestore_context_portable:
+  ldmxcsr (%rsp)
+  fldcw 4(%rsp)
+  addq $8, %rsp
+  popq %r15
+  popq %r14
+  popq %r13
+  popq %r12
+  popq %rbx
+  popq %rbp
+  ret
+  .size swapcontext_portable, .-swapcontext_portable
+
+  .p2align 4
+  .globl setcontext_portable
+  .type setcontext_portable, @function
+setcontext_portable:
+  movq (%rdi), %rsp
+  jmp .Lrestore_context_portable
+  .size setcontext_portable, .-setcontext_portable
+
+  .p2align 4
+  .type makecontext_portable_trampoline, @function
+makecontext_portable_trampoline:
+  callq *%rbx
+  ud2
+  .size makecontext_portable_trampoline, .-makecontext_portable_trampoline
+)");
+
+extern "C" void makecontext_portable_trampoline();
+
+void makecontext_portable(ucontext_t_portable *ucp, void (*func)(), void *stack, size_t stack_size) {
+  assert(stack_size >= 128);
+  ucp->uc_stack.ss_sp = stack;
+  ucp->uc_stack.ss_size = stack_size;
+  ucp->uc_stack.ss_flags = 0;
+  // the stack may be reused after a context that has never returned, drop the stale asan poisoning
+  ASAN_UNPOISON_MEMORY_REGION(stack, stack_size);
+
+  auto top = (reinterpret_cast<uintptr_t>(stack) + stack_size) & ~uintptr_t{15};
+  // after 'ret' into the trampoline %rsp is 16-byte aligned, so func() gets a properly aligned frame
+  auto *frame = reinterpret_cast<uint64_t *>(top) - 8;
+  uint32_t mxcsr = 0;
+  uint16_t fpu_cw = 0;
+  asm volatile("stmxcsr %0\n\tfnstcw %1" : "=m"(mxcsr), "=m"(fpu_cw));
+  frame[0] = mxcsr | (uint64_t{fpu_cw} << 32);
+  frame[1] = 0; // r15
+  frame[2] = 0; // r14
+  frame[3] = 0; // r13
+  frame[4] = 0; // r12
+  frame[5] = reinterpret_cast<uint64_t>(func); // rbx
+  frame[6] = 0; // rbp, terminates the frame chain for fast_backtrace
+  frame[7] = reinterpret_cast<uint64_t>(&makecontext_portable_trampoline);
+  ucp->sp = frame;
+}
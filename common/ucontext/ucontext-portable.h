@@ -0,0 +1,29 @@
+// Compiler for PHP (aka KPHP)
+// Copyright (c) 2020 LLC «V Kontakte»
+// Distributed under the GPL v3 License, see LICENSE.notice.txt
+
+#pragma once
+
+#include <csignal>
+#include <cstddef>
+
+// A lightweight replacement for getcontext/makecontext/swapcontext from <ucontext.h>.
+// glibc swapcontext saves and restores the signal mask, which costs a rt_sigprocmask syscall on every switch;
+// here only callee-saved registers (and fp control words) are stored on the stack of the suspended context,
+// so a switch is just a few dozen instructions.
+// The signal mask is NOT touched: if a context is left from a signal handler, it's up to the caller to restore it.
+struct ucontext_t_portable {
+  // must be the first field, it is accessed from assembly code
+  void *sp;
+  // the same meaning as ucontext_t::uc_stack, nullptr/0 for the contexts that run on the main thread stack
+  stack_t uc_stack;
+};
+
+extern "C" {
+// prepares the context to run func() on the stack [stack, stack + stack_size); func() must never return
+void makecontext_portable(ucontext_t_portable *ucp, void (*func)(), void *stack, size_t stack_size);
+// saves the current context into oucp and activates ucp
+void swapcontext_portable(ucontext_t_portable *oucp, const ucontext_t_portable *ucp);
+// activates ucp, the current context is lost
+void setcontext_portable(const ucontext_t_portable *ucp) __attribute__((noreturn));
+}
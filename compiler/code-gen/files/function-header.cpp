@@ -55,6 +55,7 @@ void FunctionH::compile(CodeGenerator &W) const {
     declare_global_vars(function, W);
     declare_const_vars(function, W);
     declare_static_vars(function, W);
+    declare_global_vars_blocks(function, W);
     W << UnlockComments();
     W << function->root << NL;
     W << LockComments();
@@ -4,6 +4,8 @@
 
 #include "compiler/code-gen/files/function-source.h"
 
+#include "compiler/code-gen/files/vars-reset.h"
+
 #include "compiler/code-gen/common.h"
 #include "compiler/code-gen/declarations.h"
 #include "compiler/code-gen/includes.h"
@@ -34,6 +36,10 @@ void declare_static_vars(FunctionPtr function, CodeGenerator &W) {
   }
 }
 
+void declare_global_vars_blocks(FunctionPtr function, CodeGenerator &W) {
+  W << GlobalVarsBlocksDeclaration(function);
+}
+
 void FunctionCpp::compile(CodeGenerator &W) const {
   if (function->is_inline) {
     return;
@@ -52,6 +58,7 @@ void FunctionCpp::compile(CodeGenerator &W) const {
   declare_global_vars(function, W);
   declare_const_vars(function, W);
   declare_static_vars(function, W);
+  declare_global_vars_blocks(function, W);
 
   W << UnlockComments();
   W << function->root << NL;
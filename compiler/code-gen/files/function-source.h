@@ -16,3 +16,4 @@ struct FunctionCpp {
 void declare_global_vars(FunctionPtr function, CodeGenerator &W);
 void declare_const_vars(FunctionPtr function, CodeGenerator &W);
 void declare_static_vars(FunctionPtr function, CodeGenerator &W);
+void declare_global_vars_blocks(FunctionPtr function, CodeGenerator &W);
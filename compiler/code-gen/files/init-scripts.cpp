@@ -122,6 +122,7 @@ void GlobalResetFunction::compile(CodeGenerator &W) const {
   }
 
   FunctionSignatureGenerator(W) << "void " << FunctionName(function) << "$global_reset() " << BEGIN;
+  W << "GlobalVarsBlock::clear_reset_vars_count();" << NL;
   W << "void " << GlobalVarsResetFuncName(function) << ";" << NL;
   W << GlobalVarsResetFuncName(function) << ";" << NL;
   for (LibPtr lib: G->get_libs()) {
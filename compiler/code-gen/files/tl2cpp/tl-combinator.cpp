@@ -49,11 +49,18 @@ void CombinatorGen::compile_left(CodeGenerator &W) const {
     }
   }
   gen_before_args_processing(W);
-  for (const auto &arg : combinator->args) {
-    if (arg->is_optional()) {
+  const auto &args = combinator->args;
+  for (size_t i = 0; i < args.size();) {
+    if (args[i]->is_optional()) {
+      ++i;
       continue;
     }
-    gen_arg_processing(W, arg);
+    if (const size_t processed_args = gen_args_span_processing(W, i)) {
+      i += processed_args;
+      continue;
+    }
+    gen_arg_processing(W, args[i]);
+    ++i;
   }
   gen_after_args_processing(W);
 }
@@ -185,6 +192,67 @@ void CombinatorFetch::gen_before_args_processing(CodeGenerator &W) const {
   }
 };
 
+// the C++ type a bare fixed size field is loaded as, or nullptr if the field is not such one
+const char *CombinatorFetch::get_fixed_size_arg_cpp_type(const std::unique_ptr<vk::tl::arg> &arg) {
+  if (arg->is_optional() || arg->is_fields_mask_optional() || arg->is_forwarded_function()) {
+    return nullptr;
+  }
+  auto *type_expr = arg->type_expr->as<vk::tl::type_expr>();
+  if (!type_expr || is_magic_processing_needed(type_expr)) {
+    return nullptr;
+  }
+  const auto *type = tl2cpp::type_of(type_expr);
+  if (type->is_integer_variable() || type->id == TL_INT) {
+    return "int32_t";
+  }
+  if (type->id == TL_LONG) {
+    return "int64_t";
+  }
+  if (type->id == TL_DOUBLE) {
+    return "double";
+  }
+  return nullptr;
+}
+
+size_t CombinatorFetch::gen_args_span_processing(CodeGenerator &W, size_t first_arg) const {
+  if (!typed_mode) {
+    return 0;
+  }
+  const auto &args = combinator->args;
+  size_t last_arg = first_arg;
+  while (last_arg < args.size() && get_fixed_size_arg_cpp_type(args[last_arg])) {
+    ++last_arg;
+  }
+  // a single field is fetched as usual
+  if (last_arg - first_arg < 2) {
+    return 0;
+  }
+
+  std::vector<std::string> loads;
+  size_t span_size = 0;
+  for (size_t i = first_arg; i != last_arg; ++i) {
+    const std::string cpp_type = get_fixed_size_arg_cpp_type(args[i]);
+    loads.emplace_back(fmt_format("{} = tl_load_from_span<{}>(tl_span{});", tl2cpp::get_tl_object_field_access(args[i], tl2cpp::field_rw_type::WRITE),
+                                  cpp_type, span_size ? " + " + std::to_string(span_size) : ""));
+    span_size += cpp_type == "int32_t" ? 1 : 2;
+  }
+  W << fmt_format("if (const int32_t *tl_span = tl_fetch_fixed_size_span({})) ", span_size) << BEGIN;
+  for (const auto &load : loads) {
+    W << load << NL;
+  }
+  W << END << NL;
+
+  for (size_t i = first_arg; i != last_arg; ++i) {
+    const auto &arg = args[i];
+    if (arg->var_num != -1 && tl2cpp::type_of(arg->type_expr)->is_integer_variable()) {
+      // save the field mask for the future use
+      W << var_num_access << combinator->get_var_num_arg(arg->var_num)->name << " = " << tl2cpp::get_tl_object_field_access(arg, tl2cpp::field_rw_type::READ)
+        << ";" << NL;
+    }
+  }
+  return last_arg - first_arg;
+}
+
 void CombinatorFetch::gen_arg_processing(CodeGenerator &W, const std::unique_ptr<vk::tl::arg> &arg) const {
   if (arg->is_fields_mask_optional()) {
     W << fmt_format("if ({}{} & (1 << {})) ", var_num_access,
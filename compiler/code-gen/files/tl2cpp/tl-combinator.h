@@ -29,6 +29,8 @@ struct CombinatorGen {
   void compile_right(CodeGenerator &W) const;
 
   virtual void gen_before_args_processing(CodeGenerator &W __attribute__ ((unused))) const {};
+  // processes several args starting from the given one at once, returns the number of the processed args
+  virtual size_t gen_args_span_processing(CodeGenerator &W __attribute__ ((unused)), size_t first_arg __attribute__ ((unused))) const { return 0; };
   virtual void gen_arg_processing(CodeGenerator &W, const std::unique_ptr<vk::tl::arg> &arg) const = 0;
   virtual void gen_after_args_processing(CodeGenerator &W __attribute__ ((unused))) const {};
 
@@ -102,6 +104,14 @@ private:
       return t_Vector<t_Vector<t_Maybe<tl_exclamation_fetch_wrapper, 0>, 0>, 0>(t_Vector<t_Maybe<tl_exclamation_fetch_wrapper, 0>, 0>(t_Maybe<tl_exclamation_fetch_wrapper, 0>(std::move(X)))).fetch();
     }
  * 3) Handling of the main part of the type expression in TypeExprStore/Fetch
+ * 4) The consecutive bare int, long, double and # fields are fetched with a single length check (typed mode only):
+    void c_hints_objectExt::typed_fetch_to(C$VK$TL$Types$hints$objectExt *tl_object, int64_t fields_mask) {
+      if (const int32_t *tl_span = tl_fetch_fixed_size_span(2)) {
+        tl_object->$type = tl_load_from_span<int32_t>(tl_span);
+        tl_object->$object_id = tl_load_from_span<int32_t>(tl_span + 1);
+      }
+      ...
+    }
 */
 struct CombinatorFetch : CombinatorGen {
   CombinatorFetch(const vk::tl::combinator *combinator, CombinatorPart part, bool typed_mode) :
@@ -109,10 +119,15 @@ struct CombinatorFetch : CombinatorGen {
 
   void gen_before_args_processing(CodeGenerator &W) const final;
 
+  size_t gen_args_span_processing(CodeGenerator &W, size_t first_arg) const final;
+
   void gen_arg_processing(CodeGenerator &W, const std::unique_ptr<vk::tl::arg> &arg) const final;
 
   void gen_after_args_processing(CodeGenerator &W) const final;
 
   void gen_result_expr_processing(CodeGenerator &W) const final;
+
+private:
+  static const char *get_fixed_size_arg_cpp_type(const std::unique_ptr<vk::tl::arg> &arg);
 };
 }
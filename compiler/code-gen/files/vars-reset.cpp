@@ -4,18 +4,66 @@
 
 #include "compiler/code-gen/files/vars-reset.h"
 
+#include "common/algorithms/hashes.h"
+
 #include "compiler/code-gen/common.h"
 #include "compiler/code-gen/declarations.h"
 #include "compiler/code-gen/includes.h"
 #include "compiler/code-gen/namespace.h"
+#include "compiler/code-gen/naming.h"
 #include "compiler/code-gen/vertex-compiler.h"
 #include "compiler/data/class-data.h"
 #include "compiler/data/src-file.h"
 #include "compiler/data/vars-collector.h"
 #include "compiler/vertex.h"
 
-GlobalVarsReset::GlobalVarsReset(SrcFilePtr main_file) :
-  main_file_(main_file) {
+static const char *dirty_blocks_list_name = "dirty_global_vars_blocks";
+
+std::string get_global_vars_block_name(VarPtr var) {
+  if (var->is_builtin_global()) {
+    return {};
+  }
+  if (var->is_function_static_var()) {
+    return "f$" + var->holder_func->name + "$globals_block";
+  }
+  if (var->is_class_static_var()) {
+    return var->class_id->src_name + "$globals_block";
+  }
+  return "v$" + var->name + "$globals_block";
+}
+
+std::set<std::string> get_global_vars_blocks(FunctionPtr function) {
+  std::set<std::string> blocks;
+  for (const auto &vars : {function->global_var_ids, function->static_var_ids}) {
+    for (auto var : vars) {
+      std::string block = get_global_vars_block_name(var);
+      if (!block.empty()) {
+        blocks.emplace(std::move(block));
+      }
+    }
+  }
+  return blocks;
+}
+
+void GlobalVarsBlocksDeclaration::compile(CodeGenerator &W) const {
+  const auto blocks = get_global_vars_blocks(function);
+  if (blocks.empty()) {
+    return;
+  }
+  W << "extern GlobalVarsBlock *" << dirty_blocks_list_name << ";" << NL;
+  for (const auto &block : blocks) {
+    W << "extern GlobalVarsBlock " << block << ";" << NL;
+  }
+}
+
+void GlobalVarsBlocksMarkDirty::compile(CodeGenerator &W) const {
+  for (const auto &block : get_global_vars_blocks(function)) {
+    W << block << ".mark_dirty(" << dirty_blocks_list_name << ");" << NL;
+  }
+}
+
+GlobalVarsReset::GlobalVarsReset(std::vector<SrcFilePtr> main_files) :
+  main_files_(std::move(main_files)) {
 }
 
 void GlobalVarsReset::declare_extern_for_init_val(VertexPtr v, std::set<VarPtr> &externed_vars, CodeGenerator &W) {
@@ -31,79 +79,129 @@ void GlobalVarsReset::declare_extern_for_init_val(VertexPtr v, std::set<VarPtr>
   }
 }
 
-void GlobalVarsReset::compile_part(FunctionPtr func, const std::set<VarPtr> &used_vars, int part_i, CodeGenerator &W) {
+static void compile_hard_reset_var(VarPtr var, CodeGenerator &W) {
+  W << "hard_reset_var(" << VarName(var);
+  //FIXME: brk and comments
+  if (var->init_val) {
+    W << UnlockComments();
+    W << ", " << var->init_val;
+    W << LockComments();
+  }
+  W << ");" << NL;
+}
+
+void GlobalVarsReset::compile_blocks_part(const std::map<std::string, std::vector<VarPtr>> &blocks, CodeGenerator &W) {
   IncludesCollector includes;
-  for (auto var : used_vars) {
-    includes.add_var_signature_depends(var);
+  for (const auto &block : blocks) {
+    for (auto var : block.second) {
+      includes.add_var_signature_depends(var);
+    }
   }
   W << includes;
   W << OpenNamespace();
 
+  W << "extern GlobalVarsBlock *" << dirty_blocks_list_name << ";" << NL;
   std::set<VarPtr> externed_vars;
-  for (auto var : used_vars) {
-    W << VarExternDeclaration(var);
-    if (var->init_val) {
-      declare_extern_for_init_val(var->init_val, externed_vars, W);
+  for (const auto &block : blocks) {
+    for (auto var : block.second) {
+      W << VarExternDeclaration(var);
+      if (var->init_val) {
+        declare_extern_for_init_val(var->init_val, externed_vars, W);
+      }
     }
   }
+  W << NL;
 
-  FunctionSignatureGenerator(W) << "void " << GlobalVarsResetFuncName(func, part_i) << " " << BEGIN;
-  for (auto var : used_vars) {
-    if (G->settings().is_static_lib_mode() && var->is_builtin_global()) {
-      continue;
-    }
-
-    W << "hard_reset_var(" << VarName(var);
-    //FIXME: brk and comments
-    if (var->init_val) {
-      W << UnlockComments();
-      W << ", " << var->init_val;
-      W << LockComments();
+  for (const auto &block : blocks) {
+    FunctionSignatureGenerator(W) << "static int64_t " << block.first << "$reset() " << BEGIN;
+    for (auto var : block.second) {
+      compile_hard_reset_var(var, W);
     }
-    W << ");" << NL;
+    W << "return " << block.second.size() << ";" << NL;
+    W << END << NL;
+    W << "GlobalVarsBlock " << block.first << "{" << dirty_blocks_list_name << ", " << block.first << "$reset};" << NL << NL;
   }
 
-  W << END;
-  W << NL;
   W << CloseNamespace();
 }
 
-void GlobalVarsReset::compile_func(FunctionPtr func, int parts_n, CodeGenerator &W) {
+void GlobalVarsReset::compile_func(FunctionPtr func, const std::set<VarPtr> &always_reset_vars, CodeGenerator &W) {
+  IncludesCollector includes;
+  for (auto var : always_reset_vars) {
+    includes.add_var_signature_depends(var);
+  }
+  W << includes;
   W << OpenNamespace();
-  FunctionSignatureGenerator(W) << "void " << GlobalVarsResetFuncName(func) << " " << BEGIN;
 
-  for (int i = 0; i < parts_n; i++) {
-    W << "void " << GlobalVarsResetFuncName(func, i) << ";" << NL;
-    W << GlobalVarsResetFuncName(func, i) << ";" << NL;
+  W << "extern GlobalVarsBlock *" << dirty_blocks_list_name << ";" << NL;
+  for (auto var : always_reset_vars) {
+    W << VarExternDeclaration(var);
   }
+  W << NL;
 
+  FunctionSignatureGenerator(W) << "void " << GlobalVarsResetFuncName(func) << " " << BEGIN;
+  for (auto var : always_reset_vars) {
+    compile_hard_reset_var(var, W);
+  }
+  if (!always_reset_vars.empty()) {
+    W << "GlobalVarsBlock::add_reset_vars_count(" << always_reset_vars.size() << ");" << NL;
+  }
+  W << "GlobalVarsBlock::reset_dirty(" << dirty_blocks_list_name << ");" << NL;
   W << END;
   W << NL;
   W << CloseNamespace();
 }
 
 void GlobalVarsReset::compile(CodeGenerator &W) const {
-  FunctionPtr main_func = main_file_->main_function;
-
-  VarsCollector vars_collector{32};
-  vars_collector.collect_global_and_static_vars_from(main_func);
-  auto used_vars = vars_collector.flush();
-
-  static const std::string vars_reset_src_prefix = "vars_reset.";
-  std::vector<std::string> src_names(used_vars.size());
-  for (int i = 0; i < used_vars.size(); i++) {
-    src_names[i] = vars_reset_src_prefix + std::to_string(i) + "." + main_func->src_name;
+  // the blocks are shared between the main files, a request of any of them resets all the dirty ones
+  std::vector<std::map<std::string, std::vector<VarPtr>>> blocks_parts(32);
+  std::set<VarPtr> added_vars;
+  std::vector<std::set<VarPtr>> always_reset_vars;
+
+  for (const auto &main_file : main_files_) {
+    VarsCollector vars_collector{1};
+    vars_collector.collect_global_and_static_vars_from(main_file->main_function);
+    auto used_vars = vars_collector.flush();
+
+    always_reset_vars.emplace_back();
+    for (const auto &vars : used_vars) {
+      for (auto var : vars) {
+        if (G->settings().is_static_lib_mode() && var->is_builtin_global()) {
+          continue;
+        }
+        const std::string block = get_global_vars_block_name(var);
+        if (block.empty()) {
+          always_reset_vars.back().emplace(var);
+        } else if (added_vars.emplace(var).second) {
+          blocks_parts[vk::std_hash(block) % blocks_parts.size()][block].emplace_back(var);
+        }
+      }
+    }
   }
 
-  for (int i = 0; i < used_vars.size(); i++) {
-    W << OpenFile(src_names[i], "o_vars_reset", false);
+  static const std::string vars_reset_src_prefix = "vars_reset.";
+  for (size_t i = 0; i < blocks_parts.size(); i++) {
+    if (blocks_parts[i].empty()) {
+      continue;
+    }
+    W << OpenFile(vars_reset_src_prefix + std::to_string(i) + ".cpp", "o_vars_reset", false);
     W << ExternInclude("runtime-headers.h");
-    compile_part(main_func, used_vars[i], i, W);
+    compile_blocks_part(blocks_parts[i], W);
     W << CloseFile();
   }
 
-  W << OpenFile(vars_reset_src_prefix + main_func->src_name, "", false);
+  W << OpenFile(vars_reset_src_prefix + "cpp", "", false);
   W << ExternInclude("runtime-headers.h");
-  compile_func(main_func, used_vars.size(), W);
+  W << OpenNamespace();
+  W << "GlobalVarsBlock *" << dirty_blocks_list_name << " = nullptr;" << NL;
+  W << CloseNamespace();
   W << CloseFile();
+
+  for (size_t i = 0; i < main_files_.size(); i++) {
+    FunctionPtr main_func = main_files_[i]->main_function;
+    W << OpenFile(vars_reset_src_prefix + main_func->src_name, "", false);
+    W << ExternInclude("runtime-headers.h");
+    compile_func(main_func, always_reset_vars[i], W);
+    W << CloseFile();
+  }
 }
@@ -4,21 +4,51 @@
 
 #pragma once
 
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
 #include "compiler/code-gen/code-generator.h"
 #include "compiler/data/data_ptr.h"
 #include "compiler/data/vertex-adaptor.h"
 
+// the vars are reset by blocks, only the blocks marked as dirty by the called functions (see GlobalVarsBlock in runtime)
 struct GlobalVarsReset {
-  GlobalVarsReset(SrcFilePtr main_file);
+  explicit GlobalVarsReset(std::vector<SrcFilePtr> main_files);
 
   void compile(CodeGenerator &W) const;
 
-  static void compile_part(FunctionPtr func, const std::set<VarPtr> &used_vars, int part_i, CodeGenerator &W);
+  static void compile_blocks_part(const std::map<std::string, std::vector<VarPtr>> &blocks, CodeGenerator &W);
 
-  static void compile_func(FunctionPtr func, int parts_n, CodeGenerator &W);
+  static void compile_func(FunctionPtr func, const std::set<VarPtr> &always_reset_vars, CodeGenerator &W);
 
   static void declare_extern_for_init_val(VertexPtr v, std::set<VarPtr> &externed_vars, CodeGenerator &W);
 
 private:
-  SrcFilePtr main_file_;
+  std::vector<SrcFilePtr> main_files_;
+};
+
+// the name of the block the var is reset with, empty for the vars that are reset after every request
+std::string get_global_vars_block_name(VarPtr var);
+
+// the blocks a function marks as dirty on entry
+std::set<std::string> get_global_vars_blocks(FunctionPtr function);
+
+struct GlobalVarsBlocksDeclaration {
+  FunctionPtr function;
+  explicit GlobalVarsBlocksDeclaration(FunctionPtr function) :
+    function(function) {
+  }
+
+  void compile(CodeGenerator &W) const;
+};
+
+struct GlobalVarsBlocksMarkDirty {
+  FunctionPtr function;
+  explicit GlobalVarsBlocksMarkDirty(FunctionPtr function) :
+    function(function) {
+  }
+
+  void compile(CodeGenerator &W) const;
 };
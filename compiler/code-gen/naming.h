@@ -202,19 +202,13 @@ struct VarName {
 };
 
 struct GlobalVarsResetFuncName {
-  explicit GlobalVarsResetFuncName(FunctionPtr main_func, int part = -1) :
-    main_func_(main_func),
-    part_(part) {}
+  explicit GlobalVarsResetFuncName(FunctionPtr main_func) :
+    main_func_(main_func) {}
 
   void compile(CodeGenerator &W) const {
-    W << FunctionName(main_func_) << "$global_vars_reset";
-    if (part_ >= 0) {
-      W << std::to_string(part_);
-    }
-    W << "()";
+    W << FunctionName(main_func_) << "$global_vars_reset()";
   }
 
 private:
   const FunctionPtr main_func_;
-  const int part_{-1};
 };
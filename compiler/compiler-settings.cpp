@@ -278,7 +278,7 @@ void CompilerSettings::init() {
   append_curl(cxx_flags.value_, ld_flags.value_);
 
   auto external_libs = {"pthread", "rt", "crypto", "m"};
-  auto external_static_libs = {"vk-flex-data", "pcre", "re2", "yaml-cpp", "h3", "ssl", "z", "zstd", "nghttp2"};
+  auto external_static_libs = {"vk-flex-data", "pcre", "re2", "yaml-cpp", "h3", "ssl", "z", "zstd", "brotlienc", "brotlicommon", "nghttp2"};
   append_if_doesnt_contain(ld_flags.value_, external_libs, "-l");
   append_if_doesnt_contain(ld_flags.value_, external_static_libs, "-l:lib", ".a");
 
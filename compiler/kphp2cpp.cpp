@@ -180,7 +180,12 @@ std::string with_extra_flag(std::string flags) {
 }
 
 std::string get_default_extra_cxxflags() noexcept {
-  return with_extra_flag("-Os -ggdb -march=nehalem -mfpmath=sse");
+  std::string flags = "-Os -ggdb -march=nehalem -mfpmath=sse";
+#if KPHP_ARRAY_CTRL_BYTES
+  // array<T> map layout depends on it, so the generated code must be built the same way as the runtime
+  flags.append(" -DKPHP_ARRAY_CTRL_BYTES=1");
+#endif
+  return with_extra_flag(std::move(flags));
 }
 
 std::string get_default_extra_ldflags() noexcept {
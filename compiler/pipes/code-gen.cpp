@@ -152,9 +152,7 @@ void CodeGenF::on_finish(DataStream<WriterData> &os) {
     }
   }
 
-  for (const auto &main_file : main_files) {
-    W << Async(GlobalVarsReset(main_file));
-  }
+  W << Async(GlobalVarsReset(main_files));
 
   if (G->settings().enable_global_vars_memory_stats.get()) {
     W << Async(GlobalVarsMemoryStats{main_files});
@@ -5,8 +5,10 @@
 #include "compiler/scheduler/node.h"
 
 #include <cassert>
+#include <typeinfo>
 
 #include "compiler/scheduler/scheduler-base.h"
+#include "compiler/threading/profiler.h"
 
 void Node::add_to_scheduler(SchedulerBase *scheduler) {
   if (in_scheduler == scheduler) {
@@ -26,6 +28,10 @@ bool Node::is_parallel() {
   return parallel;
 }
 
+std::string Node::get_description() {
+  return demangle(typeid(*this).name());
+}
+
 Node::Node(bool parallel) :
   in_scheduler(nullptr),
   parallel(parallel) {}
@@ -4,6 +4,8 @@
 
 #pragma once
 
+#include <string>
+
 class SchedulerBase;
 class Task;
 
@@ -26,6 +28,8 @@ public:
 
   virtual bool is_parallel();
 
+  virtual std::string get_description();
+
   virtual Task *get_task() = 0;
   virtual void on_finish() = 0;
 };
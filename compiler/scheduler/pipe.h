@@ -115,4 +115,8 @@ public:
   void on_finish() override {
     on_finish(pipe_fun_have_on_finish{});
   }
+
+  std::string get_description() override {
+    return demangle(typeid(PipeF).name());
+  }
 };
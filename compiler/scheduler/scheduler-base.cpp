@@ -6,7 +6,7 @@
 
 #include <cassert>
 
-volatile int tasks_before_sync_node;
+std::atomic<int> tasks_before_sync_node{0};
 
 static SchedulerBase *scheduler;
 
@@ -25,6 +25,12 @@ SchedulerBase *get_scheduler() {
   return scheduler;
 }
 
+void notify_scheduler_task_added() {
+  if (scheduler != nullptr) {
+    scheduler->on_task_added();
+  }
+}
+
 SchedulerBase::SchedulerBase() {
   set_scheduler(this);
 }
@@ -4,6 +4,8 @@
 
 #pragma once
 
+#include <atomic>
+
 class Node;
 
 class Task;
@@ -16,13 +18,18 @@ public:
   virtual void add_sync_node(Node *node) = 0;
   virtual void add_task(Task *task) = 0;
   virtual void execute() = 0;
+
+  // is called after the input for a new task is pushed to a stream
+  virtual void on_task_added() {}
 };
 
 SchedulerBase *get_scheduler();
 void set_scheduler(SchedulerBase *new_scheduler);
 void unset_scheduler(SchedulerBase *old_scheduler);
 
-extern volatile int tasks_before_sync_node;
+extern std::atomic<int> tasks_before_sync_node;
+
+void notify_scheduler_task_added();
 
 inline void register_async_task(Task *task) {
   get_scheduler()->add_task(task);
@@ -4,9 +4,12 @@
 
 #include "compiler/scheduler/scheduler.h"
 
+#include <algorithm>
+#include <chrono>
 #include <vector>
 
 #include "compiler/scheduler/task.h"
+#include "compiler/threading/profiler.h"
 #include "compiler/threading/thread-id.h"
 #include "compiler/threading/tls.h"
 
@@ -18,7 +21,6 @@ public:
   class Scheduler *scheduler;
 
   Node *node;
-  bool run_flag;
 };
 
 
@@ -43,6 +45,9 @@ void Scheduler::add_node(Node *node) {
 
 void Scheduler::add_sync_node(Node *node) {
   sync_nodes.push(node);
+  const std::string description = node->get_description();
+  stage_wall_time_names.emplace_back("Scheduler: wall time before " + description);
+  stage_idle_time_names.emplace_back("Scheduler: threads idle before " + description);
 }
 
 void Scheduler::add_task(Task *task) {
@@ -54,33 +59,37 @@ void Scheduler::execute() {
   task_pull->add_to_scheduler(this);
   set_thread_id(0);
   std::vector<ThreadContext> threads(threads_count + 1);
+  stage_wall_time_names.emplace_back("Scheduler: wall time before the end");
+  stage_idle_time_names.emplace_back("Scheduler: threads idle before the end");
 
   assert ((int)one_thread_nodes.size() < threads_count);
   for (int i = 1; i <= threads_count; i++) {
     threads[i].thread_id = i;
     threads[i].scheduler = this;
-    threads[i].run_flag = true;
-    if (i <= (int)one_thread_nodes.size()) {
-      threads[i].node = one_thread_nodes[i - 1];
-    }
+    threads[i].node = i <= (int)one_thread_nodes.size() ? one_thread_nodes[i - 1] : nullptr;
     pthread_create(&threads[i].pthread_id, nullptr, ::scheduler_thread_execute, &threads[i]);
   }
 
   while (true) {
-    if (tasks_before_sync_node > 0) {
-      usleep(250);
-      continue;
+    {
+      AutoProfiler profiler{get_profiler(stage_wall_time_names[current_stage])};
+      wait_for_sync_node();
     }
     if (sync_nodes.empty()) {
       break;
     }
+    ++current_stage;
     sync_nodes.front()->on_finish();
     sync_nodes.pop();
   }
 
+  {
+    std::lock_guard<std::mutex> lock{mutex};
+    stopped = true;
+  }
+  new_tasks_cv.notify_all();
+  stop_cv.notify_all();
   for (int i = 1; i <= threads_count; i++) {
-    threads[i].run_flag = false;
-    __sync_synchronize();
     pthread_join(threads[i].pthread_id, nullptr);
   }
 
@@ -89,11 +98,26 @@ void Scheduler::execute() {
   }
 }
 
+void Scheduler::on_task_added() {
+  if (idle_threads_count > 0) {
+    {
+      std::lock_guard<std::mutex> lock{mutex};
+      ++new_tasks_epoch;
+    }
+    new_tasks_cv.notify_one();
+  }
+}
+
 void Scheduler::set_threads_count(int new_threads_count) {
   assert (1 <= new_threads_count && new_threads_count <= MAX_THREADS_COUNT);
   threads_count = new_threads_count;
 }
 
+void Scheduler::wait_for_sync_node() {
+  std::unique_lock<std::mutex> lock{mutex};
+  sync_node_cv.wait(lock, [] { return tasks_before_sync_node == 0; });
+}
+
 bool Scheduler::thread_process_node(Node *node) {
   Task *task = node->get_task();
   if (task == nullptr) {
@@ -101,12 +125,19 @@ bool Scheduler::thread_process_node(Node *node) {
   }
   task->execute();
   delete task;
-  __sync_fetch_and_sub(&tasks_before_sync_node, 1);
+  if (--tasks_before_sync_node == 0) {
+    std::lock_guard<std::mutex> lock{mutex};
+    sync_node_cv.notify_one();
+  }
   return true;
 }
 
 void Scheduler::thread_execute(ThreadContext *tls) {
   set_thread_id(tls->thread_id);
+  if (tls->node != nullptr) {
+    thread_execute_one_thread_node(tls->node);
+    return;
+  }
 
   auto process_node = [this](Node *node) {
     bool at_least_one_task_executed = false;
@@ -115,15 +146,48 @@ void Scheduler::thread_execute(ThreadContext *tls) {
     }
     return at_least_one_task_executed;
   };
-  while (tls->run_flag) {
+  auto process_nodes = [this, &process_node] {
+    return std::count_if(nodes.begin(), nodes.end(), process_node) > 0;
+  };
+
+  while (true) {
+    if (process_nodes()) {
+      continue;
+    }
+    // a task added after the nodes are checked would be missed, so look at them again after becoming idle:
+    // a task is either found there or its on_task_added() sees the idle thread and changes the epoch
+    const uint64_t epoch = new_tasks_epoch;
+    ++idle_threads_count;
+    if (process_nodes()) {
+      --idle_threads_count;
+      continue;
+    }
+    bool stop = false;
+    {
+      AutoProfiler profiler{get_profiler(stage_idle_time_names[current_stage])};
+      std::unique_lock<std::mutex> lock{mutex};
+      new_tasks_cv.wait(lock, [this, epoch] { return stopped || new_tasks_epoch != epoch; });
+      stop = stopped;
+    }
+    --idle_threads_count;
+    if (stop) {
+      return;
+    }
+  }
+}
+
+void Scheduler::thread_execute_one_thread_node(Node *node) {
+  // such a thread is not woken up by on_task_added(), it polls its only node
+  std::unique_lock<std::mutex> lock{mutex};
+  while (!stopped) {
+    lock.unlock();
     bool at_least_one_task_executed = false;
-    if (tls->node != nullptr) {
-      at_least_one_task_executed = process_node(tls->node);
-    } else {
-      at_least_one_task_executed = std::count_if(nodes.begin(), nodes.end(), process_node) > 0;
+    while (thread_process_node(node)) {
+      at_least_one_task_executed = true;
     }
+    lock.lock();
     if (!at_least_one_task_executed) {
-      usleep(250);
+      stop_cv.wait_for(lock, std::chrono::microseconds{250});
     }
   }
 }
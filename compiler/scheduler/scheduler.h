@@ -4,7 +4,11 @@
 
 #pragma once
 
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
 #include <queue>
+#include <string>
 #include <vector>
 
 #include "compiler/scheduler/scheduler-base.h"
@@ -20,8 +24,25 @@ private:
   int threads_count;
   TaskPull *task_pull;
 
+  // the threads without tasks sleep instead of polling the nodes,
+  // new_tasks_epoch is increased when they have to look at the nodes again
+  std::mutex mutex;
+  std::condition_variable new_tasks_cv;
+  std::condition_variable sync_node_cv;
+  std::condition_variable stop_cv;
+  std::atomic<int> idle_threads_count{0};
+  std::atomic<uint64_t> new_tasks_epoch{0};
+  bool stopped{false};
+
+  // profiler names of the stages between the sync nodes, the last one is after all of them
+  std::vector<std::string> stage_wall_time_names;
+  std::vector<std::string> stage_idle_time_names;
+  std::atomic<size_t> current_stage{0};
+
   bool thread_process_node(Node *node);
   void thread_execute(ThreadContext *tls);
+  void thread_execute_one_thread_node(Node *node);
+  void wait_for_sync_node();
   friend void *scheduler_thread_execute(void *arg);
 
 public:
@@ -31,6 +52,7 @@ public:
   void add_sync_node(Node *node) override;
   void add_task(Task *task) override;
   void execute() override;
+  void on_task_added() override;
 
   void set_threads_count(int new_threads_count);
 };
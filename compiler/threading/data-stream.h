@@ -3,6 +3,8 @@
 // Distributed under the GPL v3 License, see LICENSE.notice.txt
 
 #pragma once
+#include <array>
+#include <atomic>
 #include <forward_list>
 #include <mutex>
 #include <vector>
@@ -11,6 +13,7 @@
 
 #include "compiler/scheduler/scheduler-base.h"
 #include "compiler/stage.h"
+#include "compiler/threading/tls.h"
 
 template<class DataT>
 class DataStream {
@@ -27,26 +30,38 @@ public:
   }
 
   bool get(DataType &result) {
-    std::lock_guard<std::mutex> lock{mutex_};
-    if (!queue_.empty()) {
-      result = std::move(queue_.front());
-      queue_.pop_front();
-      return true;
+    if (size_ == 0) {
+      return false;
+    }
+    // the own queue first, then steal from the others
+    const int thread_id = get_thread_id();
+    for (int i = 0; i <= MAX_THREADS_COUNT; ++i) {
+      const int id = thread_id + i <= MAX_THREADS_COUNT ? thread_id + i : thread_id + i - MAX_THREADS_COUNT - 1;
+      if (queues_[id].pop(result)) {
+        --size_;
+        return true;
+      }
     }
     return false;
   }
 
   void operator<<(DataType input) {
     if (!is_sink_mode_) {
-      __sync_fetch_and_add(&tasks_before_sync_node, 1);
+      ++tasks_before_sync_node;
+    }
+    queues_[get_thread_id()].push(std::move(input));
+    ++size_;
+    if (!is_sink_mode_) {
+      notify_scheduler_task_added();
     }
-    std::lock_guard<std::mutex> lock{mutex_};
-    queue_.push_front(std::move(input));
   }
 
   std::forward_list<DataType> flush() {
-    std::lock_guard<std::mutex> lock{mutex_};
-    return std::move(queue_);
+    std::forward_list<DataType> result;
+    for (auto &queue : queues_) {
+      size_ -= queue.flush_to(result);
+    }
+    return result;
   }
 
   std::vector<DataType> flush_as_vector() {
@@ -55,8 +70,45 @@ public:
   }
 
 private:
-  std::mutex mutex_;
-  std::forward_list<DataT> queue_;
+  // every thread pushes to its own queue, so the threads don't contend for a single lock
+  class ThreadQueue {
+  public:
+    void push(DataType &&input) {
+      std::lock_guard<std::mutex> lock{mutex_};
+      queue_.push_front(std::move(input));
+      ++size_;
+    }
+
+    bool pop(DataType &result) {
+      if (size_ == 0) {
+        return false;
+      }
+      std::lock_guard<std::mutex> lock{mutex_};
+      if (queue_.empty()) {
+        return false;
+      }
+      result = std::move(queue_.front());
+      queue_.pop_front();
+      --size_;
+      return true;
+    }
+
+    size_t flush_to(std::forward_list<DataType> &result) {
+      std::lock_guard<std::mutex> lock{mutex_};
+      const size_t flushed = size_;
+      result.splice_after(result.before_begin(), queue_);
+      size_ = 0;
+      return flushed;
+    }
+
+  private:
+    std::mutex mutex_;
+    std::forward_list<DataT> queue_;
+    std::atomic<size_t> size_{0};
+  };
+
+  std::array<ThreadQueue, MAX_THREADS_COUNT + 1> queues_;
+  std::atomic<size_t> size_{0};
   const bool is_sink_mode_;
 };
 
@@ -4,14 +4,22 @@
 
 #pragma once
 
-#include <cassert>
+#include <algorithm>
+#include <atomic>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <utility>
 #include <vector>
 
 #include "compiler/threading/locks.h"
 
+// The table is split into shards by the hash, every shard grows on its own.
+// Insertions lock the shard, lookups don't take any locks:
+// a shard index is never changed after being replaced by a bigger one, and the old indexes live as long as the table.
+// Nodes never move, so the pointers returned by at() stay valid.
 template<class T>
 class TSHashTable {
-  static const int N = 1000000;
 public:
   struct HTNode : Lockable {
     unsigned long long hash;
@@ -24,65 +32,117 @@ public:
   };
 
 private:
-  HTNode *nodes;
-  int used_size;
-  int nodes_size;
-public:
-  TSHashTable() :
-    nodes(new HTNode[N]),
-    used_size(0),
-    nodes_size(N) {
-  }
+  static constexpr int SHARDS_BITS = 8;
+  static constexpr size_t MIN_INDEX_SIZE = 16;
 
-  HTNode *at(unsigned long long hash) {
-    int i = (unsigned)hash % (unsigned)nodes_size;
-    while (true) {
-      while (nodes[i].hash != 0 && nodes[i].hash != hash) {
-        i++;
-        if (i == nodes_size) {
-          i = 0;
+  struct Index {
+    explicit Index(size_t size) :
+      mask(size - 1),
+      slots(new std::atomic<HTNode *>[size]()) {
+    }
+
+    HTNode *find(unsigned long long hash) const {
+      for (size_t i = hash & mask; ; i = (i + 1) & mask) {
+        HTNode *node = slots[i].load(std::memory_order_acquire);
+        if (node == nullptr || node->hash == hash) {
+          return node;
         }
       }
-      if (nodes[i].hash == 0 && !__sync_bool_compare_and_swap(&nodes[i].hash, 0, hash)) {
-        int id = __sync_fetch_and_add(&used_size, 1);
-        assert(id * 2 < N);
-        continue;
+    }
+
+    void insert(HTNode *node) {
+      size_t i = node->hash & mask;
+      while (slots[i].load(std::memory_order_relaxed) != nullptr) {
+        i = (i + 1) & mask;
       }
-      break;
+      slots[i].store(node, std::memory_order_release);
     }
-    return &nodes[i];
-  }
 
-  const T *find(unsigned long long hash) {
-    int i = (unsigned)hash % (unsigned)nodes_size;
-    while (nodes[i].hash != 0 && nodes[i].hash != hash) {
-      i++;
-      if (i == nodes_size) {
-        i = 0;
+    const size_t mask;
+    std::unique_ptr<std::atomic<HTNode *>[]> slots;
+  };
+
+  struct Shard {
+    std::atomic<Index *> index{nullptr};
+
+    std::mutex mutex;
+    std::deque<HTNode> nodes;
+    std::vector<std::unique_ptr<Index>> indexes;
+
+    HTNode *find(unsigned long long hash) const {
+      const Index *cur_index = index.load(std::memory_order_acquire);
+      return cur_index ? cur_index->find(hash) : nullptr;
+    }
+
+    HTNode *insert(unsigned long long hash) {
+      const size_t index_size = indexes.empty() ? 0 : indexes.back()->mask + 1;
+      if ((nodes.size() + 1) * 2 > index_size) {
+        auto new_index = std::make_unique<Index>(index_size ? index_size * 2 : MIN_INDEX_SIZE);
+        for (auto &node : nodes) {
+          new_index->insert(&node);
+        }
+        index.store(new_index.get(), std::memory_order_release);
+        indexes.emplace_back(std::move(new_index));
       }
+      nodes.emplace_back();
+      HTNode *node = &nodes.back();
+      node->hash = hash;
+      indexes.back()->insert(node);
+      return node;
     }
+  };
+
+  Shard shards[1 << SHARDS_BITS];
 
-    return nodes[i].hash == hash ? &nodes[i].data : nullptr;
+  Shard &get_shard(unsigned long long hash) {
+    return shards[(hash * 0x9E3779B97F4A7C15ULL) >> (64 - SHARDS_BITS)];
   }
 
-  std::vector<T> get_all() {
-    std::vector<T> res;
-    for (int i = 0; i < N; i++) {
-      if (nodes[i].hash != 0) {
-        res.push_back(nodes[i].data);
+  template<class CondF>
+  std::vector<T> collect(const CondF &callbackF) {
+    std::vector<std::pair<unsigned long long, T>> found;
+    for (auto &shard : shards) {
+      std::lock_guard<std::mutex> lock{shard.mutex};
+      for (const auto &node : shard.nodes) {
+        if (callbackF(node.data)) {
+          found.emplace_back(node.hash, node.data);
+        }
       }
     }
+    // the insertion order depends on the threads, while the generated code must not
+    std::sort(found.begin(), found.end(), [](const auto &lhs, const auto &rhs) { return lhs.first < rhs.first; });
+    std::vector<T> res;
+    res.reserve(found.size());
+    for (auto &hash_and_data : found) {
+      res.emplace_back(std::move(hash_and_data.second));
+    }
     return res;
   }
 
+public:
+  HTNode *at(unsigned long long hash) {
+    Shard &shard = get_shard(hash);
+    if (HTNode *node = shard.find(hash)) {
+      return node;
+    }
+    std::lock_guard<std::mutex> lock{shard.mutex};
+    if (HTNode *node = shard.find(hash)) {
+      return node;
+    }
+    return shard.insert(hash);
+  }
+
+  const T *find(unsigned long long hash) {
+    HTNode *node = get_shard(hash).find(hash);
+    return node ? &node->data : nullptr;
+  }
+
+  std::vector<T> get_all() {
+    return collect([](const T &) { return true; });
+  }
+
   template<class CondF>
   std::vector<T> get_all_if(const CondF &callbackF) {
-    std::vector<T> res;
-    for (int i = 0; i < N; i++) {
-      if (nodes[i].hash != 0 && callbackF(nodes[i].data)) {
-        res.push_back(nodes[i].data);
-      }
-    }
-    return res;
+    return collect(callbackF);
   }
 };
@@ -42,6 +42,7 @@
 #include "net/net-events.h"
 #include "net/net-ifnet.h"
 #include "net/net-msg-buffers.h"
+#include "net/net-reuseport-steering.h"
 #include "net/net-sockaddr-storage.h"
 #include "net/net-socket-options.h"
 #include "net/net-socket.h"
@@ -638,6 +639,7 @@ void close_special_connection(struct connection *c) {
     if (--active_special_connections < max_special_connections && Connections[c->listening].basic_type == ct_listen &&
         Connections[c->listening].generation == c->listening_generation) {
       epoll_insert(c->listening, EVT_READ | EVT_LEVEL);
+      reuseport_steering_on_listening_changed(c->listening, true);
     }
   }
 }
@@ -1142,6 +1144,7 @@ int accept_new_connections(struct connection *cc) {
                    max_special_connections);
         }
         if (++active_special_connections >= max_special_connections) {
+          reuseport_steering_on_listening_changed(cc->fd, false);
           return EVA_REMOVE;
         }
       }
@@ -1926,7 +1929,7 @@ int insert_conn_query_into_list(struct conn_query *q, struct conn_query *h) {
     q->req_generation = q->requester->generation;
     q->requester->pending_queries++;
   }
-  q->timer.h_idx = 0;
+  q->timer.wheel_node.slot = 0;
   q->timer.wakeup = conn_event_wakeup_gateway;
   if (q->timer.wakeup_time > 0) {
     set_timer_operation(&q->timer, "connection query");
@@ -1944,7 +1947,7 @@ int push_conn_query_into_list(struct conn_query *q, struct conn_query *h) {
     q->req_generation = q->requester->generation;
     q->requester->pending_queries++;
   }
-  q->timer.h_idx = 0;
+  q->timer.wheel_node.slot = 0;
   q->timer.wakeup = conn_event_wakeup_gateway;
   if (q->timer.wakeup_time > 0) {
     set_timer_operation(&q->timer, "connection query");
@@ -1986,7 +1989,7 @@ int delete_conn_query(struct conn_query *q) {
   }
   q->requester = 0;
   q->outbound = 0;
-  if (q->timer.h_idx) {
+  if (event_timer_active(&q->timer)) {
     remove_event_timer(&q->timer);
   }
   return 0;
@@ -2005,7 +2008,7 @@ int delete_conn_query_from_requester(struct conn_query *q) {
     }
   }
   q->requester = 0;
-  if (q->timer.h_idx) {
+  if (event_timer_active(&q->timer)) {
     remove_event_timer(&q->timer);
   }
   return 0;
@@ -10,7 +10,7 @@ net_reactor_ctx_t main_thread_reactor = {.epoll_fd = -1,
                                          .max_events = 0,
                                          .max_timers = 0,
                                          .event_heap_size = 0,
-                                         .timer_heap_size = 0,
+                                         .timers_count = 0,
                                          .now = 0,
                                          .prev_now = 0,
                                          .timestamp = 0,
@@ -18,7 +18,7 @@ net_reactor_ctx_t main_thread_reactor = {.epoll_fd = -1,
                                          .events = NULL,
                                          .timers = NULL,
                                          .event_heap = NULL,
-                                         .timer_heap = NULL,
+                                         .timer_wheel = NULL,
                                          .pre_runqueue = NULL,
                                          .post_runqueue = NULL,
                                          .pre_event = NULL,
@@ -26,7 +26,11 @@ net_reactor_ctx_t main_thread_reactor = {.epoll_fd = -1,
                                          .last_wait = 0,
                                          .total_idle_time = 0,
                                          .average_idle_time = 0,
-                                         .average_idle_quotient = 0};
+                                         .average_idle_quotient = 0,
+                                         .uring = NULL,
+                                         .uring_generations = NULL,
+                                         .uring_epoll_ready = false,
+                                         .syscalls = 0};
 
 static void main_thread_reactor_alloc() __attribute__((constructor));
 
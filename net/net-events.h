@@ -145,7 +145,7 @@ static inline int remove_event_timer(event_timer_t *et) {
 }
 
 static inline bool event_timer_active(const event_timer_t *et) {
-  return et->h_idx;
+  return et->wheel_node.slot != 0;
 }
 
 #endif
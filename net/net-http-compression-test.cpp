@@ -0,0 +1,145 @@
+// Compiler for PHP (aka KPHP)
+// Copyright (c) 2020 LLC «V Kontakte»
+// Distributed under the GPL v3 License, see LICENSE.notice.txt
+
+#include <brotli/decode.h>
+#include <cstring>
+#include <gtest/gtest.h>
+#include <string>
+#include <zlib.h>
+#include <zstd.h>
+
+#include "net/net-http-compression.h"
+
+namespace {
+
+http_content_encoding choose(const char *accept_encoding) {
+  return http_choose_content_encoding(accept_encoding, static_cast<int>(strlen(accept_encoding)));
+}
+
+std::string read_all(netbuffer_t *buf) {
+  std::string res(get_total_ready_bytes(buf), '\0');
+  EXPECT_EQ(read_in(buf, &res[0], static_cast<int>(res.size())), static_cast<int>(res.size()));
+  return res;
+}
+
+// the decoders are streaming too, so that a flushed prefix of a stream can be checked
+std::string zlib_decode(const std::string &compressed) {
+  z_stream strm;
+  memset(&strm, 0, sizeof(strm));
+  // 32 enables the detection of both the gzip and the zlib headers
+  EXPECT_EQ(inflateInit2(&strm, MAX_WBITS + 32), Z_OK);
+  std::string res(1 << 20, '\0');
+  strm.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(compressed.data()));
+  strm.avail_in = static_cast<uInt>(compressed.size());
+  strm.next_out = reinterpret_cast<Bytef *>(&res[0]);
+  strm.avail_out = static_cast<uInt>(res.size());
+  const int ret = inflate(&strm, Z_SYNC_FLUSH);
+  EXPECT_TRUE(ret == Z_OK || ret == Z_STREAM_END);
+  res.resize(strm.total_out);
+  inflateEnd(&strm);
+  return res;
+}
+
+std::string zstd_decode(const std::string &compressed) {
+  ZSTD_DStream *stream = ZSTD_createDStream();
+  ZSTD_initDStream(stream);
+  std::string res(1 << 20, '\0');
+  ZSTD_inBuffer input{compressed.data(), compressed.size(), 0};
+  ZSTD_outBuffer output{&res[0], res.size(), 0};
+  while (input.pos < input.size) {
+    EXPECT_FALSE(ZSTD_isError(ZSTD_decompressStream(stream, &output, &input)));
+  }
+  res.resize(output.pos);
+  ZSTD_freeDStream(stream);
+  return res;
+}
+
+std::string brotli_decode(const std::string &compressed) {
+  BrotliDecoderState *state = BrotliDecoderCreateInstance(nullptr, nullptr, nullptr);
+  std::string res(1 << 20, '\0');
+  size_t avail_in = compressed.size();
+  const uint8_t *next_in = reinterpret_cast<const uint8_t *>(compressed.data());
+  size_t avail_out = res.size();
+  uint8_t *next_out = reinterpret_cast<uint8_t *>(&res[0]);
+  EXPECT_NE(BrotliDecoderDecompressStream(state, &avail_in, &next_in, &avail_out, &next_out, nullptr), BROTLI_DECODER_RESULT_ERROR);
+  res.resize(res.size() - avail_out);
+  BrotliDecoderDestroyInstance(state);
+  return res;
+}
+
+std::string decode(http_content_encoding encoding, const std::string &compressed) {
+  switch (encoding) {
+    case hce_zstd:
+      return zstd_decode(compressed);
+    case hce_br:
+      return brotli_decode(compressed);
+    default:
+      return zlib_decode(compressed);
+  }
+}
+
+std::string make_body(int len) {
+  std::string body;
+  while (static_cast<int>(body.size()) < len) {
+    body += "<div class=\"item\">" + std::to_string(body.size() * 7919 % 1000) + "</div>\n";
+  }
+  body.resize(len);
+  return body;
+}
+
+} // namespace
+
+TEST(http_compression, choose_content_encoding) {
+  ASSERT_EQ(choose(""), hce_identity);
+  ASSERT_EQ(choose("identity"), hce_identity);
+  ASSERT_EQ(choose("deflate"), hce_deflate);
+  ASSERT_EQ(choose("gzip, deflate"), hce_gzip);
+  ASSERT_EQ(choose("x-gzip"), hce_gzip);
+  ASSERT_EQ(choose("GZIP"), hce_gzip);
+  ASSERT_EQ(choose("gzip, deflate, br"), hce_br);
+  ASSERT_EQ(choose("gzip, deflate, br, zstd"), hce_br);
+  ASSERT_EQ(choose("gzip, zstd"), hce_zstd);
+  ASSERT_EQ(choose("br;q=0.5, gzip;q=0.8"), hce_gzip);
+  ASSERT_EQ(choose("br; q=0.5 , gzip ;q=1.0"), hce_gzip);
+  ASSERT_EQ(choose("gzip;q=0"), hce_identity);
+  ASSERT_EQ(choose("gzip;q=0, deflate"), hce_deflate);
+  ASSERT_EQ(choose("*"), hce_br);
+  ASSERT_EQ(choose("*;q=0.1, br;q=0"), hce_zstd);
+  ASSERT_EQ(choose("gzip;q=2"), hce_identity);
+  ASSERT_EQ(choose("gzip;q=1.5"), hce_gzip);
+  ASSERT_EQ(choose("gzip;q=abc, deflate;q=0.001"), hce_deflate);
+  ASSERT_EQ(choose("compress, sdch"), hce_identity);
+}
+
+TEST(http_compression, streaming_round_trip) {
+  const std::string first_part = make_body(100000);
+  const std::string second_part = make_body(3000);
+  for (int encoding = hce_deflate; encoding <= hce_br; encoding++) {
+    const auto content_encoding = static_cast<http_content_encoding>(encoding);
+    SCOPED_TRACE(http_content_encoding_name(content_encoding));
+    // the second iteration gets the reused compressor
+    for (int iteration = 0; iteration < 2; iteration++) {
+      http_compressor *compressor = http_compressor_create(content_encoding);
+      ASSERT_NE(compressor, nullptr);
+      netbuffer_t *out = alloc_head_buffer();
+
+      int written = http_compressor_write(compressor, out, first_part.data(), static_cast<int>(first_part.size()), hco_flush);
+      ASSERT_GT(written, 0);
+      ASSERT_LT(written, static_cast<int>(first_part.size()));
+      ASSERT_EQ(written, get_total_ready_bytes(out));
+      std::string compressed = read_all(out);
+      ASSERT_EQ(decode(content_encoding, compressed), first_part);
+
+      written = http_compressor_write(compressor, out, second_part.data(), static_cast<int>(second_part.size()), hco_process);
+      ASSERT_GE(written, 0);
+      written += http_compressor_write(compressor, out, nullptr, 0, hco_finish);
+      ASSERT_GT(written, 0);
+      compressed += read_all(out);
+      ASSERT_EQ(decode(content_encoding, compressed), first_part + second_part);
+
+      http_compressor_free(compressor);
+      free_buffer(out);
+    }
+  }
+}
@@ -0,0 +1,330 @@
+// Compiler for PHP (aka KPHP)
+// Copyright (c) 2020 LLC «V Kontakte»
+// Distributed under the GPL v3 License, see LICENSE.notice.txt
+
+#include "net/net-http-compression.h"
+
+#include <assert.h>
+#include <brotli/encode.h>
+#include <ctype.h>
+#include <string.h>
+#include <zlib.h>
+#include <zstd.h>
+
+#include "common/kprintf.h"
+
+struct http_compressor {
+  explicit http_compressor(http_content_encoding encoding) :
+    encoding(encoding) {
+  }
+
+  virtual ~http_compressor() = default;
+
+  // prepares the compressor for the next response
+  virtual bool reset() = 0;
+  virtual int write(netbuffer_t *out, const char *data, int len, http_compressor_op op) = 0;
+
+  const http_content_encoding encoding;
+
+protected:
+  static constexpr int OUT_BUF_SIZE = 1 << 14;
+
+  static int flush_out(netbuffer_t *out, const char *buf, int len) {
+    return write_out(out, buf, len) == len ? len : -1;
+  }
+};
+
+namespace {
+
+constexpr int ZLIB_LEVEL = 6;
+constexpr int ZSTD_LEVEL = 3;
+constexpr int BROTLI_QUALITY = 5;
+
+class zlib_compressor final : public http_compressor {
+public:
+  explicit zlib_compressor(http_content_encoding encoding) :
+    http_compressor(encoding) {
+    memset(&strm_, 0, sizeof(strm_));
+    // the gzip wrapper for "gzip", the zlib one for "deflate"
+    const int window_bits = encoding == hce_gzip ? MAX_WBITS + 16 : MAX_WBITS;
+    initialized_ = deflateInit2(&strm_, ZLIB_LEVEL, Z_DEFLATED, window_bits, MAX_MEM_LEVEL, Z_DEFAULT_STRATEGY) == Z_OK;
+  }
+
+  ~zlib_compressor() final {
+    if (initialized_) {
+      deflateEnd(&strm_);
+    }
+  }
+
+  bool reset() final {
+    return initialized_ && deflateReset(&strm_) == Z_OK;
+  }
+
+  int write(netbuffer_t *out, const char *data, int len, http_compressor_op op) final {
+    const int flush = op == hco_finish ? Z_FINISH : (op == hco_flush ? Z_SYNC_FLUSH : Z_NO_FLUSH);
+    strm_.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(data));
+    strm_.avail_in = static_cast<uInt>(len);
+    int written = 0;
+    do {
+      char buf[OUT_BUF_SIZE];
+      strm_.next_out = reinterpret_cast<Bytef *>(buf);
+      strm_.avail_out = sizeof(buf);
+      if (deflate(&strm_, flush) == Z_STREAM_ERROR) {
+        return -1;
+      }
+      const int produced = static_cast<int>(sizeof(buf) - strm_.avail_out);
+      if (flush_out(out, buf, produced) < 0) {
+        return -1;
+      }
+      written += produced;
+    } while (strm_.avail_out == 0);
+    assert(strm_.avail_in == 0);
+    return written;
+  }
+
+private:
+  z_stream strm_;
+  bool initialized_{false};
+};
+
+class zstd_compressor final : public http_compressor {
+public:
+  zstd_compressor() :
+    http_compressor(hce_zstd),
+    cctx_(ZSTD_createCCtx()) {
+    if (cctx_) {
+      ZSTD_CCtx_setParameter(cctx_, ZSTD_c_compressionLevel, ZSTD_LEVEL);
+    }
+  }
+
+  ~zstd_compressor() final {
+    ZSTD_freeCCtx(cctx_);
+  }
+
+  bool reset() final {
+    return cctx_ && !ZSTD_isError(ZSTD_CCtx_reset(cctx_, ZSTD_reset_session_only));
+  }
+
+  int write(netbuffer_t *out, const char *data, int len, http_compressor_op op) final {
+    const ZSTD_EndDirective mode = op == hco_finish ? ZSTD_e_end : (op == hco_flush ? ZSTD_e_flush : ZSTD_e_continue);
+    ZSTD_inBuffer input{data, static_cast<size_t>(len), 0};
+    int written = 0;
+    bool done = false;
+    while (!done) {
+      char buf[OUT_BUF_SIZE];
+      ZSTD_outBuffer output{buf, sizeof(buf), 0};
+      const size_t remaining = ZSTD_compressStream2(cctx_, &output, &input, mode);
+      if (ZSTD_isError(remaining)) {
+        return -1;
+      }
+      if (flush_out(out, buf, static_cast<int>(output.pos)) < 0) {
+        return -1;
+      }
+      written += static_cast<int>(output.pos);
+      done = mode == ZSTD_e_continue ? input.pos == input.size : remaining == 0;
+    }
+    return written;
+  }
+
+private:
+  ZSTD_CCtx *cctx_;
+};
+
+class brotli_compressor final : public http_compressor {
+public:
+  brotli_compressor() :
+    http_compressor(hce_br) {
+  }
+
+  ~brotli_compressor() final {
+    if (state_) {
+      BrotliEncoderDestroyInstance(state_);
+    }
+  }
+
+  // brotli has no way to reset an encoder
+  bool reset() final {
+    if (state_) {
+      BrotliEncoderDestroyInstance(state_);
+    }
+    state_ = BrotliEncoderCreateInstance(nullptr, nullptr, nullptr);
+    return state_ && BrotliEncoderSetParameter(state_, BROTLI_PARAM_QUALITY, BROTLI_QUALITY);
+  }
+
+  int write(netbuffer_t *out, const char *data, int len, http_compressor_op op) final {
+    const BrotliEncoderOperation operation =
+      op == hco_finish ? BROTLI_OPERATION_FINISH : (op == hco_flush ? BROTLI_OPERATION_FLUSH : BROTLI_OPERATION_PROCESS);
+    size_t avail_in = static_cast<size_t>(len);
+    const uint8_t *next_in = reinterpret_cast<const uint8_t *>(data);
+    int written = 0;
+    bool done = false;
+    while (!done) {
+      char buf[OUT_BUF_SIZE];
+      size_t avail_out = sizeof(buf);
+      uint8_t *next_out = reinterpret_cast<uint8_t *>(buf);
+      if (!BrotliEncoderCompressStream(state_, operation, &avail_in, &next_in, &avail_out, &next_out, nullptr)) {
+        return -1;
+      }
+      const int produced = static_cast<int>(sizeof(buf) - avail_out);
+      if (flush_out(out, buf, produced) < 0) {
+        return -1;
+      }
+      written += produced;
+      done = avail_in == 0 && !BrotliEncoderHasMoreOutput(state_) &&
+             (operation != BROTLI_OPERATION_FINISH || BrotliEncoderIsFinished(state_));
+    }
+    return written;
+  }
+
+private:
+  BrotliEncoderState *state_{nullptr};
+};
+
+http_compressor *idle_compressors[hce_br + 1];
+
+// q-values are kept in thousandths
+int parse_qvalue(const char *s, const char *end) {
+  while (s < end && isspace(*s)) {
+    s++;
+  }
+  if (s == end || (*s != '0' && *s != '1')) {
+    return -1;
+  }
+  int q = (*s++ - '0') * 1000;
+  if (s < end && *s == '.') {
+    s++;
+    for (int scale = 100; scale > 0 && s < end && isdigit(*s); scale /= 10) {
+      q += (*s++ - '0') * scale;
+    }
+  }
+  return q > 1000 ? 1000 : q;
+}
+
+} // namespace
+
+const char *http_content_encoding_name(http_content_encoding encoding) {
+  switch (encoding) {
+    case hce_identity:
+      return "identity";
+    case hce_deflate:
+      return "deflate";
+    case hce_gzip:
+      return "gzip";
+    case hce_zstd:
+      return "zstd";
+    case hce_br:
+      return "br";
+  }
+  assert(0);
+  return nullptr;
+}
+
+http_content_encoding http_choose_content_encoding(const char *accept_encoding, int len) {
+  // -1 means that the coding is not mentioned
+  int qvalues[hce_br + 1];
+  int wildcard_qvalue = -1;
+  for (int &q : qvalues) {
+    q = -1;
+  }
+
+  const char *end = accept_encoding + len;
+  for (const char *s = accept_encoding; s < end;) {
+    const char *item_end = static_cast<const char *>(memchr(s, ',', end - s));
+    if (!item_end) {
+      item_end = end;
+    }
+    while (s < item_end && isspace(*s)) {
+      s++;
+    }
+    const char *name_end = s;
+    while (name_end < item_end && *name_end != ';' && !isspace(*name_end)) {
+      name_end++;
+    }
+
+    int q = 1000;
+    for (const char *p = name_end; p + 1 < item_end; p++) {
+      if (p[0] == ';') {
+        const char *param = p + 1;
+        while (param < item_end && isspace(*param)) {
+          param++;
+        }
+        if (param + 1 < item_end && (param[0] == 'q' || param[0] == 'Q') && param[1] == '=') {
+          q = parse_qvalue(param + 2, item_end);
+          break;
+        }
+      }
+    }
+
+    const int name_len = static_cast<int>(name_end - s);
+    if (q >= 0 && name_len > 0) {
+      if (name_len == 1 && *s == '*') {
+        wildcard_qvalue = q;
+      } else {
+        for (int encoding = hce_deflate; encoding <= hce_br; encoding++) {
+          const char *name = http_content_encoding_name(static_cast<http_content_encoding>(encoding));
+          if (static_cast<int>(strlen(name)) == name_len && !strncasecmp(s, name, name_len)) {
+            qvalues[encoding] = q;
+          }
+        }
+        // x-gzip is an alias of gzip
+        if (name_len == 6 && !strncasecmp(s, "x-gzip", 6) && qvalues[hce_gzip] < 0) {
+          qvalues[hce_gzip] = q;
+        }
+      }
+    }
+    s = item_end + 1;
+  }
+
+  http_content_encoding best = hce_identity;
+  int best_q = 0;
+  for (int encoding = hce_br; encoding >= hce_deflate; encoding--) {
+    const int q = qvalues[encoding] >= 0 ? qvalues[encoding] : wildcard_qvalue;
+    if (q > best_q) {
+      best = static_cast<http_content_encoding>(encoding);
+      best_q = q;
+    }
+  }
+  return best;
+}
+
+http_compressor *http_compressor_create(http_content_encoding encoding) {
+  assert(hce_deflate <= encoding && encoding <= hce_br);
+  if (http_compressor *compressor = idle_compressors[encoding]) {
+    idle_compressors[encoding] = nullptr;
+    return compressor;
+  }
+
+  http_compressor *compressor = nullptr;
+  switch (encoding) {
+    case hce_deflate:
+    case hce_gzip:
+      compressor = new zlib_compressor(encoding);
+      break;
+    case hce_zstd:
+      compressor = new zstd_compressor();
+      break;
+    case hce_br:
+      compressor = new brotli_compressor();
+      break;
+    case hce_identity:
+      break;
+  }
+  if (!compressor->reset()) {
+    kprintf("can't create %s compressor\n", http_content_encoding_name(encoding));
+    delete compressor;
+    return nullptr;
+  }
+  return compressor;
+}
+
+void http_compressor_free(http_compressor *compressor) {
+  if (compressor->reset() && !idle_compressors[compressor->encoding]) {
+    idle_compressors[compressor->encoding] = compressor;
+  } else {
+    delete compressor;
+  }
+}
+
+int http_compressor_write(http_compressor *compressor, netbuffer_t *out, const char *data, int len, http_compressor_op op) {
+  return compressor->write(out, data, len, op);
+}
@@ -0,0 +1,42 @@
+// Compiler for PHP (aka KPHP)
+// Copyright (c) 2020 LLC «V Kontakte»
+// Distributed under the GPL v3 License, see LICENSE.notice.txt
+
+#ifndef KDB_NET_NET_HTTP_COMPRESSION_H
+#define KDB_NET_NET_HTTP_COMPRESSION_H
+
+#include <sys/cdefs.h>
+
+#include "net/net-buffers.h"
+
+// the values are passed from the runtime to the server with the script result
+enum http_content_encoding {
+  hce_identity,
+  hce_deflate,
+  hce_gzip,
+  hce_zstd,
+  hce_br,
+};
+
+// the encoding with the highest q-value in the Accept-Encoding header value,
+// the ties are resolved in the order br, zstd, gzip, deflate; hce_identity if none is acceptable
+http_content_encoding http_choose_content_encoding(const char *accept_encoding, int len);
+const char *http_content_encoding_name(http_content_encoding encoding);
+
+enum http_compressor_op {
+  hco_process,
+  // everything written so far becomes decodable by the client, used before sending a chunk
+  hco_flush,
+  hco_finish,
+};
+
+// a streaming compressor of a response body, the compressors are cached and reused between the responses
+struct http_compressor;
+
+http_compressor *http_compressor_create(http_content_encoding encoding);
+void http_compressor_free(http_compressor *compressor);
+
+// compresses the data and appends the result to out; returns the number of the appended bytes or -1 on error
+int http_compressor_write(http_compressor *compressor, netbuffer_t *out, const char *data, int len, http_compressor_op op);
+
+#endif // KDB_NET_NET_HTTP_COMPRESSION_H
@@ -0,0 +1,74 @@
+// Compiler for PHP (aka KPHP)
+// Copyright (c) 2020 LLC «V Kontakte»
+// Distributed under the GPL v3 License, see LICENSE.notice.txt
+
+#include "net/net-io-uring.h"
+
+#include <errno.h>
+#include <poll.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <gtest/gtest.h>
+#include <numeric>
+#include <vector>
+
+TEST(net_io_uring, completions_are_kept_on_overflow) {
+  net_io_uring_t ring;
+  // the submission queue has a single entry and the completion queue has 4
+  if (!net_io_uring_init(&ring, 1)) {
+    // the kernel doesn't support io_uring
+    return;
+  }
+  int fds[2];
+  ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, fds), 0);
+  ASSERT_EQ(write(fds[1], "x", 1), 1);
+
+  // every poll of the readable socket completes at once, so most of the completions overflow the queue
+  constexpr uint64_t POLLS = 64;
+  int64_t syscalls = 0;
+  for (uint64_t i = 0; i != POLLS; ++i) {
+    io_uring_sqe *sqe = net_io_uring_get_sqe(&ring, &syscalls);
+    ASSERT_NE(sqe, nullptr) << strerror(errno);
+    net_io_uring_prep_poll_add(sqe, fds[0], POLLIN, false, i);
+  }
+
+  std::vector<uint64_t> completed;
+  for (int i = 0; i != 100 && completed.size() != POLLS; ++i) {
+    net_io_uring_submit_and_wait(&ring, 0, &syscalls);
+    uint64_t user_data = 0;
+    int32_t res = 0;
+    bool more = true;
+    while (net_io_uring_pop_cqe(&ring, &user_data, &res, &more)) {
+      EXPECT_TRUE(res & POLLIN);
+      EXPECT_FALSE(more);
+      completed.push_back(user_data);
+    }
+  }
+  std::vector<uint64_t> expected(POLLS);
+  std::iota(expected.begin(), expected.end(), 0);
+  EXPECT_EQ(completed, expected);
+
+  close(fds[0]);
+  close(fds[1]);
+  net_io_uring_free(&ring);
+}
+
+TEST(net_io_uring, no_entry_after_failure) {
+  net_io_uring_t ring;
+  if (!net_io_uring_init(&ring, 1)) {
+    return;
+  }
+  int64_t syscalls = 0;
+  ASSERT_NE(net_io_uring_get_sqe(&ring, &syscalls), nullptr);
+
+  // the full ring can't be flushed to a broken fd
+  const int ring_fd = ring.fd;
+  ring.fd = -1;
+  EXPECT_EQ(net_io_uring_get_sqe(&ring, &syscalls), nullptr);
+  EXPECT_EQ(errno, EBADF);
+
+  ring.fd = ring_fd;
+  net_io_uring_free(&ring);
+}
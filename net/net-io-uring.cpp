@@ -0,0 +1,277 @@
+// Compiler for PHP (aka KPHP)
+// Copyright (c) 2020 LLC «V Kontakte»
+// Distributed under the GPL v3 License, see LICENSE.notice.txt
+
+#include "net/net-io-uring.h"
+
+#include <algorithm>
+#include <assert.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#if __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#endif
+
+#include "common/kernel-version.h"
+#include "common/kprintf.h"
+
+#if defined(IORING_FEAT_EXT_ARG) && defined(IORING_POLL_ADD_MULTI) && defined(__NR_io_uring_setup)
+#define NET_IO_URING_SUPPORTED 1
+#endif
+
+#ifdef NET_IO_URING_SUPPORTED
+
+static int sys_io_uring_setup(unsigned entries, struct io_uring_params *params) {
+  return static_cast<int>(syscall(__NR_io_uring_setup, entries, params));
+}
+
+static int sys_io_uring_enter(int fd, unsigned to_submit, unsigned min_complete, unsigned flags, const void *arg, size_t arg_size) {
+  return static_cast<int>(syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, arg, arg_size));
+}
+
+template<class T>
+static T *ring_field(void *ring_ptr, unsigned offset) {
+  return reinterpret_cast<T *>(static_cast<char *>(ring_ptr) + offset);
+}
+
+bool net_io_uring_init(net_io_uring_t *ring, unsigned entries) {
+  memset(ring, 0, sizeof(*ring));
+  ring->fd = -1;
+  if (!io_uring_multishot_poll_supported()) {
+    kprintf("io_uring multishot poll needs linux 5.13+\n");
+    return false;
+  }
+
+  struct io_uring_params params;
+  memset(&params, 0, sizeof(params));
+  // the poll completions come in bursts, so the completion queue is bigger than the submission one
+  params.flags = IORING_SETUP_CQSIZE;
+  params.cq_entries = entries * 4;
+  const int fd = sys_io_uring_setup(entries, &params);
+  if (fd < 0) {
+    kprintf("io_uring_setup(): %m\n");
+    return false;
+  }
+  if (!(params.features & IORING_FEAT_EXT_ARG) || !(params.features & IORING_FEAT_NODROP)) {
+    kprintf("io_uring doesn't support wait timeouts or guaranteed completions\n");
+    close(fd);
+    return false;
+  }
+  ring->fd = fd;
+
+  ring->sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+  ring->cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+  if (params.features & IORING_FEAT_SINGLE_MMAP) {
+    ring->sq_ring_size = ring->cq_ring_size = std::max(ring->sq_ring_size, ring->cq_ring_size);
+  }
+  ring->sq_ring_ptr = mmap(nullptr, ring->sq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+  if (ring->sq_ring_ptr == MAP_FAILED) {
+    ring->sq_ring_ptr = nullptr;
+    kprintf("io_uring sq ring mmap(): %m\n");
+    net_io_uring_free(ring);
+    return false;
+  }
+  if (params.features & IORING_FEAT_SINGLE_MMAP) {
+    ring->cq_ring_ptr = ring->sq_ring_ptr;
+  } else {
+    ring->cq_ring_ptr = mmap(nullptr, ring->cq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+    if (ring->cq_ring_ptr == MAP_FAILED) {
+      ring->cq_ring_ptr = nullptr;
+      kprintf("io_uring cq ring mmap(): %m\n");
+      net_io_uring_free(ring);
+      return false;
+    }
+  }
+  ring->sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+  void *sqes = mmap(nullptr, ring->sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+  if (sqes == MAP_FAILED) {
+    kprintf("io_uring sqes mmap(): %m\n");
+    net_io_uring_free(ring);
+    return false;
+  }
+  ring->sqes = static_cast<struct io_uring_sqe *>(sqes);
+
+  ring->sq_head = ring_field<unsigned>(ring->sq_ring_ptr, params.sq_off.head);
+  ring->sq_tail = ring_field<unsigned>(ring->sq_ring_ptr, params.sq_off.tail);
+  ring->sq_array = ring_field<unsigned>(ring->sq_ring_ptr, params.sq_off.array);
+  ring->sq_mask = *ring_field<unsigned>(ring->sq_ring_ptr, params.sq_off.ring_mask);
+  ring->sq_entries = params.sq_entries;
+  ring->sq_pending = 0;
+
+  ring->cq_head = ring_field<unsigned>(ring->cq_ring_ptr, params.cq_off.head);
+  ring->cq_tail = ring_field<unsigned>(ring->cq_ring_ptr, params.cq_off.tail);
+  ring->cq_mask = *ring_field<unsigned>(ring->cq_ring_ptr, params.cq_off.ring_mask);
+  ring->cqes = ring_field<struct io_uring_cqe>(ring->cq_ring_ptr, params.cq_off.cqes);
+
+  // cq_entries is a power of 2
+  ring->reaped = static_cast<struct net_io_uring_cqe_copy *>(calloc(params.cq_entries, sizeof(ring->reaped[0])));
+  ring->reaped_mask = params.cq_entries - 1;
+  return true;
+}
+
+void net_io_uring_free(net_io_uring_t *ring) {
+  free(ring->reaped);
+  if (ring->sqes) {
+    munmap(ring->sqes, ring->sqes_size);
+  }
+  if (ring->cq_ring_ptr && ring->cq_ring_ptr != ring->sq_ring_ptr) {
+    munmap(ring->cq_ring_ptr, ring->cq_ring_size);
+  }
+  if (ring->sq_ring_ptr) {
+    munmap(ring->sq_ring_ptr, ring->sq_ring_size);
+  }
+  if (ring->fd >= 0) {
+    close(ring->fd);
+  }
+  memset(ring, 0, sizeof(*ring));
+  ring->fd = -1;
+}
+
+static int net_io_uring_enter(net_io_uring_t *ring, unsigned min_complete, unsigned flags, const void *arg, size_t arg_size, int64_t *syscalls) {
+  int res;
+  do {
+    ++*syscalls;
+    res = sys_io_uring_enter(ring->fd, ring->sq_pending, min_complete, flags, arg, arg_size);
+  } while (res < 0 && errno == EINTR && !min_complete);
+  if (res >= 0) {
+    ring->sq_pending -= static_cast<unsigned>(res);
+  }
+  return res;
+}
+
+static bool net_io_uring_read_cqe(net_io_uring_t *ring, struct net_io_uring_cqe_copy *copy) {
+  const unsigned head = *ring->cq_head;
+  if (head == __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE)) {
+    return false;
+  }
+  const struct io_uring_cqe *cqe = static_cast<const struct io_uring_cqe *>(ring->cqes) + (head & ring->cq_mask);
+  copy->user_data = cqe->user_data;
+  copy->res = cqe->res;
+  copy->more = cqe->flags & IORING_CQE_F_MORE;
+  __atomic_store_n(ring->cq_head, head + 1, __ATOMIC_RELEASE);
+  return true;
+}
+
+// frees the completion queue, so the kernel can flush the overflowed completions and take the submissions again
+static unsigned net_io_uring_reap_cqes(net_io_uring_t *ring) {
+  unsigned reaped = 0;
+  while (ring->reaped_tail - ring->reaped_head <= ring->reaped_mask
+         && net_io_uring_read_cqe(ring, &ring->reaped[ring->reaped_tail & ring->reaped_mask])) {
+    ++ring->reaped_tail;
+    ++reaped;
+  }
+  return reaped;
+}
+
+struct io_uring_sqe *net_io_uring_get_sqe(net_io_uring_t *ring, int64_t *syscalls) {
+  while (*ring->sq_tail - __atomic_load_n(ring->sq_head, __ATOMIC_ACQUIRE) >= ring->sq_entries) {
+    const int res = net_io_uring_enter(ring, 0, 0, nullptr, 0, syscalls);
+    if (res > 0) {
+      continue;
+    }
+    if (res == 0) {
+      errno = EAGAIN;
+    }
+    // EBUSY: the completion queue has overflowed, EAGAIN: the kernel is out of resources until some requests are completed
+    if ((errno == EBUSY || errno == EAGAIN) && net_io_uring_reap_cqes(ring)) {
+      continue;
+    }
+    return nullptr;
+  }
+  const unsigned tail = *ring->sq_tail;
+  const unsigned index = tail & ring->sq_mask;
+  struct io_uring_sqe *sqe = &ring->sqes[index];
+  memset(sqe, 0, sizeof(*sqe));
+  ring->sq_array[index] = index;
+  __atomic_store_n(ring->sq_tail, tail + 1, __ATOMIC_RELEASE);
+  ++ring->sq_pending;
+  return sqe;
+}
+
+void net_io_uring_prep_poll_add(struct io_uring_sqe *sqe, int fd, unsigned poll_mask, bool multishot, uint64_t user_data) {
+  sqe->opcode = IORING_OP_POLL_ADD;
+  sqe->fd = fd;
+  sqe->poll32_events = poll_mask;
+  sqe->len = multishot ? IORING_POLL_ADD_MULTI : 0;
+  sqe->user_data = user_data;
+}
+
+void net_io_uring_prep_poll_remove(struct io_uring_sqe *sqe, uint64_t target_user_data, uint64_t user_data) {
+  sqe->opcode = IORING_OP_POLL_REMOVE;
+  sqe->fd = -1;
+  sqe->addr = target_user_data;
+  sqe->user_data = user_data;
+}
+
+int net_io_uring_submit_and_wait(net_io_uring_t *ring, int timeout_ms, int64_t *syscalls) {
+  struct __kernel_timespec ts;
+  struct io_uring_getevents_arg arg;
+  memset(&arg, 0, sizeof(arg));
+  if (timeout_ms >= 0) {
+    ts.tv_sec = timeout_ms / 1000;
+    ts.tv_nsec = (timeout_ms % 1000) * 1000000LL;
+    arg.ts = reinterpret_cast<uint64_t>(&ts);
+  }
+  const unsigned min_complete = timeout_ms == 0 ? 0 : 1;
+  const int res = net_io_uring_enter(ring, min_complete, IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG, &arg, sizeof(arg), syscalls);
+  if (res < 0 && errno == ETIME) {
+    return 0;
+  }
+  return res < 0 ? -1 : 0;
+}
+
+bool net_io_uring_pop_cqe(net_io_uring_t *ring, uint64_t *user_data, int32_t *res, bool *more) {
+  struct net_io_uring_cqe_copy copy;
+  if (ring->reaped_head != ring->reaped_tail) {
+    copy = ring->reaped[ring->reaped_head++ & ring->reaped_mask];
+  } else if (!net_io_uring_read_cqe(ring, &copy)) {
+    return false;
+  }
+  *user_data = copy.user_data;
+  *res = copy.res;
+  *more = copy.more;
+  return true;
+}
+
+#else
+
+bool net_io_uring_init(net_io_uring_t *ring, unsigned) {
+  memset(ring, 0, sizeof(*ring));
+  ring->fd = -1;
+  kprintf("the binary is built without io_uring support\n");
+  return false;
+}
+
+void net_io_uring_free(net_io_uring_t *ring) {
+  memset(ring, 0, sizeof(*ring));
+  ring->fd = -1;
+}
+
+struct io_uring_sqe *net_io_uring_get_sqe(net_io_uring_t *, int64_t *) {
+  assert(false);
+  return nullptr;
+}
+
+void net_io_uring_prep_poll_add(struct io_uring_sqe *, int, unsigned, bool, uint64_t) {
+  assert(false);
+}
+
+void net_io_uring_prep_poll_remove(struct io_uring_sqe *, uint64_t, uint64_t) {
+  assert(false);
+}
+
+int net_io_uring_submit_and_wait(net_io_uring_t *, int, int64_t *) {
+  errno = ENOSYS;
+  return -1;
+}
+
+bool net_io_uring_pop_cqe(net_io_uring_t *, uint64_t *, int32_t *, bool *) {
+  return false;
+}
+
+#endif
@@ -0,0 +1,71 @@
+// Compiler for PHP (aka KPHP)
+// Copyright (c) 2020 LLC «V Kontakte»
+// Distributed under the GPL v3 License, see LICENSE.notice.txt
+
+#ifndef KDB_NET_NET_IO_URING_H
+#define KDB_NET_NET_IO_URING_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/cdefs.h>
+
+// A minimal io_uring wrapper over the raw syscalls, it only knows what the net reactor needs:
+// the submission entries are queued without syscalls and go to the kernel together with the wait.
+struct io_uring_sqe;
+
+struct net_io_uring_cqe_copy {
+  uint64_t user_data;
+  int32_t res;
+  bool more;
+};
+
+struct net_io_uring {
+  int fd;
+
+  unsigned *sq_head;
+  unsigned *sq_tail;
+  unsigned *sq_array;
+  unsigned sq_mask;
+  unsigned sq_entries;
+  unsigned sq_pending;
+  struct io_uring_sqe *sqes;
+
+  unsigned *cq_head;
+  unsigned *cq_tail;
+  unsigned cq_mask;
+  void *cqes;
+
+  // the completions taken out of the completion queue to let the kernel accept new submissions, they are popped first
+  struct net_io_uring_cqe_copy *reaped;
+  unsigned reaped_head;
+  unsigned reaped_tail;
+  unsigned reaped_mask;
+
+  void *sq_ring_ptr;
+  size_t sq_ring_size;
+  void *cq_ring_ptr;
+  size_t cq_ring_size;
+  size_t sqes_size;
+};
+typedef struct net_io_uring net_io_uring_t;
+
+// fails if the kernel or the headers the binary was built with don't support everything the reactor relies on
+bool net_io_uring_init(net_io_uring_t *ring, unsigned entries);
+void net_io_uring_free(net_io_uring_t *ring);
+
+// flushes the pending entries to the kernel if the ring is full,
+// returns NULL and sets errno if the kernel doesn't accept them even after the completion queue is reaped
+struct io_uring_sqe *net_io_uring_get_sqe(net_io_uring_t *ring, int64_t *syscalls);
+void net_io_uring_prep_poll_add(struct io_uring_sqe *sqe, int fd, unsigned poll_mask, bool multishot, uint64_t user_data);
+void net_io_uring_prep_poll_remove(struct io_uring_sqe *sqe, uint64_t target_user_data, uint64_t user_data);
+
+// submits the pending entries and waits for at least one completion (timeout < 0 is infinite, 0 doesn't wait),
+// returns -1 and sets errno on failure, a timeout is not a failure
+int net_io_uring_submit_and_wait(net_io_uring_t *ring, int timeout_ms, int64_t *syscalls);
+
+// takes the next ready completion, returns false if there are none;
+// more is false when it is the last completion of a multishot request
+bool net_io_uring_pop_cqe(net_io_uring_t *ring, uint64_t *user_data, int32_t *res, bool *more);
+
+#endif // KDB_NET_NET_IO_URING_H
@@ -0,0 +1,136 @@
+// Compiler for PHP (aka KPHP)
+// Copyright (c) 2020 LLC «V Kontakte»
+// Distributed under the GPL v3 License, see LICENSE.notice.txt
+
+#include <benchmark/benchmark.h>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "net/net-reactor.h"
+
+namespace {
+
+constexpr size_t RPC_SIZE = 64;
+
+struct LoopbackPair {
+  int client_fd{-1};
+  int server_fd{-1};
+  bool response_received{false};
+  bool toggle_write_interest{false};
+};
+
+int make_nonblocking_tcp_socket() {
+  const int fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+  const int one = 1;
+  setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+  return fd;
+}
+
+bool connect_loopback_pair(LoopbackPair *pair) {
+  const int listen_fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  sockaddr_in addr{};
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  socklen_t addr_len = sizeof(addr);
+  if (bind(listen_fd, reinterpret_cast<sockaddr *>(&addr), addr_len) != 0 || listen(listen_fd, 1) != 0 ||
+      getsockname(listen_fd, reinterpret_cast<sockaddr *>(&addr), &addr_len) != 0) {
+    close(listen_fd);
+    return false;
+  }
+  pair->client_fd = make_nonblocking_tcp_socket();
+  connect(pair->client_fd, reinterpret_cast<sockaddr *>(&addr), addr_len);
+  pair->server_fd = accept4(listen_fd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+  close(listen_fd);
+  const int one = 1;
+  setsockopt(pair->server_fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+  return pair->server_fd >= 0;
+}
+
+// the reactor is edge-triggered, so the handlers read until the socket is empty
+size_t read_all(int fd) {
+  char buf[4096];
+  size_t total = 0;
+  ssize_t r;
+  while ((r = read(fd, buf, sizeof(buf))) > 0) {
+    total += r;
+  }
+  return total;
+}
+
+// like the connections with pending output, the server may ask for the write readiness after a response
+int server_handler(int fd, void *data, event_t *) {
+  char response[RPC_SIZE] = {};
+  bool written = false;
+  for (size_t n = read_all(fd) / RPC_SIZE; n; --n) {
+    benchmark::DoNotOptimize(write(fd, response, sizeof(response)));
+    written = true;
+  }
+  if (!static_cast<LoopbackPair *>(data)->toggle_write_interest) {
+    return EVA_CONTINUE;
+  }
+  return written ? EVT_RWX : EVT_READ | EVT_SPEC;
+}
+
+int client_handler(int fd, void *data, event_t *) {
+  if (read_all(fd)) {
+    static_cast<LoopbackPair *>(data)->response_received = true;
+  }
+  return EVA_CONTINUE;
+}
+
+// an RPC is a request written by the client and the response written back by the server handler,
+// the reactor_syscalls_per_rpc counter shows the syscalls made by the reactor itself besides read() and write()
+void BM_loopback_rpc(benchmark::State &state) {
+  net_reactor_use_io_uring(state.range(0));
+  net_reactor_ctx_t ctx;
+  if (!net_reactor_create(&ctx, 1024, 16)) {
+    state.SkipWithError("can't create the reactor");
+    return;
+  }
+  if (state.range(0) && !ctx.uring) {
+    state.SkipWithError("io_uring is not supported");
+    net_reactor_destroy(&ctx);
+    net_reactor_free(&ctx);
+    return;
+  }
+
+  LoopbackPair pair;
+  pair.toggle_write_interest = state.range(1);
+  if (!connect_loopback_pair(&pair)) {
+    state.SkipWithError("can't connect the loopback sockets");
+    return;
+  }
+  net_reactor_set_handler(&ctx, pair.server_fd, 0, server_handler, &pair);
+  net_reactor_insert(&ctx, pair.server_fd, EVT_READ | EVT_SPEC);
+  net_reactor_set_handler(&ctx, pair.client_fd, 0, client_handler, &pair);
+  net_reactor_insert(&ctx, pair.client_fd, EVT_READ | EVT_SPEC);
+
+  const char request[RPC_SIZE] = {};
+  const int64_t syscalls_before = ctx.syscalls;
+  for (auto _ : state) {
+    pair.response_received = false;
+    benchmark::DoNotOptimize(write(pair.client_fd, request, sizeof(request)));
+    while (!pair.response_received) {
+      net_reactor_work(&ctx, 1000);
+    }
+  }
+  state.counters["reactor_syscalls_per_rpc"] =
+    benchmark::Counter(static_cast<double>(ctx.syscalls - syscalls_before) / static_cast<double>(state.iterations()));
+
+  net_reactor_close(&ctx, pair.client_fd);
+  net_reactor_close(&ctx, pair.server_fd);
+  close(pair.client_fd);
+  close(pair.server_fd);
+  net_reactor_destroy(&ctx);
+  net_reactor_free(&ctx);
+}
+
+} // namespace
+
+BENCHMARK(BM_loopback_rpc)->ArgNames({"io_uring", "toggle_write"})->Ranges({{0, 1}, {0, 1}});
+
+BENCHMARK_MAIN();
@@ -0,0 +1,189 @@
+// Compiler for PHP (aka KPHP)
+// Copyright (c) 2020 LLC «V Kontakte»
+// Distributed under the GPL v3 License, see LICENSE.notice.txt
+
+#include "net/net-reactor.h"
+
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <gtest/gtest.h>
+#include <vector>
+
+#include "common/container_of.h"
+#include "common/precise-time.h"
+
+#include "net/net-io-uring.h"
+
+namespace {
+
+int handler_calls[2];
+
+int count_handler_calls(int fd, void *data, event_t *) {
+  char buf[16];
+  while (read(fd, buf, sizeof(buf)) > 0) {
+  }
+  ++handler_calls[*static_cast<int *>(data)];
+  return EVA_CONTINUE;
+}
+
+void check_reactor_events(bool io_uring) {
+  net_reactor_use_io_uring(io_uring);
+  net_reactor_ctx_t ctx;
+  ASSERT_TRUE(net_reactor_create(&ctx, 64, 4));
+  net_reactor_use_io_uring(false);
+  if (io_uring && !ctx.uring) {
+    net_reactor_destroy(&ctx);
+    net_reactor_free(&ctx);
+    // the kernel doesn't support io_uring, the reactor has fallen back to epoll
+    return;
+  }
+
+  int edge_fds[2];
+  int level_fds[2];
+  ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, edge_fds), 0);
+  ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, level_fds), 0);
+  int ids[2] = {0, 1};
+  handler_calls[0] = handler_calls[1] = 0;
+
+  net_reactor_set_handler(&ctx, edge_fds[0], 0, count_handler_calls, &ids[0]);
+  net_reactor_insert(&ctx, edge_fds[0], EVT_READ | EVT_SPEC);
+  net_reactor_set_handler(&ctx, level_fds[0], 0, count_handler_calls, &ids[1]);
+  net_reactor_insert(&ctx, level_fds[0], EVT_READ | EVT_LEVEL);
+  EXPECT_EQ(!!(ctx.events[edge_fds[0]].state & EVT_IN_URING), io_uring);
+  EXPECT_TRUE(ctx.events[level_fds[0]].state & EVT_IN_EPOLL);
+
+  ASSERT_EQ(write(edge_fds[1], "x", 1), 1);
+  ASSERT_EQ(write(level_fds[1], "x", 1), 1);
+  for (int i = 0; i < 10 && (!handler_calls[0] || !handler_calls[1]); ++i) {
+    net_reactor_work(&ctx, 100);
+  }
+  EXPECT_EQ(handler_calls[0], 1);
+  EXPECT_EQ(handler_calls[1], 1);
+
+  // the removed fd doesn't get the events, the stale completions are dropped
+  net_reactor_remove(&ctx, edge_fds[0]);
+  ASSERT_EQ(write(edge_fds[1], "x", 1), 1);
+  net_reactor_work(&ctx, 10);
+  EXPECT_EQ(handler_calls[0], 1);
+
+  // it gets them again after being inserted back
+  net_reactor_insert(&ctx, edge_fds[0], EVT_READ | EVT_SPEC);
+  ASSERT_EQ(write(edge_fds[1], "x", 1), 1);
+  for (int i = 0; i < 10 && handler_calls[0] == 1; ++i) {
+    net_reactor_work(&ctx, 100);
+  }
+  EXPECT_EQ(handler_calls[0], 2);
+
+  for (int fd : {edge_fds[0], level_fds[0]}) {
+    net_reactor_close(&ctx, fd);
+  }
+  for (int fd : {edge_fds[0], edge_fds[1], level_fds[0], level_fds[1]}) {
+    close(fd);
+  }
+  net_reactor_destroy(&ctx);
+  net_reactor_free(&ctx);
+}
+
+void check_uring_fallback_to_epoll() {
+  net_reactor_use_io_uring(true);
+  net_reactor_ctx_t ctx;
+  ASSERT_TRUE(net_reactor_create(&ctx, 64, 4));
+  net_reactor_use_io_uring(false);
+  if (!ctx.uring) {
+    net_reactor_destroy(&ctx);
+    net_reactor_free(&ctx);
+    return;
+  }
+
+  int fds[2];
+  ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, fds), 0);
+  int id = 0;
+  handler_calls[0] = 0;
+  net_reactor_set_handler(&ctx, fds[0], 0, count_handler_calls, &id);
+  net_reactor_insert(&ctx, fds[0], EVT_READ | EVT_SPEC);
+  ASSERT_TRUE(ctx.events[fds[0]].state & EVT_IN_URING);
+
+  // the ring breaks, and the submission queue is filled with the poll updates until they can't be flushed
+  const int ring_fd = ctx.uring->fd;
+  ctx.uring->fd = -1;
+  for (int i = 0; i != 100000 && ctx.uring; ++i) {
+    net_reactor_insert(&ctx, fds[0], i % 2 ? EVT_READ | EVT_SPEC : EVT_READ | EVT_WRITE | EVT_SPEC);
+  }
+  close(ring_fd);
+  ASSERT_EQ(ctx.uring, nullptr);
+  EXPECT_FALSE(ctx.events[fds[0]].state & EVT_IN_URING);
+  EXPECT_TRUE(ctx.events[fds[0]].state & EVT_IN_EPOLL);
+
+  net_reactor_insert(&ctx, fds[0], EVT_READ | EVT_SPEC);
+  ASSERT_EQ(write(fds[1], "x", 1), 1);
+  for (int i = 0; i < 10 && !handler_calls[0]; ++i) {
+    net_reactor_work(&ctx, 100);
+  }
+  EXPECT_EQ(handler_calls[0], 1);
+
+  net_reactor_close(&ctx, fds[0]);
+  close(fds[0]);
+  close(fds[1]);
+  net_reactor_destroy(&ctx);
+  net_reactor_free(&ctx);
+}
+
+struct test_timer {
+  event_timer_t et;
+  int id;
+};
+
+std::vector<int> woken_timers;
+
+int remember_wakeup(event_timer_t *et) {
+  woken_timers.push_back(container_of(et, test_timer, et)->id);
+  return 0;
+}
+
+} // namespace
+
+TEST(net_reactor, timers) {
+  net_reactor_ctx_t ctx;
+  ASSERT_TRUE(net_reactor_create(&ctx, 64, 8));
+  woken_timers.clear();
+
+  test_timer timers[4];
+  const double delays[4] = {0.03, 0.01, 0.02, 0.015};
+  const double start = get_utime_monotonic();
+  for (int i = 0; i < 4; i++) {
+    timers[i] = test_timer{};
+    timers[i].id = i;
+    timers[i].et.wakeup = remember_wakeup;
+    timers[i].et.wakeup_time = start + delays[i];
+    EXPECT_GT(net_reactor_insert_event_timer(&ctx, &timers[i].et), 0);
+  }
+  EXPECT_EQ(net_reactor_timers(&ctx), 4);
+  EXPECT_EQ(net_reactor_remove_event_timer(&ctx, &timers[3].et), 1);
+  EXPECT_EQ(net_reactor_remove_event_timer(&ctx, &timers[3].et), 0);
+  // the rescheduled timer is moved, not added twice
+  timers[2].et.wakeup_time = start + 0.04;
+  net_reactor_insert_event_timer(&ctx, &timers[2].et);
+  EXPECT_EQ(net_reactor_timers(&ctx), 3);
+
+  while (net_reactor_timers(&ctx) && get_utime_monotonic() < start + 5) {
+    net_reactor_work(&ctx, 100);
+  }
+  EXPECT_EQ(woken_timers, (std::vector<int>{1, 0, 2}));
+  EXPECT_GE(precise_now, start + 0.04);
+
+  net_reactor_destroy(&ctx);
+  net_reactor_free(&ctx);
+}
+
+TEST(net_reactor, epoll_events) {
+  check_reactor_events(false);
+}
+
+TEST(net_reactor, io_uring_events) {
+  check_reactor_events(true);
+}
+
+TEST(net_reactor, io_uring_fallback_to_epoll) {
+  check_uring_fallback_to_epoll();
+}
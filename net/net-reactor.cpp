@@ -7,10 +7,14 @@
 #include <algorithm>
 #include <assert.h>
 #include <errno.h>
+#include <math.h>
+#include <poll.h>
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
+#include <vector>
 
+#include "common/container_of.h"
 #include "common/kernel-version.h"
 #include "common/kprintf.h"
 #include "common/options.h"
@@ -18,6 +22,7 @@
 #include "common/precise-time.h"
 #include "common/server/signals.h"
 
+#include "net/net-io-uring.h"
 #include "net/net-msg-buffers.h"
 #include "net/time-slice.h"
 
@@ -25,6 +30,12 @@ DEFINE_VERBOSITY(net_events);
 
 static int epoll_sleep_time;
 static const double max_time_slice = 0.05;
+static bool use_io_uring;
+
+static constexpr unsigned IO_URING_ENTRIES = 4096;
+// the poll of the epoll fd and the poll removals, the other requests are (generation << 32) | fd
+static constexpr uint64_t IO_URING_EPOLL_USER_DATA = ~0ULL;
+static constexpr uint64_t IO_URING_IGNORED_USER_DATA = ~0ULL - 1;
 
 OPTION_PARSER(OPT_NETWORK, "epoll-sleep-time", required_argument, "sleep time in main cycle, set in microseconds (between 1mcs and 0.5s), experimental") {
   epoll_sleep_time = atoi(optarg);
@@ -32,17 +43,26 @@ OPTION_PARSER(OPT_NETWORK, "epoll-sleep-time", required_argument, "sleep time in
   return 0;
 }
 
+OPTION_PARSER(OPT_NETWORK, "io-uring", no_argument, "deliver the network events with io_uring instead of epoll, falls back to epoll if the kernel doesn't support it, experimental") {
+  use_io_uring = true;
+  return 0;
+}
+
+void net_reactor_use_io_uring(bool enable) {
+  use_io_uring = enable;
+}
+
 void net_reactor_alloc(net_reactor_ctx_t *ctx, int max_events, int max_timers) {
   ctx->max_events = max_events;
   ctx->max_timers = max_timers;
   ctx->timestamp = 0;
   ctx->event_heap_size = 0;
-  ctx->timer_heap_size = 0;
+  ctx->timers_count = 0;
   ctx->now = 0;
   ctx->prev_now = 0;
   ctx->events = static_cast<event_t*>(calloc(max_events, sizeof(ctx->events[0])));
   ctx->event_heap = static_cast<event_t**>(calloc(max_events + 1, sizeof(ctx->event_heap[0])));
-  ctx->timer_heap = static_cast<event_timer_t**>(calloc(max_timers + 1, sizeof(ctx->timer_heap[0])));
+  ctx->timer_wheel = new vk::timing_wheel{};
   ctx->epoll_events = static_cast<epoll_event*>(calloc(max_events, sizeof(ctx->epoll_events[0])));
   ctx->pre_runqueue = ctx->post_runqueue = ctx->pre_event = NULL;
   ctx->wait_start = 0;
@@ -50,18 +70,88 @@ void net_reactor_alloc(net_reactor_ctx_t *ctx, int max_events, int max_timers) {
   ctx->total_idle_time = 0;
   ctx->average_idle_time = 0;
   ctx->average_idle_quotient = 0;
+  ctx->uring = NULL;
+  ctx->uring_generations = NULL;
+  ctx->uring_epoll_ready = false;
+  ctx->syscalls = 0;
 }
 
 void net_reactor_free(net_reactor_ctx_t *ctx) {
   free(ctx->events);
   free(ctx->event_heap);
-  free(ctx->timer_heap);
+  delete ctx->timer_wheel;
   free(ctx->epoll_events);
+  free(ctx->uring_generations);
+}
+
+static int epoll_conv_flags(int flags);
+
+static void net_reactor_uring_move_to_epoll(net_reactor_ctx_t *ctx, event_t *ev) {
+  ev->state &= ~EVT_IN_URING;
+  struct epoll_event ee;
+  memset(&ee, 0, sizeof(ee));
+  ee.events = epoll_conv_flags(ev->state & (EVT_LEVEL | EVT_RWX));
+  ee.data.fd = ev->fd;
+  ++ctx->syscalls;
+  if (epoll_ctl(ctx->epoll_fd, EPOLL_CTL_ADD, ev->fd, &ee) < 0) {
+    tvkprintf(net_events, 0, "epoll_ctl(): %m\n");
+  }
+  ev->state |= EVT_IN_EPOLL;
+}
+
+// closing the ring cancels all its polls, the fds polled by it are moved to epoll with the same flags
+static void net_reactor_uring_fallback_to_epoll(net_reactor_ctx_t *ctx) {
+  net_io_uring_free(ctx->uring);
+  free(ctx->uring);
+  ctx->uring = NULL;
+  ctx->uring_epoll_ready = false;
+
+  for (int fd = 0; fd < ctx->max_events; ++fd) {
+    event_t *ev = &ctx->events[fd];
+    if (ev->fd == fd && (ev->state & EVT_IN_URING)) {
+      net_reactor_uring_move_to_epoll(ctx, ev);
+    }
+  }
+}
+
+// returns NULL if the ring has failed, then the reactor has already fallen back to epoll
+static io_uring_sqe *net_reactor_uring_get_sqe(net_reactor_ctx_t *ctx) {
+  io_uring_sqe *sqe = net_io_uring_get_sqe(ctx->uring, &ctx->syscalls);
+  if (!sqe) {
+    tvkprintf(net_events, 0, "io_uring_enter(): %m, falling back to epoll\n");
+    net_reactor_uring_fallback_to_epoll(ctx);
+  }
+  return sqe;
+}
+
+static void net_reactor_uring_poll_epoll_fd(net_reactor_ctx_t *ctx) {
+  if (io_uring_sqe *sqe = net_reactor_uring_get_sqe(ctx)) {
+    net_io_uring_prep_poll_add(sqe, ctx->epoll_fd, POLLIN, true, IO_URING_EPOLL_USER_DATA);
+  }
+}
+
+static void net_reactor_init_uring(net_reactor_ctx_t *ctx) {
+  if (!use_io_uring) {
+    return;
+  }
+  auto *ring = static_cast<net_io_uring_t *>(calloc(1, sizeof(net_io_uring_t)));
+  if (!net_io_uring_init(ring, IO_URING_ENTRIES)) {
+    free(ring);
+    tvkprintf(net_events, 0, "io_uring is not available, falling back to epoll\n");
+    return;
+  }
+  ctx->uring = ring;
+  if (!ctx->uring_generations) {
+    ctx->uring_generations = static_cast<uint32_t *>(calloc(ctx->max_events, sizeof(ctx->uring_generations[0])));
+  }
+  ctx->uring_epoll_ready = false;
+  net_reactor_uring_poll_epoll_fd(ctx);
 }
 
 bool net_reactor_init(net_reactor_ctx_t *ctx) {
   ctx->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
   if (ctx->epoll_fd >= 0) {
+    net_reactor_init_uring(ctx);
     return true;
   }
 
@@ -72,6 +162,7 @@ bool net_reactor_create(net_reactor_ctx_t *ctx, int max_events, int max_timers)
   ctx->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
   if (ctx->epoll_fd >= 0) {
     net_reactor_alloc(ctx, max_events, max_timers);
+    net_reactor_init_uring(ctx);
 
     return true;
   }
@@ -83,6 +174,11 @@ bool net_reactor_create(net_reactor_ctx_t *ctx, int max_events, int max_timers)
 
 void net_reactor_destroy(net_reactor_ctx_t *ctx) {
   close(ctx->epoll_fd);
+  if (ctx->uring) {
+    net_io_uring_free(ctx->uring);
+    free(ctx->uring);
+    ctx->uring = NULL;
+  }
 }
 
 event_t *net_reactor_fd_event(net_reactor_ctx_t *ctx, int fd) {
@@ -262,7 +358,104 @@ static int epoll_unconv_flags(int f) {
   return r;
 }
 
+static uint64_t uring_user_data(net_reactor_ctx_t *ctx, int fd) {
+  return (static_cast<uint64_t>(ctx->uring_generations[fd]) << 32) | static_cast<uint32_t>(fd);
+}
+
+// the multishot poll is edge-triggered like EPOLLET, a new generation makes the completions of the previous poll stale;
+// if the ring fails, the fd is moved to epoll with the others
+static void net_reactor_uring_poll(net_reactor_ctx_t *ctx, event_t *ev) {
+  const int fd = ev->fd;
+  io_uring_sqe *sqe = NULL;
+  if (ev->state & EVT_IN_URING) {
+    if (!(sqe = net_reactor_uring_get_sqe(ctx))) {
+      return;
+    }
+    net_io_uring_prep_poll_remove(sqe, uring_user_data(ctx, fd), IO_URING_IGNORED_USER_DATA);
+  }
+  if (!(sqe = net_reactor_uring_get_sqe(ctx))) {
+    if (!(ev->state & EVT_IN_EPOLL)) {
+      net_reactor_uring_move_to_epoll(ctx, ev);
+    }
+    return;
+  }
+  ++ctx->uring_generations[fd];
+  const unsigned poll_mask = epoll_conv_flags(ev->state & (EVT_LEVEL | EVT_RWX)) & ~EPOLLET;
+  tvkprintf(net_events, 3, "io_uring poll(%d,%08x)\n", fd, poll_mask);
+  net_io_uring_prep_poll_add(sqe, fd, poll_mask, true, uring_user_data(ctx, fd));
+  ev->state |= EVT_IN_URING;
+}
+
+static void net_reactor_uring_remove(net_reactor_ctx_t *ctx, event_t *ev) {
+  if (io_uring_sqe *sqe = net_reactor_uring_get_sqe(ctx)) {
+    net_io_uring_prep_poll_remove(sqe, uring_user_data(ctx, ev->fd), IO_URING_IGNORED_USER_DATA);
+    ++ctx->uring_generations[ev->fd];
+    ev->state &= ~EVT_IN_URING;
+  }
+}
+
+// converts the poll completions into the epoll events, so net_reactor_fetch_events() doesn't depend on the backend
+static int net_reactor_uring_collect(net_reactor_ctx_t *ctx) {
+  int num_events = 0;
+  uint64_t user_data = 0;
+  int32_t res = 0;
+  bool more = false;
+  // the ring may fail while the polls are renewed
+  while (ctx->uring && num_events < ctx->max_events && net_io_uring_pop_cqe(ctx->uring, &user_data, &res, &more)) {
+    if (user_data == IO_URING_EPOLL_USER_DATA) {
+      ctx->uring_epoll_ready = true;
+      if (!more) {
+        net_reactor_uring_poll_epoll_fd(ctx);
+      }
+      continue;
+    }
+    if (user_data == IO_URING_IGNORED_USER_DATA) {
+      continue;
+    }
+    const int fd = static_cast<int>(user_data & 0xffffffff);
+    assert(0 <= fd && fd < ctx->max_events);
+    event_t *event = &ctx->events[fd];
+    if (event->fd != fd || !(event->state & EVT_IN_URING) || uring_user_data(ctx, fd) != user_data) {
+      continue;
+    }
+    if (res < 0) {
+      tvkprintf(net_events, 0, "io_uring poll(%d): %s\n", fd, strerror(-res));
+      event->state &= ~EVT_IN_URING;
+      continue;
+    }
+    if (!more) {
+      // the kernel has terminated the multishot poll, e.g. because of a completion queue overflow
+      event->state &= ~EVT_IN_URING;
+      net_reactor_uring_poll(ctx, event);
+    }
+    ctx->epoll_events[num_events].events = static_cast<uint32_t>(res);
+    ctx->epoll_events[num_events].data.fd = fd;
+    ++num_events;
+  }
+
+  // the epoll fd is polled edge-triggered too, so it is read until it's empty
+  if (ctx->uring_epoll_ready && num_events < ctx->max_events) {
+    ++ctx->syscalls;
+    const int epoll_events = epoll_wait(ctx->epoll_fd, ctx->epoll_events + num_events, ctx->max_events - num_events, 0);
+    if (epoll_events > 0) {
+      num_events += epoll_events;
+    }
+    ctx->uring_epoll_ready = num_events == ctx->max_events;
+  }
+  return num_events;
+}
+
 int net_reactor_wait(net_reactor_ctx_t *ctx, int timeout) {
+  if (ctx->uring) {
+    // the pending poll updates are submitted with the same syscall;
+    // EBUSY and EAGAIN mean that the kernel needs the completion queue to be reaped before it takes them
+    if (net_io_uring_submit_and_wait(ctx->uring, ctx->uring_epoll_ready ? 0 : timeout, &ctx->syscalls) < 0
+        && errno != EBUSY && errno != EAGAIN) {
+      return -1;
+    }
+    return net_reactor_uring_collect(ctx);
+  }
+  ++ctx->syscalls;
   return epoll_wait(ctx->epoll_fd, ctx->epoll_events, ctx->max_events, timeout);
 }
 
@@ -325,10 +518,27 @@ int net_reactor_insert(net_reactor_ctx_t *ctx, int fd, int flags) {
 
   flags &= EVT_NEW | EVT_NOHUP | EVT_LEVEL | EVT_RWX;
   ev->ready = 0; // !!! this bugfix led to some AIO-related bugs, now fixed with the aid of C_REPARSE flag
-  if ((ev->state & (EVT_LEVEL | EVT_RWX | EVT_IN_EPOLL)) == flags + EVT_IN_EPOLL) {
+  // the level-triggered fds (the listening sockets) stay in epoll, as io_uring has no EPOLLEXCLUSIVE
+  const bool in_uring = ctx->uring && !(flags & EVT_LEVEL);
+  const int in_reactor = in_uring ? EVT_IN_URING : EVT_IN_EPOLL;
+  if ((ev->state & (EVT_LEVEL | EVT_RWX | in_reactor)) == flags + in_reactor) {
     return 0;
   }
   ev->state = (ev->state & ~(EVT_LEVEL | EVT_RWX)) | (flags & (EVT_LEVEL | EVT_RWX));
+  if (in_uring) {
+    if (ev->state & EVT_IN_EPOLL) {
+      ev->state &= ~EVT_IN_EPOLL;
+      ++ctx->syscalls;
+      if (epoll_ctl(ctx->epoll_fd, EPOLL_CTL_DEL, fd, 0) < 0) {
+        tvkprintf(net_events, 0, "epoll_ctl(): %m\n");
+      }
+    }
+    net_reactor_uring_poll(ctx, ev);
+    return 0;
+  }
+  if (ev->state & EVT_IN_URING) {
+    net_reactor_uring_remove(ctx, ev);
+  }
   ef = epoll_conv_flags(flags);
   if (ef || (flags & EVT_NEW) || !(ev->state & EVT_IN_EPOLL)) {
     ee.events = ef;
@@ -340,6 +550,7 @@ int net_reactor_insert(net_reactor_ctx_t *ctx, int fd, int flags) {
     tvkprintf(net_events, 3, "epoll_ctl(%d,%d,%d,%d,%08x)\n", ctx->epoll_fd, (ev->state & EVT_IN_EPOLL) ? EPOLL_CTL_MOD : EPOLL_CTL_ADD, fd, ee.data.fd,
               ee.events);
 
+    ++ctx->syscalls;
     if (epoll_ctl(ctx->epoll_fd, (ev->state & EVT_IN_EPOLL) ? EPOLL_CTL_MOD : EPOLL_CTL_ADD, fd, &ee) < 0) {
       tvkprintf(net_events, 0, "epoll_ctl(): %m\n");
     }
@@ -356,8 +567,14 @@ int net_reactor_remove(net_reactor_ctx_t *ctx, int fd) {
     return -1;
   }
 
+  if (!(ev->state & EVT_FAKE) && (ev->state & EVT_IN_URING)) {
+    // the poll holds the file until the removal is submitted with the next wait;
+    // if the ring fails, the fd is moved to epoll and is removed from it below
+    net_reactor_uring_remove(ctx, ev);
+  }
   if (!(ev->state & EVT_FAKE) && (ev->state & EVT_IN_EPOLL)) {
     ev->state &= ~EVT_IN_EPOLL;
+    ++ctx->syscalls;
     if (epoll_ctl(ctx->epoll_fd, EPOLL_CTL_DEL, fd, 0) < 0) {
       tvkprintf(net_events, 0, "epoll_ctl(): %m\n");
     }
@@ -382,33 +599,13 @@ int net_reactor_close(net_reactor_ctx_t *ctx, int fd) {
   return 0;
 }
 
-static inline int basic_et_adjust(net_reactor_ctx_t *ctx, event_timer_t *et, int i) {
-  int j;
-  while (i > 1) {
-    j = (i >> 1);
-    if (ctx->timer_heap[j]->wakeup_time <= et->wakeup_time) {
-      break;
-    }
-    ctx->timer_heap[i] = ctx->timer_heap[j];
-    ctx->timer_heap[i]->h_idx = i;
-    i = j;
-  }
-  j = 2 * i;
-  while (j <= ctx->timer_heap_size) {
-    if (j < ctx->timer_heap_size && ctx->timer_heap[j]->wakeup_time > ctx->timer_heap[j + 1]->wakeup_time) {
-      j++;
-    }
-    if (et->wakeup_time <= ctx->timer_heap[j]->wakeup_time) {
-      break;
-    }
-    ctx->timer_heap[i] = ctx->timer_heap[j];
-    ctx->timer_heap[i]->h_idx = i;
-    i = j;
-    j <<= 1;
-  }
-  ctx->timer_heap[i] = et;
-  et->h_idx = i;
-  return i;
+static int64_t time_to_tick_floor(double time) {
+  return static_cast<int64_t>(floor(time * 1000));
+}
+
+// a timer is never woken up before its wakeup_time and at most a tick after it
+static int64_t time_to_tick_ceil(double time) {
+  return static_cast<int64_t>(ceil(time * 1000));
 }
 
 static int event_timer_cmp(const void *l, const void *r) {
@@ -424,71 +621,72 @@ static int event_timer_cmp(const void *l, const void *r) {
 }
 
 static void dump_too_many_event_timers(net_reactor_ctx_t *ctx) {
-  tvkprintf(net_events, 0, "Too many event timers: %d\n", ctx->timer_heap_size);
-  qsort(&ctx->timer_heap[1], (size_t) ctx->timer_heap_size, sizeof(ctx->timer_heap[0]), event_timer_cmp);
-  for (int i = 1; i <= ctx->timer_heap_size;) {
-    int j = i;
-    while (j != ctx->timer_heap_size + 1 && event_timer_cmp(&ctx->timer_heap[i], &ctx->timer_heap[j]) == 0) {
+  tvkprintf(net_events, 0, "Too many event timers: %d\n", ctx->timers_count);
+  std::vector<event_timer_t *> timers;
+  timers.reserve(ctx->timers_count);
+  ctx->timer_wheel->for_each([&timers](vk::timing_wheel_node *node) {
+    timers.push_back(container_of(node, event_timer_t, wheel_node));
+  });
+  qsort(timers.data(), timers.size(), sizeof(timers[0]), event_timer_cmp);
+  for (size_t i = 0; i < timers.size();) {
+    size_t j = i;
+    while (j != timers.size() && event_timer_cmp(&timers[i], &timers[j]) == 0) {
       j++;
     }
-    tvkprintf(net_events, 0, "%d * %s\n", j - i, ctx->timer_heap[i]->operation);
+    tvkprintf(net_events, 0, "%zu * %s\n", j - i, timers[i]->operation);
     i = j;
   }
 }
 
 bool net_reactor_has_too_many_timers(net_reactor_ctx_t *ctx) {
-  return ctx->timer_heap_size * 2 >= ctx->max_timers;
+  return ctx->timers_count * 2 >= ctx->max_timers;
 }
 
 int net_reactor_insert_event_timer(net_reactor_ctx_t *ctx, event_timer_t *et) {
-  int i;
-  if (et->h_idx) {
-    i = et->h_idx;
-    assert(i > 0 && i <= ctx->timer_heap_size && ctx->timer_heap[i] == et);
-  } else {
-    if (ctx->timer_heap_size >= ctx->max_timers) {
+  if (!et->wheel_node.slot) {
+    if (ctx->timers_count >= ctx->max_timers) {
       dump_too_many_event_timers(ctx);
     }
-    assert(ctx->timer_heap_size < ctx->max_timers);
-    i = ++ctx->timer_heap_size;
+    assert(ctx->timers_count < ctx->max_timers);
+    if (!ctx->timers_count) {
+      // the wheel isn't advanced while it is empty
+      ctx->timer_wheel->advance(time_to_tick_floor(precise_now));
+    }
+    ctx->timers_count++;
   }
 
-  return basic_et_adjust(ctx, et, i);
+  const int64_t expires = et->wakeup_time <= precise_now ? 0 : time_to_tick_ceil(et->wakeup_time);
+  ctx->timer_wheel->insert(&et->wheel_node, expires);
+  return et->wheel_node.slot;
 }
 
 int net_reactor_remove_event_timer(net_reactor_ctx_t *ctx, event_timer_t *et) {
-  int i = et->h_idx;
-  if (!i) {
+  if (!et->wheel_node.slot) {
     return 0;
   }
-  assert(i > 0 && i <= ctx->timer_heap_size && ctx->timer_heap[i] == et);
-  et->h_idx = 0;
-
-  et = ctx->timer_heap[ctx->timer_heap_size--];
-  if (i > ctx->timer_heap_size) {
-    return 1;
-  }
-  basic_et_adjust(ctx, et, i);
+  ctx->timer_wheel->remove(&et->wheel_node);
+  ctx->timers_count--;
   return 1;
 }
 
 int net_reactor_run_timers(net_reactor_ctx_t *ctx) {
-  double wait_time;
-  event_timer_t *et;
-  if (!ctx->timer_heap_size) {
+  if (!ctx->timers_count) {
     return 100000;
   }
-  wait_time = ctx->timer_heap[1]->wakeup_time - precise_now;
-  if (wait_time > 0) {
+  ctx->timer_wheel->advance(time_to_tick_floor(precise_now));
+  if (!ctx->timer_wheel->first_expired()) {
+    bool exact = false;
+    // the far timers are cascaded to the finer slots of the wheel on the way, such a wakeup runs nothing
+    const double wait_time = ctx->timer_wheel->next_event(&exact) * 0.001 - precise_now;
     // do not remove this useful debug!
-    tvkprintf(net_events, 3, "%d event timers, next in %.3f seconds\n", ctx->timer_heap_size, wait_time);
-    return (int)(std::min(100.0, wait_time) * 1000) + 1; // min to prevent integer overflow
+    tvkprintf(net_events, 3, "%d event timers, next in %.3f seconds\n", ctx->timers_count, wait_time);
+    return (int)(std::min(100.0, std::max(0.0, wait_time)) * 1000) + 1; // min to prevent integer overflow
   }
 
   const vk::net::TimeSlice time_slice(max_time_slice);
-  while (ctx->timer_heap_size > 0 && ctx->timer_heap[1]->wakeup_time <= precise_now && !pending_signals && !time_slice.expired()) {
-    et = ctx->timer_heap[1];
-    assert(et->h_idx == 1);
+  vk::timing_wheel_node *node = nullptr;
+  while (!pending_signals && !time_slice.expired() && (node = ctx->timer_wheel->first_expired())) {
+    event_timer_t *et = container_of(node, event_timer_t, wheel_node);
     net_reactor_remove_event_timer(ctx, et);
     et->wakeup(et);
   }
@@ -551,7 +749,7 @@ int net_reactor_runqueue(net_reactor_ctx_t *ctx) {
 }
 
 int net_reactor_work_timers(net_reactor_ctx_t *ctx, int timeout) {
-  if (ctx->event_heap_size || ctx->timer_heap_size) {
+  if (ctx->event_heap_size || ctx->timers_count) {
     ctx->now = time(0);
     get_utime_monotonic();
     const vk::net::TimeSlice time_slice(max_time_slice);
@@ -9,6 +9,9 @@
 #include <sys/epoll.h>
 
 #include <stdbool.h>
+#include <stdint.h>
+
+#include "common/containers/timing-wheel.h"
 
 #define EVT_READ        4
 #define EVT_WRITE       2
@@ -23,6 +26,7 @@
 #define EVT_NOHUP       0x200
 #define EVT_FROM_EPOLL  0x400
 #define EVT_FAKE        0x800
+#define EVT_IN_URING    0x1000
 
 #define EVA_CONTINUE  0
 #define EVA_RERUN     -2
@@ -51,10 +55,11 @@ struct event_descr {
 };
 
 typedef struct event_timer event_timer_t;
+struct net_io_uring;
 
 typedef int (*event_timer_wakeup_t)(event_timer_t *et);
 struct event_timer {
-  int h_idx;
+  vk::timing_wheel_node wheel_node;
   event_timer_wakeup_t wakeup;
   double wakeup_time;
   const char *operation;
@@ -65,7 +70,7 @@ struct net_reactor_ctx {
   int max_events;
   int max_timers;
   int event_heap_size;
-  int timer_heap_size;
+  int timers_count;
   int now;
   int prev_now;
   int64_t timestamp;
@@ -73,7 +78,8 @@ struct net_reactor_ctx {
   event_t *events;
   event_t *timers;
   event_t **event_heap;
-  event_timer_t **timer_heap;
+  // the ticks are milliseconds of precise_now
+  vk::timing_wheel *timer_wheel;
   epoll_func_vector_t pre_runqueue;
   epoll_func_vector_t post_runqueue;
   epoll_func_vector_t pre_event;
@@ -82,6 +88,12 @@ struct net_reactor_ctx {
   double total_idle_time;
   double average_idle_time;
   double average_idle_quotient;
+  // set if the events are delivered by io_uring; the level-triggered fds are still kept in epoll,
+  // and the epoll fd itself is polled by the ring
+  struct net_io_uring *uring;
+  uint32_t *uring_generations;
+  bool uring_epoll_ready;
+  int64_t syscalls;
 };
 typedef struct net_reactor_ctx net_reactor_ctx_t;
 
@@ -90,9 +102,12 @@ static inline int net_reactor_events(const net_reactor_ctx_t *reactor_ctx) {
 }
 
 static inline int net_reactor_timers(const net_reactor_ctx_t *reactor_ctx) {
-  return reactor_ctx->timer_heap_size;
+  return reactor_ctx->timers_count;
 }
 
+// the reactors initialized after this call use io_uring if the kernel supports it, see --io-uring
+void net_reactor_use_io_uring(bool enable);
+
 void net_reactor_alloc(net_reactor_ctx_t *ctx, int max_events, int max_timers);
 void net_reactor_free(net_reactor_ctx_t *ctx);
 bool net_reactor_init(net_reactor_ctx_t *ctx);
@@ -0,0 +1,94 @@
+// Compiler for PHP (aka KPHP)
+// Copyright (c) 2020 LLC «V Kontakte»
+// Distributed under the GPL v3 License, see LICENSE.notice.txt
+
+#include "net/net-reuseport-steering.h"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <gtest/gtest.h>
+
+namespace {
+
+int listen_reuseport(uint16_t port) {
+  const int fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+  const int one = 1;
+  setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &one, sizeof(one));
+  sockaddr_in addr{};
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  addr.sin_port = htons(port);
+  if (bind(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) != 0 || listen(fd, 128) != 0) {
+    close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+uint16_t get_port(int fd) {
+  sockaddr_in addr{};
+  socklen_t addr_len = sizeof(addr);
+  getsockname(fd, reinterpret_cast<sockaddr *>(&addr), &addr_len);
+  return ntohs(addr.sin_port);
+}
+
+// connects a few times and returns how many connections each of the listening sockets got
+std::pair<int, int> connect_and_count(uint16_t port, int first_fd, int second_fd) {
+  std::vector<int> clients;
+  for (int i = 0; i < 32; ++i) {
+    const int fd = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons(port);
+    EXPECT_EQ(connect(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)), 0);
+    clients.push_back(fd);
+  }
+  std::pair<int, int> accepted{0, 0};
+  for (int fd; (fd = accept(first_fd, nullptr, nullptr)) >= 0; ++accepted.first) {
+    close(fd);
+  }
+  for (int fd; (fd = accept(second_fd, nullptr, nullptr)) >= 0; ++accepted.second) {
+    close(fd);
+  }
+  for (int fd : clients) {
+    close(fd);
+  }
+  return accepted;
+}
+
+} // namespace
+
+TEST(net_reuseport_steering, connections_go_to_accepting_slots) {
+  if (!reuseport_steering_init()) {
+    // the kernel or the permissions don't allow the bpf programs
+    return;
+  }
+  const int first_fd = listen_reuseport(0);
+  ASSERT_GE(first_fd, 0);
+  const uint16_t port = get_port(first_fd);
+  const int second_fd = listen_reuseport(port);
+  ASSERT_GE(second_fd, 0);
+
+  reuseport_steering_set_slots_count(2);
+  ASSERT_TRUE(reuseport_steering_add_socket(first_fd, 0));
+  ASSERT_TRUE(reuseport_steering_add_socket(second_fd, 1));
+
+  reuseport_steering_on_listening_changed(second_fd, false);
+  EXPECT_EQ(connect_and_count(port, first_fd, second_fd), std::make_pair(32, 0));
+
+  reuseport_steering_set_accepting(0, false);
+  reuseport_steering_on_listening_changed(second_fd, true);
+  EXPECT_EQ(connect_and_count(port, first_fd, second_fd), std::make_pair(0, 32));
+
+  // nobody accepts, so the kernel spreads the connections on its own
+  reuseport_steering_on_listening_changed(second_fd, false);
+  const auto accepted = connect_and_count(port, first_fd, second_fd);
+  EXPECT_EQ(accepted.first + accepted.second, 32);
+
+  close(first_fd);
+  close(second_fd);
+}
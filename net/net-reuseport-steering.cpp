@@ -0,0 +1,233 @@
+// Compiler for PHP (aka KPHP)
+// Copyright (c) 2020 LLC «V Kontakte»
+// Distributed under the GPL v3 License, see LICENSE.notice.txt
+
+#include "net/net-reuseport-steering.h"
+
+#include <assert.h>
+#include <errno.h>
+#include <linux/bpf.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <vector>
+
+#include "common/kprintf.h"
+
+namespace {
+
+// the value of the only element of the mmapable array map
+struct steering_state {
+  uint32_t slots_count;
+  uint8_t accepting[REUSEPORT_STEERING_MAX_SLOTS];
+};
+
+// the number of the slots the program looks at before giving up
+constexpr int STEERING_PROBES = 8;
+
+int state_map_fd = -1;
+int sockets_map_fd = -1;
+int program_fd = -1;
+volatile steering_state *state;
+
+int own_fd = -1;
+int own_slot = -1;
+
+long sys_bpf(int cmd, union bpf_attr *attr) {
+  return syscall(__NR_bpf, cmd, attr, sizeof(*attr));
+}
+
+int create_map(uint32_t map_type, uint32_t value_size, uint32_t max_entries, uint32_t flags) {
+  union bpf_attr attr;
+  memset(&attr, 0, sizeof(attr));
+  attr.map_type = map_type;
+  attr.key_size = sizeof(uint32_t);
+  attr.value_size = value_size;
+  attr.max_entries = max_entries;
+  attr.map_flags = flags;
+  return static_cast<int>(sys_bpf(BPF_MAP_CREATE, &attr));
+}
+
+bpf_insn make_insn(uint8_t code, uint8_t dst, uint8_t src, int16_t off, int32_t imm) {
+  bpf_insn insn;
+  memset(&insn, 0, sizeof(insn));
+  insn.code = code;
+  insn.dst_reg = dst;
+  insn.src_reg = src;
+  insn.off = off;
+  insn.imm = imm;
+  return insn;
+}
+
+void emit_load_map_fd(std::vector<bpf_insn> &prog, uint8_t dst, int map_fd) {
+  prog.push_back(make_insn(BPF_LD | BPF_DW | BPF_IMM, dst, BPF_PSEUDO_MAP_FD, 0, map_fd));
+  prog.push_back(make_insn(0, 0, 0, 0, 0));
+}
+
+// r6 = ctx, r7 = connection hash, r8 = steering_state *, r9 = slots_count
+std::vector<bpf_insn> build_program() {
+  std::vector<bpf_insn> prog;
+  std::vector<size_t> jumps_to_pass;
+  prog.push_back(make_insn(BPF_ALU64 | BPF_MOV | BPF_X, BPF_REG_6, BPF_REG_1, 0, 0));
+  prog.push_back(make_insn(BPF_LDX | BPF_W | BPF_MEM, BPF_REG_7, BPF_REG_6, offsetof(sk_reuseport_md, hash), 0));
+  prog.push_back(make_insn(BPF_ST | BPF_W | BPF_MEM, BPF_REG_10, 0, -4, 0));
+  emit_load_map_fd(prog, BPF_REG_1, state_map_fd);
+  prog.push_back(make_insn(BPF_ALU64 | BPF_MOV | BPF_X, BPF_REG_2, BPF_REG_10, 0, 0));
+  prog.push_back(make_insn(BPF_ALU64 | BPF_ADD | BPF_K, BPF_REG_2, 0, 0, -4));
+  prog.push_back(make_insn(BPF_JMP | BPF_CALL, 0, 0, 0, BPF_FUNC_map_lookup_elem));
+  jumps_to_pass.push_back(prog.size());
+  prog.push_back(make_insn(BPF_JMP | BPF_JEQ | BPF_K, BPF_REG_0, 0, 0, 0));
+  prog.push_back(make_insn(BPF_ALU64 | BPF_MOV | BPF_X, BPF_REG_8, BPF_REG_0, 0, 0));
+  prog.push_back(make_insn(BPF_LDX | BPF_W | BPF_MEM, BPF_REG_9, BPF_REG_8, offsetof(steering_state, slots_count), 0));
+  jumps_to_pass.push_back(prog.size());
+  prog.push_back(make_insn(BPF_JMP | BPF_JEQ | BPF_K, BPF_REG_9, 0, 0, 0));
+
+  for (int probe = 0; probe < STEERING_PROBES; ++probe) {
+    std::vector<size_t> jumps_to_next;
+    // slot = (hash + probe * golden ratio) % slots_count, the bound check is for the verifier
+    prog.push_back(make_insn(BPF_ALU | BPF_MOV | BPF_X, BPF_REG_1, BPF_REG_7, 0, 0));
+    prog.push_back(make_insn(BPF_ALU | BPF_ADD | BPF_K, BPF_REG_1, 0, 0, static_cast<int32_t>(probe * 0x9E3779B9U)));
+    prog.push_back(make_insn(BPF_ALU | BPF_MOD | BPF_X, BPF_REG_1, BPF_REG_9, 0, 0));
+    jumps_to_next.push_back(prog.size());
+    prog.push_back(make_insn(BPF_JMP | BPF_JGE | BPF_K, BPF_REG_1, 0, 0, REUSEPORT_STEERING_MAX_SLOTS));
+    prog.push_back(make_insn(BPF_ALU64 | BPF_MOV | BPF_X, BPF_REG_2, BPF_REG_8, 0, 0));
+    prog.push_back(make_insn(BPF_ALU64 | BPF_ADD | BPF_X, BPF_REG_2, BPF_REG_1, 0, 0));
+    prog.push_back(make_insn(BPF_LDX | BPF_B | BPF_MEM, BPF_REG_3, BPF_REG_2, offsetof(steering_state, accepting), 0));
+    jumps_to_next.push_back(prog.size());
+    prog.push_back(make_insn(BPF_JMP | BPF_JEQ | BPF_K, BPF_REG_3, 0, 0, 0));
+    // the socket may be already closed, then the next slot is probed
+    prog.push_back(make_insn(BPF_STX | BPF_W | BPF_MEM, BPF_REG_10, BPF_REG_1, -8, 0));
+    prog.push_back(make_insn(BPF_ALU64 | BPF_MOV | BPF_X, BPF_REG_1, BPF_REG_6, 0, 0));
+    emit_load_map_fd(prog, BPF_REG_2, sockets_map_fd);
+    prog.push_back(make_insn(BPF_ALU64 | BPF_MOV | BPF_X, BPF_REG_3, BPF_REG_10, 0, 0));
+    prog.push_back(make_insn(BPF_ALU64 | BPF_ADD | BPF_K, BPF_REG_3, 0, 0, -8));
+    prog.push_back(make_insn(BPF_ALU64 | BPF_MOV | BPF_K, BPF_REG_4, 0, 0, 0));
+    prog.push_back(make_insn(BPF_JMP | BPF_CALL, 0, 0, 0, BPF_FUNC_sk_select_reuseport));
+    jumps_to_pass.push_back(prog.size());
+    prog.push_back(make_insn(BPF_JMP | BPF_JEQ | BPF_K, BPF_REG_0, 0, 0, 0));
+    for (size_t jump : jumps_to_next) {
+      prog[jump].off = static_cast<int16_t>(prog.size() - jump - 1);
+    }
+  }
+
+  for (size_t jump : jumps_to_pass) {
+    prog[jump].off = static_cast<int16_t>(prog.size() - jump - 1);
+  }
+  prog.push_back(make_insn(BPF_ALU64 | BPF_MOV | BPF_K, BPF_REG_0, 0, 0, SK_PASS));
+  prog.push_back(make_insn(BPF_JMP | BPF_EXIT, 0, 0, 0, 0));
+  return prog;
+}
+
+int load_program(const std::vector<bpf_insn> &prog) {
+  static char log_buf[1 << 16];
+  union bpf_attr attr;
+  memset(&attr, 0, sizeof(attr));
+  attr.prog_type = BPF_PROG_TYPE_SK_REUSEPORT;
+  attr.insns = reinterpret_cast<uint64_t>(prog.data());
+  attr.insn_cnt = static_cast<uint32_t>(prog.size());
+  attr.license = reinterpret_cast<uint64_t>("GPL");
+  attr.log_buf = reinterpret_cast<uint64_t>(log_buf);
+  attr.log_size = sizeof(log_buf);
+  attr.log_level = 1;
+  const int fd = static_cast<int>(sys_bpf(BPF_PROG_LOAD, &attr));
+  if (fd < 0 && log_buf[0]) {
+    kprintf("reuseport steering program is rejected by the verifier:\n%s\n", log_buf);
+  }
+  return fd;
+}
+
+void close_all() {
+  if (state) {
+    munmap(const_cast<steering_state *>(state), sizeof(steering_state));
+    state = nullptr;
+  }
+  for (int *fd : {&program_fd, &sockets_map_fd, &state_map_fd}) {
+    if (*fd >= 0) {
+      close(*fd);
+      *fd = -1;
+    }
+  }
+}
+
+} // namespace
+
+bool reuseport_steering_init() {
+  assert(state_map_fd < 0);
+  state_map_fd = create_map(BPF_MAP_TYPE_ARRAY, sizeof(steering_state), 1, BPF_F_MMAPABLE);
+  sockets_map_fd = create_map(BPF_MAP_TYPE_REUSEPORT_SOCKARRAY, sizeof(uint64_t), REUSEPORT_STEERING_MAX_SLOTS, 0);
+  if (state_map_fd < 0 || sockets_map_fd < 0) {
+    kprintf("can't create reuseport steering maps: %m\n");
+    close_all();
+    return false;
+  }
+  void *state_ptr = mmap(nullptr, sizeof(steering_state), PROT_READ | PROT_WRITE, MAP_SHARED, state_map_fd, 0);
+  if (state_ptr == MAP_FAILED) {
+    kprintf("can't mmap reuseport steering state: %m\n");
+    close_all();
+    return false;
+  }
+  state = static_cast<steering_state *>(state_ptr);
+  program_fd = load_program(build_program());
+  if (program_fd < 0) {
+    kprintf("can't load reuseport steering program: %m\n");
+    close_all();
+    return false;
+  }
+  return true;
+}
+
+bool reuseport_steering_enabled() {
+  return program_fd >= 0;
+}
+
+void reuseport_steering_set_slots_count(int slots_count) {
+  assert(0 <= slots_count && slots_count <= REUSEPORT_STEERING_MAX_SLOTS);
+  if (state) {
+    state->slots_count = slots_count;
+  }
+}
+
+void reuseport_steering_set_accepting(int slot, bool accepting) {
+  assert(0 <= slot && slot < REUSEPORT_STEERING_MAX_SLOTS);
+  if (state) {
+    state->accepting[slot] = accepting;
+  }
+}
+
+bool reuseport_steering_add_socket(int fd, int slot) {
+  if (!reuseport_steering_enabled()) {
+    return false;
+  }
+  assert(0 <= slot && slot < REUSEPORT_STEERING_MAX_SLOTS);
+  const uint32_t key = slot;
+  const uint64_t value = fd;
+  union bpf_attr attr;
+  memset(&attr, 0, sizeof(attr));
+  attr.map_fd = sockets_map_fd;
+  attr.key = reinterpret_cast<uint64_t>(&key);
+  attr.value = reinterpret_cast<uint64_t>(&value);
+  attr.flags = BPF_ANY;
+  if (sys_bpf(BPF_MAP_UPDATE_ELEM, &attr) < 0) {
+    kprintf("can't add socket %d to reuseport steering slot %d: %m\n", fd, slot);
+    return false;
+  }
+  // the program belongs to the whole reuseport group, every worker attaches the same one
+  if (setsockopt(fd, SOL_SOCKET, SO_ATTACH_REUSEPORT_EBPF, &program_fd, sizeof(program_fd)) < 0) {
+    kprintf("can't attach reuseport steering program to socket %d: %m\n", fd);
+    return false;
+  }
+  own_fd = fd;
+  own_slot = slot;
+  reuseport_steering_set_accepting(slot, true);
+  return true;
+}
+
+void reuseport_steering_on_listening_changed(int fd, bool accepting) {
+  if (fd == own_fd) {
+    reuseport_steering_set_accepting(own_slot, accepting);
+  }
+}
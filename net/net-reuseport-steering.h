@@ -0,0 +1,33 @@
+// Compiler for PHP (aka KPHP)
+// Copyright (c) 2020 LLC «V Kontakte»
+// Distributed under the GPL v3 License, see LICENSE.notice.txt
+
+#ifndef KDB_NET_NET_REUSEPORT_STEERING_H
+#define KDB_NET_NET_REUSEPORT_STEERING_H
+
+#include <stdbool.h>
+#include <sys/cdefs.h>
+
+// Steering of the new connections between the SO_REUSEPORT listening sockets of the workers.
+// Every worker owns a slot with its socket and an "accepting" flag, which the worker flips itself
+// in the shared memory of a bpf map, without any syscalls. The eBPF program attached to the reuseport group
+// probes a few slots picked by the connection hash and hands the connection to the first accepting one,
+// otherwise the kernel falls back to its own hash based choice.
+
+#define REUSEPORT_STEERING_MAX_SLOTS 1024
+
+// creates the maps and the program, must be called by the master before the workers are forked;
+// returns false if the kernel doesn't allow it (linux 5.5+ and CAP_BPF are needed)
+bool reuseport_steering_init();
+bool reuseport_steering_enabled();
+
+// called by the master: the slots are [0, slots_count)
+void reuseport_steering_set_slots_count(int slots_count);
+void reuseport_steering_set_accepting(int slot, bool accepting);
+
+// called by a worker for its listening socket after listen()
+bool reuseport_steering_add_socket(int fd, int slot);
+// called when the worker starts or stops accepting on a listening socket, does nothing for the other sockets
+void reuseport_steering_on_listening_changed(int fd, bool accepting);
+
+#endif // KDB_NET_NET_REUSEPORT_STEERING_H
@@ -1,8 +1,14 @@
 prepend(NET_TESTS_SOURCES ${BASE_DIR}/net/
         net-aes-keys-test.cpp
+        net-http-compression-test.cpp
+        net-io-uring-test.cpp
         net-msg-test.cpp
+        net-reactor-test.cpp
+        net-reuseport-steering-test.cpp
         net-test.cpp
         time-slice-test.cpp)
 
-set(NET_TESTS_LIBS vk::common_src vk::net_src vk::binlog_src vk::unicode -l:libzstd.a rt crypto z)
+set(NET_TESTS_LIBS vk::common_src vk::net_src vk::binlog_src vk::unicode -l:libzstd.a -l:libbrotlienc.a -l:libbrotlidec.a -l:libbrotlicommon.a rt crypto z)
 vk_add_unittest(net "${NET_TESTS_LIBS}" ${NET_TESTS_SOURCES})
+
+vk_add_benchmark(net-reactor "${NET_TESTS_LIBS}" ${BASE_DIR}/net/net-reactor-benchmark.cpp)
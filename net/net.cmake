@@ -15,9 +15,12 @@ prepend(NET_SOURCES ${BASE_DIR}/net/
         net-aes-keys.cpp
         net-socket.cpp
         net-reactor.cpp
+        net-reuseport-steering.cpp
+        net-io-uring.cpp
         net-msg-part.cpp
         net-mysql-client.cpp
         net-memcache-client.cpp
+        net-http-compression.cpp
         net-http-server.cpp
         net-msg-buffers.cpp
         net-msg.cpp
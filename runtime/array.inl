@@ -1,6 +1,7 @@
 #pragma once
 
 #include "common/algorithms/fastmod.h"
+#include "common/algorithms/probe-group.h"
 
 #ifndef INCLUDED_FROM_KPHP_CORE
   #error "this file must be included only from kphp_core.h"
@@ -141,6 +142,80 @@ uint32_t array<T>::array_inner::choose_bucket(int64_t key, uint32_t buf_size, ui
   return fastmod::fastmod_u32(static_cast<uint32_t>(key << 2), modulo_helper, buf_size);
 }
 
+template<class T>
+uint8_t array<T>::array_inner::ctrl_tag(int64_t key) {
+  // the high bits of the multiplicative hash, the bucket is chosen by the low bits of the key
+  return static_cast<uint8_t>(0x80 | ((static_cast<uint64_t>(key) * 0x9E3779B97F4A7C15ULL) >> 57));
+}
+
+template<class T>
+void array<T>::array_inner::set_ctrl(uint8_t *ctrl __attribute__((unused)), uint32_t buf_size __attribute__((unused)),
+                                     uint32_t bucket __attribute__((unused)), uint8_t value __attribute__((unused))) {
+#if KPHP_ARRAY_CTRL_BYTES
+  ctrl[bucket] = value;
+  // buf_size may be less than the group size, so a bucket may have several clones
+  for (uint32_t clone = bucket; clone < vk::probe_group::SIZE; clone += buf_size) {
+    ctrl[buf_size + clone] = value;
+  }
+#endif
+}
+
+template<class T>
+template<class E, class F>
+uint32_t array<T>::array_inner::probe_bucket(const E *entries, const uint8_t *ctrl, uint32_t buf_size, uint32_t bucket, uint8_t tag, const F &is_same_key) {
+#if KPHP_ARRAY_CTRL_BYTES
+  // most of the keys are in their home buckets, check it without touching the control bytes
+  if (entries[bucket].next == EMPTY_POINTER || is_same_key(bucket)) {
+    return bucket;
+  }
+  return probe_groups(ctrl, buf_size, bucket + 1 == buf_size ? 0 : bucket + 1, tag, is_same_key);
+#else
+  static_cast<void>(ctrl);
+  static_cast<void>(tag);
+  while (entries[bucket].next != EMPTY_POINTER && !is_same_key(bucket)) {
+    if (unlikely (++bucket == buf_size)) {
+      bucket = 0;
+    }
+  }
+  return bucket;
+#endif
+}
+
+#if KPHP_ARRAY_CTRL_BYTES
+template<class T>
+template<class F>
+uint32_t array<T>::array_inner::probe_groups(const uint8_t *ctrl, uint32_t buf_size, uint32_t bucket, uint8_t tag, const F &is_same_key) {
+  // there is always an empty bucket as the load factor is kept below 3/5,
+  // so the matches after the first empty slot of the group must not be checked and need no wrapping more than once
+  while (true) {
+    const vk::probe_group group{ctrl + bucket};
+    const uint64_t empty = group.match(0);
+    uint64_t match = group.match(tag);
+    if (empty) {
+      match = vk::probe_group::slots_before(match, empty);
+    }
+    for (; match; match &= match - 1) {
+      uint32_t candidate = bucket + static_cast<uint32_t>(vk::probe_group::lowest_slot(match));
+      if (candidate >= buf_size) {
+        candidate -= buf_size;
+      }
+      if (is_same_key(candidate)) {
+        return candidate;
+      }
+    }
+    if (likely(empty)) {
+      const uint32_t empty_bucket = bucket + static_cast<uint32_t>(vk::probe_group::lowest_slot(empty));
+      return empty_bucket >= buf_size ? empty_bucket - buf_size : empty_bucket;
+    }
+    // the group is full, so buf_size > vk::probe_group::SIZE here
+    bucket += vk::probe_group::SIZE;
+    if (bucket >= buf_size) {
+      bucket -= buf_size;
+    }
+  }
+}
+#endif
+
 template<class T>
 bool array<T>::array_inner::is_vector() const {
   return string_buf_size == std::numeric_limits<uint32_t>::max();
@@ -215,6 +290,26 @@ typename array<T>::string_hash_entry *array<T>::array_inner::get_string_entries(
   return (string_hash_entry * )(int_entries + int_buf_size);
 }
 
+template<class T>
+const uint8_t *array<T>::array_inner::get_int_ctrl() const {
+  return reinterpret_cast<const uint8_t *>(get_string_entries() + string_buf_size);
+}
+
+template<class T>
+uint8_t *array<T>::array_inner::get_int_ctrl() {
+  return reinterpret_cast<uint8_t *>(get_string_entries() + string_buf_size);
+}
+
+template<class T>
+const uint8_t *array<T>::array_inner::get_string_ctrl() const {
+  return get_int_ctrl() + sizeof_ctrl(int_buf_size);
+}
+
+template<class T>
+uint8_t *array<T>::array_inner::get_string_ctrl() {
+  return get_int_ctrl() + sizeof_ctrl(int_buf_size);
+}
+
 template<class T>
 typename array<T>::array_inner_fields_for_map &array<T>::array_inner::fields_for_map() {
   return *reinterpret_cast<array_inner_fields_for_map *>(reinterpret_cast<char *>(this) - sizeof(array_inner_fields_for_map));
@@ -232,7 +327,17 @@ size_t array<T>::array_inner::sizeof_vector(uint32_t int_size) {
 
 template<class T>
 size_t array<T>::array_inner::sizeof_map(uint32_t int_size, uint32_t string_size) {
-  return sizeof(array_inner_fields_for_map) + sizeof(array_inner) + int_size * sizeof(int_hash_entry) + string_size * sizeof(string_hash_entry);
+  return sizeof(array_inner_fields_for_map) + sizeof(array_inner) + int_size * sizeof(int_hash_entry) + string_size * sizeof(string_hash_entry) +
+         sizeof_ctrl(int_size) + sizeof_ctrl(string_size);
+}
+
+template<class T>
+size_t array<T>::array_inner::sizeof_ctrl(uint32_t buf_size __attribute__((unused))) {
+#if KPHP_ARRAY_CTRL_BYTES
+  return buf_size + vk::probe_group::SIZE;
+#else
+  return 0;
+#endif
 }
 
 template<class T>
@@ -378,14 +483,13 @@ template<class T>
 template<class ...Args>
 T &array<T>::array_inner::emplace_int_key_map_value(overwrite_element policy, int64_t int_key, Args &&... args) noexcept {
   static_assert(std::is_constructible<T, Args...>{}, "should be constructible");
-  uint32_t bucket = choose_bucket_int(int_key);
-  while (int_entries[bucket].next != EMPTY_POINTER && int_entries[bucket].int_key != int_key) {
-    if (unlikely (++bucket == int_buf_size)) {
-      bucket = 0;
-    }
-  }
+  uint8_t *int_ctrl = get_int_ctrl();
+  const uint8_t tag = ctrl_tag(int_key);
+  const uint32_t bucket = probe_bucket(int_entries, int_ctrl, int_buf_size, choose_bucket_int(int_key), tag,
+                                       [this, int_key](uint32_t b) { return int_entries[b].int_key == int_key; });
 
   if (int_entries[bucket].next == EMPTY_POINTER) {
+    set_ctrl(int_ctrl, int_buf_size, bucket, tag);
     int_entries[bucket].int_key = int_key;
 
     int_entries[bucket].prev = end()->prev;
@@ -422,14 +526,12 @@ void array<T>::array_inner::unset_vector_value() {
 
 template<class T>
 void array<T>::array_inner::unset_map_value(int64_t int_key) {
-  uint32_t bucket = choose_bucket_int(int_key);
-  while (int_entries[bucket].next != EMPTY_POINTER && int_entries[bucket].int_key != int_key) {
-    if (unlikely (++bucket == int_buf_size)) {
-      bucket = 0;
-    }
-  }
+  uint8_t *int_ctrl = get_int_ctrl();
+  uint32_t bucket = probe_bucket(int_entries, int_ctrl, int_buf_size, choose_bucket_int(int_key), ctrl_tag(int_key),
+                                 [this, int_key](uint32_t b) { return int_entries[b].int_key == int_key; });
 
   if (int_entries[bucket].next != EMPTY_POINTER) {
+    set_ctrl(int_ctrl, int_buf_size, bucket, 0);
     int_entries[bucket].int_key = 0;
 
     get_entry(int_entries[bucket].prev)->next = int_entries[bucket].next;
@@ -458,6 +560,8 @@ void array<T>::array_inner::unset_map_value(int64_t int_key) {
         list_hash_entry *ei = int_entries + ri, *ej = int_entries + rj;
         memcpy(ei, ej, sizeof(int_hash_entry));
         ej->next = EMPTY_POINTER;
+        set_ctrl(int_ctrl, int_buf_size, ri, int_ctrl[rj]);
+        set_ctrl(int_ctrl, int_buf_size, rj, 0);
 
         get_entry(ei->prev)->next = get_pointer(ei);
         get_entry(ei->next)->prev = get_pointer(ei);
@@ -474,12 +578,8 @@ void array<T>::array_inner::unset_map_value(int64_t int_key) {
 template<class T>
 template<class S>
 auto &array<T>::array_inner::find_map_entry(S &self, int64_t int_key) noexcept {
-  uint32_t bucket = self.choose_bucket_int(int_key);
-  while (self.int_entries[bucket].next != EMPTY_POINTER && self.int_entries[bucket].int_key != int_key) {
-    if (unlikely (++bucket == self.int_buf_size)) {
-      bucket = 0;
-    }
-  }
+  const uint32_t bucket = probe_bucket(self.int_entries, self.get_int_ctrl(), self.int_buf_size, self.choose_bucket_int(int_key), ctrl_tag(int_key),
+                                       [&self, int_key](uint32_t b) { return self.int_entries[b].int_key == int_key; });
 
   return self.int_entries[bucket];
 }
@@ -488,13 +588,10 @@ template<class T>
 template<class S>
 auto &array<T>::array_inner::find_map_entry(S &self, const string &string_key, int64_t precomuted_hash) noexcept {
   auto *string_entries = self.get_string_entries();
-  uint32_t bucket = self.choose_bucket_string(precomuted_hash);
-  while (string_entries[bucket].next != EMPTY_POINTER &&
-         (string_entries[bucket].int_key != precomuted_hash || string_entries[bucket].string_key != string_key)) {
-    if (unlikely (++bucket == self.string_buf_size)) {
-      bucket = 0;
-    }
-  }
+  const uint32_t bucket = probe_bucket(string_entries, self.get_string_ctrl(), self.string_buf_size, self.choose_bucket_string(precomuted_hash), ctrl_tag(precomuted_hash),
+                                       [string_entries, &string_key, precomuted_hash](uint32_t b) {
+                                         return string_entries[b].int_key == precomuted_hash && string_entries[b].string_key == string_key;
+                                       });
 
   return string_entries[bucket];
 }
@@ -522,14 +619,15 @@ T &array<T>::array_inner::emplace_string_key_map_value(overwrite_element policy,
   static_assert(std::is_same<std::decay_t<STRING>, string>::value, "string_key should be string");
 
   string_hash_entry *string_entries = get_string_entries();
-  uint32_t bucket = choose_bucket_string(int_key);
-  while (string_entries[bucket].next != EMPTY_POINTER && (string_entries[bucket].int_key != int_key || string_entries[bucket].string_key != string_key)) {
-    if (unlikely (++bucket == string_buf_size)) {
-      bucket = 0;
-    }
-  }
+  uint8_t *string_ctrl = get_string_ctrl();
+  const uint8_t tag = ctrl_tag(int_key);
+  const uint32_t bucket = probe_bucket(string_entries, string_ctrl, string_buf_size, choose_bucket_string(int_key), tag,
+                                       [string_entries, &string_key, int_key](uint32_t b) {
+                                         return string_entries[b].int_key == int_key && string_entries[b].string_key == string_key;
+                                       });
 
   if (string_entries[bucket].next == EMPTY_POINTER) {
+    set_ctrl(string_ctrl, string_buf_size, bucket, tag);
     string_entries[bucket].int_key = int_key;
     new(&string_entries[bucket].string_key) string{std::forward<STRING>(string_key)};
 
@@ -557,14 +655,14 @@ T &array<T>::array_inner::set_map_value(overwrite_element policy, int64_t int_ke
 template<class T>
 void array<T>::array_inner::unset_map_value(const string &string_key, int64_t precomuted_hash) {
   string_hash_entry *string_entries = get_string_entries();
-  uint32_t bucket = choose_bucket_string(precomuted_hash);
-  while (string_entries[bucket].next != EMPTY_POINTER && (string_entries[bucket].int_key != precomuted_hash || string_entries[bucket].string_key != string_key)) {
-    if (unlikely (++bucket == string_buf_size)) {
-      bucket = 0;
-    }
-  }
+  uint8_t *string_ctrl = get_string_ctrl();
+  uint32_t bucket = probe_bucket(string_entries, string_ctrl, string_buf_size, choose_bucket_string(precomuted_hash), ctrl_tag(precomuted_hash),
+                                 [string_entries, &string_key, precomuted_hash](uint32_t b) {
+                                   return string_entries[b].int_key == precomuted_hash && string_entries[b].string_key == string_key;
+                                 });
 
   if (string_entries[bucket].next != EMPTY_POINTER) {
+    set_ctrl(string_ctrl, string_buf_size, bucket, 0);
     string_entries[bucket].int_key = 0;
     string_entries[bucket].string_key.~string();
 
@@ -594,6 +692,8 @@ void array<T>::array_inner::unset_map_value(const string &string_key, int64_t pr
         list_hash_entry *ei = string_entries + ri, *ej = string_entries + rj;
         memcpy(ei, ej, sizeof(string_hash_entry));
         ej->next = EMPTY_POINTER;
+        set_ctrl(string_ctrl, string_buf_size, ri, string_ctrl[rj]);
+        set_ctrl(string_ctrl, string_buf_size, rj, 0);
 
         get_entry(ei->prev)->next = get_pointer(ei);
         get_entry(ei->next)->prev = get_pointer(ei);
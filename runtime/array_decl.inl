@@ -91,6 +91,9 @@ private:
     //if key is string, int_key contains hash of this string, string_key contains this string.
     //empty hash_entry identified by (next == EMPTY_POINTER)
     //vector is_identified by string_buf_size == -1
+    //with KPHP_ARRAY_CTRL_BYTES map entries are followed by the control bytes of the int and then of the string entries:
+    //0 for an empty bucket and ctrl_tag(int_key) for an occupied one, see probe_bucket();
+    //the first vk::probe_group::SIZE control bytes of each table are cloned after its end, so a group can be loaded from any bucket
 
     static constexpr uint32_t MAX_HASHTABLE_SIZE = (1 << 26);
 
@@ -127,6 +130,11 @@ private:
     inline const string_hash_entry *get_string_entries() const __attribute__ ((always_inline));
     inline string_hash_entry *get_string_entries() __attribute__ ((always_inline));
 
+    inline const uint8_t *get_int_ctrl() const __attribute__ ((always_inline));
+    inline uint8_t *get_int_ctrl() __attribute__ ((always_inline));
+    inline const uint8_t *get_string_ctrl() const __attribute__ ((always_inline));
+    inline uint8_t *get_string_ctrl() __attribute__ ((always_inline));
+
     inline array_inner_fields_for_map &fields_for_map() __attribute__((always_inline));
     inline const array_inner_fields_for_map &fields_for_map() const __attribute__((always_inline));
 
@@ -134,8 +142,19 @@ private:
     inline uint32_t choose_bucket_string(int64_t key) const __attribute__ ((always_inline));
     inline static uint32_t choose_bucket(int64_t key, uint32_t buf_size, uint64_t modulo_helper) __attribute__ ((always_inline));
 
+    inline static uint8_t ctrl_tag(int64_t key) __attribute__ ((always_inline));
+    inline static void set_ctrl(uint8_t *ctrl, uint32_t buf_size, uint32_t bucket, uint8_t value) __attribute__ ((always_inline));
+    // returns the bucket of the entry satisfying is_same_key or the empty bucket where it should be inserted
+    template<class E, class F>
+    inline static uint32_t probe_bucket(const E *entries, const uint8_t *ctrl, uint32_t buf_size, uint32_t bucket, uint8_t tag, const F &is_same_key) __attribute__ ((always_inline));
+#if KPHP_ARRAY_CTRL_BYTES
+    template<class F>
+    inline static uint32_t probe_groups(const uint8_t *ctrl, uint32_t buf_size, uint32_t bucket, uint8_t tag, const F &is_same_key);
+#endif
+
     inline static size_t sizeof_vector(uint32_t int_size) __attribute__((always_inline));
     inline static size_t sizeof_map(uint32_t int_size, uint32_t string_size) __attribute__((always_inline));
+    inline static size_t sizeof_ctrl(uint32_t buf_size) __attribute__((always_inline));
     inline static size_t estimate_size(int64_t &new_int_size, int64_t &new_string_size, bool is_vector);
     inline static array_inner *create(int64_t new_int_size, int64_t new_string_size, bool is_vector);
 
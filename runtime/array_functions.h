@@ -8,6 +8,7 @@
 #include <numeric>
 
 #include "common/type_traits/constexpr_if.h"
+#include "common/numeric-vector.h"
 #include "common/type_traits/function_traits.h"
 #include "common/vector-product.h"
 
@@ -887,8 +888,35 @@ bool f$array_key_exists(K, const array<T> &) {
   return false;
 }
 
+// array<int64_t> and array<double> vectors are searched by the SIMD kernels, both == and === are the plain == there
+template<class T, class T1>
+bool find_in_numeric_vector(const array<T> &, const T1 &, int64_t &) noexcept {
+  return false;
+}
+
+inline bool find_in_numeric_vector(const array<int64_t> &a, int64_t value, int64_t &index) noexcept {
+  if (!a.is_vector()) {
+    return false;
+  }
+  index = static_cast<int64_t>(int64_vector_find(a.get_const_vector_pointer(), a.count(), value));
+  return true;
+}
+
+inline bool find_in_numeric_vector(const array<double> &a, double value, int64_t &index) noexcept {
+  if (!a.is_vector()) {
+    return false;
+  }
+  index = static_cast<int64_t>(double_vector_find(a.get_const_vector_pointer(), a.count(), value));
+  return true;
+}
+
 template<class T, class T1>
 typename array<T>::key_type f$array_search(const T1 &val, const array<T> &a, bool strict) {
+  int64_t index = 0;
+  if (find_in_numeric_vector(a, val, index)) {
+    return index != a.count() ? typename array<T>::key_type(index) : typename array<T>::key_type(false);
+  }
+
   for (const auto &it : a) {
     if (strict ? equals(it.get_value(), val) : eq2(it.get_value(), val)) {
       return it.get_key();
@@ -1021,6 +1049,11 @@ array<typename array<T>::key_type> f$array_flip(const array<T> &a) {
 
 template<class T, class T1>
 bool f$in_array(const T1 &value, const array<T> &a, bool strict) {
+  int64_t index = 0;
+  if (find_in_numeric_vector(a, value, index)) {
+    return index != a.count();
+  }
+
   if (!strict) {
     for (const auto &it : a) {
       if (eq2(it.get_value(), value)) {
@@ -1364,11 +1397,30 @@ void f$natsort(array<T> &a) {
   return a.sort(sort_compare_natural<typename array<T>::key_type>(), false);
 }
 
+// the integer sum wraps around, so it may be computed in any order;
+// the double one is left sequential, as the reordered additions would round differently
+template<class T, class ReturnT>
+bool sum_numeric_vector(const array<T> &, ReturnT &) noexcept {
+  return false;
+}
+
+inline bool sum_numeric_vector(const array<int64_t> &a, int64_t &result) noexcept {
+  if (!a.is_vector()) {
+    return false;
+  }
+  result = int64_vector_sum(a.get_const_vector_pointer(), a.count());
+  return true;
+}
+
 template<class T, class ReturnT>
 ReturnT f$array_sum(const array<T> &a) {
   static_assert(!std::is_same<T, int>{}, "int is forbidden");
 
   ReturnT result = 0;
+  if (sum_numeric_vector(a, result)) {
+    return result;
+  }
+
   for (const auto &it : a) {
     result += vk::constexpr_if(
       std::is_same<T, int64_t>{},
@@ -34,6 +34,11 @@ public:
     return acquired_sample_->get_confdata();
   }
 
+  const mixed *find_section(const string &first_key) const noexcept {
+    php_assert(acquired_sample_);
+    return acquired_sample_->find_section(first_key);
+  }
+
   bool is_initialized() const noexcept {
     return global_manager_.is_initialized();
   }
@@ -96,16 +101,14 @@ mixed f$confdata_get_value(const string &key) noexcept {
   const auto &local_manager = ConfdataLocalManager::get();
   ConfdataKeyMaker key_maker;
   key_maker.update(key.c_str(), static_cast<int16_t>(key.size()), local_manager.get_predefined_wildcards());
-  const auto &confdata_storage = local_manager.get_confdata_storage();
-  auto it = confdata_storage.find(key_maker.get_first_key());
-  if (it != confdata_storage.end()) {
+  if (const mixed *section = local_manager.find_section(key_maker.get_first_key())) {
     // if key doesn't contain prefixes
     if (key_maker.get_first_key_type() == ConfdataFirstKeyType::simple_key) {
-      return it->second;
+      return *section;
     }
     // it must be an array (we loaded it this way)
-    php_assert(it->second.is_array());
-    if (auto *value = it->second.as_array().find_value(key_maker.get_second_key())) {
+    php_assert(section->is_array());
+    if (auto *value = section->as_array().find_value(key_maker.get_second_key())) {
       return *value;
     }
   }
@@ -124,18 +127,17 @@ array<mixed> f$confdata_get_values_by_any_wildcard(const string &wildcard) noexc
   const auto &local_manager = ConfdataLocalManager::get();
   const auto &predefined_wildcards = local_manager.get_predefined_wildcards();
   ConfdataKeyMaker key_maker;
-  const auto &confdata_storage = local_manager.get_confdata_storage();
   // wildcard has a form of '\w+\..*' or '\w+\.\w+\..*' and contains a predefined prefix
   if (key_maker.update(wildcard.c_str(), static_cast<int16_t>(wildcard.size()), predefined_wildcards) != ConfdataFirstKeyType::simple_key) {
     // the first key is '\w+\.' or '\w+\.\w+\.'
-    auto it = confdata_storage.find(key_maker.get_first_key());
-    if (it == confdata_storage.end()) {
+    const mixed *section = local_manager.find_section(key_maker.get_first_key());
+    if (!section) {
       return {};
     }
 
     // it must be an array (we loaded it this way)
-    php_assert(it->second.is_array());
-    const auto &second_key_array = it->second.as_array();
+    php_assert(section->is_array());
+    const auto &second_key_array = section->as_array();
 
     // if the second key is an empty string; i.e. the first key is an entire prefix ('\w+\.' or '\w+\.\w+\.' or predefined)
     if (key_maker.get_second_key().is_string() && key_maker.get_second_key().as_string().empty()) {
@@ -167,6 +169,8 @@ array<mixed> f$confdata_get_values_by_any_wildcard(const string &wildcard) noexc
       result.set_value(string{section_suffix}.append(section_it.get_key()), section_it.get_value());
     }
   };
+  // the sections are sorted, so the ones starting with the wildcard are adjacent
+  const auto &confdata_storage = local_manager.get_confdata_storage();
   auto it = confdata_storage.lower_bound(wildcard);
   while (it != confdata_storage.end() && it->first.starts_with(wildcard)) {
     const vk::string_view section_wildcard{it->first.c_str(), it->first.size()};
@@ -203,17 +207,15 @@ array<mixed> f$confdata_get_values_by_predefined_wildcard(const string &wildcard
   }
 
   const auto &local_manager = ConfdataLocalManager::get();
-  const auto &confdata_storage = local_manager.get_confdata_storage();
   const vk::string_view wildcard_view{wildcard.c_str(), wildcard.size()};
   if (local_manager.get_predefined_wildcards().detect_first_key_type(wildcard_view) == ConfdataFirstKeyType::simple_key) {
     php_warning("Trying to get elements by non predefined wildcard '%s'", wildcard.c_str());
     return {};
   }
 
-  const auto elements_it = confdata_storage.find(wildcard);
-  if (elements_it != confdata_storage.end()) {
-    php_assert(elements_it->second.is_array());
-    return elements_it->second.as_array();
+  if (const mixed *elements = local_manager.find_section(wildcard)) {
+    php_assert(elements->is_array());
+    return elements->as_array();
   }
   return {};
 }
@@ -29,8 +29,56 @@ void recursively_destroy_confdata_element(mixed &element) noexcept {
   element.force_destroy(ExtraRefCnt::for_confdata);
 }
 
+void destroy_confdata_garbage(std::forward_list<ConfdataGarbageNode> &garbage) noexcept {
+  garbage.remove_if([](ConfdataGarbageNode &node) {
+    if (node.destroy_way == ConfdataGarbageDestroyWay::shallow_first) {
+      node.value.force_destroy(ExtraRefCnt::for_confdata);
+      return true;
+    }
+    return false;
+  });
+
+  while (!garbage.empty()) {
+    recursively_destroy_confdata_element(garbage.front().value);
+    garbage.pop_front();
+  }
+}
+
 } // namespace
 
+void ConfdataSectionIndex::build(const confdata_sample_storage &confdata, memory_resource::unsynchronized_pool_resource &resource) noexcept {
+  clear(resource);
+  if (confdata.empty()) {
+    return;
+  }
+  // the load factor is at most 0.5, so the probe sequences are short
+  size_t capacity = 2;
+  while (capacity < confdata.size() * 2) {
+    capacity *= 2;
+  }
+  auto *mem = resource.allocate(sizeof(Slot) * capacity);
+  php_assert(mem);
+  slots_ = static_cast<Slot *>(mem);
+  std::fill(slots_, slots_ + capacity, Slot{0, nullptr});
+  mask_ = capacity - 1;
+  for (const auto &section : confdata) {
+    const int64_t hash = section.first.hash();
+    size_t i = static_cast<size_t>(hash) & mask_;
+    while (slots_[i].section) {
+      i = (i + 1) & mask_;
+    }
+    slots_[i] = Slot{hash, &section};
+  }
+}
+
+void ConfdataSectionIndex::clear(memory_resource::unsynchronized_pool_resource &resource) noexcept {
+  if (slots_) {
+    resource.deallocate(slots_, sizeof(Slot) * (mask_ + 1));
+    slots_ = nullptr;
+    mask_ = 0;
+  }
+}
+
 void ConfdataSample::init(memory_resource::unsynchronized_pool_resource &resource) noexcept {
   php_assert(!resource_);
   php_assert(!confdata_storage_);
@@ -38,33 +86,22 @@ void ConfdataSample::init(memory_resource::unsynchronized_pool_resource &resourc
   auto *mem = resource_->allocate(sizeof(*confdata_storage_));
   php_assert(mem);
   confdata_storage_ = new(mem) confdata_sample_storage{confdata_sample_storage::allocator_type{*resource_}};
+  mem = resource_->allocate(sizeof(*section_index_));
+  php_assert(mem);
+  section_index_ = new(mem) ConfdataSectionIndex{};
 }
 
-void ConfdataSample::reset(confdata_sample_storage &&new_confdata) noexcept {
+void ConfdataSample::reset(confdata_sample_storage &&new_confdata, uint64_t epoch) noexcept {
   clear();
+  epoch_ = epoch;
   *confdata_storage_ = std::move(new_confdata);
+  section_index_->build(*confdata_storage_, *resource_);
 }
 
 void ConfdataSample::clear() noexcept {
   php_assert(confdata_storage_);
+  section_index_->clear(*resource_);
   confdata_storage_->clear();
-
-  if (garbage_) {
-    garbage_->remove_if([](ConfdataGarbageNode &node) {
-      if (node.destroy_way == ConfdataGarbageDestroyWay::shallow_first) {
-        node.value.force_destroy(ExtraRefCnt::for_confdata);
-        return true;
-      }
-      return false;
-    });
-
-    while (!garbage_->empty()) {
-      recursively_destroy_confdata_element(garbage_->front().value);
-      garbage_->pop_front();
-    }
-    delete garbage_;
-    garbage_ = nullptr;
-  }
 }
 
 void ConfdataSample::destroy() noexcept {
@@ -73,19 +110,15 @@ void ConfdataSample::destroy() noexcept {
     clear();
     confdata_storage_->~map();
     resource_->deallocate(confdata_storage_, sizeof(*confdata_storage_));
+    section_index_->~ConfdataSectionIndex();
+    resource_->deallocate(section_index_, sizeof(*section_index_));
 
     confdata_storage_ = nullptr;
+    section_index_ = nullptr;
     resource_ = nullptr;
   }
 }
 
-void ConfdataSample::save_garbage(std::forward_list<ConfdataGarbageNode> &&garbage) noexcept {
-  php_assert(!garbage_);
-  php_assert(confdata_storage_);
-  if (!garbage.empty()) {
-    garbage_ = new std::forward_list<ConfdataGarbageNode>{std::move(garbage)};
-  }
-}
 
 ConfdataGlobalManager &ConfdataGlobalManager::get() noexcept {
   static ConfdataGlobalManager manager;
@@ -104,9 +137,34 @@ void ConfdataGlobalManager::init(size_t confdata_memory_limit,
   key_blacklist_.set_blacklist(std::move(blacklist_pattern));
 }
 
+void ConfdataGlobalManager::save_garbage(std::forward_list<ConfdataGarbageNode> &&garbage) noexcept {
+  if (!garbage.empty()) {
+    php_assert(garbage_.empty() || garbage_.back().epoch < current_epoch_);
+    garbage_.push_back(ConfdataEpochGarbage{current_epoch_, std::move(garbage)});
+  }
+}
+
+void ConfdataGlobalManager::clear_unused_samples() noexcept {
+  confdata_samples_.clear_dirty_unused_resources();
+  // the garbage values of an epoch may be referred by the samples of this and the previous epochs,
+  // so they are destroyed only when all of these samples are cleared
+  uint64_t oldest_used_epoch = current_epoch_;
+  confdata_samples_.for_each_dirty_resource([&oldest_used_epoch](const ConfdataSample &sample) {
+    oldest_used_epoch = std::min(oldest_used_epoch, sample.get_epoch());
+  });
+  while (!garbage_.empty() && garbage_.front().epoch < oldest_used_epoch) {
+    destroy_confdata_garbage(garbage_.front().nodes);
+    garbage_.pop_front();
+  }
+}
+
 ConfdataGlobalManager::~ConfdataGlobalManager() noexcept {
   if (confdata_samples_.is_initial_process() && is_initialized()) {
     confdata_samples_.destroy();
+    for (auto &epoch_garbage : garbage_) {
+      destroy_confdata_garbage(epoch_garbage.nodes);
+    }
+    garbage_.clear();
     munmap(resource_.memory_begin(), resource_.get_memory_stats().memory_limit);
     resource_.init(nullptr, 0);
   }
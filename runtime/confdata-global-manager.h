@@ -3,6 +3,7 @@
 // Distributed under the GPL v3 License, see LICENSE.notice.txt
 
 #pragma once
+#include <deque>
 #include <forward_list>
 #include <unordered_set>
 
@@ -27,23 +28,68 @@ struct ConfdataGarbageNode {
   ConfdataGarbageDestroyWay destroy_way;
 };
 
+// The exact lookup index of the sections of a published sample: an open addressing hash table with the linear probing.
+// It is built in the confdata memory by the master when the sample is published and is read only for the workers,
+// the sorted map is still used for the prefix scans.
+class ConfdataSectionIndex : vk::not_copyable {
+public:
+  void build(const confdata_sample_storage &confdata, memory_resource::unsynchronized_pool_resource &resource) noexcept;
+  void clear(memory_resource::unsynchronized_pool_resource &resource) noexcept;
+
+  const confdata_sample_storage::value_type *find(const string &first_key) const noexcept {
+    if (!slots_) {
+      return nullptr;
+    }
+    const int64_t hash = first_key.hash();
+    for (size_t i = static_cast<size_t>(hash) & mask_;; i = (i + 1) & mask_) {
+      const Slot &slot = slots_[i];
+      if (!slot.section) {
+        return nullptr;
+      }
+      if (slot.hash == hash && slot.section->first.size() == first_key.size() &&
+          !memcmp(slot.section->first.c_str(), first_key.c_str(), first_key.size())) {
+        return slot.section;
+      }
+    }
+  }
+
+private:
+  struct Slot {
+    int64_t hash;
+    const confdata_sample_storage::value_type *section;
+  };
+
+  Slot *slots_{nullptr};
+  size_t mask_{0};
+};
+
 class ConfdataSample : vk::not_copyable {
 public:
   void init(memory_resource::unsynchronized_pool_resource &resource) noexcept;
-  void reset(confdata_sample_storage &&new_confdata) noexcept;
+  void reset(confdata_sample_storage &&new_confdata, uint64_t epoch = 0) noexcept;
   void clear() noexcept;
   void destroy() noexcept;
 
-  void save_garbage(std::forward_list<ConfdataGarbageNode> &&garbage) noexcept;
+  // the number of the publication the sample has been reset with
+  uint64_t get_epoch() const noexcept {
+    return epoch_;
+  }
 
   const auto &get_confdata() const noexcept {
     return *confdata_storage_;
   }
 
+  // the section of the first key, or nullptr if there is no one
+  const mixed *find_section(const string &first_key) const noexcept {
+    const auto *section = section_index_->find(first_key);
+    return section ? &section->second : nullptr;
+  }
+
 private:
   memory_resource::unsynchronized_pool_resource *resource_{nullptr};
   confdata_sample_storage *confdata_storage_{nullptr};
-  std::forward_list<ConfdataGarbageNode> *garbage_{nullptr};
+  ConfdataSectionIndex *section_index_{nullptr};
+  uint64_t epoch_{0};
 };
 
 class ConfdataGlobalManager : vk::not_copyable {
@@ -72,18 +118,35 @@ public:
     return confdata_samples_.release_resource(sample);
   }
 
-  bool can_next_be_updated() noexcept {
-    return confdata_samples_.is_next_resource_unused();
+  // the master holds the current sample while a forked process reads it,
+  // the held sample isn't cleared and the garbage of its epoch isn't destroyed until it is released
+  const ConfdataSample *hold_current_sample() noexcept {
+    return confdata_samples_.hold_current_resource();
   }
 
-  bool try_switch_to_next_sample(confdata_sample_storage &&confdata_storage) noexcept {
-    return confdata_samples_.try_switch_to_next_unused_resource(std::move(confdata_storage));
+  void release_held_sample(const ConfdataSample *sample) noexcept {
+    confdata_samples_.release_held_resource(sample);
   }
 
-  void clear_unused_samples() noexcept {
-    return confdata_samples_.clear_dirty_unused_resources_in_sequence();
+  // a sample can't be updated only if all the inactive ones are still used by the workers
+  bool can_next_be_updated() const noexcept {
+    return confdata_samples_.has_clean_inactive_resource();
   }
 
+  // the garbage is the values of the current sample which the next one doesn't have,
+  // it should be saved right before the switch
+  void save_garbage(std::forward_list<ConfdataGarbageNode> &&garbage) noexcept;
+
+  bool try_switch_to_next_sample(confdata_sample_storage &&confdata_storage) noexcept {
+    if (!confdata_samples_.try_switch_to_any_clean_resource(std::move(confdata_storage), current_epoch_ + 1)) {
+      return false;
+    }
+    ++current_epoch_;
+    return true;
+  }
+
+  void clear_unused_samples() noexcept;
+
   memory_resource::unsynchronized_pool_resource &get_resource() noexcept {
     return resource_;
   }
@@ -107,6 +170,14 @@ private:
   memory_resource::unsynchronized_pool_resource resource_;
   InterProcessResourceManager<ConfdataSample, 30> confdata_samples_;
 
+  // the master only fields: the epoch of the current sample and the garbage of the previous epochs, the oldest first
+  struct ConfdataEpochGarbage {
+    uint64_t epoch;
+    std::forward_list<ConfdataGarbageNode> nodes;
+  };
+  uint64_t current_epoch_{0};
+  std::deque<ConfdataEpochGarbage> garbage_;
+
   ConfdataPredefinedWildcards predefined_wildcards_;
   ConfdataKeyBlacklist key_blacklist_;
 };
@@ -14,7 +14,10 @@
 #include "runtime/global_storage.h"
 #include "runtime/integer_types.h"
 #include "runtime/interface.h"
+#include "runtime/net_events.h"
 #include "runtime/openssl.h"
+#include "runtime/resumable.h"
+#include "server/php-queries.h"
 #include "common/smart_ptrs/singleton.h"
 #include "common/wrappers/to_array.h"
 
@@ -167,6 +170,8 @@ public:
   Optional<string> private_data{false};
 
   bool return_transfer{false};
+  // the forked resumable which is finished with the transfer of curl_exec_concurrently, 0 if there is no transfer
+  int64_t exec_transfer_id{0};
 };
 
 class MultiContext : public BaseContext {
@@ -183,12 +188,24 @@ public:
   }
 
   CURLM *multi_handle;
+  // CURL_POLL_* of the sockets the handle waits for, reported by curl_multi_socket_cb
+  array<int64_t> sockets;
+  // curl_exec_concurrently handle only: its CURLMOPT_TIMERFUNCTION timer
+  event_timer *timer{nullptr};
+  bool timeout_expired{false};
 };
 
 struct CurlContexts_ {
   array<EasyContext *> easy_contexts;
   array<MultiContext *> multi_contexts;
 
+  // runs the transfers of curl_exec_concurrently, its sockets are watched by the engine reactor
+  MultiContext *exec_multi{nullptr};
+
+  // the multi handle waiting in curl_multi_select and the number of its sockets became ready
+  MultiContext *selecting_multi{nullptr};
+  int64_t selected_sockets{0};
+
   template<typename T>
   T *get_value(int64_t id) const noexcept;
 };
@@ -227,6 +244,9 @@ void easy_close(EasyContext *easy_context) noexcept {
 
 void multi_close(MultiContext *multi_context) noexcept {
   dl::critical_section_call(curl_multi_cleanup, multi_context->multi_handle);
+  if (multi_context->timer) {
+    remove_event_timer(multi_context->timer);
+  }
   multi_context->~MultiContext();
   dl::deallocate(multi_context, sizeof(MultiContext));
 }
@@ -248,6 +268,161 @@ size_t curl_write(char *data, size_t size, size_t nmemb, void *userdata) {
   return size * nmemb;
 }
 
+int to_script_fd_flags(int64_t curl_poll) noexcept {
+  return (curl_poll & CURL_POLL_IN ? sfd_read : 0) | (curl_poll & CURL_POLL_OUT ? sfd_write : 0);
+}
+
+// this is a callback called from the curl_multi_* functions
+int curl_multi_socket_cb(CURL *, curl_socket_t fd, int what, void *userp, void *) {
+  dl::leave_critical_section();
+  auto *multi_context = static_cast<MultiContext *>(userp);
+  const bool is_exec_multi = multi_context == CurlContexts::get()->exec_multi;
+  if (what == CURL_POLL_REMOVE) {
+    multi_context->sockets.unset(int64_t{fd});
+    unwatch_script_fd(fd);
+  } else {
+    multi_context->sockets.set_value(int64_t{fd}, int64_t{what});
+    // the sockets of the other multi handles are watched only during curl_multi_select
+    if (is_exec_multi) {
+      watch_script_fd(fd, to_script_fd_flags(what));
+    }
+  }
+  dl::enter_critical_section();
+  return 0;
+}
+
+int curl_timeout_wakeup_id = -1;
+
+// this is a callback called from the curl_multi_* functions of the curl_exec_concurrently handle
+int curl_timer_callback(CURLM *, long timeout_ms, void *userp) {
+  dl::leave_critical_section();
+  auto *multi_context = static_cast<MultiContext *>(userp);
+  if (multi_context->timer) {
+    remove_event_timer(multi_context->timer);
+    multi_context->timer = nullptr;
+  }
+  // curl_multi_socket_action can't be called from its own callback, the caller runs it once more
+  if (timeout_ms == 0) {
+    multi_context->timeout_expired = true;
+  } else if (timeout_ms > 0) {
+    multi_context->timer = allocate_event_timer(get_precise_now() + timeout_ms * 0.001, curl_timeout_wakeup_id, 0);
+  }
+  dl::enter_critical_section();
+  return 0;
+}
+
+EasyContext *find_easy_context(CURL *easy_handle) noexcept {
+  void *id_as_ptr = nullptr;
+  dl::critical_section_call([&] { curl_easy_getinfo (easy_handle, CURLINFO_PRIVATE, &id_as_ptr); });
+  const auto curl_handler_id = static_cast<int64_t>(reinterpret_cast<size_t>(id_as_ptr));
+  auto *const *easy_context = CurlContexts::get()->easy_contexts.find_value(curl_handler_id - 1);
+  return easy_context && *easy_context && (*easy_context)->easy_handle == easy_handle ? *easy_context : nullptr;
+}
+
+MultiContext *get_exec_multi() noexcept {
+  if (MultiContext *exec_multi = CurlContexts::get()->exec_multi) {
+    return exec_multi;
+  }
+  CURLM *multi_handle = dl::critical_section_call(curl_multi_init);
+  if (unlikely(multi_handle == nullptr)) {
+    return nullptr;
+  }
+  auto *exec_multi = static_cast<MultiContext *>(dl::allocate(sizeof(MultiContext)));
+  new(exec_multi) MultiContext{multi_handle};
+  exec_multi->set_option_safe(CURLMOPT_SOCKETFUNCTION, curl_multi_socket_cb);
+  exec_multi->set_option_safe(CURLMOPT_SOCKETDATA, static_cast<void *>(exec_multi));
+  exec_multi->set_option_safe(CURLMOPT_TIMERFUNCTION, curl_timer_callback);
+  exec_multi->set_option_safe(CURLMOPT_TIMERDATA, static_cast<void *>(exec_multi));
+  CurlContexts::get()->exec_multi = exec_multi;
+  return exec_multi;
+}
+
+// lets the curl_exec_concurrently handle do its work and wakes up its calls with the finished transfers
+void exec_multi_socket_action(curl_socket_t fd, int ev_bitmask) noexcept {
+  MultiContext *exec_multi = CurlContexts::get()->exec_multi;
+  int running = 0;
+  dl::critical_section_call(curl_multi_socket_action, exec_multi->multi_handle, fd, ev_bitmask, &running);
+  while (exec_multi->timeout_expired) {
+    exec_multi->timeout_expired = false;
+    dl::critical_section_call(curl_multi_socket_action, exec_multi->multi_handle, CURL_SOCKET_TIMEOUT, 0, &running);
+  }
+
+  array<int64_t> finished_transfers;
+  int msgs_in_queue = 0;
+  while (CURLMsg *msg = dl::critical_section_call(curl_multi_info_read, exec_multi->multi_handle, &msgs_in_queue)) {
+    if (msg->msg != CURLMSG_DONE) {
+      continue;
+    }
+    CURL *easy_handle = msg->easy_handle;
+    const CURLcode result = msg->data.result;
+    dl::critical_section_call(curl_multi_remove_handle, exec_multi->multi_handle, easy_handle);
+    if (EasyContext *easy_context = find_easy_context(easy_handle)) {
+      easy_context->error_num = result;
+      finished_transfers.push_back(easy_context->exec_transfer_id);
+      easy_context->exec_transfer_id = 0;
+    }
+  }
+  for (auto it = finished_transfers.cbegin(); it != finished_transfers.cend(); ++it) {
+    resumable_run_ready(it.get_value());
+  }
+}
+
+void process_curl_timeout(event_timer *timer) {
+  MultiContext *exec_multi = CurlContexts::get()->exec_multi;
+  php_assert (exec_multi && exec_multi->timer == timer);
+  remove_event_timer(timer);
+  exec_multi->timer = nullptr;
+  exec_multi_socket_action(CURL_SOCKET_TIMEOUT, 0);
+}
+
+// finishes when the transfer of curl_exec_concurrently is done, the result is kept by the easy context
+class curl_transfer_resumable final : public Resumable {
+protected:
+  bool run() final {
+    output_->save_void();
+    return true;
+  }
+};
+
+mixed get_exec_result(EasyContext *easy_context) noexcept {
+  if (easy_context->error_num != CURLE_OK && easy_context->error_num != CURLE_PARTIAL_FILE) {
+    return false;
+  }
+
+  if (easy_context->return_transfer) {
+    return easy_context->result;
+  }
+
+  return true;
+}
+
+class curl_exec_resumable final : public Resumable {
+  using ReturnT = mixed;
+  curl_easy easy_id;
+  int64_t transfer_id;
+
+  bool ready{false};
+
+protected:
+  bool run() final {
+    RESUMABLE_BEGIN
+      ready = wait_without_result(transfer_id);
+      TRY_WAIT(curl_exec_resumable_label_0, ready, bool);
+      php_assert (ready);
+      get_forked_storage(transfer_id)->load<void>();
+      // the handle may be closed by another fork
+      auto *easy_context = get_context<EasyContext>(easy_id);
+      RETURN(easy_context ? get_exec_result(easy_context) : mixed{false});
+    RESUMABLE_END
+  }
+
+public:
+  curl_exec_resumable(curl_easy easy_id, int64_t transfer_id) noexcept:
+    easy_id(easy_id),
+    transfer_id(transfer_id) {
+  }
+};
+
 // this is a callback called from curl_easy_perform
 int64_t curl_info_header_out(CURL *, curl_infotype type, char *buf, size_t buf_len, void *userdata) {
   if (type == CURLINFO_HEADER_OUT) {
@@ -667,19 +842,46 @@ mixed f$curl_exec(curl_easy easy_id) noexcept {
   if (!easy_context) {
     return false;
   }
+  if (easy_context->exec_transfer_id) {
+    php_warning("curl_exec_concurrently is already running for the handle %ld", easy_id);
+    return false;
+  }
 
   easy_context->cleanup_for_next_request();
   easy_context->error_num = dl::critical_section_call(curl_easy_perform, easy_context->easy_handle);
+  return get_exec_result(easy_context);
+}
 
-  if (easy_context->error_num != CURLE_OK && easy_context->error_num != CURLE_PARTIAL_FILE) {
+mixed f$curl_exec_concurrently(curl_easy easy_id) noexcept {
+  auto *easy_context = get_context<EasyContext>(easy_id);
+  if (!easy_context) {
+    return false;
+  }
+  if (easy_context->exec_transfer_id) {
+    php_warning("curl_exec_concurrently is already running for the handle %ld", easy_id);
     return false;
   }
 
-  if (easy_context->return_transfer) {
-    return easy_context->result;
+  easy_context->cleanup_for_next_request();
+  MultiContext *exec_multi = get_exec_multi();
+  if (unlikely(exec_multi == nullptr)) {
+    // the transfer blocks the whole process, but it is better than nothing
+    easy_context->error_num = dl::critical_section_call(curl_easy_perform, easy_context->easy_handle);
+    return get_exec_result(easy_context);
   }
 
-  return true;
+  const CURLMcode add_result = dl::critical_section_call(curl_multi_add_handle, exec_multi->multi_handle, easy_context->easy_handle);
+  if (add_result != CURLM_OK) {
+    easy_context->error_num = CURLE_FAILED_INIT;
+    snprintf(easy_context->error_msg, CURL_ERROR_SIZE, "%s", dl::critical_section_call(curl_multi_strerror, add_result));
+    return false;
+  }
+
+  // the transfer runs while the other forks are working, the sockets are watched by the engine reactor
+  const int64_t transfer_id = register_forked_resumable(new curl_transfer_resumable());
+  easy_context->exec_transfer_id = transfer_id;
+  exec_multi_socket_action(CURL_SOCKET_TIMEOUT, 0);
+  return start_resumable<mixed>(new curl_exec_resumable(easy_id, transfer_id));
 }
 
 mixed f$curl_getinfo(curl_easy easy_id, int64_t option) noexcept {
@@ -784,7 +986,15 @@ int64_t f$curl_errno(curl_easy easy_id) noexcept {
 void f$curl_close(curl_easy easy_id) noexcept {
   if (auto *easy_context = get_context<EasyContext>(easy_id)) {
     CurlContexts::get()->easy_contexts.set_value(easy_id - 1, nullptr);
+    const int64_t transfer_id = easy_context->exec_transfer_id;
+    if (transfer_id) {
+      dl::critical_section_call(curl_multi_remove_handle, CurlContexts::get()->exec_multi->multi_handle, easy_context->easy_handle);
+    }
     easy_close(easy_context);
+    // curl_exec_concurrently waiting for the handle returns false
+    if (transfer_id) {
+      resumable_run_ready(transfer_id);
+    }
   }
 }
 
@@ -799,6 +1009,8 @@ curl_multi f$curl_multi_init() noexcept {
 
   auto *multi = static_cast<MultiContext *>(dl::allocate(sizeof(MultiContext)));
   new(multi) MultiContext{multi_handle};
+  multi->set_option_safe(CURLMOPT_SOCKETFUNCTION, curl_multi_socket_cb);
+  multi->set_option_safe(CURLMOPT_SOCKETDATA, static_cast<void *>(multi));
 
   CurlContexts::get()->multi_contexts.push_back(multi);
   return CurlContexts::get()->multi_contexts.count();
@@ -866,13 +1078,34 @@ Optional<int64_t> f$curl_multi_exec(curl_multi multi_id, int64_t &still_running)
 
 Optional<int64_t> f$curl_multi_select(curl_multi multi_id, double timeout) noexcept {
   if (auto *multi_context = get_context<MultiContext>(multi_id)) {
-    int numfds = 0;
-    multi_context->error_num = dl::critical_section_call(curl_multi_wait, multi_context->multi_handle, nullptr, 0,
-                                                         static_cast<int>(timeout * 1000.0), &numfds);
+    long curl_timeout_ms = -1;
+    multi_context->error_num = dl::critical_section_call(curl_multi_timeout, multi_context->multi_handle, &curl_timeout_ms);
     if (multi_context->error_num != CURLM_OK) {
       return -1;
     }
-    return int64_t{numfds};
+    if (curl_timeout_ms >= 0 && curl_timeout_ms * 0.001 < timeout) {
+      timeout = curl_timeout_ms * 0.001;
+    }
+
+    // the sockets are waited for by the engine reactor, so that the net events of the other forks are processed meanwhile
+    const array<int64_t> sockets = multi_context->sockets;
+    for (auto it = sockets.cbegin(); it != sockets.cend(); ++it) {
+      watch_script_fd(static_cast<int>(it.get_key().to_int()), to_script_fd_flags(it.get_value()));
+    }
+    CurlContexts::get()->selecting_multi = multi_context;
+    CurlContexts::get()->selected_sockets = 0;
+
+    update_precise_now();
+    const double finish_time = get_precise_now() + timeout;
+    while (CurlContexts::get()->selected_sockets == 0 && get_precise_now() < finish_time) {
+      wait_net(timeout_convert_to_ms(finish_time - get_precise_now()));
+    }
+
+    CurlContexts::get()->selecting_multi = nullptr;
+    for (auto it = sockets.cbegin(); it != sockets.cend(); ++it) {
+      unwatch_script_fd(static_cast<int>(it.get_key().to_int()));
+    }
+    return CurlContexts::get()->selected_sockets;
   }
   return false;
 }
@@ -888,13 +1121,9 @@ Optional<array<int64_t>> f$curl_multi_info_read(curl_multi multi_id, int64_t &ms
       result.set_value(string{"msg"}, static_cast<int64_t>(msg->msg));
       result.set_value(string{"result"}, static_cast<int64_t>(msg->data.result));
 
-      void *id_as_ptr = nullptr;
-      dl::critical_section_call([&] { curl_easy_getinfo (msg->easy_handle, CURLINFO_PRIVATE, &id_as_ptr); });
-      const auto curl_handler_id = static_cast<int64_t>(reinterpret_cast<size_t>(id_as_ptr));
-      const auto *easy_handle = CurlContexts::get()->easy_contexts.find_value(curl_handler_id - 1);
-      if (easy_handle && (*easy_handle)->easy_handle == msg->easy_handle) {
-        (*easy_handle)->error_num = msg->data.result;
-        result.set_value(string{"handle"}, curl_handler_id);
+      if (EasyContext *easy_context = find_easy_context(msg->easy_handle)) {
+        easy_context->error_num = msg->data.result;
+        result.set_value(string{"handle"}, easy_context->self_id);
       }
       return result;
     }
@@ -966,6 +1195,9 @@ void free_curl_lib() noexcept {
         multi_close(multi_context);
       }
     }
+    if (auto exec_multi = CurlContexts::get()->exec_multi) {
+      multi_close(exec_multi);
+    }
 
     curl_global_cleanup();
     CurlContexts::get().hard_reset();
@@ -974,3 +1206,27 @@ void free_curl_lib() noexcept {
     reinit_openssl_lib_hack();
   }
 }
+
+void curl_on_socket_ready(int fd, int ready) noexcept {
+  if (dl::query_num != CurlContexts::get().get_query_tag()) {
+    return;
+  }
+  MultiContext *exec_multi = CurlContexts::get()->exec_multi;
+  if (exec_multi && exec_multi->sockets.has_key(int64_t{fd})) {
+    const int ev_bitmask = (ready & sfd_read ? CURL_CSELECT_IN : 0) | (ready & sfd_write ? CURL_CSELECT_OUT : 0) | (ready & sfd_error ? CURL_CSELECT_ERR : 0);
+    exec_multi_socket_action(fd, ev_bitmask);
+    // the reactor reports the fd once, it is watched again while curl needs it
+    if (const int64_t *what = exec_multi->sockets.find_value(int64_t{fd})) {
+      watch_script_fd(fd, to_script_fd_flags(*what));
+    }
+    return;
+  }
+  if (CurlContexts::get()->selecting_multi && CurlContexts::get()->selecting_multi->sockets.has_key(int64_t{fd})) {
+    CurlContexts::get()->selected_sockets++;
+  }
+}
+
+void global_init_curl_lib() noexcept {
+  php_assert (curl_timeout_wakeup_id == -1);
+  curl_timeout_wakeup_id = register_wakeup_callback(&process_curl_timeout);
+}
@@ -18,6 +18,9 @@ bool f$curl_setopt_array(curl_easy easy_id, const array<mixed> &options) noexcep
 
 mixed f$curl_exec(curl_easy easy_id) noexcept;
 
+// runs the transfer in the engine reactor, the other forks are working meanwhile
+mixed f$curl_exec_concurrently(curl_easy easy_id) noexcept;
+
 mixed f$curl_getinfo(curl_easy easy_id, int64_t option = 0) noexcept;
 
 string f$curl_error(curl_easy easy_id) noexcept;
@@ -54,4 +57,7 @@ Optional<string> f$curl_multi_strerror(int64_t error_num) noexcept;
 
 void free_curl_lib() noexcept;
 
+// called for the ne_fd_ready net events, the curl sockets are the only fds watched by the runtime
+void curl_on_socket_ready(int fd, int ready) noexcept;
 
+void global_init_curl_lib() noexcept;
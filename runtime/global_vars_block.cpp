@@ -0,0 +1,33 @@
+// Compiler for PHP (aka KPHP)
+// Copyright (c) 2020 LLC «V Kontakte»
+// Distributed under the GPL v3 License, see LICENSE.notice.txt
+
+#include "runtime/global_vars_block.h"
+
+static int64_t reset_vars_count = 0;
+
+void GlobalVarsBlock::reset_dirty(GlobalVarsBlock *&dirty_blocks) noexcept {
+  while (dirty_blocks) {
+    GlobalVarsBlock *block = dirty_blocks;
+    dirty_blocks = block->next_;
+    block->next_ = nullptr;
+    block->dirty_ = false;
+    reset_vars_count += block->reset_();
+  }
+}
+
+void GlobalVarsBlock::clear_reset_vars_count() noexcept {
+  reset_vars_count = 0;
+}
+
+void GlobalVarsBlock::add_reset_vars_count(int64_t count) noexcept {
+  reset_vars_count += count;
+}
+
+int64_t GlobalVarsBlock::get_reset_vars_count() noexcept {
+  return reset_vars_count;
+}
+
+int64_t f$get_global_vars_reset_count() {
+  return GlobalVarsBlock::get_reset_vars_count();
+}
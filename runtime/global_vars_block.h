@@ -0,0 +1,51 @@
+// Compiler for PHP (aka KPHP)
+// Copyright (c) 2020 LLC «V Kontakte»
+// Distributed under the GPL v3 License, see LICENSE.notice.txt
+
+#pragma once
+
+#include <cstdint>
+
+#include "common/mixin/not_copyable.h"
+
+// Global and static vars are reset after a request by blocks:
+// the static vars of a function, the static fields of a class or a single global var.
+// The generated functions mark the blocks of the vars they use as dirty on entry,
+// and only the dirty blocks are reset.
+class GlobalVarsBlock : vk::not_copyable {
+public:
+  // resets the vars of the block and returns their number
+  using ResetFunction = int64_t (*)();
+
+  // a block starts dirty, so the first reset gives all the vars their initial values
+  GlobalVarsBlock(GlobalVarsBlock *&dirty_blocks, ResetFunction reset) noexcept :
+    reset_(reset) {
+    link(dirty_blocks);
+  }
+
+  void mark_dirty(GlobalVarsBlock *&dirty_blocks) noexcept {
+    if (!dirty_) {
+      link(dirty_blocks);
+    }
+  }
+
+  static void reset_dirty(GlobalVarsBlock *&dirty_blocks) noexcept;
+
+  static void clear_reset_vars_count() noexcept;
+  static void add_reset_vars_count(int64_t count) noexcept;
+  static int64_t get_reset_vars_count() noexcept;
+
+private:
+  void link(GlobalVarsBlock *&dirty_blocks) noexcept {
+    dirty_ = true;
+    next_ = dirty_blocks;
+    dirty_blocks = this;
+  }
+
+  const ResetFunction reset_;
+  GlobalVarsBlock *next_{nullptr};
+  bool dirty_{false};
+};
+
+// the number of global and static vars reset after the previous request
+int64_t f$get_global_vars_reset_count();
@@ -4,20 +4,23 @@
 
 #include "runtime/instance_cache.h"
 
+#include <algorithm>
+#include <array>
 #include <chrono>
 #include <forward_list>
-#include <map>
 #include <mutex>
 #include <unordered_set>
 
+#include "common/cacheline.h"
 #include "common/kprintf.h"
 
 #include "runtime/allocator.h"
 #include "runtime/critical_section.h"
 #include "runtime/inter-process-mutex.h"
+#include "runtime/instance_cache_index.h"
 #include "runtime/inter-process-resource.h"
-#include "runtime/memory_resource/resource_allocator.h"
 #include "runtime/refcountable_php_classes.h"
+#include "server/php-engine-vars.h"
 
 namespace ic_impl_ {
 
@@ -55,9 +58,13 @@ struct CacheContext : private vk::not_copyable {
   memory_resource::unsynchronized_pool_resource memory_resource;
   InstanceCacheStats stats;
   std::atomic<bool> memory_swap_required{false};
+  ReadersEpochs readers;
 
-  void move_to_garbage(ElementHolder *element) noexcept;
-  bool has_garbage() const noexcept { return cache_garbage_ != nullptr; }
+  void move_to_garbage(ElementHolder *element) noexcept { garbage_.add(element); }
+  // should be called under the allocator_mutex
+  void move_to_garbage(IndexTable<ElementHolder> *table) noexcept { garbage_.add(table); }
+  bool has_garbage() const noexcept { return !garbage_.empty(); }
+  // should be called under the allocator_mutex
   void clear_garbage() noexcept;
 
   auto memory_replacement_guard(bool force_enable_disable = false) noexcept {
@@ -70,7 +77,7 @@ struct CacheContext : private vk::not_copyable {
   }
 
 private:
-  std::atomic<ElementHolder *> cache_garbage_{nullptr};
+  EpochGarbage<ElementHolder> garbage_;
 };
 
 class ElementHolder : private vk::thread_safe_refcnt<ElementHolder> {
@@ -78,6 +85,17 @@ public:
   using vk::thread_safe_refcnt<ElementHolder>::add_ref;
   using vk::thread_safe_refcnt<ElementHolder>::get_refcnt;
 
+  // the element found by a lock-free lookup may be already released, but not destroyed yet
+  bool try_add_ref() noexcept {
+    size_t current_refcnt = refcnt.load();
+    do {
+      if (current_refcnt == 0) {
+        return false;
+      }
+    } while (!refcnt.compare_exchange_weak(current_refcnt, current_refcnt + 1));
+    return true;
+  }
+
   void release() noexcept {
     if (--refcnt == 0) {
       cache_context.move_to_garbage(this);
@@ -88,14 +106,16 @@ public:
     php_assert(refcnt == 0);
     cache_context.stats.elements_destroyed.fetch_add(1, std::memory_order_relaxed);
     auto &mem_resource = cache_context.memory_resource;
+    DeepDestroyFromCacheVisitor{}.process(key);
     this->~ElementHolder();
     mem_resource.deallocate(this, sizeof(ElementHolder));
   }
 
-  ElementHolder(std::chrono::nanoseconds now, int64_t ttl,
+  ElementHolder(std::chrono::nanoseconds now, int64_t ttl, string &&key_in_shared_memory,
                 std::unique_ptr<InstanceWrapperBase> &&instance,
                 CacheContext &context) noexcept:
     inserted_by_process(getpid()),
+    key(std::move(key_in_shared_memory)),
     instance_wrapper(std::move(instance)),
     cache_context(context) {
     update_time_points(now, ttl);
@@ -104,28 +124,35 @@ public:
 
   // returns how long the element is lived in relation to the expected lifetime
   double freshness_ratio(std::chrono::nanoseconds now, double immortal_ratio = 0.5) const noexcept {
+    const std::chrono::nanoseconds stored = stored_at;
+    const std::chrono::nanoseconds expiring = expiring_at;
     // an immortal element
-    if (expiring_at == std::chrono::nanoseconds::max()) {
+    if (expiring == std::chrono::nanoseconds::max()) {
       return immortal_ratio;
     }
-    if (expiring_at <= stored_at) {
+    if (expiring <= stored) {
       return 1.0;
     }
-    const auto real_age = std::chrono::duration<double>{std::max(now, stored_at) - stored_at};
-    const auto max_age = std::chrono::duration<double>{expiring_at - stored_at};
+    const auto real_age = std::chrono::duration<double>{std::max(now, stored) - stored};
+    const auto max_age = std::chrono::duration<double>{expiring - stored};
     return real_age.count() / max_age.count();
   }
 
+  // should be called under the storage_mutex
   void update_time_points(std::chrono::nanoseconds now, int64_t ttl) noexcept {
-    stored_at = std::max(now, stored_at);
-    expiring_at = ttl > 0 ? stored_at + std::chrono::seconds{ttl} : std::chrono::nanoseconds::max();
+    const std::chrono::nanoseconds stored = std::max(now, stored_at.load());
+    stored_at = stored;
+    expiring_at = ttl > 0 ? stored + std::chrono::seconds{ttl} : std::chrono::nanoseconds::max();
     early_fetch_performed = false;
   }
 
-  std::chrono::nanoseconds stored_at{std::chrono::nanoseconds::min()};
-  std::chrono::nanoseconds expiring_at{std::chrono::nanoseconds::max()};
-  bool early_fetch_performed{false};
+  // time points are updated under the storage_mutex, but they are read by the lock-free fetch
+  std::atomic<std::chrono::nanoseconds> stored_at{std::chrono::nanoseconds::min()};
+  std::atomic<std::chrono::nanoseconds> expiring_at{std::chrono::nanoseconds::max()};
+  std::atomic<bool> early_fetch_performed{false};
   const pid_t inserted_by_process{0};
+  // a key in the shared memory, it's immutable while the element is alive
+  string key;
 
   std::unique_ptr<InstanceWrapperBase> instance_wrapper;
   CacheContext &cache_context;
@@ -134,35 +161,18 @@ public:
   std::atomic<ElementHolder *> next_in_garbage_list{nullptr};
 };
 
-using ElementStorage_ = memory_resource::stl::map<string, vk::intrusive_ptr<ElementHolder>, memory_resource::unsynchronized_pool_resource, stl_string_less>;
-
 struct SharedDataStorages : private vk::not_copyable {
-  explicit SharedDataStorages(memory_resource::unsynchronized_pool_resource &resource) :
-    storage(ElementStorage_::allocator_type{resource}) {
-  }
-
   inter_process_mutex storage_mutex;
-  ElementStorage_ storage;
+  ElementsIndex<ElementHolder> storage;
   std::atomic<bool> is_storage_empty{true};
 };
 
-void CacheContext::move_to_garbage(ElementHolder *element) noexcept {
-  php_assert(element->next_in_garbage_list == nullptr);
-  // Put all garbage into the cache_context.cache_garbage; the cleanup happens later, under the lock
-  auto *next = cache_garbage_.load();
-  do {
-    element->next_in_garbage_list.store(next);
-  } while (!cache_garbage_.compare_exchange_strong(next, element));
-}
-
 void CacheContext::clear_garbage() noexcept {
-  auto element = cache_garbage_.exchange(nullptr);
-
-  while (element) {
-    auto next = element->next_in_garbage_list.load();
-    element->destroy();
-    element = next;
-  }
+  garbage_.collect(readers, [this](IndexTable<ElementHolder> *table) {
+    const size_t table_size = IndexTable<ElementHolder>::memory_size(table->capacity);
+    table->~IndexTable();
+    memory_resource.deallocate(table, table_size);
+  });
 }
 
 class SharedMemoryData : vk::not_copyable {
@@ -225,7 +235,7 @@ private:
     cache_context_->memory_resource.init(data_storage_mem + get_data_size(), shared_memory_pool_size_);
     data_shards_ = reinterpret_cast<SharedDataStorages *>(data_storage_mem);
     for (size_t i = 0; i != DATA_SHARDS_COUNT; ++i) {
-      new(&data_shards_[i]) SharedDataStorages{cache_context_->memory_resource};
+      new(&data_shards_[i]) SharedDataStorages{};
     }
   }
 
@@ -352,45 +362,37 @@ public:
       return (*cached_element_ptr)->instance_wrapper.get();
     }
 
-    vk::intrusive_ptr<ElementHolder> element;
-    bool element_logically_expired = false;
-    {
-      auto &data = current_->get_data(key);
-      std::lock_guard<inter_process_mutex> shared_data_lock{data.storage_mutex};
-      auto it = data.storage.find(key);
-      if (it == data.storage.end()) {
-        ic_debug("can't fetch '%s' because it is absent\n", key.c_str());
-        context_->stats.elements_missed.fetch_add(1, std::memory_order_relaxed);
-        return nullptr;
-      }
+    vk::intrusive_ptr<ElementHolder> element = find_element(current_->get_data(key), key);
+    if (!element) {
+      ic_debug("can't fetch '%s' because it is absent\n", key.c_str());
+      context_->stats.elements_missed.fetch_add(1, std::memory_order_relaxed);
+      return nullptr;
+    }
 
-      update_now();
-      // if more than EARLY_EXPIRATION_ELEMENT_RATIO time is passed out of the expected element lifetime,
-      // return null to the next worker process so it knows that the value needs to be updated in advance
-      if (!it->second->early_fetch_performed &&
-          it->second->freshness_ratio(now_) >= EARLY_EXPIRATION_ELEMENT_RATIO) {
-        it->second->early_fetch_performed = true;
-        context_->stats.elements_missed_earlier.fetch_add(1, std::memory_order_relaxed);
-        ic_debug("can't fetch '%s' because less than %f of total time is left\n",
-                 key.c_str(), EARLY_EXPIRATION_ELEMENT_RATIO);
-        return nullptr;
-      }
-      element_logically_expired = it->second->expiring_at <= now_;
-      if (element_logically_expired) {
-        if (even_if_expired) {
-          context_->stats.elements_logically_expired_but_fetched.fetch_add(1, std::memory_order_relaxed);
-          ic_debug("fetch logically expired element '%s'\n", key.c_str());
-        } else {
-          context_->stats.elements_logically_expired_and_ignored.fetch_add(1, std::memory_order_relaxed);
-          ic_debug("can't fetch '%s' because element was logically expired\n", key.c_str());
-          return nullptr;
-        }
+    update_now();
+    // if more than EARLY_EXPIRATION_ELEMENT_RATIO time is passed out of the expected element lifetime,
+    // return null to the next worker process so it knows that the value needs to be updated in advance
+    if (!element->early_fetch_performed.load(std::memory_order_relaxed) &&
+        element->freshness_ratio(now_) >= EARLY_EXPIRATION_ELEMENT_RATIO &&
+        !element->early_fetch_performed.exchange(true)) {
+      context_->stats.elements_missed_earlier.fetch_add(1, std::memory_order_relaxed);
+      ic_debug("can't fetch '%s' because less than %f of total time is left\n",
+               key.c_str(), EARLY_EXPIRATION_ELEMENT_RATIO);
+      return nullptr;
+    }
+    const bool element_logically_expired = element->expiring_at.load() <= now_;
+    if (element_logically_expired) {
+      if (even_if_expired) {
+        context_->stats.elements_logically_expired_but_fetched.fetch_add(1, std::memory_order_relaxed);
+        ic_debug("fetch logically expired element '%s'\n", key.c_str());
       } else {
-        context_->stats.elements_fetched.fetch_add(1, std::memory_order_relaxed);
-        ic_debug("fetch '%s' from inter process cache\n", key.c_str());
+        context_->stats.elements_logically_expired_and_ignored.fetch_add(1, std::memory_order_relaxed);
+        ic_debug("can't fetch '%s' because element was logically expired\n", key.c_str());
+        return nullptr;
       }
-
-      element = it->second;
+    } else {
+      context_->stats.elements_fetched.fetch_add(1, std::memory_order_relaxed);
+      ic_debug("fetch '%s' from inter process cache\n", key.c_str());
     }
 
     // don't cache logically expired elements
@@ -419,12 +421,12 @@ public:
     auto &data = current_->get_data(key);
     update_now();
     std::lock_guard<inter_process_mutex> shared_data_lock{data.storage_mutex};
-    auto it = data.storage.find(key);
-    if (it == data.storage.end()) {
+    ElementHolder *element = data.storage.find(key, ElementsIndex<ElementHolder>::hash_of(key));
+    if (!element) {
       return false;
     }
 
-    it->second->update_time_points(now_, ttl);
+    element->update_time_points(now_, ttl);
     return true;
   }
 
@@ -438,22 +440,27 @@ public:
     auto &data = current_->get_data(key);
     update_now();
     std::lock_guard<inter_process_mutex> shared_data_lock{data.storage_mutex};
-    auto it = data.storage.find(key);
-    if (it == data.storage.end()) {
+    ElementHolder *element = data.storage.find(key, ElementsIndex<ElementHolder>::hash_of(key));
+    if (!element) {
       return false;
     }
 
     // calculate expiring_at in a way that the next fetch returns false
     constexpr double SCALE = 1.0 / EARLY_EXPIRATION_ELEMENT_RATIO;
-    auto new_element_ttl = std::chrono::duration_cast<std::chrono::nanoseconds>((now_ - it->second->stored_at) * SCALE);
-    auto new_expiring_at = std::chrono::duration_cast<std::chrono::nanoseconds>(it->second->stored_at + new_element_ttl);
+    const std::chrono::nanoseconds stored_at = element->stored_at;
+    auto new_element_ttl = std::chrono::duration_cast<std::chrono::nanoseconds>((now_ - stored_at) * SCALE);
+    auto new_expiring_at = std::chrono::duration_cast<std::chrono::nanoseconds>(stored_at + new_element_ttl);
     new_expiring_at = std::min(new_expiring_at, now_ + DELETED_ELEMENT_LIFETIME_LIMIT);
-    it->second->expiring_at = std::max(new_expiring_at, it->second->stored_at);
+    element->expiring_at = std::max(new_expiring_at, stored_at);
     return true;
   }
 
   void force_release_all_resources() {
     data_manager_.force_release_all_resources();
+    // the previous worker with the same logname_id might be killed inside the lock-free fetch
+    data_manager_.for_each_resource([](SharedMemoryData &data) {
+      data.get_context().readers.force_leave();
+    });
   }
 
   // this function should be called only from master
@@ -477,10 +484,12 @@ public:
       }
       {
         std::lock_guard<inter_process_mutex> shared_data_lock{data_shard.storage_mutex};
-        if (std::none_of(data_shard.storage.begin(), data_shard.storage.end(),
-                         [now_with_delay](const auto &stored_element) {
-                           return stored_element.second->expiring_at <= now_with_delay;
-                         })) {
+        bool has_expired_elements = false;
+        data_shard.storage.for_each_slot([now_with_delay, &has_expired_elements](const IndexTable<ElementHolder>::Slot &slot) {
+          const ElementHolder *element = slot.element.load(std::memory_order_relaxed);
+          has_expired_elements |= element && element->expiring_at.load() <= now_with_delay;
+        });
+        if (!has_expired_elements) {
           continue;
         }
       }
@@ -488,18 +497,16 @@ public:
       // lock in this very order and do not move allocator_lock anywhere below, otherwise it will result in a deadlock!
       std::lock_guard<inter_process_mutex> allocator_lock{context.allocator_mutex};
       std::lock_guard<inter_process_mutex> shared_data_lock{data_shard.storage_mutex};
-      for (auto it = data_shard.storage.begin(); it != data_shard.storage.end();) {
-        if (it->second->expiring_at <= now_with_delay) {
-          ic_debug("purge '%s'\n", it->first.c_str());
-          string removing_key = it->first;
-          it = data_shard.storage.erase(it);
-          DeepDestroyFromCacheVisitor{}.process(removing_key);
+      data_shard.storage.for_each_slot([now_with_delay, &data_shard, &context](IndexTable<ElementHolder>::Slot &slot) {
+        const ElementHolder *element = slot.element.load(std::memory_order_relaxed);
+        if (element && element->expiring_at.load() <= now_with_delay) {
+          ic_debug("purge '%s'\n", element->key.c_str());
+          // the key is destroyed with the element, when the lock-free readers can't access it anymore
+          data_shard.storage.remove(slot)->release();
           context.stats.elements_expired.fetch_add(1, std::memory_order_relaxed);
           context.stats.elements_cached.fetch_sub(1, std::memory_order_relaxed);
-        } else {
-          ++it;
         }
-      }
+      });
       data_shard.is_storage_empty.store(data_shard.storage.empty(), std::memory_order_relaxed);
     }
 
@@ -534,13 +541,22 @@ public:
   }
 
 private:
-  bool is_element_insertion_can_be_skipped(SharedDataStorages &data, const string &key) const {
-    std::lock_guard<inter_process_mutex> shared_data_lock{data.storage_mutex};
-    auto it = data.storage.find(key);
+  // the lock-free lookup, the element is returned with an acquired reference
+  vk::intrusive_ptr<ElementHolder> find_element(const SharedDataStorages &data, const string &key) const noexcept {
+    dl::CriticalSectionGuard critical_section;
+    context_->readers.enter();
+    ElementHolder *element = data.storage.find(key, ElementsIndex<ElementHolder>::hash_of(key));
+    const bool is_acquired = element && element->try_add_ref();
+    context_->readers.leave();
+    return vk::intrusive_ptr<ElementHolder>{is_acquired ? element : nullptr, false};
+  }
+
+  bool is_element_insertion_can_be_skipped(const SharedDataStorages &data, const string &key) const {
+    auto element = find_element(data, key);
     // allow to skip the insertion of the element if it was inserted by another process recently enough
-    if (it != data.storage.end() &&
-        it->second->freshness_ratio(now_) < FRESHNESS_ELEMENT_RATIO &&
-        it->second->inserted_by_process != getpid()) {
+    if (element &&
+        element->freshness_ratio(now_) < FRESHNESS_ELEMENT_RATIO &&
+        element->inserted_by_process != getpid()) {
       ic_debug("skip '%s' because it was recently updated\n", key.c_str());
       context_->stats.elements_storing_skipped_due_recent_update.fetch_add(1, std::memory_order_relaxed);
       return true;
@@ -605,35 +621,39 @@ private:
 
     // moving an instance into a shared memory
     if (auto cached_instance_wrapper = instance_wrapper.clone_and_detach_shared_ref(detach_processor)) {
-      if (void *mem = detach_processor.prepare_raw_memory(sizeof(ElementHolder))) {
-        vk::intrusive_ptr<ElementHolder> element{new(mem) ElementHolder{now_, ttl, std::move(cached_instance_wrapper), *context_}};
+      string key_in_shared_memory = key_in_script_memory;
+      if (unlikely(!detach_processor.process(key_in_shared_memory))) {
+        return nullptr;
+      }
+      void *mem = detach_processor.prepare_raw_memory(sizeof(ElementHolder));
+      if (unlikely(!mem)) {
+        DeepDestroyFromCacheVisitor{}.process(key_in_shared_memory);
+        return nullptr;
+      }
+      auto *inserted_element = new(mem) ElementHolder{now_, ttl, std::move(key_in_shared_memory), std::move(cached_instance_wrapper), *context_};
+      vk::intrusive_ptr<ElementHolder> element{inserted_element};
+      const uint64_t hash = ElementsIndex<ElementHolder>::hash_of(inserted_element->key);
+      ElementHolder *replaced_element = nullptr;
+      {
         std::lock_guard<inter_process_mutex> shared_data_lock{data.storage_mutex};
-        auto it = data.storage.find(key_in_script_memory);
-        if (it == data.storage.end()) {
-          string key_in_shared_memory = key_in_script_memory;
-          if (unlikely(!detach_processor.process(key_in_shared_memory))) {
-            return nullptr;
-          }
-          constexpr auto node_max_size = ElementStorage_::allocator_type::max_value_type_size();
-          if (unlikely(!detach_processor.is_enough_memory_for(node_max_size))) {
-            DeepDestroyFromCacheVisitor{}.process(key_in_shared_memory);
-            return nullptr;
-          }
-
-          it = data.storage.emplace(std::move(key_in_shared_memory), vk::intrusive_ptr<ElementHolder>{}).first;
-          data.is_storage_empty.store(false, std::memory_order_relaxed);
-          context_->stats.elements_cached.fetch_add(1, std::memory_order_relaxed);
+        // the index owns its own reference
+        inserted_element->add_ref();
+        if (unlikely(!data.storage.insert_or_replace(hash, inserted_element, replaced_element, *context_, detach_processor))) {
+          inserted_element->release();
+          return nullptr;
         }
-        // replace element and save previous element into used_elements_;
+        data.is_storage_empty.store(false, std::memory_order_relaxed);
+      }
+      if (replaced_element) {
+        // save previous element into used_elements_;
         // it'll make it possible to free it without taking a storage_mutex lock
-        it->second.swap(element);
-        if (element) {
-          // used_elements_ uses heap memory for its internal allocations
-          used_elements_.emplace(std::move(element));
-        }
-        used_elements_.emplace(it->second);
-        return it->second.get();
+        // used_elements_ uses heap memory for its internal allocations
+        used_elements_.emplace(vk::intrusive_ptr<ElementHolder>{replaced_element, false});
+      } else {
+        context_->stats.elements_cached.fetch_add(1, std::memory_order_relaxed);
       }
+      used_elements_.emplace(std::move(element));
+      return inserted_element;
     }
     return nullptr;
   }
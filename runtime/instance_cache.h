@@ -12,8 +12,12 @@
 //    therefore the reference counter of cached strings and arrays is ExtraRefCnt::for_instance_cache or ExtraRefCnt::for_global_const;
 //  3) On fetch, all strings and arrays are returned as is;
 //  4) On store, all instances (and sub instances) are deeply cloned into instance cache;
-//  5) On fetch, all instances (and sub instances) are deeply cloned from instance cache;
-//  6) All instances (with all members) are destroyed strictly before or after request,
+//  5) On fetch, all instances (and sub instances) are returned as is, without cloning:
+//    the compiler allows only immutable classes there (check @kphp-immutable-class), so the script can't modify them,
+//    their reference counter is ExtraRefCnt::for_instance_cache, so copying them doesn't touch the shared memory,
+//    and nested strings and arrays are copied on write into the script memory;
+//  6) A fetched element is pinned by its ElementHolder reference until the end of the request,
+//    so all instances (with all members) are destroyed strictly before or after request,
 //    and shouldn't be destroyed while request.
 
 #include "common/mixin/not_copyable.h"
@@ -0,0 +1,345 @@
+// Compiler for PHP (aka KPHP)
+// Copyright (c) 2020 LLC «V Kontakte»
+// Distributed under the GPL v3 License, see LICENSE.notice.txt
+
+#pragma once
+
+// The lock-free part of the instance cache: the elements index, which is read without any locks,
+// and the epoch based reclamation of the elements and the index tables removed from it.
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <utility>
+
+#include "common/cacheline.h"
+#include "common/mixin/not_copyable.h"
+
+#include "runtime/kphp_core.h"
+#include "server/php-engine-vars.h"
+
+namespace ic_impl_ {
+
+// Minimal capacity of the elements index of a bucket
+static constexpr uint32_t INDEX_MIN_CAPACITY{8u};
+
+// Epoch based reclamation for the lock-free fetch:
+// a worker announces the epoch it has started reading in, and the garbage which was unlinked at some epoch
+// can be destroyed only after all the workers have left the older epochs.
+class ReadersEpochs : vk::not_copyable {
+public:
+  void enter() noexcept {
+    auto &announced = announced_epochs_[get_reader_index()].epoch;
+    uint64_t epoch = global_epoch_.load();
+    while (true) {
+      announced.store(epoch);
+      const uint64_t actual_epoch = global_epoch_.load();
+      if (actual_epoch == epoch) {
+        return;
+      }
+      epoch = actual_epoch;
+    }
+  }
+
+  void leave() noexcept {
+    announced_epochs_[get_reader_index()].epoch.store(0, std::memory_order_release);
+  }
+
+  // a worker killed inside the lock-free fetch leaves its epoch announced,
+  // it is cleared by the next worker with the same logname_id, otherwise nothing could be destroyed anymore
+  void force_leave() noexcept {
+    leave();
+  }
+
+  uint64_t advance_epoch() noexcept {
+    return global_epoch_.fetch_add(1) + 1;
+  }
+
+  bool all_left_before(uint64_t epoch) const noexcept {
+    // logname_id of a restarted worker can exceed workers_n, so all the slots are checked
+    return std::all_of(announced_epochs_.begin(), announced_epochs_.end(),
+                       [epoch](const AnnouncedEpoch &announced) {
+                         const uint64_t reader_epoch = announced.epoch.load();
+                         return reader_epoch == 0 || reader_epoch >= epoch;
+                       });
+  }
+
+private:
+  static size_t get_reader_index() noexcept {
+    php_assert(logname_id >= 0 && logname_id < MAX_WORKERS);
+    return static_cast<size_t>(logname_id);
+  }
+
+  struct alignas(KDB_CACHELINE_SIZE) AnnouncedEpoch {
+    // 0 means that the worker doesn't read now
+    std::atomic<uint64_t> epoch{0};
+  };
+
+  std::atomic<uint64_t> global_epoch_{1};
+  std::array<AnnouncedEpoch, MAX_WORKERS> announced_epochs_;
+};
+
+// A slots table of the ElementsIndex, the slots array is placed right after the header
+template<class Element>
+struct IndexTable : private vk::not_copyable {
+  struct Slot {
+    // 0 means that the slot has never been used
+    std::atomic<uint64_t> hash{0};
+    // nullptr with nonzero hash means that the element was removed
+    std::atomic<Element *> element{nullptr};
+  };
+
+  explicit IndexTable(uint32_t capacity) noexcept:
+    capacity(capacity) {
+    for (uint32_t i = 0; i != capacity; ++i) {
+      new(&slots()[i]) Slot{};
+    }
+  }
+
+  static size_t memory_size(uint32_t capacity) noexcept {
+    return sizeof(IndexTable) + sizeof(Slot) * capacity;
+  }
+
+  Slot *slots() noexcept {
+    return reinterpret_cast<Slot *>(this + 1);
+  }
+
+  const uint32_t capacity{0};
+  // Removed tables list
+  IndexTable *next_in_garbage_list{nullptr};
+};
+
+// Open addressing hash table of the elements with the linear probing, keyed by the string hash.
+// find() is lock-free and should be called between ReadersEpochs::enter() and ReadersEpochs::leave(),
+// modifications should be done under the storage_mutex. The table holds one reference to each element.
+template<class Element>
+class ElementsIndex : vk::not_copyable {
+public:
+  using Table = IndexTable<Element>;
+  using Slot = typename Table::Slot;
+
+  static uint64_t hash_of(const string &key) noexcept {
+    // 0 is reserved for the never used slots
+    const auto hash = static_cast<uint64_t>(key.hash());
+    return hash ? hash : 1;
+  }
+
+  Element *find(const string &key, uint64_t hash) const noexcept {
+    Table *table = table_.load(std::memory_order_acquire);
+    if (!table) {
+      return nullptr;
+    }
+    // the slot may be reused for another key right after the lookup, so return exactly the element whose key was compared
+    Element *element = nullptr;
+    lookup(*table, key, hash, element);
+    return element;
+  }
+
+  // should be called under the storage_mutex and the allocator_mutex,
+  // the element reference is moved into the index, the replaced element is returned with its reference;
+  // the new tables are taken from allocator.prepare_raw_memory() and the old ones are passed to context.move_to_garbage()
+  template<class Context, class Allocator>
+  bool insert_or_replace(uint64_t hash, Element *element, Element *&replaced, Context &context, Allocator &allocator) noexcept {
+    if (Slot *slot = find_slot(element->key, hash)) {
+      replaced = slot->element.exchange(element, std::memory_order_acq_rel);
+      return true;
+    }
+    Table *table = table_.load(std::memory_order_relaxed);
+    if (!table || (used_slots_ + 1) * 4 > table->capacity * 3) {
+      table = rehash(context, allocator);
+      if (!table) {
+        return false;
+      }
+    }
+    Slot &slot = free_slot(*table, hash);
+    if (slot.hash.load(std::memory_order_relaxed) == 0) {
+      ++used_slots_;
+    }
+    slot.hash.store(hash, std::memory_order_release);
+    slot.element.store(element, std::memory_order_release);
+    ++size_;
+    replaced = nullptr;
+    return true;
+  }
+
+  // should be called under the storage_mutex, the removed element is returned with its reference
+  Element *remove(Slot &slot) noexcept {
+    Element *element = slot.element.exchange(nullptr, std::memory_order_acq_rel);
+    if (element) {
+      --size_;
+    }
+    return element;
+  }
+
+  // should be called under the storage_mutex
+  template<typename F>
+  void for_each_slot(F &&f) noexcept {
+    if (Table *table = table_.load(std::memory_order_relaxed)) {
+      std::for_each(table->slots(), table->slots() + table->capacity, std::forward<F>(f));
+    }
+  }
+
+  bool empty() const noexcept {
+    return size_ == 0;
+  }
+
+private:
+  Slot *find_slot(const string &key, uint64_t hash) noexcept {
+    Table *table = table_.load(std::memory_order_relaxed);
+    Element *element = nullptr;
+    return table ? lookup(*table, key, hash, element) : nullptr;
+  }
+
+  static uint32_t start_position(uint64_t hash, uint32_t capacity) noexcept {
+    // capacity is a power of 2; the low bits of the hash are the same for the keys of a shard, mix them
+    return static_cast<uint32_t>((hash * 0x9E3779B97F4A7C15ULL) >> 32) & (capacity - 1);
+  }
+
+  // returns the slot of the key and sets the found element, which is loaded only once
+  static Slot *lookup(Table &table, const string &key, uint64_t hash, Element *&found_element) noexcept {
+    for (uint32_t i = start_position(hash, table.capacity), probes = 0; probes != table.capacity;
+         i = (i + 1) & (table.capacity - 1), ++probes) {
+      Slot &slot = table.slots()[i];
+      const uint64_t slot_hash = slot.hash.load(std::memory_order_acquire);
+      if (slot_hash == 0) {
+        return nullptr;
+      }
+      if (slot_hash == hash) {
+        // the element can't be destroyed while the reader is inside the epoch, so the key can be safely compared
+        Element *element = slot.element.load(std::memory_order_acquire);
+        if (element && element->key == key) {
+          found_element = element;
+          return &slot;
+        }
+      }
+    }
+    return nullptr;
+  }
+
+  // removed slots are reused, probing sequences are never broken as the hash of a slot never becomes 0 again
+  static Slot &free_slot(Table &table, uint64_t hash) noexcept {
+    for (uint32_t i = start_position(hash, table.capacity);; i = (i + 1) & (table.capacity - 1)) {
+      Slot &slot = table.slots()[i];
+      if (slot.element.load(std::memory_order_relaxed) == nullptr) {
+        return slot;
+      }
+    }
+  }
+
+  template<class Context, class Allocator>
+  Table *rehash(Context &context, Allocator &allocator) noexcept {
+    uint32_t capacity = INDEX_MIN_CAPACITY;
+    while (capacity < (size_ + 1) * 2) {
+      capacity *= 2;
+    }
+    void *mem = allocator.prepare_raw_memory(Table::memory_size(capacity));
+    if (!mem) {
+      return nullptr;
+    }
+    auto *new_table = new(mem) Table{capacity};
+    Table *old_table = table_.load(std::memory_order_relaxed);
+    if (old_table) {
+      std::for_each(old_table->slots(), old_table->slots() + old_table->capacity, [new_table](Slot &slot) {
+        if (Element *element = slot.element.load(std::memory_order_relaxed)) {
+          const uint64_t hash = slot.hash.load(std::memory_order_relaxed);
+          Slot &new_slot = free_slot(*new_table, hash);
+          new_slot.hash.store(hash, std::memory_order_relaxed);
+          new_slot.element.store(element, std::memory_order_relaxed);
+        }
+      });
+    }
+    used_slots_ = size_;
+    table_.store(new_table, std::memory_order_release);
+    if (old_table) {
+      // readers may still probe the old table, it'll be destroyed after them
+      context.move_to_garbage(old_table);
+    }
+    return new_table;
+  }
+
+  std::atomic<Table *> table_{nullptr};
+  // alive elements
+  uint32_t size_{0};
+  // alive and removed elements
+  uint32_t used_slots_{0};
+};
+
+// The elements and the index tables unlinked from the index.
+// They might be still visible to the lock-free readers, so they are destroyed only after the readers have left.
+template<class Element>
+class EpochGarbage : vk::not_copyable {
+public:
+  using Table = IndexTable<Element>;
+
+  // lock-free
+  void add(Element *element) noexcept {
+    php_assert(element->next_in_garbage_list == nullptr);
+    auto *next = elements_.load();
+    do {
+      element->next_in_garbage_list.store(next);
+    } while (!elements_.compare_exchange_strong(next, element));
+  }
+
+  // should be called under the allocator_mutex
+  void add(Table *table) noexcept {
+    php_assert(table->next_in_garbage_list == nullptr);
+    table->next_in_garbage_list = tables_;
+    tables_ = table;
+  }
+
+  bool empty() const noexcept {
+    return elements_ == nullptr && !has_pending_;
+  }
+
+  // should be called under the allocator_mutex, the elements are destroyed by Element::destroy()
+  template<class TableDestroyer>
+  void collect(ReadersEpochs &readers, const TableDestroyer &destroy_table) noexcept {
+    if (has_pending_) {
+      if (!readers.all_left_before(pending_epoch_)) {
+        return;
+      }
+      destroy_pending(destroy_table);
+    }
+
+    pending_elements_ = elements_.exchange(nullptr);
+    pending_tables_ = std::exchange(tables_, nullptr);
+    if (pending_elements_ || pending_tables_) {
+      // all the garbage is already unlinked, the readers which will enter after that can't reach it
+      pending_epoch_ = readers.advance_epoch();
+      has_pending_ = true;
+      if (readers.all_left_before(pending_epoch_)) {
+        destroy_pending(destroy_table);
+      }
+    }
+  }
+
+private:
+  template<class TableDestroyer>
+  void destroy_pending(const TableDestroyer &destroy_table) noexcept {
+    auto element = std::exchange(pending_elements_, nullptr);
+    while (element) {
+      auto next = element->next_in_garbage_list.load();
+      element->destroy();
+      element = next;
+    }
+
+    auto table = std::exchange(pending_tables_, nullptr);
+    while (table) {
+      auto next = table->next_in_garbage_list;
+      destroy_table(table);
+      table = next;
+    }
+    has_pending_ = false;
+  }
+
+  std::atomic<Element *> elements_{nullptr};
+  // the garbage below is accessed only under the allocator_mutex
+  Table *tables_{nullptr};
+  // the garbage that might be still visible to the readers which have entered before pending_epoch_
+  Element *pending_elements_{nullptr};
+  Table *pending_tables_{nullptr};
+  uint64_t pending_epoch_{0};
+  std::atomic<bool> has_pending_{false};
+};
+
+} // namespace ic_impl_
@@ -62,8 +62,13 @@ public:
   }
 
   uint32_t switch_active_to_next() noexcept {
+    return switch_active_to(get_next_inactive_resource_id());
+  }
+
+  uint32_t switch_active_to(uint32_t resource_id) noexcept {
+    php_assert(resource_id < RESOURCE_AMOUNT);
     const uint32_t prev_active = active_resource_id_;
-    active_resource_id_ = get_next_inactive_resource_id();
+    active_resource_id_ = resource_id;
     return prev_active;
   }
 
@@ -117,6 +122,14 @@ public:
     (*control_block_)->force_release_all_resources();
   }
 
+  // the resources are in the shared memory, so any process can reset the state it has left in them
+  template<typename F>
+  void for_each_resource(const F &f) noexcept {
+    for (auto &resource: switchable_resource_) {
+      f(resource);
+    }
+  }
+
   // this function should be called only from master
   T &get_current_resource() noexcept {
     php_assert(is_initial_process());
@@ -153,6 +166,78 @@ public:
     return false;
   }
 
+  // this function should be called only from master
+  bool has_clean_inactive_resource() const noexcept {
+    php_assert(is_initial_process());
+    return dirty_inactive_resources_.count() + 1 < RESOURCE_AMOUNT;
+  }
+
+  // this function should be called only from master
+  // unlike try_switch_to_next_unused_resource, any clean inactive resource may become active,
+  // so a resource held by a worker for a long time doesn't stop the switching
+  template<typename ...Args>
+  bool try_switch_to_any_clean_resource(Args &&... args) noexcept {
+    php_assert(is_initial_process());
+    php_assert(control_block_);
+    const uint32_t current_resource_id = (*control_block_)->get_active_resource_id();
+    for (uint32_t resource_id = (current_resource_id + 1) % RESOURCE_AMOUNT;
+         resource_id != current_resource_id;
+         resource_id = (resource_id + 1) % RESOURCE_AMOUNT) {
+      // the clean inactive resources can't be acquired, so it is safe to reset them
+      if (!dirty_inactive_resources_.test(resource_id)) {
+        switchable_resource_[resource_id].reset(std::forward<Args>(args)...);
+        (*control_block_)->switch_active_to(resource_id);
+        dirty_inactive_resources_.set(current_resource_id);
+        return true;
+      }
+    }
+    return false;
+  }
+
+  // this function should be called only from master
+  // the held resource isn't cleared until it is released, even if it's inactive and isn't used by the workers
+  const T *hold_current_resource() noexcept {
+    php_assert(is_initial_process());
+    php_assert(control_block_);
+    const uint32_t resource_id = (*control_block_)->get_active_resource_id();
+    held_resources_.set(resource_id);
+    return &switchable_resource_[resource_id];
+  }
+
+  // this function should be called only from master
+  void release_held_resource(const T *data) noexcept {
+    php_assert(is_initial_process());
+    const auto it = std::find_if(switchable_resource_.begin(), switchable_resource_.end(),
+                                 [data](const T &res) { return &res == data; });
+    php_assert(it != switchable_resource_.end());
+    held_resources_.reset(static_cast<size_t>(it - switchable_resource_.begin()));
+  }
+
+  // this function should be called only from master
+  // unlike clear_dirty_unused_resources_in_sequence, the resources are cleared in any order,
+  // so the resources mustn't own anything the other resources can refer to
+  void clear_dirty_unused_resources() noexcept {
+    php_assert(is_initial_process());
+    for (uint32_t resource_id = 0; resource_id != RESOURCE_AMOUNT && dirty_inactive_resources_.any(); ++resource_id) {
+      if (dirty_inactive_resources_.test(resource_id) && !held_resources_.test(resource_id) &&
+          (*control_block_)->is_resource_unused(resource_id)) {
+        switchable_resource_[resource_id].clear();
+        dirty_inactive_resources_.reset(resource_id);
+      }
+    }
+  }
+
+  // this function should be called only from master
+  template<typename F>
+  void for_each_dirty_resource(const F &f) const noexcept {
+    php_assert(is_initial_process());
+    for (uint32_t resource_id = 0; resource_id != RESOURCE_AMOUNT; ++resource_id) {
+      if (dirty_inactive_resources_.test(resource_id)) {
+        f(switchable_resource_[resource_id]);
+      }
+    }
+  }
+
   // this function should be called only from master
   void clear_dirty_unused_resources_in_sequence() noexcept {
     php_assert(is_initial_process());
@@ -167,7 +252,7 @@ public:
          resource_id != current_resource_id && dirty_inactive_resources_.any();
          resource_id = (resource_id + 1) % RESOURCE_AMOUNT) {
       if (dirty_inactive_resources_.test(resource_id)) {
-        if ((*control_block_)->is_resource_unused(resource_id)) {
+        if (!held_resources_.test(resource_id) && (*control_block_)->is_resource_unused(resource_id)) {
           switchable_resource_[resource_id].clear();
           dirty_inactive_resources_.reset(resource_id);
         } else {
@@ -201,6 +286,7 @@ public:
 
 private:
   std::bitset<RESOURCE_AMOUNT> dirty_inactive_resources_;
+  std::bitset<RESOURCE_AMOUNT> held_resources_;
   const pid_t initiate_process_pid_{0};
   std::array<T, RESOURCE_AMOUNT> switchable_resource_;
   vk::lock_accessible<InterProcessResourceControl<RESOURCE_AMOUNT>, inter_process_mutex> *control_block_{nullptr};
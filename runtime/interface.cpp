@@ -15,6 +15,7 @@
 #include <unistd.h>
 
 #include "common/algorithms/string-algorithms.h"
+#include "net/net-http-compression.h"
 
 #include "runtime/array_functions.h"
 #include "runtime/bcmath.h"
@@ -41,7 +42,6 @@
 #include "runtime/typed_rpc.h"
 #include "runtime/udp.h"
 #include "runtime/url.h"
-#include "runtime/zlib.h"
 #include "server/php-engine-vars.h"
 #include "server/php-queries.h"
 #include "server/php-query-data.h"
@@ -61,7 +61,13 @@ static int ob_cur_buffer;
 
 static string_buffer oub[OB_MAX_BUFFERS];
 string_buffer *coub;
-static int http_need_gzip;
+static bool http_need_compression;
+static http_content_encoding http_accepted_encoding;
+// after the first flush() the headers are sent and the rest of the body goes in chunks
+static bool http_headers_sent;
+static http_content_encoding http_streaming_encoding;
+// the client can't receive a chunked response, flush() does nothing then
+static bool http_streaming_unsupported;
 
 void f$ob_clean() {
   coub->clean();
@@ -98,7 +104,7 @@ void f$ob_start(const string &callback) {
   }
   if (!callback.empty()) {
     if (ob_cur_buffer == 0 && callback == string("ob_gzhandler", 12)) {
-      http_need_gzip |= 4;
+      http_need_compression = true;
     } else {
       php_critical_error ("unsupported callback %s at buffering level %d", callback.c_str(), ob_cur_buffer + 1);
     }
@@ -221,6 +227,10 @@ static bool check_status_line(const char *str, int str_len) {
 }
 
 static void header(const char *str, int str_len, bool replace = true, int http_response_code = 0) {
+  if (http_headers_sent) {
+    php_warning("Can't send header \"%s\", the headers are already sent by flush()", str);
+    return;
+  }
   if (dl::query_num != header_last_query_num) {
     new(headers_storage) array<string>();
     header_last_query_num = dl::query_num;
@@ -293,6 +303,10 @@ void f$header(const string &str, bool replace, int64_t http_response_code) {
   header(str.c_str(), (int)str.size(), replace, static_cast<int32_t>(http_response_code));
 }
 
+bool f$headers_sent() {
+  return http_headers_sent;
+}
+
 array<string> f$headers_list() {
   array<string> result;
   if (dl::query_num != header_last_query_num) {
@@ -408,12 +422,12 @@ static inline const char *http_get_error_msg_text(int *code) {
   return "Extension Code";
 }
 
-static const string_buffer *get_headers(int content_length) {//can't use static_SB, returns pointer to static_SB_spare
+static const string_buffer *get_headers(int content_length) {//can't use static_SB, returns pointer to static_SB_spare; no Content-Length if content_length < 0
   string date = f$gmdate(HTTP_DATE);
   static_SB_spare.clean() << "Date: " << date;
   header(static_SB_spare.c_str(), (int)static_SB_spare.size());
 
-  if (!is_head_query) {
+  if (!is_head_query && content_length >= 0) {
     static_SB_spare.clean() << "Content-Length: " << content_length;
     header(static_SB_spare.c_str(), (int)static_SB_spare.size());
   }
@@ -437,6 +451,21 @@ static const string_buffer *get_headers(int content_length) {//can't use static_
   return &static_SB_spare;
 }
 
+// the body is compressed by the server, it also adds the Content-Length or sends the body in chunks;
+// the body with the Content-Length set by the script is sent as is, as the script expects the length to match it
+static http_content_encoding prepare_http_content_encoding() {
+  if (is_head_query || !http_need_compression || http_accepted_encoding == hce_identity) {
+    return hce_identity;
+  }
+  if (dl::query_num == header_last_query_num && headers->has_key(string{"content-length"})) {
+    return hce_identity;
+  }
+  static_SB_spare.clean() << "Content-Encoding: " << http_content_encoding_name(http_accepted_encoding);
+  header(static_SB_spare.c_str(), (int)static_SB_spare.size(), true);
+  header("Vary: Accept-Encoding", 21, false);
+  return http_accepted_encoding;
+}
+
 constexpr uint32_t MAX_SHUTDOWN_FUNCTIONS = 256;
 // i don't want destructors of this array to be called
 int shutdown_functions_count;
@@ -445,6 +474,37 @@ shutdown_function_type *shutdown_functions = reinterpret_cast<shutdown_function_
 static bool finished;
 static bool flushed;
 
+void f$flush() {
+  // like in php, only the output that isn't buffered by ob_start() is flushed
+  string_buffer &out = oub[0];
+  switch (query_type) {
+    case QUERY_TYPE_CONSOLE: {
+      write_safe(1, out.buffer(), out.size());
+      out.clean();
+      break;
+    }
+    case QUERY_TYPE_HTTP: {
+      if (flushed || is_head_query || http_streaming_unsupported || (http_headers_sent && out.size() == 0)) {
+        break;
+      }
+      const string_buffer *headers = nullptr;
+      if (!http_headers_sent) {
+        http_streaming_encoding = prepare_http_content_encoding();
+        headers = get_headers(-1);
+      }
+      if (!http_flush_result(headers ? headers->buffer() : nullptr, headers ? headers->size() : 0, out.buffer(), out.size(), http_streaming_encoding)) {
+        http_streaming_unsupported = true;
+        break;
+      }
+      http_headers_sent = true;
+      out.clean();
+      break;
+    }
+    default:
+      break;
+  }
+}
+
 void f$fastcgi_finish_request(int64_t exit_code) {
   if (flushed) {
     return;
@@ -479,24 +539,19 @@ void f$fastcgi_finish_request(int64_t exit_code) {
       break;
     }
     case QUERY_TYPE_HTTP: {
-      const string_buffer *compressed;
+      const string_buffer *body = &oub[first_not_empty_buffer];
+      if (http_headers_sent) {
+        // the rest of the body is sent as the last chunk
+        http_set_result(nullptr, 0, body->buffer(), body->size(), static_cast<int32_t>(exit_code), http_streaming_encoding);
+        break;
+      }
+
       if (is_head_query) {
         oub[first_not_empty_buffer].clean();
-        compressed = &oub[first_not_empty_buffer];
-      } else {
-        if ((http_need_gzip & 5) == 5) {
-          header("Content-Encoding: gzip", 22, true);
-          compressed = zlib_encode(oub[first_not_empty_buffer].c_str(), oub[first_not_empty_buffer].size(), 6, ZLIB_ENCODE);
-        } else if ((http_need_gzip & 6) == 6) {
-          header("Content-Encoding: deflate", 25, true);
-          compressed = zlib_encode(oub[first_not_empty_buffer].c_str(), oub[first_not_empty_buffer].size(), 6, ZLIB_COMPRESS);
-        } else {
-          compressed = &oub[first_not_empty_buffer];
-        }
       }
-
-      const string_buffer *headers = get_headers(compressed->size());
-      http_set_result(headers->buffer(), headers->size(), compressed->buffer(), compressed->size(), static_cast<int32_t>(exit_code));
+      const http_content_encoding content_encoding = prepare_http_content_encoding();
+      const string_buffer *headers = get_headers(content_encoding == hce_identity ? body->size() : -1);
+      http_set_result(headers->buffer(), headers->size(), body->buffer(), body->size(), static_cast<int32_t>(exit_code), content_encoding);
 
       break;
     }
@@ -1336,7 +1391,8 @@ static void init_superglobals(const char *uri, int uri_len, const char *get, int
     }
   }
 
-  http_need_gzip = 0;
+  http_need_compression = false;
+  http_accepted_encoding = hce_identity;
   string content_type("application/x-www-form-urlencoded", 33);
   string content_type_lower = content_type;
   if (headers_len) {
@@ -1369,12 +1425,7 @@ static void init_superglobals(const char *uri, int uri_len, const char *get, int
       header_value = f$trim(header_value);
 
       if (!strcmp(header_name.c_str(), "accept-encoding")) {
-        if (strstr(header_value.c_str(), "gzip") != nullptr) {
-          http_need_gzip |= 1;
-        }
-        if (strstr(header_value.c_str(), "deflate") != nullptr) {
-          http_need_gzip |= 2;
-        }
+        http_accepted_encoding = http_choose_content_encoding(header_value.c_str(), header_value.size());
       } else if (!strcmp(header_name.c_str(), "cookie")) {
         array<string> cookie = explode(';', header_value);
         for (int t = 0; t < (int)cookie.count(); t++) {
@@ -2062,6 +2113,9 @@ static void init_runtime_libs() {
   shutdown_functions_count = 0;
   finished = false;
   flushed = false;
+  http_headers_sent = false;
+  http_streaming_encoding = hce_identity;
+  http_streaming_unsupported = false;
 
   php_warning_level = std::max(2, php_warning_minimum_level);
   php_disable_warnings = 0;
@@ -2132,6 +2186,7 @@ void global_init_runtime_libs() {
   global_init_regexp_lib();
   global_init_resumable_lib();
   global_init_rpc_lib();
+  global_init_curl_lib();
   global_init_udp_lib();
 }
 
@@ -29,6 +29,8 @@ void f$ob_flush();
 
 bool f$ob_end_flush();
 
+void f$flush();
+
 Optional<string> f$ob_get_flush();
 
 Optional<int64_t> f$ob_get_length();
@@ -39,6 +41,8 @@ void f$header(const string &str, bool replace = true, int64_t http_response_code
 
 array<string> f$headers_list();
 
+bool f$headers_sent();
+
 void f$setcookie(const string &name, const string &value, int64_t expire = 0, const string &path = string(), const string &domain = string(), bool secure = false, bool http_only = false);
 
 void f$setrawcookie(const string &name, const string &value, int64_t expire = 0, const string &path = string(), const string &domain = string(), bool secure = false, bool http_only = false);
@@ -4,6 +4,8 @@
 
 #pragma once
 
+#include "common/numeric-vector.h"
+
 #include "runtime/kphp_core.h"
 
 int64_t f$bindec(const string &number) noexcept;
@@ -120,6 +122,49 @@ void init_math_functions() noexcept;
  */
 
 
+// array<int64_t> and array<double> vectors are reduced by the SIMD kernels, the result is the same as of the loops below
+template<class T>
+bool min_of_numeric_vector(const array<T> &, T &) noexcept {
+  return false;
+}
+
+inline bool min_of_numeric_vector(const array<int64_t> &a, int64_t &result) noexcept {
+  if (!a.is_vector()) {
+    return false;
+  }
+  result = int64_vector_min(a.get_const_vector_pointer(), a.count());
+  return true;
+}
+
+inline bool min_of_numeric_vector(const array<double> &a, double &result) noexcept {
+  if (!a.is_vector()) {
+    return false;
+  }
+  result = double_vector_min(a.get_const_vector_pointer(), a.count());
+  return true;
+}
+
+template<class T>
+bool max_of_numeric_vector(const array<T> &, T &) noexcept {
+  return false;
+}
+
+inline bool max_of_numeric_vector(const array<int64_t> &a, int64_t &result) noexcept {
+  if (!a.is_vector()) {
+    return false;
+  }
+  result = int64_vector_max(a.get_const_vector_pointer(), a.count());
+  return true;
+}
+
+inline bool max_of_numeric_vector(const array<double> &a, double &result) noexcept {
+  if (!a.is_vector()) {
+    return false;
+  }
+  result = double_vector_max(a.get_const_vector_pointer(), a.count());
+  return true;
+}
+
 template<class T>
 T f$min(const array<T> &a) {
   if (a.count() == 0) {
@@ -129,6 +174,10 @@ T f$min(const array<T> &a) {
 
   typename array<T>::const_iterator p = a.begin();
   T res = p.get_value();
+  if (min_of_numeric_vector(a, res)) {
+    return res;
+  }
+
   for (++p; p != a.end(); ++p) {
     if (lt(p.get_value(), res)) {
       res = p.get_value();
@@ -146,6 +195,10 @@ T f$max(const array<T> &a) {
 
   typename array<T>::const_iterator p = a.begin();
   T res = p.get_value();
+  if (max_of_numeric_vector(a, res)) {
+    return res;
+  }
+
   for (++p; p != a.end(); ++p) {
     if (gt(p.get_value(), res)) {
       res = p.get_value();
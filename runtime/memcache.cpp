@@ -439,6 +439,36 @@ C$McMemcache::host get_host(const array<C$McMemcache::host> &hosts) {
   return hosts.get_value(f$array_rand(hosts));
 }
 
+// the keys are spread over the hosts by their hash, every host gets one pipelined "get" with all its keys,
+// and the requests are sent in parallel, so that a big multiget costs one round trip
+static void run_multiget(const array<C$McMemcache::host> &hosts, const array<string> &real_keys) {
+  const int hosts_n = static_cast<int>(hosts.count());
+  array<string> requests(array_size(hosts_n, 0, true));
+  for (int i = 0; i < hosts_n; i++) {
+    requests.push_back(string());
+  }
+  for (array<string>::const_iterator p = real_keys.begin(); p != real_keys.end(); ++p) {
+    const string &real_key = p.get_value();
+    string &request = requests[static_cast<int64_t>(static_cast<uint64_t>(real_key.hash()) % hosts_n)];
+    request.append(request.empty() ? "get " : " ", request.empty() ? 4 : 1);
+    request.append(real_key);
+  }
+
+  int parts_n = 0;
+  auto *parts = static_cast<mc_query_part_t *>(dl::allocate(sizeof(mc_query_part_t) * hosts_n));
+  for (int i = 0; i < hosts_n; i++) {
+    string &request = requests[i];
+    if (request.empty()) {
+      continue;
+    }
+    request.append("\r\n", 2);
+    const C$McMemcache::host &cur_host = hosts.get_value(i);
+    parts[parts_n++] = {cur_host.host_num, request.c_str(), static_cast<int>(request.size()), cur_host.timeout_ms};
+  }
+  mc_run_queries(parts, parts_n, mc_multiget_callback);
+  dl::deallocate(parts, sizeof(mc_query_part_t) * hosts_n);
+}
+
 
 static bool run_set(const class_instance<C$McMemcache> &mc, const string &key, const mixed &value, int64_t flags, int64_t expire) {
   if (mc->hosts.count() <= 0) {
@@ -587,11 +617,13 @@ mixed f$McMemcache$$get(const class_instance<C$McMemcache> &v$this, const mixed
     drivers_SB.clean();
     drivers_SB << "get";
     bool is_immediate_query = true;
+    array<string> real_keys(array_size(key_var.count(), 0, true));
     for (array<mixed>::const_iterator p = key_var.begin(); p != key_var.end(); ++p) {
       const string key = p.get_value().to_string();
       const string real_key = mc_prepare_key(key);
       drivers_SB << ' ' << real_key;
       is_immediate_query = is_immediate_query && mc_is_immediate_query(real_key);
+      real_keys.push_back(real_key);
     }
     drivers_SB << "\r\n";
 
@@ -599,6 +631,10 @@ mixed f$McMemcache$$get(const class_instance<C$McMemcache> &v$this, const mixed
     auto cur_host = get_host(v$this->hosts);
     if (is_immediate_query) {
       mc_run_query(cur_host.host_num, drivers_SB.c_str(), drivers_SB.size(), cur_host.timeout_ms, 0, nullptr); //TODO wrong if we have no mc_proxy
+    } else if (v$this->hosts.count() > 1 && real_keys.count() > 1) {
+      mc_last_key = drivers_SB.c_str();
+      mc_last_key_len = (int)drivers_SB.size();
+      run_multiget(v$this->hosts, real_keys);
     } else {
       mc_last_key = drivers_SB.c_str();
       mc_last_key_len = (int)drivers_SB.size();
@@ -39,6 +39,8 @@ Optional<array<mixed>> f$posix_getpwuid(int64_t uid);
 
 
 string f$serialize(const mixed &v);
+// appends the serialized value to static_SB
+void do_serialize(const mixed &v);
 
 mixed f$unserialize(const string &v);
 mixed unserialize_raw(const char *v, int32_t v_len);
@@ -4,6 +4,9 @@
 
 #include "runtime/mysql.h"
 
+#include "common/precise-time.h"
+#include "runtime/resumable.h"
+#include "server/php-queries-stats.h"
 #include "server/php-queries.h"
 
 static int mysql_callback_state;
@@ -225,11 +228,37 @@ static void mysql_query_callback(const char *result_, int result_len) {
 
 static class_instance<C$mysqli> DB_Proxy;
 
-static bool mysql_query(const class_instance<C$mysqli> &db, const string &query) {
-  if (query.size() > (1 << 24) - 10) {
-    return false;
+// the forked resumables waiting for the answers of the sent queries, by the slot ids of the queries
+static array<int64_t> sql_waiting_queries;
+// the answers of the finished queries until mysqli_query takes them, false on a net error
+static array<Optional<string>> sql_answers;
+
+static void finish_sql_query(int32_t slot_id, Optional<string> &&answer) {
+  const int64_t *resumable_id = sql_waiting_queries.find_value(int64_t{slot_id});
+  if (resumable_id == nullptr) {
+    return;
   }
+  const int64_t id = *resumable_id;
+  sql_waiting_queries.unset(int64_t{slot_id});
+  sql_answers.set_value(int64_t{slot_id}, std::move(answer));
+  resumable_run_ready(id);
+}
 
+void process_sql_answer(int32_t slot_id, char *result, int32_t result_len __attribute__((unused))) {
+  string answer;
+  if (result != nullptr) {
+    answer.assign_raw(result - string::inner_sizeof());
+  }
+  finish_sql_query(slot_id, std::move(answer));
+}
+
+void process_sql_error(int32_t slot_id, int32_t error_code __attribute__((unused)), const char *error_message) {
+  php_warning("Can't run MySQL query: %s", error_message ? error_message : "unknown error");
+  finish_sql_query(slot_id, false);
+}
+
+// all the packets of the answer are parsed at once, so the concurrent queries can share the callback state
+static bool mysql_parse_answer(const class_instance<C$mysqli> &db, const string &answer) {
   db->error = string();
   db->errno_ = 0;
   db->affected_rows = 0;
@@ -238,17 +267,6 @@ static bool mysql_query(const class_instance<C$mysqli> &db, const string &query)
   array<array<mixed>> query_result;
   bool query_id = true;
 
-  int packet_len = query.size() + 1;
-  int len = query.size() + 5;
-
-  string real_query(len, false);
-  real_query[0] = (char)(packet_len & 255);
-  real_query[1] = (char)((packet_len >> 8) & 255);
-  real_query[2] = (char)((packet_len >> 16) & 255);
-  real_query[3] = 0;
-  real_query[4] = 3;
-  memcpy(&real_query[5], query.c_str(), query.size());
-
   error_ptr = &db->error;
   errno_ptr = &db->errno_;
   affected_rows_ptr = &db->affected_rows;
@@ -260,7 +278,17 @@ static bool mysql_query(const class_instance<C$mysqli> &db, const string &query)
   field_names_ptr = &db->field_names;
 
   mysql_callback_state = 0;
-  db_run_query(db->connection_id, real_query.c_str(), len, DB_TIMEOUT_MS, mysql_query_callback);
+  const char *packet = answer.c_str();
+  const char *answer_end = packet + answer.size();
+  while (answer_end - packet >= 4) {
+    const auto *header = reinterpret_cast<const unsigned char *>(packet);
+    const int packet_len = 4 + header[0] + (header[1] << 8) + (header[2] << 16);
+    if (packet_len > answer_end - packet) {
+      break;
+    }
+    mysql_query_callback(packet, packet_len);
+    packet += packet_len;
+  }
   if (mysql_callback_state != 5 || !query_id) {
     return false;
   }
@@ -272,6 +300,51 @@ static bool mysql_query(const class_instance<C$mysqli> &db, const string &query)
   return true;
 }
 
+// finishes when the answer of the query comes, it is kept in sql_answers
+class mysql_answer_resumable final : public Resumable {
+protected:
+  bool run() final {
+    output_->save_void();
+    return true;
+  }
+};
+
+class mysqli_query_resumable final : public Resumable {
+  using ReturnT = mixed;
+  class_instance<C$mysqli> db;
+  int32_t slot_id;
+  int64_t answer_id;
+  double start_time;
+
+  bool ready{false};
+
+protected:
+  bool run() final {
+    RESUMABLE_BEGIN
+      ready = wait_without_result(answer_id);
+      TRY_WAIT(mysqli_query_resumable_label_0, ready, bool);
+      php_assert (ready);
+      get_forked_storage(answer_id)->load<void>();
+      PhpQueriesStats::get_sql_queries_stat().register_latency(get_network_time() - start_time);
+
+      Optional<string> answer = sql_answers.get_value(int64_t{slot_id});
+      sql_answers.unset(int64_t{slot_id});
+      if (!answer.has_value() || !mysql_parse_answer(db, answer.val())) {
+        RETURN(false);
+      }
+      RETURN(db->last_query_id = db->biggest_query_id);
+    RESUMABLE_END
+  }
+
+public:
+  mysqli_query_resumable(const class_instance<C$mysqli> &db, int32_t slot_id, int64_t answer_id, double start_time) noexcept:
+    db(db),
+    slot_id(slot_id),
+    answer_id(answer_id),
+    start_time(start_time) {
+  }
+};
+
 string f$mysqli_error(const class_instance<C$mysqli> &db) {
   return db->error;
 }
@@ -335,11 +408,31 @@ mixed f$mysqli_query(const class_instance<C$mysqli> &db, const string &query) {
     php_warning("DB object is NULL in mysql_query");
     return false;
   }
-  bool query_id = mysql_query(db, query);
-  if (!query_id) {
+  if (query.size() > (1 << 24) - 10) {
+    return false;
+  }
+
+  int packet_len = query.size() + 1;
+  int len = query.size() + 5;
+
+  auto *real_query = static_cast<char *>(dl::allocate(len));
+  real_query[0] = (char)(packet_len & 255);
+  real_query[1] = (char)((packet_len >> 8) & 255);
+  real_query[2] = (char)((packet_len >> 16) & 255);
+  real_query[3] = 0;
+  real_query[4] = 3;
+  memcpy(&real_query[5], query.c_str(), query.size());
+
+  // the query is sent when the script yields, other forks keep running until the answer comes
+  const slot_id_t slot_id = db_send_query(db->connection_id, real_query, len, DB_TIMEOUT_MS);
+  if (slot_id <= 0) {
+    dl::deallocate(real_query, len);
     return false;
   }
-  return db->last_query_id = db->biggest_query_id;
+
+  const int64_t answer_id = register_forked_resumable(new mysql_answer_resumable());
+  sql_waiting_queries.set_value(int64_t{slot_id}, answer_id);
+  return start_resumable<mixed>(new mysqli_query_resumable(db, slot_id, answer_id, get_network_time()));
 }
 
 class_instance<C$mysqli> f$mysqli_connect(const string &host __attribute__((unused)), const string &username __attribute__((unused)), const string &password __attribute__((unused)), const string &db_name __attribute__((unused)), int64_t port __attribute__((unused))) {
@@ -377,6 +470,8 @@ bool f$mysqli_select_db(const class_instance<C$mysqli> &db __attribute__((unused
 
 static void reset_mysql_global_vars() {
   hard_reset_var(DB_Proxy);
+  hard_reset_var(sql_waiting_queries);
+  hard_reset_var(sql_answers);
 }
 
 void init_mysql_lib() {
@@ -50,6 +50,10 @@ class_instance<C$mysqli> f$mysqli_connect(const string &host, const string &user
 
 bool f$mysqli_select_db(const class_instance<C$mysqli> &db, const string &name);
 
+void process_sql_answer(int32_t slot_id, char *result, int32_t result_len);
+
+void process_sql_error(int32_t slot_id, int32_t error_code, const char *error_message);
+
 void init_mysql_lib();
 
 void free_mysql_lib();
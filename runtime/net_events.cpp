@@ -4,9 +4,14 @@
 
 #include "runtime/net_events.h"
 
+#include <cmath>
+
+#include "common/container_of.h"
 #include "common/precise-time.h"
 
 #include "runtime/allocator.h"
+#include "runtime/curl.h"
+#include "runtime/mysql.h"
 #include "runtime/rpc.h"
 #include "server/php-queries.h"
 
@@ -42,6 +47,12 @@ static bool process_net_event(net_event_t *e) {
     process_rpc_answer(e->slot_id, e->result, e->result_len);
   } else if (e->type == ne_rpc_error) {
     process_rpc_error(e->slot_id, e->error_code, e->error_message);
+  } else if (e->type == ne_fd_ready) {
+    curl_on_socket_ready(e->fd, e->fd_ready);
+  } else if (e->type == ne_sql_answer) {
+    process_sql_answer(e->slot_id, e->result, e->result_len);
+  } else if (e->type == ne_sql_error) {
+    process_sql_error(e->slot_id, e->error_code, e->error_message);
   } else {
     php_critical_error ("unsupported net event %d", e->type);
   }
@@ -59,7 +70,6 @@ static int process_net_events() {
 
 
 const int MAX_WAKEUP_CALLBACKS_EXP = 3;
-const int EVENT_TIMERS_HEAP_INDEX_MASK = ((1 << (31 - MAX_WAKEUP_CALLBACKS_EXP)) - 1);
 static void (*wakeup_callbacks[1 << MAX_WAKEUP_CALLBACKS_EXP ])(event_timer *timer);
 static int wakeup_callbacks_size;
 
@@ -71,38 +81,15 @@ int register_wakeup_callback(void (*wakeup)(event_timer *timer)) {
   return wakeup_callbacks_size++;
 }
 
-static event_timer **event_timers_heap;
-static int event_timers_heap_size;
-static int event_timers_max_heap_size;
+// the ticks of the wheel are milliseconds; a timer is never woken up before its wakeup_time and at most a tick after it
+static vk::timing_wheel event_timers_wheel;
 
-static inline int event_timer_heap_move_up(double wakeup_time, int i) {
-  while (i > 1) {
-    int j = (i >> 1);
-    if (event_timers_heap[j]->wakeup_time <= wakeup_time) {
-      break;
-    }
-    event_timers_heap[i] = event_timers_heap[j];
-    event_timers_heap[i]->heap_index ^= i ^ j;
-    i = j;
-  }
-  return i;
+static int64_t time_to_tick_floor(double time) {
+  return static_cast<int64_t>(floor(time * 1000));
 }
 
-static inline int event_timer_heap_move_down(double wakeup_time, int i) {
-  int j = 2 * i;
-  while (j <= event_timers_heap_size) {
-    if (j < event_timers_heap_size && event_timers_heap[j]->wakeup_time > event_timers_heap[j + 1]->wakeup_time) {
-      j++;
-    }
-    if (wakeup_time <= event_timers_heap[j]->wakeup_time) {
-      break;
-    }
-    event_timers_heap[i] = event_timers_heap[j];
-    event_timers_heap[i]->heap_index ^= i ^ j;
-    i = j;
-    j <<= 1;
-  }
-  return i;
+static int64_t time_to_tick_ceil(double time) {
+  return static_cast<int64_t>(ceil(time * 1000));
 }
 
 event_timer *allocate_event_timer(double wakeup_time, int wakeup_callback_id, int wakeup_extra) {
@@ -110,46 +97,26 @@ event_timer *allocate_event_timer(double wakeup_time, int wakeup_callback_id, in
   php_assert (0 <= wakeup_callback_id && wakeup_callback_id < wakeup_callbacks_size);
   php_assert (get_precise_now() < wakeup_time);
 
+  et->wheel_node.slot = 0;
+  et->wakeup_callback_id = wakeup_callback_id;
   et->wakeup_extra = wakeup_extra;
   et->wakeup_time = wakeup_time;
-
-  int i = ++event_timers_heap_size;
-  if (i == event_timers_max_heap_size) {
-    event_timers_heap = static_cast <event_timer **> (dl::reallocate(event_timers_heap, sizeof(event_timer *) * 2 * event_timers_max_heap_size, sizeof(event_timer *) * event_timers_max_heap_size));
-    event_timers_max_heap_size *= 2;
-    if (event_timers_max_heap_size > EVENT_TIMERS_HEAP_INDEX_MASK) {
-      php_critical_error ("maximum number of event timers exceeded");
-    }
-  }
-  i = event_timer_heap_move_up(et->wakeup_time, i);
-  et->heap_index = i | (wakeup_callback_id << (31 - MAX_WAKEUP_CALLBACKS_EXP));
-  event_timers_heap[i] = et;
+  event_timers_wheel.insert(&et->wheel_node, time_to_tick_ceil(wakeup_time));
   return et;
 }
 
 void remove_event_timer(event_timer *et) {
-  int i = (et->heap_index & EVENT_TIMERS_HEAP_INDEX_MASK);
-  php_assert (i > 0 && i <= event_timers_heap_size && event_timers_heap[i] == et);
-  et->heap_index = 0;//TODO remove after testing
+  php_assert (et->wheel_node.slot != 0);
+  event_timers_wheel.remove(&et->wheel_node);
   dl::deallocate(et, sizeof(event_timer));
-
-  et = event_timers_heap[event_timers_heap_size--];
-  if (i > event_timers_heap_size) {
-    return;
-  }
-
-  i = event_timer_heap_move_up(et->wakeup_time, i);
-  i = event_timer_heap_move_down(et->wakeup_time, i);
-  et->heap_index &= ~EVENT_TIMERS_HEAP_INDEX_MASK;
-  et->heap_index |= i;
-  event_timers_heap[i] = et;
 }
 
 int remove_expired_event_timers() {
   int expired_events = 0;
-  while (event_timers_heap_size > 0 && event_timers_heap[1]->wakeup_time <= get_precise_now()) {
-    event_timer *et = event_timers_heap[1];
-    wakeup_callbacks[et->heap_index >> (31 - MAX_WAKEUP_CALLBACKS_EXP)](et);
+  event_timers_wheel.advance(time_to_tick_floor(get_precise_now()));
+  while (vk::timing_wheel_node *node = event_timers_wheel.first_expired()) {
+    event_timer *et = container_of(node, event_timer, wheel_node);
+    wakeup_callbacks[et->wakeup_callback_id](et);
     expired_events++;
   }
   return expired_events;
@@ -164,22 +131,37 @@ int wait_net(int timeout_ms) {
   int finished_events = process_net_events();
   if (finished_events) {
     timeout_ms = 0;
-  } else {
-    if (event_timers_heap_size > 0 && event_timers_heap[1]->wakeup_time <= get_precise_now() + timeout_ms * 0.001) {
-      if (timeout_ms > 0) {
-        timeout_ms = timeout_convert_to_ms(event_timers_heap[1]->wakeup_time - get_precise_now());
+  }
+  const double finish_time = begin_time + timeout_ms * 0.001;
+
+  // the far timers are cascaded to the finer slots of the wheel on the way,
+  // such a wakeup expires nothing, so the wait is continued until the requested timeout
+  bool cascade_only = false;
+  do {
+    int wait_ms = timeout_ms;
+    if (cascade_only) {
+      wait_ms = timeout_convert_to_ms(finish_time - get_precise_now());
+    }
+    cascade_only = false;
+    bool exact = false;
+    const int64_t next_tick = finished_events ? vk::timing_wheel::NO_EVENT : event_timers_wheel.next_event(&exact);
+    const double next_time = next_tick * 0.001;
+    if (next_tick != vk::timing_wheel::NO_EVENT && next_time <= get_precise_now() + wait_ms * 0.001) {
+      if (wait_ms > 0) {
+        wait_ms = timeout_convert_to_ms(next_time - get_precise_now());
       }
-      some_expires = true;
-      expire_event_time = event_timers_heap[1]->wakeup_time;
+      some_expires = exact;
+      cascade_only = !exact;
+      expire_event_time = next_time;
     }
-  }
 
-//  fprintf (stderr, "wait_net_middle %d\n", finished_events);
-  wait_net_events(timeout_ms);
-  finished_events += process_net_events();
+//    fprintf (stderr, "wait_net_middle %d\n", finished_events);
+    wait_net_events(wait_ms);
+    finished_events += process_net_events();
 
-  update_precise_now();
-  finished_events += remove_expired_event_timers();
+    update_precise_now();
+    finished_events += remove_expired_event_timers();
+  } while (cascade_only && !finished_events && get_precise_now() < finish_time);
 
   if (some_expires && !finished_events) {
     php_warning("Have no finished events, but we must have them. begin_time = %.9lf, expire_event_time = %.9lf, timeout_ms = %d, now = %.9lf", begin_time, expire_event_time, timeout_ms, get_precise_now());
@@ -191,9 +173,7 @@ int wait_net(int timeout_ms) {
 }
 
 void init_net_events_lib() {
-  event_timers_heap_size = 0;
-  event_timers_max_heap_size = 1023;
-  event_timers_heap = static_cast <event_timer **> (dl::allocate(sizeof(event_timer *) * event_timers_max_heap_size));
-
   update_precise_now();
+  // the timers of the previous request were freed together with the script memory
+  event_timers_wheel.reset(time_to_tick_floor(get_precise_now()));
 }
@@ -4,6 +4,8 @@
 
 #pragma once
 
+#include "common/containers/timing-wheel.h"
+
 constexpr int MAX_TIMEOUT = 86400;
 constexpr int MAX_TIMEOUT_MS = MAX_TIMEOUT * 1000;
 
@@ -16,7 +18,8 @@ double get_precise_now();
 
 
 struct event_timer {
-  int heap_index;
+  vk::timing_wheel_node wheel_node;
+  int wakeup_callback_id;
   int wakeup_extra;
   double wakeup_time;
 };
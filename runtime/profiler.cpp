@@ -131,6 +131,7 @@ FunctionStatsBase::Stats &stats_binary_op(FunctionStatsBase::Stats &lhs, const F
   f(lhs.rpc_requests_stat, rhs.rpc_requests_stat);
   f(lhs.sql_requests_stat, rhs.sql_requests_stat);
   f(lhs.mc_requests_stat, rhs.mc_requests_stat);
+  f(lhs.forks_stat, rhs.forks_stat);
   return lhs;
 }
 
@@ -151,6 +152,7 @@ void FunctionStatsBase::Stats::write_to(FILE *out, long double nanoseconds_to_ts
           " %" PRIu64 " %" PRIu64
           " %" PRIu64
           " %" PRIu64 " %" PRIu64 " %" PRIu64
+          " %" PRIu64 " %" PRIu64 " %" PRIu64 " %" PRIu64
           " %" PRIu64 " %" PRIu64 " %" PRIu64
           " %" PRIu64 " %" PRIu64 " %" PRIu64
           " %" PRIu64 " %" PRIu64 "\n",
@@ -158,8 +160,9 @@ void FunctionStatsBase::Stats::write_to(FILE *out, long double nanoseconds_to_ts
           memory_used, real_memory_used,
           context_swaps_for_query_count,
           rpc_requests_stat.queries_count(), rpc_requests_stat.outgoing_bytes(), rpc_requests_stat.incoming_bytes(),
-          sql_requests_stat.queries_count(), sql_requests_stat.outgoing_bytes(), sql_requests_stat.incoming_bytes(),
+          sql_requests_stat.queries_count(), sql_requests_stat.outgoing_bytes(), sql_requests_stat.incoming_bytes(), sql_requests_stat.latency_ns(),
           mc_requests_stat.queries_count(), mc_requests_stat.outgoing_bytes(), mc_requests_stat.incoming_bytes(),
+          forks_stat.created(), forks_stat.finished(), tsc2ns(forks_stat.bookkeeping_tsc(), nanoseconds_to_tsc_rate),
           tsc2ns(working_tsc, nanoseconds_to_tsc_rate),
           tsc2ns(waiting_tsc, nanoseconds_to_tsc_rate));
 }
@@ -240,6 +243,7 @@ void ProfilerBase::set_initial_stats(uint64_t start_working_tsc, const memory_re
   start_rpc_queries_stat_ = PhpQueriesStats::get_rpc_queries_stat();
   start_sql_queries_stat_ = PhpQueriesStats::get_sql_queries_stat();
   start_mc_queries_stat_ = PhpQueriesStats::get_mc_queries_stat();
+  start_forks_stat_ = get_forks_stat();
 }
 
 void ProfilerBase::start() noexcept {
@@ -261,6 +265,7 @@ void ProfilerBase::stop() noexcept {
   profiled_stats.rpc_requests_stat = PhpQueriesStats::get_rpc_queries_stat() - start_rpc_queries_stat_;
   profiled_stats.sql_requests_stat = PhpQueriesStats::get_sql_queries_stat() - start_sql_queries_stat_;
   profiled_stats.mc_requests_stat = PhpQueriesStats::get_mc_queries_stat() - start_mc_queries_stat_;
+  profiled_stats.forks_stat = get_forks_stat() - start_forks_stat_;
   function_stats_->on_call_finish(profiled_stats);
 
   auto *caller = get_next();
@@ -543,11 +548,16 @@ void forcibly_stop_and_flush_profiler() noexcept {
           "event: sql_outgoing_queries: Queries: SQL outgoing queries\n"
           "event: sql_outgoing_traffic: Traffic: SQL outgoing bytes\n"
           "event: sql_incoming_traffic: Traffic: SQL incoming bytes\n"
+          "event: sql_queries_ns: Nanoseconds: SQL queries latency\n"
 
           "event: mc_outgoing_queries: Queries: MC outgoing queries\n"
           "event: mc_outgoing_traffic: Traffic: MC outgoing bytes\n"
           "event: mc_incoming_traffic: Traffic: MC incoming bytes\n"
 
+          "event: forks_created: Forks: Forks created\n"
+          "event: forks_finished: Forks: Forks finished\n"
+          "event: forks_bookkeeping_ns: Nanoseconds: Forks creation and finishing overhead\n"
+
           "event: summary_queries = rpc_outgoing_queries + sql_outgoing_queries + mc_outgoing_queries: Queries: Summary outgoing queries\n"
           "event: summary_outgoing_traffic = rpc_outgoing_traffic + sql_outgoing_traffic + mc_outgoing_traffic: Traffic: Summary outgoing bytes\n"
           "event: summary_incoming_traffic = rpc_incoming_traffic + sql_incoming_traffic + mc_incoming_traffic: Traffic: Summary incoming bytes\n"
@@ -560,8 +570,9 @@ void forcibly_stop_and_flush_profiler() noexcept {
           "total_allocations total_memory_allocated memory_allocated real_memory_allocated "
           "query_ctx_swaps "
           "rpc_outgoing_queries rpc_outgoing_traffic rpc_incoming_traffic "
-          "sql_outgoing_queries sql_outgoing_traffic sql_incoming_traffic "
+          "sql_outgoing_queries sql_outgoing_traffic sql_incoming_traffic sql_queries_ns "
           "mc_outgoing_queries mc_outgoing_traffic mc_incoming_traffic "
+          "forks_created forks_finished forks_bookkeeping_ns "
           "cpu_ns net_ns\n\n");
 
   const long double nanoseconds_to_tsc_rate = context.calc_nanoseconds_to_tsc_rate();
@@ -13,6 +13,7 @@
 #include "common/wrappers/string_view.h"
 
 #include "runtime/kphp_core.h"
+#include "runtime/resumable.h"
 #include "server/php-queries-stats.h"
 
 template<class T>
@@ -51,6 +52,7 @@ public:
     QueriesStat rpc_requests_stat;
     QueriesStat sql_requests_stat;
     QueriesStat mc_requests_stat;
+    ForksStat forks_stat;
 
     Stats &operator+=(const Stats &other) noexcept;
     Stats &operator-=(const Stats &other) noexcept;
@@ -171,6 +173,7 @@ protected:
   QueriesStat start_rpc_queries_stat_;
   QueriesStat start_sql_queries_stat_;
   QueriesStat start_mc_queries_stat_;
+  ForksStat start_forks_stat_;
 
   uint64_t last_callee_waiting_generation_{0};
   uint64_t waiting_generation_{0};
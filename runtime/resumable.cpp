@@ -6,6 +6,7 @@
 
 #include <typeinfo>
 
+#include "common/cycleclock.h"
 #include "common/kprintf.h"
 
 #include "runtime/net_events.h"
@@ -71,6 +72,7 @@ struct forked_resumable_info {
   Resumable *continuation;
   int64_t queue_id;// == 0 - default, 2 * 10^9 > x > 10^8 - waited by x, 10^8 > x > 0 - in queue x, -1 if answer received and not in queue, x < 0 - (-id) of next finished function in the same queue or -2 if none
   int64_t son;
+  int64_t id;// 0 if the slot is free
   const char *name;
   double running_time;
 };
@@ -85,11 +87,18 @@ struct started_resumable_info {
 };
 
 static int64_t first_forked_resumable_id;
-static int64_t first_array_forked_resumable_id;
 static int64_t current_forked_resumable_id = 1123456789;
+// the ids are dense, while the infos are kept in the slots which are reused after the results of the forks are gotten
+static int32_t *forked_resumable_slots;// the slot of the id or -1 if the result is gotten
+static uint32_t forked_resumable_slots_size;
 static forked_resumable_info *forked_resumables;
 static forked_resumable_info gotten_forked_resumable_info;
 static uint32_t forked_resumables_size;
+static uint32_t forked_resumables_used;
+static uint32_t *free_forked_resumables;
+static uint32_t free_forked_resumables_count;
+
+static ForksStat forks_stat;
 
 static int64_t first_started_resumable_id;
 static int64_t current_started_resumable_id = 123456789;
@@ -128,10 +137,11 @@ static inline bool is_forked_resumable_id(int64_t resumable_id) {
 
 static inline forked_resumable_info *get_forked_resumable_info(int64_t resumable_id) {
   php_assert (is_forked_resumable_id(resumable_id));
-  if (resumable_id < first_array_forked_resumable_id) {
+  int32_t slot = forked_resumable_slots[resumable_id - first_forked_resumable_id];
+  if (slot < 0) {
     return &gotten_forked_resumable_info;
   }
-  return &forked_resumables[resumable_id - first_array_forked_resumable_id];
+  return &forked_resumables[slot];
 }
 
 static inline bool is_started_resumable_id(int64_t resumable_id) {
@@ -169,40 +179,66 @@ bool check_forked_storage(Storage *storage) {
 }
 
 
-int64_t register_forked_resumable(Resumable *resumable) {
-  if (current_forked_resumable_id == first_array_forked_resumable_id + forked_resumables_size) {
-    uint32_t first_needed_id = 0;
-    while (first_needed_id < forked_resumables_size &&
-           forked_resumables[first_needed_id].queue_id == -1 &&
-           forked_resumables[first_needed_id].output.tag == 0) {
-      first_needed_id++;
+// the slots of the forks with the gotten results are freed all at once, when there are no free slots left
+static void collect_free_forked_resumables() {
+  for (uint32_t slot = 0; slot < forked_resumables_used; slot++) {
+    forked_resumable_info *info = &forked_resumables[slot];
+    if (info->id != 0 && info->queue_id == -1 && info->output.tag == 0) {
+      forked_resumable_slots[info->id - first_forked_resumable_id] = -1;
+      info->id = 0;
+      free_forked_resumables[free_forked_resumables_count++] = slot;
     }
-    if (first_needed_id > forked_resumables_size / 2) {
-      memcpy(forked_resumables, forked_resumables + first_needed_id, sizeof(forked_resumable_info) * (forked_resumables_size - first_needed_id));
-      first_array_forked_resumable_id += first_needed_id;
-    } else {
+  }
+}
+
+static uint32_t allocate_forked_resumable_slot() {
+  if (free_forked_resumables_count == 0 && forked_resumables_used == forked_resumables_size) {
+    collect_free_forked_resumables();
+    // the slots are collected in O(size), so the array grows unless it frees a good share of them
+    if (free_forked_resumables_count < forked_resumables_size / 4) {
       forked_resumables = static_cast <forked_resumable_info *> (dl::reallocate(forked_resumables, sizeof(forked_resumable_info) * 2 * forked_resumables_size, sizeof(forked_resumable_info) * forked_resumables_size));
+      free_forked_resumables = static_cast <uint32_t *> (dl::reallocate(free_forked_resumables, sizeof(uint32_t) * 2 * forked_resumables_size, sizeof(uint32_t) * forked_resumables_size));
       forked_resumables_size *= 2;
+      Resumable::update_output();
     }
-    Resumable::update_output();
   }
+  if (free_forked_resumables_count > 0) {
+    return free_forked_resumables[--free_forked_resumables_count];
+  }
+  return forked_resumables_used++;
+}
+
+int64_t register_forked_resumable(Resumable *resumable) {
+  const uint64_t start_tsc = cycleclock_now();
   if (current_forked_resumable_id >= 2000000000) {
     php_critical_error ("too many forked resumables");
   }
+  if (current_forked_resumable_id == first_forked_resumable_id + forked_resumable_slots_size) {
+    forked_resumable_slots = static_cast <int32_t *> (dl::reallocate(forked_resumable_slots, sizeof(int32_t) * 2 * forked_resumable_slots_size, sizeof(int32_t) * forked_resumable_slots_size));
+    forked_resumable_slots_size *= 2;
+  }
 
   int64_t res_id = current_forked_resumable_id++;
-  forked_resumable_info *res = get_forked_resumable_info(res_id);
+  uint32_t slot = allocate_forked_resumable_slot();
+  forked_resumable_slots[res_id - first_forked_resumable_id] = static_cast<int32_t>(slot);
+  forked_resumable_info *res = &forked_resumables[slot];
 
   new(&res->output) Storage();
   res->continuation = resumable;
   res->queue_id = 0;
   res->son = 0;
+  res->id = res_id;
   res->running_time = 0;
   res->name = resumable ? typeid(*resumable).name() : "(null)";
 
+  forks_stat.register_create(cycleclock_now() - start_tsc);
   return res_id;
 }
 
+const ForksStat &get_forks_stat() noexcept {
+  return forks_stat;
+}
+
 static inline void update_current_resumable_id(int64_t new_id) {
   int64_t old_running_fork = f$get_running_fork_id();
   runned_resumable_id = new_id;
@@ -341,11 +377,14 @@ static void add_resumable_to_queue(int64_t resumable_id, forked_resumable_info *
 }
 
 void finish_forked_resumable(int64_t resumable_id) {
+  const uint64_t start_tsc = cycleclock_now();
   forked_resumable_info *res = get_forked_resumable_info(resumable_id);
   php_assert (res->continuation != nullptr);
 
   delete res->continuation;
   res->continuation = nullptr;
+  // the waiter woken up below runs the script code, so it isn't counted
+  forks_stat.register_finish(cycleclock_now() - start_tsc);
 
   if (res->queue_id > 100000000) {
     php_assert (is_started_resumable_id(res->queue_id));
@@ -1219,7 +1258,7 @@ void init_resumable_lib() {
   if (first_forked_resumable_id >= 1500000000) {
     first_forked_resumable_id = 1111111111;
   }
-  first_array_forked_resumable_id = current_forked_resumable_id = first_forked_resumable_id;
+  current_forked_resumable_id = first_forked_resumable_id;
 
   first_started_resumable_id = current_started_resumable_id;
   if (first_started_resumable_id >= 500000000) {
@@ -1228,8 +1267,14 @@ void init_resumable_lib() {
   current_started_resumable_id = first_started_resumable_id;
   first_free_started_resumable_id = 0;
 
+  forked_resumable_slots_size = 256;
+  forked_resumable_slots = static_cast<int32_t *>(dl::allocate(sizeof(int32_t) * forked_resumable_slots_size));
+
   forked_resumables_size = 170;
+  forked_resumables_used = 0;
   forked_resumables = static_cast<forked_resumable_info *>(dl::allocate(sizeof(forked_resumable_info) * forked_resumables_size));
+  free_forked_resumables_count = 0;
+  free_forked_resumables = static_cast<uint32_t *>(dl::allocate(sizeof(uint32_t) * forked_resumables_size));
 
   started_resumables_size = 170;
   started_resumables = static_cast<started_resumable_info *>(dl::allocate(sizeof(started_resumable_info) * started_resumables_size));
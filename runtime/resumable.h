@@ -140,6 +140,50 @@ void init_resumable_lib();
 int64_t f$get_running_fork_id();
 Optional<array<mixed>> f$get_fork_stat(int64_t fork_id);
 
+// the cost of the forked resumables bookkeeping, reported by the embedded profiler
+struct ForksStat {
+  void register_create(uint64_t tsc) noexcept {
+    ++created_;
+    bookkeeping_tsc_ += tsc;
+  }
+
+  void register_finish(uint64_t tsc) noexcept {
+    ++finished_;
+    bookkeeping_tsc_ += tsc;
+  }
+
+  ForksStat &operator+=(const ForksStat &other) noexcept {
+    created_ += other.created_;
+    finished_ += other.finished_;
+    bookkeeping_tsc_ += other.bookkeeping_tsc_;
+    return *this;
+  }
+
+  ForksStat &operator-=(const ForksStat &other) noexcept {
+    created_ -= other.created_;
+    finished_ -= other.finished_;
+    bookkeeping_tsc_ -= other.bookkeeping_tsc_;
+    return *this;
+  }
+
+  friend inline ForksStat operator-(const ForksStat &lhs, const ForksStat &rhs) noexcept {
+    ForksStat res = lhs;
+    res -= rhs;
+    return res;
+  }
+
+  uint64_t created() const noexcept { return created_; }
+  uint64_t finished() const noexcept { return finished_; }
+  uint64_t bookkeeping_tsc() const noexcept { return bookkeeping_tsc_; }
+
+private:
+  uint64_t created_{0};
+  uint64_t finished_{0};
+  uint64_t bookkeeping_tsc_{0};
+};
+
+const ForksStat &get_forks_stat() noexcept;
+
 /*
  *
  *     IMPLEMENTATION
@@ -349,6 +349,40 @@ void f$fetch_raw_vector_double(array<double> &out, int64_t n_elems) {
   rpc_data += rpc_data_buf_offset;
 }
 
+void rpc_fetch_raw_vector_int(array<int64_t> &out, int64_t n_elems) {
+  TRY_CALL_VOID(void, (check_rpc_data_len(n_elems)));
+  out.reserve(n_elems, 0, true);
+  for (int64_t i = 0; i < n_elems; ++i) {
+    out.push_back(rpc_data[i]);
+  }
+  rpc_data += n_elems;
+}
+
+void rpc_fetch_raw_vector_long(array<int64_t> &out, int64_t n_elems) {
+  TRY_CALL_VOID(void, (check_rpc_data_len(2 * n_elems)));
+  if (n_elems) {
+    out.reserve(n_elems, 0, true);
+    out.memcpy_vector(n_elems, rpc_data);
+    rpc_data += 2 * n_elems;
+  }
+}
+
+void rpc_fetch_raw_vector_double(array<double> &out, int64_t n_elems) {
+  TRY_CALL_VOID(void, (check_rpc_data_len(2 * n_elems)));
+  if (n_elems) {
+    out.reserve(n_elems, 0, true);
+    out.memcpy_vector(n_elems, rpc_data);
+    rpc_data += 2 * n_elems;
+  }
+}
+
+const int32_t *rpc_fetch_span(int64_t x4_len) {
+  TRY_CALL_VOID_(check_rpc_data_len(x4_len), return nullptr);
+  const int32_t *span = rpc_data;
+  rpc_data += x4_len;
+  return span;
+}
+
 static inline const char *f$fetch_string_raw(int *string_len) {
   TRY_CALL_VOID_(check_rpc_data_len(1), return nullptr);
   const char *str = reinterpret_cast <const char *> (rpc_data);
@@ -755,9 +789,9 @@ protected:
 
 /*
     if (request->resumable_id == -1) {
-      int len = *reinterpret_cast <int *>(request->answer - 12);
+      int len = *reinterpret_cast <int *>(request->answer - string::inner_sizeof());
       fprintf (stderr, "Receive  string of len %d at %p\n", len, request->answer);
-      for (int i = -12; i <= len; i++) {
+      for (int i = -static_cast<int>(string::inner_sizeof()); i <= len; i++) {
         fprintf (stderr, "%d: %x(%d)\t%c\n", i, request->answer[i], request->answer[i], request->answer[i] >= 32 ? request->answer[i] : '.');
       }
     }
@@ -931,7 +965,7 @@ void process_rpc_answer(int32_t request_id, char *result, int32_t result_len __a
 
   if (request->resumable_id < 0) {
     php_assert (result != nullptr);
-    dl::deallocate(result - 12, result_len + 13);
+    dl::deallocate(result - string::inner_sizeof(), result_len + string::inner_sizeof() + 1);
     php_assert (request->resumable_id != -1);
     return;
   }
@@ -1008,7 +1042,7 @@ protected:
       php_assert (res.resumable_id == -1);
 
       string result;
-      result.assign_raw(res.answer - 12);
+      result.assign_raw(res.answer - string::inner_sizeof());
       RETURN(result);
     RESUMABLE_END
   }
@@ -1081,7 +1115,7 @@ protected:
       php_assert (res.resumable_id == -1);
 
       string result;
-      result.assign_raw(res.answer - 12);
+      result.assign_raw(res.answer - string::inner_sizeof());
       bool parse_result = f$rpc_parse(result);
       php_assert(parse_result);
 
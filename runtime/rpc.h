@@ -84,6 +84,15 @@ bool f$fetch_end();
 
 void f$fetch_raw_vector_double(array<double> &out, int64_t n_elems);
 
+void rpc_fetch_raw_vector_int(array<int64_t> &out, int64_t n_elems);
+
+void rpc_fetch_raw_vector_long(array<int64_t> &out, int64_t n_elems);
+
+void rpc_fetch_raw_vector_double(array<double> &out, int64_t n_elems);
+
+// checks the length of x4_len ints at once and skips them; returns their beginning or nullptr after an exception
+const int32_t *rpc_fetch_span(int64_t x4_len);
+
 void estimate_and_flush_overflow(size_t &bytes_sent);
 
 struct tl_func_base;
@@ -20,6 +20,7 @@ prepend(KPHP_RUNTIME_SOURCES ${BASE_DIR}/runtime/
         datetime.cpp
         exception.cpp
         files.cpp
+        global_vars_block.cpp
         instance_cache.cpp
         inter-process-mutex.cpp
         interface.cpp
@@ -77,7 +78,7 @@ target_include_directories(kphp_runtime PUBLIC ${BASE_DIR} /opt/curl7600/include
 
 set(RUNTIME_LIBS
         vk::kphp_runtime vk::kphp_server vk::popular_common vk::unicode vk::common_src vk::binlog_src vk::net_src
-        -l:libyaml-cpp.a -l:libre2.a -l:libzstd.a -l:libh3.a m rt crypto z pthread)
+        -l:libyaml-cpp.a -l:libre2.a -l:libzstd.a -l:libbrotlienc.a -l:libbrotlicommon.a -l:libh3.a m rt crypto z pthread)
 vk_add_library(kphp-full-runtime STATIC)
 target_link_libraries(kphp-full-runtime PUBLIC ${RUNTIME_LIBS})
 set_target_properties(kphp-full-runtime PROPERTIES ARCHIVE_OUTPUT_DIRECTORY ${OBJS_DIR})
@@ -14,10 +14,15 @@ bool string::string_inner::is_shared() const {
   return ref_count > 0;
 }
 
+void string::string_inner::invalidate_hash() {
+  hash = hash_not_computed;
+}
+
 void string::string_inner::set_length_and_sharable(size_type n) {
 //  fprintf (stderr, "inc ref cnt %d %s\n", 0, ref_data());
   ref_count = 0;
   size = n;
+  invalidate_hash();
   ref_data()[n] = '\0';
 }
 
@@ -50,6 +55,7 @@ string::string_inner *string::string_inner::create(size_type requested_capacity,
   size_type new_size = (size_type)(sizeof(string_inner) + (capacity + 1));
   string_inner *p = (string_inner *)dl::allocate(new_size);
   p->capacity = capacity;
+  p->invalidate_hash();
   return p;
 }
 
@@ -60,6 +66,7 @@ char *string::string_inner::reserve(size_type requested_capacity) {
 
   string_inner *p = (string_inner *)dl::reallocate((void *)this, new_size, old_size);
   p->capacity = new_cap;
+  p->invalidate_hash();
   return p->ref_data();
 }
 
@@ -128,6 +135,9 @@ char *string::create(const char *beg, const char *end) {
   if (dnew == 1) {
     return string_cache::cached_char(*beg).ref_data();
   }
+  if (dnew == 2) {
+    return string_cache::cached_two_chars(beg[0], beg[1]).ref_data();
+  }
 
   string_inner *r = string_inner::create(dnew, 0);
   char *s = r->ref_data();
@@ -328,6 +338,9 @@ string &string::reserve_at_least(size_type res) {
     force_reserve(res);
   } else if (res > capacity()) {
     p = inner()->reserve(res);
+  } else {
+    // the caller is going to write into the buffer directly
+    inner()->invalidate_hash();
   }
   return *this;
 }
@@ -345,6 +358,10 @@ const char &string::operator[](size_type pos) const {
 }
 
 char &string::operator[](size_type pos) {
+  // constant strings can be placed in read only memory, they are never modified anyway
+  if (inner()->ref_count < ExtraRefCnt::for_global_const) {
+    inner()->invalidate_hash();
+  }
   return p[pos];
 }
 
@@ -550,6 +567,7 @@ string &string::append_unsafe(const mixed &v) {
 
 string &string::finish_append() {
   php_assert (inner()->size <= inner()->capacity);
+  inner()->invalidate_hash();
   p[inner()->size] = '\0';
   return *this;
 }
@@ -627,7 +645,7 @@ string &string::assign(size_type n, bool b __attribute__((unused))) {
 
 
 void string::assign_raw(const char *s) {
-  static_assert (sizeof(string_inner) == 12u, "need 12 bytes");
+  static_assert (sizeof(string_inner) == 20u, "need 20 bytes");
   p = const_cast <char *> (s + sizeof(string_inner));
 }
 
@@ -639,6 +657,9 @@ void string::swap(string &s) {
 }
 
 char *string::buffer() {
+  if (inner()->ref_count < ExtraRefCnt::for_global_const) {
+    inner()->invalidate_hash();
+  }
   return p;
 }
 
@@ -838,7 +859,16 @@ bool string::is_numeric() const {
 }
 
 int64_t string::hash() const {
-  return string_hash(p, size());
+  string_inner *in = inner();
+  if (in->hash != string_inner::hash_not_computed) {
+    return in->hash;
+  }
+  const int64_t h = string_hash(p, size());
+  // strings with extra ref counters can be shared between processes or placed in read only memory
+  if (in->ref_count < ExtraRefCnt::for_global_const) {
+    in->hash = h;
+  }
+  return h;
 }
 
 
@@ -935,6 +965,8 @@ void string::set_reference_counter_to(ExtraRefCnt ref_cnt_value) noexcept {
   // some const arrays are placed in read only memory and can't be modified
   if (inner()->ref_count != ref_cnt_value) {
     inner()->ref_count = ref_cnt_value;
+    // after that hash() stops memoizing, so do it once while the string is still writable
+    inner()->hash = string_hash(p, size());
   }
 }
 
@@ -954,7 +986,7 @@ inline string::size_type string::estimate_memory_usage() const {
 
 inline string string::make_const_string_on_memory(const char *str, size_type len, void *memory, size_t memory_size) {
   php_assert(len + inner_sizeof() + 1 <= memory_size);
-  auto *inner = new (memory) string_inner {len, len, ExtraRefCnt::for_global_const};
+  auto *inner = new (memory) string_inner {len, len, ExtraRefCnt::for_global_const, string_hash(str, len)};
   memcpy(inner->ref_data(), str, len);
   inner->ref_data()[len] = '\0';
   string result;
@@ -962,6 +994,12 @@ inline string string::make_const_string_on_memory(const char *str, size_type len
   return result;
 }
 
+inline char *string::make_raw_on_memory(size_type len, void *memory) {
+  auto *inner = new (memory) string_inner {len, len, 0};
+  inner->ref_data()[len] = '\0';
+  return inner->ref_data();
+}
+
 inline void string::destroy() {
   if (p) {
     inner()->dispose();
@@ -15,3 +15,21 @@ const string::string_inner &string_cache::cached_large_int(int64_t i) noexcept {
   php_assert(i < large_int_cache.size());
   return large_int_cache[i].inner;
 }
+
+const string::string_inner &string_cache::cached_two_chars(char c1, char c2) noexcept {
+  constexpr size_t cache_size = 1 << 16;
+  // in bss, the pages are filled by the master process and shared with the workers afterwards
+  alignas(string_8bytes) static char storage[cache_size * sizeof(string_8bytes)];
+  static const string_8bytes *two_chars_cache = [] {
+    auto *cache = reinterpret_cast<string_8bytes *>(storage);
+    for (size_t i = 0; i < cache_size; ++i) {
+      auto *s = new(&cache[i]) string_8bytes{static_cast<char>(i >> 8), static_cast<char>(i & 0xff)};
+      s->inner.hash = string_hash(s->data, 2);
+    }
+    return cache;
+  }();
+  return two_chars_cache[static_cast<uint8_t>(c1) << 8 | static_cast<uint8_t>(c2)].inner;
+}
+
+// fill the cache before the workers are forked
+static const auto &two_chars_cache_init __attribute__((unused)) = string_cache::cached_two_chars('\0', '\0');
@@ -15,6 +15,11 @@ private:
       data{c, '\0'} {
     }
 
+    constexpr string_8bytes(char c1, char c2) :
+      inner{2, 2, ExtraRefCnt::for_global_const},
+      data{c1, c2, '\0'} {
+    }
+
     template<size_t... Digits>
     constexpr explicit string_8bytes(std::index_sequence<Digits...>) :
       inner{sizeof...(Digits), sizeof...(Digits), ExtraRefCnt::for_global_const},
@@ -98,6 +103,10 @@ public:
     return constexpr_char_cache[static_cast<uint8_t>(c)].inner;
   }
 
+  // all the two byte strings: short array keys and field values are mostly such;
+  // 1.8MB, too big to be generated at compile time, so it's filled on startup
+  static const string::string_inner &cached_two_chars(char c1, char c2) noexcept;
+
   static const string::string_inner &cached_int(int64_t i) noexcept {
     // constexpr_make_small_ints generates numbers from 0 to 99 (small_int_max - 1),
     // it makes the compilation faster
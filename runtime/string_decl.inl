@@ -13,12 +13,21 @@ private:
   char *p;
 
 private:
+#pragma pack(push, 4)
   struct string_inner {
+    // hash() is never equal to INT64_MIN, see string_hash()
+    static constexpr int64_t hash_not_computed = std::numeric_limits<int64_t>::min();
+
     size_type size;
     size_type capacity;
     int ref_count;
+    // memoized string_hash() of the data, hash_not_computed after any mutation;
+    // it is written lazily only for the process-local strings,
+    // the shared memory ones get it precomputed in set_reference_counter_to()
+    int64_t hash{hash_not_computed};
 
     inline bool is_shared() const;
+    inline void invalidate_hash();
     inline void set_length_and_sharable(size_type n);
 
     inline char *ref_data() const;
@@ -38,6 +47,7 @@ private:
 
     inline char *clone(size_type requested_cap);
   };
+#pragma pack(pop)
 
   inline string_inner *inner() const;
 
@@ -186,6 +196,8 @@ public:
 
   inline static constexpr size_t inner_sizeof() noexcept { return sizeof(string_inner); }
   inline static string make_const_string_on_memory(const char *str, size_type len, void *memory, size_t memory_size);
+  // initializes a not shared string header of length len in memory of inner_sizeof() + len + 1 bytes, returns its data
+  inline static char *make_raw_on_memory(size_type len, void *memory);
 
   inline void destroy() __attribute__((always_inline));
 };
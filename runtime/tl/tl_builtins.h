@@ -76,14 +76,17 @@ inline void fetch_magic_if_not_bare(unsigned int inner_magic, const char *error_
   }
 }
 
-template<class T>
-inline void fetch_raw_vector_T(array<T> &out __attribute__ ((unused)), int64_t n_elems __attribute__ ((unused))) {
-  php_assert(0 && "never called in runtime");
+// the consecutive bare fixed size fields of a combinator are fetched with a single length check, see tl2cpp CombinatorFetch
+inline const int32_t *tl_fetch_fixed_size_span(int64_t x4_len) {
+  CHECK_EXCEPTION(return nullptr);
+  return rpc_fetch_span(x4_len);
 }
 
-template<>
-inline void fetch_raw_vector_T<double>(array<double> &out, int64_t n_elems) {
-  f$fetch_raw_vector_double(out, n_elems);
+template<class T>
+inline T tl_load_from_span(const int32_t *span) {
+  T value;
+  memcpy(&value, span, sizeof(T));
+  return value;
 }
 
 template<class T>
@@ -220,6 +223,28 @@ struct t_Double {
   }
 };
 
+// the bare elements of these types are fetched into a vector at once
+template<typename T>
+struct is_raw_vector_fetchable : vk::is_type_in_list<T, t_Int, tl_Long_impl<true>, t_Double> {
+};
+
+template<typename T>
+inline void fetch_raw_vector(const T &, array<typename T::PhpType> &, int64_t) {
+  php_assert(0 && "never called in runtime");
+}
+
+inline void fetch_raw_vector(const t_Int &, array<int64_t> &out, int64_t n_elems) {
+  rpc_fetch_raw_vector_int(out, n_elems);
+}
+
+inline void fetch_raw_vector(const tl_Long_impl<true> &, array<int64_t> &out, int64_t n_elems) {
+  rpc_fetch_raw_vector_long(out, n_elems);
+}
+
+inline void fetch_raw_vector(const t_Double &, array<double> &out, int64_t n_elems) {
+  rpc_fetch_raw_vector_double(out, n_elems);
+}
+
 struct t_Float {
   void store(const mixed &tl_object) {
     f$store_float(f$floatval(tl_object));
@@ -389,12 +414,12 @@ struct t_Vector {
       CurrentProcessingQuery::get().raise_fetching_error("Vector size is negative");
       return;
     }
-    out.reserve(n, 0, true);
-
-    if (std::is_same<T, t_Double>{} && inner_magic == 0) {
-      fetch_raw_vector_T<typename T::PhpType>(out, n);
+    // the length is checked before the reservation, so a broken size doesn't make a huge allocation
+    if (is_raw_vector_fetchable<T>{} && inner_magic == 0) {
+      fetch_raw_vector(elem_state, out, n);
       return;
     }
+    out.reserve(n, 0, true);
 
     for (int i = 0; i < n; ++i) {
       fetch_magic_if_not_bare(inner_magic, "Incorrect magic of inner type of type Vector");
@@ -617,12 +642,11 @@ struct t_Tuple {
 
   void typed_fetch_to(PhpType &out) {
     CHECK_EXCEPTION(return);
-    out.reserve(size, 0, true);
-
-    if (std::is_same<T, t_Double>{} && inner_magic == 0) {
-      fetch_raw_vector_T<typename T::PhpType>(out, size);
+    if (is_raw_vector_fetchable<T>{} && inner_magic == 0) {
+      fetch_raw_vector(elem_state, out, size);
       return;
     }
+    out.reserve(size, 0, true);
 
     for (int64_t i = 0; i < size; ++i) {
       typename T::PhpType elem;
@@ -690,12 +714,11 @@ struct tl_array {
 
   void typed_fetch_to(PhpType &out) {
     CHECK_EXCEPTION(return);
-    out.reserve(size, 0, true);
-
-    if (std::is_same<T, t_Double>{} && inner_magic == 0) {
-      fetch_raw_vector_T<typename T::PhpType>(out, size);
+    if (is_raw_vector_fetchable<T>{} && inner_magic == 0) {
+      fetch_raw_vector(cell, out, size);
       return;
     }
+    out.reserve(size, 0, true);
 
     for (int64_t i = 0; i < size; ++i) {
       typename T::PhpType elem;
@@ -4,28 +4,96 @@
 
 #include "server/confdata-binlog-replay.h"
 
+#include <algorithm>
 #include <bitset>
 #include <chrono>
 #include <cinttypes>
+#include <csignal>
+#include <cstring>
+#include <fcntl.h>
 #include <forward_list>
 #include <map>
-
+#include <thread>
+#include <sys/mman.h>
+#include <sys/prctl.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <zlib.h>
+
+#include "common/binlog/binlog-buffer.h"
 #include "common/binlog/binlog-replayer.h"
 #include "common/precise-time.h"
 #include "common/server/engine-settings.h"
 #include "common/server/init-binlog.h"
 #include "common/server/init-snapshot.h"
+#include "common/server/main-binlog.h"
 #include "common/wrappers/string_view.h"
 #include "common/kfs/kfs.h"
+#include "common/mixin/not_copyable.h"
 
 #include "runtime/allocator.h"
 #include "runtime/confdata-global-manager.h"
 #include "runtime/kphp_core.h"
+#include "runtime/memcache.h"
+#include "runtime/misc.h"
+#include "runtime/string_functions.h"
+#include "runtime/zlib.h"
 #include "server/confdata-binlog-events.h"
 #include "server/confdata-stats.h"
 
 namespace {
 
+// the result of the parallel decoding of a binlog event, which is used when the event is applied
+struct ConfdataDecodedEvent {
+  size_t offset{0};
+  int size{0};
+  int now{0};
+  bool blacklisted{false};
+  bool uncompressed{false};
+  std::string value;
+};
+
+// a not encrypted snapshot is mapped instead of being read into the heap,
+// so the loading doesn't need the memory for one more copy of the whole snapshot
+class SnapshotData : vk::not_copyable {
+public:
+  SnapshotData(kfs_file_handle_t snapshot, int64_t size) noexcept {
+    if (!snapshot->info->iv) {
+      const off_t offset = lseek(snapshot->fd, 0, SEEK_CUR);
+      if (offset >= 0 && offset + size <= snapshot->info->file_size) {
+        void *mapped = mmap(nullptr, offset + size, PROT_READ, MAP_PRIVATE, snapshot->fd, 0);
+        if (mapped != MAP_FAILED) {
+          madvise(mapped, offset + size, MADV_WILLNEED);
+          mapped_ = static_cast<char *>(mapped);
+          mapped_size_ = offset + size;
+          data_ = mapped_ + offset;
+          return;
+        }
+        kprintf("can't mmap snapshot %s, it will be read: %m\n", snapshot->info->filename);
+      }
+    }
+    copy_ = std::make_unique<char[]>(size);
+    kfs_read_file_assert (snapshot, copy_.get(), size);
+    data_ = copy_.get();
+  }
+
+  ~SnapshotData() {
+    if (mapped_) {
+      munmap(mapped_, mapped_size_);
+    }
+  }
+
+  const char *get() const noexcept {
+    return data_;
+  }
+
+private:
+  char *mapped_{nullptr};
+  size_t mapped_size_{0};
+  std::unique_ptr<char[]> copy_;
+  const char *data_{nullptr};
+};
+
 class ConfdataBinlogReplayer : vk::binlog::replayer {
 public:
   enum class OperationStatus {
@@ -41,6 +109,7 @@ public:
   }
 
   using vk::binlog::replayer::replay;
+  using vk::binlog::replayer::get_event_size;
 
   size_t try_reserve_for_snapshot(vk::string_view key, size_t search_from,
                                   vk::string_view &prev_key, array_size &counter) noexcept {
@@ -64,15 +133,15 @@ public:
     return dot_pos;
   }
 
-  int load_index() noexcept {
-    if (!Snapshot) {
+  int load_index(kfs_file_handle_t snapshot) noexcept {
+    if (!snapshot) {
       jump_log_ts = 0;
       jump_log_pos = 0;
       jump_log_crc32 = 0;
       return 0;
     }
     index_header header;
-    kfs_read_file_assert (Snapshot, &header, sizeof(index_header));
+    kfs_read_file_assert (snapshot, &header, sizeof(index_header));
     if (header.magic != PMEMCACHED_INDEX_MAGIC) {
       fprintf(stderr, "index file is not for confdata\n");
       return -1;
@@ -86,12 +155,11 @@ public:
     auto index_offset = std::make_unique<int64_t[]>(nrecords + 1);
     assert (index_offset);
 
-    kfs_read_file_assert (Snapshot, index_offset.get(), sizeof(index_offset[0]) * (nrecords + 1));
+    kfs_read_file_assert (snapshot, index_offset.get(), sizeof(index_offset[0]) * (nrecords + 1));
     vkprintf(1, "index_offset[%d]=%" PRId64 "\n", nrecords, index_offset[nrecords]);
 
-    auto index_binary_data = std::make_unique<char[]>(index_offset[nrecords]);
-    assert (index_binary_data);
-    kfs_read_file_assert (Snapshot, index_binary_data.get(), index_offset[nrecords]);
+    const SnapshotData snapshot_data{snapshot, index_offset[nrecords]};
+    const char *index_binary_data = snapshot_data.get();
 
     using entry_type = lev_confdata_store_wrapper<index_entry, pmct_set>;
 
@@ -221,6 +289,55 @@ public:
     return event_counters_;
   }
 
+  // the decoded event is used instead of checking the blacklist and uncompressing the value again
+  void set_decoded_event(const ConfdataDecodedEvent *decoded_event) noexcept {
+    decoded_event_ = decoded_event;
+  }
+
+  // restores the original keys of the elements, each element is visited once (its delay is -1 if it has no one);
+  // the elements of each section are visited in the order of their keys
+  template<class F>
+  void for_each_element(const confdata_sample_storage &confdata, const F &callback) const noexcept {
+    std::vector<std::pair<std::string, const mixed *>> section_elements;
+    for (const auto &section : confdata) {
+      const vk::string_view first_key{section.first.c_str(), section.first.size()};
+      const auto first_key_type = predefined_wildcards_.detect_first_key_type(first_key);
+      if (first_key_type == ConfdataFirstKeyType::simple_key) {
+        callback(first_key, section.second, get_element_delay(first_key));
+        continue;
+      }
+      // all these elements are in the one dot wildcards as well
+      if (first_key_type == ConfdataFirstKeyType::two_dots_wildcard) {
+        continue;
+      }
+
+      assert(section.second.is_array());
+      const auto &elements = section.second.as_array();
+      section_elements.clear();
+      for (auto it = elements.begin(); it != elements.end(); ++it) {
+        const auto &second_key = it.get_key();
+        std::string key{first_key.data(), first_key.size()};
+        if (array<mixed>::is_int_key(second_key)) {
+          key += std::to_string(second_key.to_int());
+        } else {
+          const string &second_key_str = second_key.as_string();
+          key.append(second_key_str.c_str(), second_key_str.size());
+        }
+        if (is_element_section(first_key, first_key_type, key)) {
+          section_elements.emplace_back(std::move(key), &it.get_value());
+        }
+      }
+      std::sort(section_elements.begin(), section_elements.end(),
+                [](const std::pair<std::string, const mixed *> &lhs, const std::pair<std::string, const mixed *> &rhs) {
+                  return lhs.first < rhs.first;
+                });
+      for (const auto &element : section_elements) {
+        const vk::string_view key{element.first};
+        callback(key, *element.second, get_element_delay(key));
+      }
+    }
+  }
+
 private:
   ConfdataBinlogReplayer() noexcept:
     key_blacklist_(ConfdataGlobalManager::get().get_key_blacklist()),
@@ -609,7 +726,10 @@ private:
   template<class BASE, int OPERATION>
   const mixed &get_processing_value(const lev_confdata_store_wrapper<BASE, OPERATION> &E) noexcept {
     if (processing_value_.is_null()) {
-      processing_value_ = E.get_value_as_var();
+      processing_value_ = decoded_event_ && decoded_event_->uncompressed
+                          ? mc_get_value(decoded_event_->value.data(), static_cast<int32_t>(decoded_event_->value.size()),
+                                         E.get_flags() & ~MEMCACHE_COMPRESSED)
+                          : E.get_value_as_var();
     }
     return processing_value_;
   }
@@ -621,7 +741,25 @@ private:
            : array<mixed>{};
   }
 
+  // an element with the predefined wildcards is always in the first of them,
+  // and it is in the one dot wildcard only if it has no predefined ones
+  bool is_element_section(vk::string_view first_key, ConfdataFirstKeyType first_key_type, vk::string_view key) const noexcept {
+    const auto predefined_wildcard_lengths = predefined_wildcards_.make_predefined_wildcard_len_range_by_key(key);
+    if (first_key_type == ConfdataFirstKeyType::predefined_wildcard) {
+      return !predefined_wildcard_lengths.empty() && *predefined_wildcard_lengths.begin() == first_key.size();
+    }
+    return predefined_wildcard_lengths.empty();
+  }
+
+  int get_element_delay(vk::string_view key) const noexcept {
+    auto it = element_delays_.find(key);
+    return it != element_delays_.end() ? it->second : -1;
+  }
+
   bool is_key_blacklisted(vk::string_view key) const noexcept {
+    if (decoded_event_) {
+      return decoded_event_->blacklisted;
+    }
     return blacklist_enabled_ && key_blacklist_.is_blacklisted(key);
   }
 
@@ -645,6 +783,7 @@ private:
   std::multimap<int, std::string> expiration_trace_;
 
   bool blacklist_enabled_{true};
+  const ConfdataDecodedEvent *decoded_event_{nullptr};
   const ConfdataKeyBlacklist &key_blacklist_;
   const ConfdataPredefinedWildcards &predefined_wildcards_;
 };
@@ -654,14 +793,427 @@ struct {
   size_t memory_limit{2u * 1024u * 1024u * 1024u};
   std::unique_ptr<re2::RE2> key_blacklist_pattern;
   std::unordered_set<vk::string_view> predefined_wildcards;
+  std::chrono::seconds snapshot_period{0};
+  int replay_threads{4};
 
   bool is_enabled() const noexcept {
     return binlog_mask;
   }
 } confdata_settings;
 
+// Writes the published confdata as a pmemcached index next to the binlog,
+// so the next start loads it by load_index and replays only the binlog after it.
+// Serializing the whole confdata takes long, so the snapshot is written by a forked process,
+// the master holds the published sample and doesn't clear it until the process exits.
+class ConfdataSnapshotWriter : vk::not_copyable {
+public:
+  static ConfdataSnapshotWriter &get() noexcept {
+    static ConfdataSnapshotWriter writer;
+    return writer;
+  }
+
+  void init(long long loaded_snapshot_log_pos) noexcept {
+    last_snapshot_log_pos_ = loaded_snapshot_log_pos;
+    next_snapshot_time_point_ = std::chrono::steady_clock::now() + confdata_settings.snapshot_period;
+    if (confdata_settings.snapshot_period.count() > 0 && engine_snapshot_replica) {
+      // the most recent snapshot is rotated as the written ones after the next snapshot is written
+      last_snapshot_path_ = remove_stale_confdata_snapshots(engine_snapshot_replica);
+    }
+  }
+
+  void try_start(const ConfdataBinlogReplayer &replayer, ConfdataGlobalManager &confdata_manager) noexcept {
+    const auto now_time_point = std::chrono::steady_clock::now();
+    if (writer_pid_ || confdata_settings.snapshot_period.count() <= 0 || now_time_point < next_snapshot_time_point_) {
+      return;
+    }
+    // the replayed events are not published yet, so the published sample doesn't match the binlog position
+    if (replayer.has_new_confdata()) {
+      return;
+    }
+    next_snapshot_time_point_ = now_time_point + confdata_settings.snapshot_period;
+    ConfdataSnapshotPosition position;
+    position.log_pos = log_cur_pos();
+    if (position.log_pos <= last_snapshot_log_pos_) {
+      return;
+    }
+    position.log_timestamp = BinlogBuffer.log_last_ts;
+    position.log_pos_crc32 = bb_buffer_relax_crc32(&BinlogBuffer, position.log_pos);
+
+    std::string snapshot_path = make_snapshot_path(position.log_pos);
+    const ConfdataSample *sample = confdata_manager.hold_current_sample();
+    const pid_t writer_pid = fork();
+    if (writer_pid < 0) {
+      kprintf("can't fork to write confdata snapshot %s: %m\n", snapshot_path.c_str());
+      confdata_manager.release_held_sample(sample);
+      return;
+    }
+    if (writer_pid == 0) {
+      prctl(PR_SET_PDEATHSIG, SIGKILL);
+      // the confdata memory is shared with the master, the writer mustn't allocate there
+      dl::restore_default_script_allocator(true);
+      const int records = write_confdata_snapshot((snapshot_path + ".tmp").c_str(), sample->get_confdata(), position);
+      _exit(records < 0 ? 1 : 0);
+    }
+
+    vkprintf(1, "confdata snapshot %s is being written by process %d\n", snapshot_path.c_str(), writer_pid);
+    writer_pid_ = writer_pid;
+    writing_sample_ = sample;
+    writing_log_pos_ = position.log_pos;
+    writing_snapshot_path_ = std::move(snapshot_path);
+    writing_started_ = now_time_point;
+  }
+
+  bool on_process_exit(pid_t exited_pid, int status) noexcept {
+    if (!writer_pid_ || exited_pid != writer_pid_) {
+      return false;
+    }
+    writer_pid_ = 0;
+    ConfdataGlobalManager::get().release_held_sample(writing_sample_);
+    writing_sample_ = nullptr;
+
+    auto &confdata_stats = ConfdataStats::get();
+    const std::string tmp_path = writing_snapshot_path_ + ".tmp";
+    const int records = WIFEXITED(status) && WEXITSTATUS(status) == 0 ? read_records_count(tmp_path) : -1;
+    if (records < 0 || rename(tmp_path.c_str(), writing_snapshot_path_.c_str()) != 0) {
+      kprintf("can't write confdata snapshot %s, writer exit status %d\n", writing_snapshot_path_.c_str(), status);
+      unlink(tmp_path.c_str());
+    } else {
+      vkprintf(1, "confdata snapshot %s is written, %d records\n", writing_snapshot_path_.c_str(), records);
+      if (!last_snapshot_path_.empty()) {
+        unlink(last_snapshot_path_.c_str());
+      }
+      last_snapshot_path_ = std::move(writing_snapshot_path_);
+      last_snapshot_log_pos_ = writing_log_pos_;
+      ++confdata_stats.snapshots_written;
+      confdata_stats.last_snapshot_elements = static_cast<size_t>(records);
+    }
+    writing_snapshot_path_.clear();
+    confdata_stats.total_snapshot_writing_time += std::chrono::steady_clock::now() - writing_started_;
+    return true;
+  }
+
+private:
+  ConfdataSnapshotWriter() = default;
+
+  // the suffix is parsed by kfs_classify_suffix: the two digits of the power and then the position,
+  // the position has at least 4 digits and the power is the number of the digits after the 4th one
+  static std::string make_snapshot_path(long long log_pos) noexcept {
+    char suffix[32];
+    const int digits = snprintf(nullptr, 0, "%lld", log_pos);
+    if (digits <= 4) {
+      snprintf(suffix, sizeof(suffix), ".00%04lld", log_pos);
+    } else {
+      snprintf(suffix, sizeof(suffix), ".%02d%lld", digits - 4, log_pos);
+    }
+    assert(engine_snapshot_replica);
+    return std::string{engine_snapshot_replica->replica_prefix} + suffix;
+  }
+
+  static int read_records_count(const std::string &path) noexcept {
+    const int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+      return -1;
+    }
+    index_header header{};
+    const bool read = pread(fd, &header, sizeof(header), 0) == sizeof(header);
+    close(fd);
+    return read ? header.nrecords : -1;
+  }
+
+  std::chrono::steady_clock::time_point next_snapshot_time_point_;
+  long long last_snapshot_log_pos_{0};
+  std::string last_snapshot_path_;
+
+  pid_t writer_pid_{0};
+  const ConfdataSample *writing_sample_{nullptr};
+  long long writing_log_pos_{0};
+  std::string writing_snapshot_path_;
+  std::chrono::steady_clock::time_point writing_started_;
+};
+
+// Checks the keys of the events against the blacklist and uncompresses the values in a worker thread,
+// each thread has its own decoder, as the replayer counts the calls of the handlers.
+class ConfdataEventDecoder : vk::binlog::replayer {
+public:
+  explicit ConfdataEventDecoder(const ConfdataKeyBlacklist &key_blacklist) noexcept:
+    vk::binlog::replayer([](const lev_generic *, int) { return 0; }),
+    key_blacklist_(key_blacklist) {
+    add_handler([this](const lev_confdata_delete &E) {
+      check_key(E.key, E.key_len);
+    });
+    add_handler([this](const lev_confdata_touch &E) {
+      check_key(E.key, E.key_len);
+    });
+    add_store_handler<lev_pmemcached_store, pmct_add>();
+    add_store_handler<lev_pmemcached_store, pmct_set>();
+    add_store_handler<lev_pmemcached_store, pmct_replace>();
+    add_store_handler<lev_pmemcached_store_forever, pmct_add>();
+    add_store_handler<lev_pmemcached_store_forever, pmct_set>();
+    add_store_handler<lev_pmemcached_store_forever, pmct_replace>();
+  }
+
+  void decode(const char *events, ConfdataDecodedEvent *first, ConfdataDecodedEvent *last) noexcept {
+    for (; first != last; ++first) {
+      decoding_event_ = first;
+      replay(reinterpret_cast<const lev_generic *>(events + first->offset), first->size);
+    }
+    decoding_event_ = nullptr;
+  }
+
+private:
+  template<class BASE, int OPERATION>
+  void add_store_handler() noexcept {
+    add_handler([this](const lev_confdata_store_wrapper<BASE, OPERATION> &E) {
+      if (check_key(E.data, E.key_len) && (E.get_flags() & MEMCACHE_COMPRESSED)) {
+        uncompress(E.get_value_as_string());
+      }
+    });
+  }
+
+  bool check_key(const char *key, int key_len) noexcept {
+    if (key_len < 0) {
+      return false;
+    }
+    decoding_event_->blacklisted = key_blacklist_.is_blacklisted(vk::string_view{key, static_cast<size_t>(key_len)});
+    return !decoding_event_->blacklisted;
+  }
+
+  // the value is left for the sequential mc_get_value if it can't be uncompressed the same way
+  void uncompress(vk::string_view compressed) noexcept {
+    if (compressed.empty()) {
+      return;
+    }
+    z_stream strm{};
+    if (inflateInit2(&strm, ZLIB_COMPRESS) != Z_OK) {
+      return;
+    }
+    std::string &value = decoding_event_->value;
+    value.resize(std::min(compressed.size() * 4, static_cast<size_t>(PHP_BUF_LEN)));
+    strm.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(compressed.data()));
+    strm.avail_in = static_cast<uInt>(compressed.size());
+    int ret = Z_OK;
+    while (true) {
+      strm.next_out = reinterpret_cast<Bytef *>(&value[strm.total_out]);
+      strm.avail_out = static_cast<uInt>(value.size() - strm.total_out);
+      ret = inflate(&strm, Z_NO_FLUSH);
+      if (ret != Z_OK || strm.avail_out != 0 || value.size() == static_cast<size_t>(PHP_BUF_LEN)) {
+        break;
+      }
+      value.resize(std::min(value.size() * 2, static_cast<size_t>(PHP_BUF_LEN)));
+    }
+    const bool uncompressed = vk::any_of_equal(ret, Z_OK, Z_STREAM_END, Z_BUF_ERROR) && (ret == Z_STREAM_END || strm.avail_out != 0);
+    value.resize(uncompressed ? strm.total_out : 0);
+    decoding_event_->uncompressed = uncompressed;
+    inflateEnd(&strm);
+  }
+
+  ConfdataDecodedEvent *decoding_event_{nullptr};
+  const ConfdataKeyBlacklist &key_blacklist_;
+};
+
+// Pipelined initial loading: the binlog buffer reads and checks the binlog in the main thread and the events are copied into a batch,
+// the full batch is decoded by the worker threads while the next one is read, then it is applied by the replayer in the binlog order.
+// The applying is sequential as the confdata memory resource isn't thread safe.
+class ConfdataParallelLoader : vk::not_copyable {
+public:
+  ConfdataParallelLoader(ConfdataBinlogReplayer &replayer, const ConfdataKeyBlacklist &key_blacklist, int threads) noexcept:
+    replayer_(replayer),
+    started_(std::chrono::steady_clock::now()) {
+    for (int i = 0; i < threads; ++i) {
+      decoders_.emplace_back(std::make_unique<ConfdataEventDecoder>(key_blacklist));
+    }
+  }
+
+  ~ConfdataParallelLoader() {
+    wait_decoding();
+  }
+
+  int push_event(const lev_generic *E, int size) noexcept {
+    const int event_size = replayer_.get_event_size(E, size);
+    if (event_size <= 0) {
+      return event_size;
+    }
+    ConfdataDecodedEvent event;
+    event.offset = reading_.events.size();
+    event.size = event_size;
+    event.now = now;
+    // the events are kept 8 bytes aligned like in the binlog buffer
+    reading_.events.resize(event.offset + ((event_size + 7) & ~7));
+    memcpy(reading_.events.data() + event.offset, E, event_size);
+    reading_.decoded.emplace_back(std::move(event));
+
+    auto &read_stage = ConfdataStats::get().initial_loading_read;
+    ++read_stage.events;
+    read_stage.bytes += event_size;
+    if (reading_.events.size() >= BATCH_BYTES) {
+      flush();
+    }
+    return event_size;
+  }
+
+  void finish() noexcept {
+    flush();
+    flush();
+    auto &confdata_stats = ConfdataStats::get();
+    confdata_stats.initial_loading_read.time = std::chrono::steady_clock::now() - started_
+                                               - confdata_stats.initial_loading_apply.time - waiting_time_;
+  }
+
+private:
+  static constexpr size_t BATCH_BYTES = 8 * 1024 * 1024;
+
+  struct Batch {
+    std::vector<char> events;
+    std::vector<ConfdataDecodedEvent> decoded;
+
+    void clear() noexcept {
+      events.clear();
+      decoded.clear();
+    }
+  };
+
+  // applies the decoded batch and starts decoding the read one
+  void flush() noexcept {
+    const auto waiting_start = std::chrono::steady_clock::now();
+    wait_decoding();
+    waiting_time_ += std::chrono::steady_clock::now() - waiting_start;
+    apply(decoding_);
+    decoding_.clear();
+    std::swap(reading_, decoding_);
+    start_decoding();
+  }
+
+  void start_decoding() noexcept {
+    if (decoding_.decoded.empty()) {
+      return;
+    }
+    decoding_start_ = std::chrono::steady_clock::now();
+    const size_t events = decoding_.decoded.size();
+    decoding_finish_.assign(decoders_.size(), decoding_start_);
+    for (size_t i = 0; i < decoders_.size(); ++i) {
+      ConfdataDecodedEvent *first = decoding_.decoded.data() + events * i / decoders_.size();
+      ConfdataDecodedEvent *last = decoding_.decoded.data() + events * (i + 1) / decoders_.size();
+      workers_.emplace_back([this, i, first, last] {
+        decoders_[i]->decode(decoding_.events.data(), first, last);
+        decoding_finish_[i] = std::chrono::steady_clock::now();
+      });
+    }
+  }
+
+  void wait_decoding() noexcept {
+    if (workers_.empty()) {
+      return;
+    }
+    for (auto &worker : workers_) {
+      worker.join();
+    }
+    workers_.clear();
+    auto &decode_stage = ConfdataStats::get().initial_loading_decode;
+    decode_stage.events += decoding_.decoded.size();
+    decode_stage.bytes += decoding_.events.size();
+    decode_stage.time += *std::max_element(decoding_finish_.begin(), decoding_finish_.end()) - decoding_start_;
+  }
+
+  void apply(const Batch &batch) noexcept {
+    if (batch.decoded.empty()) {
+      return;
+    }
+    auto &apply_stage = ConfdataStats::get().initial_loading_apply;
+    const auto apply_start = std::chrono::steady_clock::now();
+    const int binlog_now = now;
+    for (const auto &event : batch.decoded) {
+      // the delays are compared with the time of the event
+      now = event.now;
+      replayer_.set_decoded_event(&event);
+      const int replayed = replayer_.replay(reinterpret_cast<const lev_generic *>(batch.events.data() + event.offset), event.size);
+      assert(replayed == event.size);
+      apply_stage.bytes += event.size;
+    }
+    replayer_.set_decoded_event(nullptr);
+    now = binlog_now;
+    apply_stage.events += batch.decoded.size();
+    apply_stage.time += std::chrono::steady_clock::now() - apply_start;
+  }
+
+  ConfdataBinlogReplayer &replayer_;
+  std::vector<std::unique_ptr<ConfdataEventDecoder>> decoders_;
+  std::vector<std::thread> workers_;
+  Batch reading_;
+  Batch decoding_;
+  std::chrono::steady_clock::time_point started_;
+  std::chrono::steady_clock::time_point decoding_start_;
+  std::vector<std::chrono::steady_clock::time_point> decoding_finish_;
+  std::chrono::nanoseconds waiting_time_{std::chrono::nanoseconds::zero()};
+};
+
+ConfdataParallelLoader *confdata_parallel_loader{nullptr};
+
 } // namespace
 
+int write_confdata_snapshot(const char *path, const confdata_sample_storage &confdata, const ConfdataSnapshotPosition &position) noexcept {
+  const auto &replayer = ConfdataBinlogReplayer::get();
+  std::unique_ptr<FILE, int (*)(FILE *)> file{fopen(path, "wb"), fclose};
+  if (!file) {
+    return -1;
+  }
+
+  int records = 0;
+  replayer.for_each_element(confdata, [&records](vk::string_view, const mixed &, int) { ++records; });
+  std::vector<int64_t> index_offset(records + 1, 0);
+  const long data_offset = static_cast<long>(sizeof(index_header) + sizeof(index_offset[0]) * index_offset.size());
+  if (fseek(file.get(), data_offset, SEEK_SET) != 0) {
+    return -1;
+  }
+
+  int record = 0;
+  int64_t offset = 0;
+  replayer.for_each_element(confdata, [&](vk::string_view key, const mixed &value, int delay) {
+    assert(record < records);
+    index_offset[record++] = offset;
+    vk::string_view value_data;
+    index_entry entry{};
+    if (value.is_string()) {
+      value_data = vk::string_view{value.as_string().c_str(), value.as_string().size()};
+    } else {
+      static_SB.clean();
+      do_serialize(value);
+      value_data = vk::string_view{static_SB.buffer(), static_SB.size()};
+      entry.flags = MEMCACHE_SERIALIZED;
+    }
+    assert(key.size() <= std::numeric_limits<short>::max());
+    entry.key_len = static_cast<short>(key.size());
+    entry.data_len = static_cast<int>(value_data.size());
+    entry.delay = delay;
+    // the entries are 4 bytes aligned and terminated by '\0' like the events
+    const size_t entry_size = offsetof(index_entry, data) + key.size() + value_data.size() + 1;
+    const size_t padding = (4 - entry_size % 4) % 4;
+    fwrite(&entry, offsetof(index_entry, data), 1, file.get());
+    fwrite(key.data(), 1, key.size(), file.get());
+    fwrite(value_data.data(), 1, value_data.size(), file.get());
+    fwrite("\0\0\0\0", 1, padding + 1, file.get());
+    offset += static_cast<int64_t>(entry_size + padding);
+  });
+  assert(record == records);
+  index_offset[records] = offset;
+
+  index_header header{};
+  header.magic = PMEMCACHED_INDEX_MAGIC;
+  header.created_at = static_cast<int>(time(nullptr));
+  header.log_pos1 = position.log_pos;
+  header.log_timestamp = position.log_timestamp;
+  header.log_pos1_crc32 = position.log_pos_crc32;
+  header.nrecords = records;
+  if (fseek(file.get(), 0, SEEK_SET) != 0 ||
+      fwrite(&header, sizeof(header), 1, file.get()) != 1 ||
+      fwrite(index_offset.data(), sizeof(index_offset[0]), index_offset.size(), file.get()) != index_offset.size() ||
+      fflush(file.get()) != 0 || ferror(file.get()) ||
+      fsync(fileno(file.get())) != 0) {
+    return -1;
+  }
+  return records;
+}
+
+
 void set_confdata_binlog_mask(const char *mask) noexcept {
   confdata_settings.binlog_mask = mask;
 }
@@ -670,10 +1222,18 @@ void set_confdata_memory_limit(size_t memory_limit) noexcept {
   confdata_settings.memory_limit = memory_limit;
 }
 
+void set_confdata_snapshot_period(int seconds) noexcept {
+  confdata_settings.snapshot_period = std::chrono::seconds{seconds};
+}
+
 void set_confdata_blacklist_pattern(std::unique_ptr<re2::RE2> &&key_blacklist_pattern) noexcept {
   confdata_settings.key_blacklist_pattern = std::move(key_blacklist_pattern);
 }
 
+void set_confdata_replay_threads(int threads) noexcept {
+  confdata_settings.replay_threads = threads;
+}
+
 void add_confdata_predefined_wildcard(const char *wildcard) noexcept {
   assert(wildcard && *wildcard);
   vk::string_view wildcard_value{wildcard};
@@ -692,10 +1252,12 @@ void init_confdata_binlog_reader() noexcept {
   static engine_settings_t settings = {};
   settings.name = NAME_VERSION;
   settings.load_index = []() {
-    return ConfdataBinlogReplayer::get().load_index();
+    return ConfdataBinlogReplayer::get().load_index(Snapshot);
   };
   settings.replay_logevent = [](const lev_generic *E, int size) {
-    return ConfdataBinlogReplayer::get().replay(E, size);
+    return confdata_parallel_loader
+           ? confdata_parallel_loader->push_event(E, size)
+           : ConfdataBinlogReplayer::get().replay(E, size);
   };
   settings.on_lev_start = [](const lev_start *E) {
     log_split_min = E->split_min;
@@ -726,7 +1288,15 @@ void init_confdata_binlog_reader() noexcept {
   auto &confdata_binlog_replayer = ConfdataBinlogReplayer::get();
   confdata_binlog_replayer.init(confdata_manager.get_resource());
   engine_default_load_index(confdata_settings.binlog_mask);
-  engine_default_read_binlog();
+  if (confdata_settings.replay_threads > 0) {
+    ConfdataParallelLoader parallel_loader{confdata_binlog_replayer, confdata_manager.get_key_blacklist(), confdata_settings.replay_threads};
+    confdata_parallel_loader = &parallel_loader;
+    engine_default_read_binlog();
+    parallel_loader.finish();
+    confdata_parallel_loader = nullptr;
+  } else {
+    engine_default_read_binlog();
+  }
   confdata_binlog_replayer.delete_expired_elements();
 
   auto loaded_confdata = confdata_binlog_replayer.finish_confdata_update();
@@ -738,6 +1308,7 @@ void init_confdata_binlog_reader() noexcept {
   confdata_stats.initial_loading_time += confdata_stats.last_update_time_point.time_since_epoch();
 
   confdata_manager.get_current().reset(std::move(loaded_confdata.new_confdata));
+  ConfdataSnapshotWriter::get().init(jump_log_pos);
 
   vkprintf(1, "confdata loaded\n");
   confdata_allocator_rollback.disable();
@@ -762,13 +1333,15 @@ void confdata_binlog_update_cron() noexcept {
   binlog_try_read_events();
   confdata_binlog_replayer.delete_expired_elements();
 
+  // the samples released by the workers are cleared first, so that they can be reused for this update
+  confdata_manager.clear_unused_samples();
   if (confdata_binlog_replayer.has_new_confdata()){
     if (confdata_manager.can_next_be_updated()) {
       auto updated_confdata = confdata_binlog_replayer.finish_confdata_update();
       confdata_stats.on_update(updated_confdata.new_confdata,
                                updated_confdata.previous_confdata_garbage_size,
                                confdata_manager.get_predefined_wildcards());
-      previous_confdata_sample.save_garbage(std::move(updated_confdata.previous_confdata_garbage));
+      confdata_manager.save_garbage(std::move(updated_confdata.previous_confdata_garbage));
       const bool switched = confdata_manager.try_switch_to_next_sample(std::move(updated_confdata.new_confdata));
       assert(switched);
     } else {
@@ -776,12 +1349,57 @@ void confdata_binlog_update_cron() noexcept {
     }
   }
 
-  confdata_manager.clear_unused_samples();
+  ConfdataSnapshotWriter::get().try_start(confdata_binlog_replayer, confdata_manager);
 
   dl::restore_default_script_allocator(true);
   confdata_stats.total_updating_time += std::chrono::steady_clock::now().time_since_epoch();
 }
 
+bool on_confdata_snapshot_writer_exit(pid_t pid, int status) noexcept {
+  return confdata_settings.is_enabled() && ConfdataSnapshotWriter::get().on_process_exit(pid, status);
+}
+
+std::string remove_stale_confdata_snapshots(kfs_replica_handle_t replica) noexcept {
+  // only the files named as make_snapshot_path() does: the position digits and optionally .tmp
+  const auto is_written_snapshot = [](const kfs_file_info *info, bool &is_tmp) {
+    if (info->flags & KFS_FILE_SNAPSHOT_DIFF || info->suffix[0] != '.') {
+      return false;
+    }
+    const char *tail = info->suffix + 1 + strspn(info->suffix + 1, "0123456789");
+    is_tmp = !strcmp(tail, ".tmp");
+    return tail != info->suffix + 1 && (is_tmp || !*tail);
+  };
+
+  // the snapshots are sorted by the position, so the most recent one is the last
+  const kfs_file_info *recent_snapshot = nullptr;
+  for (int i = 0; i != replica->snapshot_num; ++i) {
+    const kfs_file_info *info = replica->snapshots[i];
+    bool is_tmp = false;
+    if (!is_written_snapshot(info, is_tmp)) {
+      continue;
+    }
+    const kfs_file_info *stale_snapshot = info;
+    if (!is_tmp) {
+      stale_snapshot = std::exchange(recent_snapshot, info);
+    }
+    if (stale_snapshot) {
+      vkprintf(1, "remove stale confdata snapshot %s\n", stale_snapshot->filename);
+      if (unlink(stale_snapshot->filename) != 0) {
+        kprintf("can't remove stale confdata snapshot %s: %m\n", stale_snapshot->filename);
+      }
+    }
+  }
+  return recent_snapshot ? std::string{recent_snapshot->filename} : std::string{};
+}
+
+confdata_sample_storage load_confdata_snapshot(kfs_file_handle_t snapshot) noexcept {
+  auto &confdata_binlog_replayer = ConfdataBinlogReplayer::get();
+  confdata_binlog_replayer.init(ConfdataGlobalManager::get().get_resource());
+  const int loaded = confdata_binlog_replayer.load_index(snapshot);
+  assert(loaded == 0);
+  return confdata_binlog_replayer.finish_confdata_update().new_confdata;
+}
+
 void write_confdata_stats_to(stats_t *stats) noexcept {
   if (confdata_settings.is_enabled()) {
     auto &confdata_stats = ConfdataStats::get();
@@ -4,14 +4,19 @@
 
 #pragma once
 #include <re2/re2.h>
+#include <string>
 
+#include "common/kfs/kfs-typedefs.h"
 #include "common/stats/provider.h"
 
 #include "runtime/allocator.h"
+#include "runtime/confdata-global-manager.h"
 
 void set_confdata_binlog_mask(const char *mask) noexcept;
 
 void set_confdata_memory_limit(size_t memory_limit) noexcept;
+void set_confdata_snapshot_period(int seconds) noexcept;
+void set_confdata_replay_threads(int threads) noexcept;
 void set_confdata_blacklist_pattern(std::unique_ptr<re2::RE2> &&key_blacklist_pattern) noexcept;
 void add_confdata_predefined_wildcard(const char *wildcard) noexcept;
 void clear_confdata_predefined_wildcards() noexcept;
@@ -19,5 +24,24 @@ void clear_confdata_predefined_wildcards() noexcept;
 void init_confdata_binlog_reader() noexcept;
 
 void confdata_binlog_update_cron() noexcept;
+// the snapshots are written by a child process of the master, returns false if the exited process isn't the writer
+bool on_confdata_snapshot_writer_exit(pid_t pid, int status) noexcept;
+
+// The position of the binlog a snapshot is written at
+struct ConfdataSnapshotPosition {
+  long long log_pos{0};
+  int log_timestamp{0};
+  unsigned int log_pos_crc32{0};
+};
+
+// Writes the confdata as a pmemcached index with the original keys of the elements,
+// returns the number of the written records or -1 on error
+int write_confdata_snapshot(const char *path, const confdata_sample_storage &confdata, const ConfdataSnapshotPosition &position) noexcept;
+// Removes the unfinished snapshots and all but the most recent written one, which were left by the previous runs.
+// The path of the most recent snapshot is returned, it's empty if there is none
+std::string remove_stale_confdata_snapshots(kfs_replica_handle_t replica) noexcept;
+// Initializes the replayer and loads the snapshot by it without the binlog, the loaded confdata is returned.
+// The current script allocator should be the confdata one
+confdata_sample_storage load_confdata_snapshot(kfs_file_handle_t snapshot) noexcept;
 
 void write_confdata_stats_to(stats_t *stats) noexcept;
@@ -28,6 +28,19 @@ void write_event_stats(stats_t *stats, const char *name, const ConfdataStats::Ev
   write_if_not_zero(stats, name, event.ttl_updated, ".ttl_updated");
 }
 
+void write_initial_loading_stage_stats(stats_t *stats, const char *name, const ConfdataStats::InitialLoadingStage &stage) noexcept {
+  if (stage.events) {
+    char buffer[256]{0};
+    const double seconds = to_seconds(stage.time);
+    snprintf(buffer, sizeof(buffer) - 1, "confdata.initial_loading.%s.seconds", name);
+    add_histogram_stat_double(stats, buffer, seconds);
+    snprintf(buffer, sizeof(buffer) - 1, "confdata.initial_loading.%s.events_per_second", name);
+    add_histogram_stat_double(stats, buffer, seconds > 0 ? static_cast<double>(stage.events) / seconds : 0);
+    snprintf(buffer, sizeof(buffer) - 1, "confdata.initial_loading.%s.mb_per_second", name);
+    add_histogram_stat_double(stats, buffer, seconds > 0 ? static_cast<double>(stage.bytes) / (1 << 20) / seconds : 0);
+  }
+}
+
 } // namespace
 
 void ConfdataStats::on_update(const confdata_sample_storage &new_confdata,
@@ -86,6 +99,9 @@ void ConfdataStats::write_stats_to(stats_t *stats, const memory_resource::Memory
   memory_stats.write_stats_to(stats, "confdata");
 
   add_histogram_stat_double(stats, "confdata.initial_loading_duration", to_seconds(initial_loading_time));
+  write_initial_loading_stage_stats(stats, "read", initial_loading_read);
+  write_initial_loading_stage_stats(stats, "decode", initial_loading_decode);
+  write_initial_loading_stage_stats(stats, "apply", initial_loading_apply);
   add_histogram_stat_double(stats, "confdata.total_updating_time", to_seconds(total_updating_time));
   add_histogram_stat_double(stats, "confdata.seconds_since_last_update",
                             to_seconds(std::chrono::steady_clock::now() - last_update_time_point));
@@ -93,6 +109,10 @@ void ConfdataStats::write_stats_to(stats_t *stats, const memory_resource::Memory
   add_histogram_stat_long(stats, "confdata.updates.ignored", ignored_updates);
   add_histogram_stat_long(stats, "confdata.updates.total", total_updates);
 
+  add_histogram_stat_long(stats, "confdata.snapshots.written", snapshots_written);
+  add_histogram_stat_long(stats, "confdata.snapshots.last_elements", last_snapshot_elements);
+  add_histogram_stat_double(stats, "confdata.snapshots.total_writing_time", to_seconds(total_snapshot_writing_time));
+
   add_histogram_stat_long(stats, "confdata.elements.total", total_elements);
   add_histogram_stat_long(stats, "confdata.elements.simple_key", simple_key_elements);
   add_histogram_stat_long(stats, "confdata.elements.one_dot_wildcard", one_dot_wildcard_elements);
@@ -18,10 +18,24 @@ struct ConfdataStats : private vk::not_copyable {
   std::chrono::nanoseconds initial_loading_time{std::chrono::nanoseconds::zero()};
   std::chrono::nanoseconds total_updating_time{std::chrono::nanoseconds::zero()};
   std::chrono::steady_clock::time_point last_update_time_point{std::chrono::nanoseconds::zero()};
+  std::chrono::nanoseconds total_snapshot_writing_time{std::chrono::nanoseconds::zero()};
+
+  // the stages of the parallel initial loading, see ConfdataParallelLoader
+  struct InitialLoadingStage {
+    size_t events{0};
+    size_t bytes{0};
+    std::chrono::nanoseconds time{std::chrono::nanoseconds::zero()};
+  };
+  InitialLoadingStage initial_loading_read;
+  InitialLoadingStage initial_loading_decode;
+  InitialLoadingStage initial_loading_apply;
 
   size_t total_updates{0};
   size_t ignored_updates{0};
 
+  size_t snapshots_written{0};
+  size_t last_snapshot_elements{0};
+
   size_t last_garbage_size{0};
   std::array<size_t, 100> garbage_statistic_{{0}};
 
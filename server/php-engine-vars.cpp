@@ -37,6 +37,8 @@ double load_time;
 /** http **/
 int http_port = -1;
 int http_sfd = -1;
+int http_reuseport = 0;
+int http_reuseport_steering = 0;
 
 /** rpc **/
 long long rpc_failed, rpc_sent, rpc_received, rpc_received_news_subscr, rpc_received_news_redirect;
@@ -47,6 +47,10 @@ extern double load_time;
 /** http **/
 extern int http_port;
 extern int http_sfd;
+// every worker listens on its own SO_REUSEPORT socket instead of the one shared by the master
+extern int http_reuseport;
+// the new connections are steered to the workers ready to accept them, see net-reuseport-steering.h
+extern int http_reuseport_steering;
 
 /** rpc **/
 extern long long rpc_failed, rpc_sent, rpc_received, rpc_received_news_subscr, rpc_received_news_redirect;
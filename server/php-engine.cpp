@@ -4,6 +4,7 @@
 
 #include "server/php-engine.h"
 
+#include <algorithm>
 #include <cassert>
 #include <cerrno>
 #include <cstdlib>
@@ -16,6 +17,7 @@
 #include <sys/prctl.h>
 #include <sys/socket.h>
 #include <unistd.h>
+#include <vector>
 
 #include "common/crc32c.h"
 #include "common/cycleclock.h"
@@ -38,10 +40,12 @@
 #include "net/net-connections.h"
 #include "net/net-crypto-aes.h"
 #include "net/net-dc.h"
+#include "net/net-http-compression.h"
 #include "net/net-http-server.h"
 #include "net/net-memcache-client.h"
 #include "net/net-memcache-server.h"
 #include "net/net-mysql-client.h"
+#include "net/net-reuseport-steering.h"
 #include "net/net-sockaddr-storage.h"
 #include "net/net-socket.h"
 #include "net/net-tcp-connections.h"
@@ -196,6 +200,7 @@ double fix_timeout(double timeout) {
   HTTP INTERFACE
  ***/
 void http_return(connection *c, const char *str, int len);
+void php_worker_http_flush(php_worker *worker, php_query_http_flush_t *query);
 
 int delete_pending_query(conn_query *q) {
   vkprintf (1, "delete_pending_query(%p,%p)\n", q, q->requester);
@@ -312,6 +317,9 @@ php_worker *php_worker_create(php_worker_mode_t mode, connection *c, http_query_
 
   worker->req_id = req_id;
 
+  worker->http_streaming = false;
+  worker->http_compressor = nullptr;
+
   if (worker->conn->target) {
     worker->target_fd = static_cast<int>(worker->conn->target - Targets);
   } else {
@@ -331,6 +339,11 @@ void php_worker_free(php_worker *worker) {
   php_query_data_free(worker->data);
   worker->data = nullptr;
 
+  if (worker->http_compressor != nullptr) {
+    http_compressor_free(worker->http_compressor);
+    worker->http_compressor = nullptr;
+  }
+
   free(worker);
 }
 
@@ -514,6 +527,9 @@ void php_worker_run_net_query(php_worker *worker, php_query_base_t *q_base) {
     case NETQ_PACKET:
       php_worker_run_net_query_packet(worker, (php_net_query_packet_t *)q_base);
       break;
+    case NETQ_PACKETS:
+      php_worker_run_mc_query_packets(worker, (php_net_query_packets_t *)q_base);
+      break;
     default:
       assert ("unknown net_query type" && 0);
   }
@@ -723,6 +739,49 @@ void php_worker_wait(php_worker *worker, int timeout_ms) {
   }
 }
 
+static std::vector<int> watched_script_fds;
+
+static int script_fd_handler(int fd, void *data __attribute__((unused)), event_t *ev) {
+  int ready = 0;
+  if (ev->ready & EVT_READ) {
+    ready |= sfd_read;
+  }
+  if (ev->ready & EVT_WRITE) {
+    ready |= sfd_write;
+  }
+  if (ev->ready & EVT_SPEC) {
+    ready |= sfd_error;
+  }
+  // the fds are level-triggered, so the fd stays out of epoll until the script is ready for its next event
+  epoll_remove(fd);
+  on_net_event(create_fd_ready_event(fd, ready, nullptr));
+  return 0;
+}
+
+void watch_script_fd(int fd, int flags) {
+  if (std::find(watched_script_fds.begin(), watched_script_fds.end(), fd) == watched_script_fds.end()) {
+    watched_script_fds.push_back(fd);
+  }
+  epoll_sethandler(fd, 0, script_fd_handler, nullptr);
+  epoll_insert(fd, EVT_LEVEL | (flags & sfd_read ? EVT_READ : 0) | (flags & sfd_write ? EVT_WRITE : 0) | EVT_SPEC);
+}
+
+void unwatch_script_fd(int fd) {
+  auto it = std::find(watched_script_fds.begin(), watched_script_fds.end(), fd);
+  if (it != watched_script_fds.end()) {
+    watched_script_fds.erase(it);
+    epoll_close(fd);
+  }
+}
+
+// the libraries close their fds with the script, the reactor must not keep them
+static void unwatch_all_script_fds() {
+  for (int fd : watched_script_fds) {
+    epoll_close(fd);
+  }
+  watched_script_fds.clear();
+}
+
 void php_worker_run_query(php_worker *worker) {
   auto q_base = (php_query_base_t *)php_script_get_query(php_script);
 
@@ -756,6 +815,10 @@ void php_worker_run_query(php_worker *worker) {
       query_stats.desc = "HTTP_LOAD_POST";
       php_worker_http_load_post(worker, (php_query_http_load_post_t *)q_base);
       break;
+    case PHPQ_HTTP_FLUSH:
+      query_stats.desc = "HTTP_FLUSH";
+      php_worker_http_flush(worker, (php_query_http_flush_t *)q_base);
+      break;
     default:
       assert ("unknown php_query type" && 0);
   }
@@ -811,11 +874,159 @@ void client_rpc_error(connection *c, long long req_id, int code, const char *str
   TCP_RPCC_FUNC(c)->flush_packet(c);
 }
 
+// returns the length of the data compressed into c->Tmp or -1
+static int http_compress_to_tmp(connection *c, http_compressor *compressor, const char *data, int len, http_compressor_op op) {
+  if (c->Tmp == nullptr) {
+    c->Tmp = alloc_head_buffer();
+    assert (c->Tmp != nullptr);
+  }
+  const int compressed_len = http_compressor_write(compressor, c->Tmp, data, len, op);
+  if (compressed_len < 0) {
+    free_all_buffers(c->Tmp);
+    c->Tmp = nullptr;
+  }
+  return compressed_len;
+}
+
+// the body is compressed after the script is finished, so the Content-Length is added here, before the empty line ending the headers
+static void http_write_compressed_result(connection *c, const script_result *res) {
+  http_compressor *compressor = http_compressor_create(static_cast<http_content_encoding>(res->content_encoding));
+  if (compressor == nullptr) {
+    http_return(c, "ERROR", 5);
+    return;
+  }
+  const int compressed_len = http_compress_to_tmp(c, compressor, res->body, res->body_len, hco_finish);
+  http_compressor_free(compressor);
+  if (compressed_len < 0) {
+    http_return(c, "ERROR", 5);
+    return;
+  }
+
+  char content_length[64];
+  const int content_length_len = snprintf(content_length, sizeof(content_length), "Content-Length: %d\r\n\r\n", compressed_len);
+  assert (res->headers_len >= 2);
+  write_out(&c->Out, res->headers, res->headers_len - 2);
+  write_out(&c->Out, content_length, content_length_len);
+  copy_through(&c->Out, c->Tmp, compressed_len);
+}
+
+// the limit of the response data queued by f$flush() and not sent to the client yet
+static constexpr int HTTP_FLUSH_MAX_PENDING_BYTES = 1 << 20;
+
+// writes a part of the body as a chunk, the compressed responses are compressed chunk by chunk
+static bool http_write_chunk(php_worker *worker, const char *data, int len, http_compressor_op op) {
+  connection *c = worker->conn;
+  if (worker->http_compressor != nullptr) {
+    len = http_compress_to_tmp(c, worker->http_compressor, data, len, op);
+    if (len < 0) {
+      return false;
+    }
+  }
+  if (len == 0) {
+    return true;
+  }
+
+  char chunk_size[16];
+  const int chunk_size_len = snprintf(chunk_size, sizeof(chunk_size), "%x\r\n", len);
+  if (write_out(&c->Out, chunk_size, chunk_size_len) != chunk_size_len) {
+    return false;
+  }
+  const int written = worker->http_compressor != nullptr ? copy_through(&c->Out, c->Tmp, len) : write_out(&c->Out, data, len);
+  return written == len && write_out(&c->Out, "\r\n", 2) == 2;
+}
+
+// f$flush() returns as soon as the chunk is queued, so the script writing faster than the client reads
+// is blocked here until the output is sent down to the limit, like the post loading blocks until the data is received
+static bool http_wait_output_sent(php_worker *worker) {
+  connection *c = worker->conn;
+  pollfd poll_fds;
+  poll_fds.fd = c->fd;
+  poll_fds.events = POLLOUT;
+
+  while (get_total_ready_bytes(&c->Out) > HTTP_FLUSH_MAX_PENDING_BYTES) {
+    if (c->error) {
+      return false;
+    }
+    const double left_time = worker->finish_time - get_utime_monotonic();
+    if (left_time < 0.01) {
+      return false;
+    }
+
+    const int r = poll(&poll_fds, 1, static_cast<int>(left_time * 1000 + 1));
+    if (r > 0) {
+      flush_connection_output(c);
+    } else if (r == 0 || errno != EINTR) {
+      return false;
+    }
+  }
+  return true;
+}
+
+static bool php_worker_http_flush_impl(php_worker *worker, const php_query_http_flush_t *query) {
+  connection *c = worker->conn;
+  if (c == nullptr) {
+    return false;
+  }
+  if (!worker->http_streaming) {
+    if (HTS_DATA(c)->http_ver < HTTP_V11) {
+      return false;
+    }
+    if (query->content_encoding != hce_identity) {
+      worker->http_compressor = http_compressor_create(static_cast<http_content_encoding>(query->content_encoding));
+      if (worker->http_compressor == nullptr) {
+        return false;
+      }
+    }
+    assert (query->headers_len >= 2);
+    worker->http_streaming = true;
+    if (write_out(&c->Out, query->headers, query->headers_len - 2) != query->headers_len - 2
+        || write_out(&c->Out, "Transfer-Encoding: chunked\r\n\r\n", 30) != 30) {
+      php_worker_terminate(worker, 0, script_error_t::net_event_error, "can't write http response headers");
+      return true;
+    }
+  }
+
+  if (!http_write_chunk(worker, query->body, query->body_len, hco_flush)) {
+    php_worker_terminate(worker, 0, script_error_t::net_event_error, "can't write http response chunk");
+    return true;
+  }
+  flush_connection_output(c);
+  if (!http_wait_output_sent(worker)) {
+    php_worker_terminate(worker, 0, script_error_t::net_event_error, "can't send http response chunk");
+  }
+  return true;
+}
+
+void php_worker_http_flush(php_worker *worker, php_query_http_flush_t *query) {
+  php_script_query_readed(php_script);
+
+  static php_query_http_flush_answer_t res;
+  res.sent = php_worker_http_flush_impl(worker, query);
+  query->base.ans = &res;
+
+  php_script_query_answered(php_script);
+}
+
+static void http_finish_streaming(php_worker *worker, const char *data, int len) {
+  if (!http_write_chunk(worker, data, len, hco_finish) || write_out(&worker->conn->Out, "0\r\n\r\n", 5) != 5) {
+    // the client finds the response incomplete by the closed connection
+    HTS_DATA(worker->conn)->query_flags &= ~QF_KEEPALIVE;
+  }
+  if (worker->http_compressor != nullptr) {
+    http_compressor_free(worker->http_compressor);
+    worker->http_compressor = nullptr;
+  }
+}
+
 void php_worker_set_result(php_worker *worker, script_result *res) {
   if (worker->conn != nullptr) {
     if (worker->mode == http_worker) {
-      if (res == nullptr) {
+      if (worker->http_streaming) {
+        http_finish_streaming(worker, res ? res->body : nullptr, res ? res->body_len : 0);
+      } else if (res == nullptr) {
         http_return(worker->conn, "OK", 2);
+      } else if (res->content_encoding != hce_identity) {
+        http_write_compressed_result(worker->conn, res);
       } else {
         write_out(&worker->conn->Out, res->headers, res->headers_len);
         write_out(&worker->conn->Out, res->body, res->body_len);
@@ -831,11 +1042,17 @@ void php_worker_set_result(php_worker *worker, script_result *res) {
   }
 }
 
-void php_worker_run_net_queue(php_worker *worker __attribute__((unused))) {
+void php_worker_run_net_queue(php_worker *worker) {
   net_query_t *query;
   while ((query = pop_net_query()) != nullptr) {
-    //no other types of query are currently supported
-    php_worker_run_rpc_send_query(query);
+    switch (query->type) {
+      case nq_rpc_send:
+        php_worker_run_rpc_send_query(query);
+        break;
+      case nq_sql_send:
+        php_worker_run_sql_send_query(worker, query);
+        break;
+    }
     free_net_query(query);
   }
 }
@@ -893,7 +1110,12 @@ void php_worker_run(php_worker *worker) {
 
         if (worker->conn != nullptr) {
           if (worker->mode == http_worker) {
-            http_return(worker->conn, "ERROR", 5);
+            if (worker->http_streaming) {
+              // the response is partially sent, the client finds it incomplete by the closed connection
+              HTS_DATA(worker->conn)->query_flags &= ~QF_KEEPALIVE;
+            } else {
+              http_return(worker->conn, "ERROR", 5);
+            }
           } else if (worker->mode == rpc_worker) {
             if (!rpc_stored) {
               server_rpc_error(worker->conn, worker->req_id, -504, php_script_get_error(php_script));
@@ -953,6 +1175,7 @@ void php_worker_free_script(php_worker *worker) {
     delete_pending_query(q);
   }
 
+  unwatch_all_script_fds();
   php_queries_finish();
   php_script_clear(php_script);
 
@@ -1102,6 +1325,7 @@ void hts_stop() {
     return;
   }
   if (http_sfd != -1) {
+    reuseport_steering_on_listening_changed(http_sfd, false);
     epoll_close(http_sfd);
     close(http_sfd);
     http_sfd = -1;
@@ -1653,7 +1877,20 @@ void pnet_query_answer(conn_query *q) {
     } else {
       assert ("unexpected type of connection\n" && 0);
     }
-    php_worker_answer_query(reinterpret_cast<php_worker *>(extra), ((net_ansgen_t *)(q->extra))->ans);
+    php_net_query_packet_answer_t *ans = ((net_ansgen_t *)(q->extra))->ans;
+    if (ans->slot_id != 0) {
+      on_net_event(ans->state == nq_ok ? create_sql_answer_event(ans->slot_id, ans->chain, nullptr)
+                                       : create_sql_error_event(ans->slot_id, ans->res, nullptr));
+      return;
+    }
+    if (ans->group != nullptr) {
+      if (--ans->group->pending > 0) {
+        return;
+      }
+      php_worker_answer_query(reinterpret_cast<php_worker *>(extra), ans->group);
+      return;
+    }
+    php_worker_answer_query(reinterpret_cast<php_worker *>(extra), ans);
   }
 }
 
@@ -2070,7 +2307,7 @@ void cron() {
 }
 
 int try_get_http_fd() {
-  return server_socket(http_port, settings_addr, backlog, 0);
+  return server_socket(http_port, settings_addr, backlog, http_reuseport ? SM_REUSEPORT : 0);
 }
 
 void open_json_log() {
@@ -2113,7 +2350,11 @@ void start_server() {
 
   init_epoll();
   if (master_flag) {
-    start_master(http_port > 0 ? &http_sfd : nullptr, &try_get_http_fd, http_port);
+    if (http_reuseport_steering && !reuseport_steering_init()) {
+      vkprintf(-1, "reuseport steering is not available, the kernel chooses the workers for the new connections\n");
+    }
+    // in the reuseport mode the master doesn't listen, the workers open their sockets after the fork
+    start_master(http_port > 0 && !http_reuseport ? &http_sfd : nullptr, &try_get_http_fd, http_port);
 
     if (logname_pattern != nullptr) {
       reopen_logs();
@@ -2124,8 +2365,8 @@ void start_server() {
   prev_time = 0;
 
   if (http_port > 0 && http_sfd < 0) {
-    dl_assert (!master_flag, "failed to get http_fd\n");
-    if (master_flag) {
+    dl_assert (!master_flag || http_reuseport, "failed to get http_fd\n");
+    if (master_flag && !http_reuseport) {
       vkprintf (-1, "try_get_http_fd after start_master\n");
       exit(1);
     }
@@ -2134,6 +2375,9 @@ void start_server() {
       vkprintf (-1, "cannot open http server socket at port %d: %m\n", http_port);
       exit(1);
     }
+    if (master_flag && reuseport_steering_enabled()) {
+      reuseport_steering_add_socket(http_sfd, logname_id);
+    }
   }
 
   if (rpc_port > 0 && rpc_sfd < 0) {
@@ -2586,6 +2830,40 @@ int main_args_handler(int i) {
       kprintf("couldn't set net-dc-mask '%s'\n", optarg);
       return -1;
     }
+    case 2013: {
+      http_reuseport = 1;
+      return 0;
+    }
+    case 2014: {
+      http_reuseport = 1;
+      http_reuseport_steering = 1;
+      return 0;
+    }
+    case 2015: {
+      if (set_mysql_max_connections(atoi(optarg))) {
+        return 0;
+      }
+      kprintf("couldn't set mysql-max-connections '%s'\n", optarg);
+      return -1;
+    }
+    case 2016: {
+      const int confdata_snapshot_period = atoi(optarg);
+      if (confdata_snapshot_period < 0) {
+        kprintf("confdata-snapshot-period has to be non negative\n");
+        return -1;
+      }
+      set_confdata_snapshot_period(confdata_snapshot_period);
+      return 0;
+    }
+    case 2017: {
+      const int confdata_replay_threads = atoi(optarg);
+      if (confdata_replay_threads < 0) {
+        kprintf("confdata-replay-threads has to be non negative\n");
+        return -1;
+      }
+      set_confdata_replay_threads(confdata_replay_threads);
+      return 0;
+    }
 
     default:
       return -1;
@@ -2651,6 +2929,14 @@ void parse_main_args(int argc, char *argv[]) {
   parse_option("profiler-log-prefix", required_argument, 2010, "set profier log path perfix");
   parse_option("mysql-db-name", required_argument, 2011, "database name of MySQL to connect");
   parse_option("net-dc-mask", required_argument, 2012, "a string formatted like '8=1.2.3.4/12' to detect a datacenter by ipv4");
+  parse_option("http-reuseport", no_argument, 2013, "every worker listens on its own SO_REUSEPORT http socket "
+                                                    "(enable net.ipv4.tcp_migrate_req to keep the queued connections of the exiting workers)");
+  parse_option("http-reuseport-steering", no_argument, 2014, "--http-reuseport with the new connections steered to the workers ready to accept them by an eBPF program");
+  parse_option("mysql-max-connections", required_argument, 2015, "maximum number of MySQL connections of a worker, the queries of the forks run over them in parallel (default 3)");
+  parse_option("confdata-snapshot-period", required_argument, 2016, "write a confdata snapshot next to the binlog every <seconds> if it has new events, "
+                                                                    "the next start replays only the binlog after it (default 0, disabled)");
+  parse_option("confdata-replay-threads", required_argument, 2017, "number of threads decoding the confdata binlog events at start while it is being read, "
+                                                                   "0 replays it in the main thread only (default 4)");
   parse_engine_options_long(argc, argv, main_args_handler);
   parse_main_args_till_option(argc, argv);
 }
@@ -41,6 +41,7 @@
 #include "net/net-connections.h"
 #include "net/net-http-server.h"
 #include "net/net-memcache-server.h"
+#include "net/net-reuseport-steering.h"
 #include "net/net-socket.h"
 #include "net/net-tcp-rpc-client.h"
 #include "net/net-tcp-rpc-server.h"
@@ -921,6 +922,15 @@ void clear_pipe_info(pipe_info_t *info) {
   info->reader = nullptr;
 }
 
+// the workers' logname ids are their reuseport steering slots
+static void update_reuseport_steering_slots() {
+  int slots_count = 0;
+  for (int i = 0; i < me_workers_n; i++) {
+    slots_count = std::max(slots_count, workers[i]->logname_id + 1);
+  }
+  reuseport_steering_set_slots_count(slots_count);
+}
+
 int run_worker() {
   dl_block_all_signals();
 
@@ -936,10 +946,13 @@ int run_worker() {
 
   tot_workers_started++;
 
+  int worker_logname_id = get_logname_id();
+  // the new worker marks itself as accepting when its socket is ready
+  reuseport_steering_set_accepting(worker_logname_id, false);
+
   pid_t new_pid = fork();
   assert (new_pid != -1 && "failed to fork");
 
-  int worker_logname_id = get_logname_id();
   if (new_pid == 0) {
     prctl(PR_SET_PDEATHSIG, SIGKILL); // TODO: or SIGTERM
     if (getppid() != me->pid) {
@@ -1026,6 +1039,7 @@ int run_worker() {
   close(new_fast_pipe[1]);
 
   me_running_workers_n++;
+  update_reuseport_steering_slots();
 
   changed = 1;
 
@@ -1049,10 +1063,12 @@ void remove_worker(pid_t pid) {
 
       clear_pipe_info(&workers[i]->pipes[0]);
       clear_pipe_info(&workers[i]->pipes[1]);
+      reuseport_steering_set_accepting(workers[i]->logname_id, false);
       delete_worker(workers[i]);
 
       me_workers_n--;
       workers[i] = workers[me_workers_n];
+      update_reuseport_steering_slots();
 
       vkprintf(1, "worker_removed: [running = %d] [dying = %d]\n", me_running_workers_n, me_dying_workers_n);
       return;
@@ -1067,6 +1083,9 @@ void update_workers() {
     int status;
     pid_t pid = waitpid(-1, &status, WNOHANG);
     if (pid > 0) {
+      if (on_confdata_snapshot_writer_exit(pid, status)) {
+        continue;
+      }
       if (!WIFEXITED (status)) {
         tot_workers_strange_dead++;
       }
@@ -248,20 +248,14 @@ int memcache_client_execute(connection *c, int op) {
   return 0;
 }
 
-void php_worker_run_mc_query_packet(php_worker *worker, php_net_query_packet_t *query) {
-  query_stats.desc = "MC";
-  query_stats.query = query->data;
-
-  php_script_query_readed(php_script);
-  mc_ansgen_t *ansgen = mc_ansgen_packet_create();
-  ansgen->func->set_query_type(ansgen, query->extra_type);
-
+// writes the packet to a connection of its target and registers the query waiting for the answer;
+// returns the error description if the packet can't be sent
+static const char *mc_send_query_packet(php_worker *worker, php_net_query_packet_t *query, mc_ansgen_t *ansgen, conn_query **cq) {
   auto net_ansgen = (net_ansgen_t *)ansgen;
   int connection_id = query->connection_id;
 
   if (connection_id < 0 || connection_id >= MAX_TARGETS) {
-    net_error(net_ansgen, (php_query_base_t *)query, "Invalid connection_id (1)");
-    return;
+    return "Invalid connection_id (1)";
   }
 
   conn_target_t *target = &Targets[connection_id];
@@ -272,8 +266,7 @@ void php_worker_run_mc_query_packet(php_worker *worker, php_net_query_packet_t *
 
   connection *conn = get_target_connection_force(target);
   if (conn == nullptr) {
-    net_error(net_ansgen, (php_query_base_t *)query, "Failed to establish connection [probably reconnect timeout is not expired]");
-    return;
+    return "Failed to establish connection [probably reconnect timeout is not expired]";
   }
 
   if (conn->status != conn_connecting) {
@@ -287,7 +280,23 @@ void php_worker_run_mc_query_packet(php_worker *worker, php_net_query_packet_t *
   }
 
   double timeout = fix_timeout(query->timeout) + precise_now;
-  conn_query *cq = create_pnet_query(worker->conn, conn, (net_ansgen_t *)ansgen, timeout);
+  *cq = create_pnet_query(worker->conn, conn, net_ansgen, timeout);
+  return nullptr;
+}
+
+void php_worker_run_mc_query_packet(php_worker *worker, php_net_query_packet_t *query) {
+  query_stats.desc = "MC";
+  query_stats.query = query->data;
+
+  php_script_query_readed(php_script);
+  mc_ansgen_t *ansgen = mc_ansgen_packet_create();
+  ansgen->func->set_query_type(ansgen, query->extra_type);
+
+  conn_query *cq = nullptr;
+  if (const char *error = mc_send_query_packet(worker, query, ansgen, &cq)) {
+    net_error((net_ansgen_t *)ansgen, (php_query_base_t *)query, error);
+    return;
+  }
 
   if (query->extra_type & PNETF_IMMEDIATE) {
     pnet_query_timeout(cq);
@@ -296,6 +305,41 @@ void php_worker_run_mc_query_packet(php_worker *worker, php_net_query_packet_t *
   }
 }
 
+void php_worker_run_mc_query_packets(php_worker *worker, php_net_query_packets_t *query) {
+  query_stats.desc = "MC_MULTI";
+  query_stats.query = query->packets_n > 0 ? query->packets[0].data : nullptr;
+
+  php_script_query_readed(php_script);
+
+  auto ans = (php_net_query_packets_answer_t *)qmem_malloc0(sizeof(php_net_query_packets_answer_t));
+  ans->answers_n = query->packets_n;
+  ans->answers = (php_net_query_packet_answer_t **)qmem_malloc0(sizeof(php_net_query_packet_answer_t *) * query->packets_n);
+  // the answers of the sent packets decrement it in pnet_query_answer, the script is answered by the last one
+  ans->pending = query->packets_n;
+  query->base.ans = ans;
+
+  for (int i = 0; i < query->packets_n; i++) {
+    php_net_query_packet_t *packet = &query->packets[i];
+    mc_ansgen_t *ansgen = mc_ansgen_packet_create();
+    auto net_ansgen = (net_ansgen_t *)ansgen;
+    net_ansgen->ans->group = ans;
+    ans->answers[i] = net_ansgen->ans;
+
+    conn_query *cq = nullptr;
+    if (const char *error = mc_send_query_packet(worker, packet, ansgen, &cq)) {
+      net_ansgen->func->error(net_ansgen, error);
+      net_ansgen->func->free(net_ansgen);
+      ans->pending--;
+    }
+  }
+
+  if (ans->pending == 0) {
+    php_script_query_answered(php_script);
+  } else if (worker->conn != nullptr) {
+    worker->conn->status = conn_wait_net;
+  }
+}
+
 memcache_client_functions memcache_client_outbound = [] {
   auto res = memcache_client_functions();
   res.execute = memcache_client_execute;
@@ -10,4 +10,5 @@
 #include "server/php-worker.h"
 
 void php_worker_run_mc_query_packet(php_worker *worker, php_net_query_packet_t *query);
+void php_worker_run_mc_query_packets(php_worker *worker, php_net_query_packets_t *query);
 extern conn_target_t memcache_ct;
@@ -18,10 +18,16 @@ struct QueriesStat {
     incoming_bytes_ += std::max(0, size);
   }
 
+  // the time from sending a query till getting its answer, the latencies of the parallel queries are summed up
+  void register_latency(double seconds) noexcept {
+    latency_ns_ += static_cast<uint64_t>(std::max(0.0, seconds) * 1e9);
+  }
+
   QueriesStat &operator+=(const QueriesStat &other) noexcept {
     queries_count_ += other.queries_count_;
     incoming_bytes_ += other.incoming_bytes_;
     outgoing_bytes_ += other.outgoing_bytes_;
+    latency_ns_ += other.latency_ns_;
     return *this;
   }
 
@@ -29,6 +35,7 @@ struct QueriesStat {
     queries_count_ -= other.queries_count_;
     incoming_bytes_ -= other.incoming_bytes_;
     outgoing_bytes_ -= other.outgoing_bytes_;
+    latency_ns_ -= other.latency_ns_;
     return *this;
   }
 
@@ -41,11 +48,13 @@ struct QueriesStat {
   uint64_t queries_count() const noexcept { return queries_count_; }
   uint64_t incoming_bytes() const noexcept { return incoming_bytes_; }
   uint64_t outgoing_bytes() const noexcept { return outgoing_bytes_; }
+  uint64_t latency_ns() const noexcept { return latency_ns_; }
 
 private:
   uint64_t queries_count_{0};
   uint64_t incoming_bytes_{0};
   uint64_t outgoing_bytes_{0};
+  uint64_t latency_ns_{0};
 };
 
 class PhpQueriesStats : vk::not_copyable {
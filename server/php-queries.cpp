@@ -10,8 +10,10 @@
 #include <cstring>
 
 #include "common/precise-time.h"
+#include "net/net-http-compression.h"
 
 #include "runtime/allocator.h"
+#include "runtime/kphp_core.h"
 #include "server/php-engine-vars.h"
 #include "server/php-queries-stats.h"
 #include "server/php-runner.h"
@@ -782,24 +784,13 @@ void *dl_allocate_safe(size_t size) {
     return nullptr;
   }
 
-  assert (size <= (1u << 30) - 13);
-  void *dest = dl::allocate(size + 13);
+  assert (size <= (1u << 30) - string::inner_sizeof() - 1);
+  void *dest = dl::allocate(string::inner_sizeof() + size + 1);
   if (dest == nullptr) {
     return nullptr;
   }
 
-  int *dest_int = static_cast <int *> (dest);
-  dest_int[0] = static_cast<int>(size);
-  dest_int[1] = static_cast<int>(size);
-  dest_int[2] = 0;
-  (static_cast <char *> (dest))[size + 12] = '\0';
-
-//  fprintf (stderr, "Allocate string of len %d at %p\n", (int)size, (void *)(dest_int + 3));
-//  for (int i = 0; i < (int)size + 13; i++) {
-//    fprintf (stderr, "%d: %x(%d)\n", i - 12, static_cast <char *> (dest)[i], static_cast <char *> (dest)[i]);
-//  }
-
-  return (void *)(dest_int + 3);
+  return string::make_raw_on_memory(static_cast<string::size_type>(size), dest);
 }
 
 int alloc_net_event(slot_id_t slot_id, net_event_type_t type, net_event_t **res) {
@@ -858,6 +849,68 @@ int create_rpc_answer_event(slot_id_t slot_id, int len, net_event_t **res) {
   return 1;
 }
 
+int create_fd_ready_event(int fd, int ready, net_event_t **res) {
+  net_event_t *event = net_events.create();
+  if (event == nullptr) {
+    return -2;
+  }
+  event->type = ne_fd_ready;
+  event->slot_id = -1;
+  event->fd = fd;
+  event->fd_ready = ready;
+  if (res != nullptr) {
+    *res = event;
+  }
+  return 1;
+}
+
+int create_sql_answer_event(slot_id_t slot_id, chain_t *chain, net_event_t **res) {
+  int len = 0;
+  for (chain_t *cur = chain->next; cur != chain; cur = cur->next) {
+    len += cur->len;
+  }
+  PhpQueriesStats::get_sql_queries_stat().register_answer(len);
+  net_event_t *event;
+  int status = alloc_net_event(slot_id, ne_sql_answer, &event);
+  if (status <= 0) {
+    return status;
+  }
+  if (len != 0) {
+    void *buf = dl_allocate_safe(len);
+    if (buf == nullptr) {
+      unalloc_net_event(event);
+      return -1;
+    }
+    event->result = static_cast <char *> (buf);
+    char *dest = event->result;
+    for (chain_t *cur = chain->next; cur != chain; cur = cur->next) {
+      memcpy(dest, cur->buf, cur->len);
+      dest += cur->len;
+    }
+  } else {
+    event->result = nullptr;
+  }
+  event->result_len = len;
+  if (res != nullptr) {
+    *res = event;
+  }
+  return 1;
+}
+
+int create_sql_error_event(slot_id_t slot_id, const char *error_message, net_event_t **res) {
+  net_event_t *event;
+  int status = alloc_net_event(slot_id, ne_sql_error, &event);
+  if (status <= 0) {
+    return status;
+  }
+  event->error_code = -1;
+  event->error_message = error_message; //in static or query memory
+  if (res != nullptr) {
+    *res = event;
+  }
+  return 1;
+}
+
 int net_events_empty() {
   return net_events.empty();
 }
@@ -901,24 +954,58 @@ void mc_run_query(int host_num, const char *request, int request_len, int timeou
   }
 }
 
-void db_run_query(int host_num, const char *request, int request_len, int timeout_ms, void (*callback)(const char *result, int result_len)) {
-  PhpQueriesStats::get_sql_queries_stat().register_query(request_len);
-  php_net_query_packet_answer_t *res = php_net_query_packet(host_num, request, request_len, timeout_ms * 0.001, p_sql, 0);
-  if (res->state == nq_error) {
-    fprintf(stderr, "db_run_query error: %s [%s]\n", res->desc ? res->desc : "", res->res);
-    save_last_net_error(res->res);
-  } else {
-    assert (res->chain != nullptr);
-    chain_t *cur = res->chain->next;
-    while (cur != res->chain) {
-      //fprintf (stderr, "sql_callback [len = %d]\n", cur->len);
-      PhpQueriesStats::get_sql_queries_stat().register_answer(cur->len);
-      callback(cur->buf, cur->len);
-      cur = cur->next;
+void mc_run_queries(const mc_query_part_t *parts, int parts_n, void (*callback)(const char *result, int result_len)) {
+  php_net_query_packets_t q;
+  q.base.type = PHPQ_NETQ | NETQ_PACKETS;
+  q.packets = (php_net_query_packet_t *)qmem_malloc(sizeof(php_net_query_packet_t) * parts_n);
+  q.packets_n = parts_n;
+  assert (q.packets != nullptr);
+  for (int i = 0; i < parts_n; i++) {
+    PhpQueriesStats::get_mc_queries_stat().register_query(parts[i].request_len);
+    php_net_query_packet_t &packet = q.packets[i];
+    packet.connection_id = parts[i].host_num;
+    packet.data = parts[i].request;
+    packet.data_len = parts[i].request_len;
+    packet.timeout = parts[i].timeout_ms * 0.001;
+    packet.protocol = p_memcached;
+    packet.extra_type = 0;
+  }
+
+  PHPScriptBase::current_script->ask_query((void *)&q);
+
+  auto *ans = (php_net_query_packets_answer_t *)q.base.ans;
+  for (int i = 0; i < ans->answers_n; i++) {
+    php_net_query_packet_answer_t *res = ans->answers[i];
+    if (res->state == nq_error) {
+      fprintf(stderr, "mc_run_queries error: %s [%s]\n", res->desc ? res->desc : "", res->res);
+      save_last_net_error(res->res);
+    } else {
+      assert (res->res != nullptr);
+      PhpQueriesStats::get_mc_queries_stat().register_answer(res->res_len);
+      callback(res->res, res->res_len);
     }
   }
 }
 
+slot_id_t db_send_query(int host_num, char *request, int request_size, int timeout_ms) {
+  net_query_t *query = create_net_query(nq_sql_send);
+  if (query == nullptr) {
+    return -1; // memory limit
+  }
+  query->slot_id = create_slot();
+  if (query->slot_id == -1) {
+    unalloc_net_query(query);
+    return -1;
+  }
+
+  PhpQueriesStats::get_sql_queries_stat().register_query(request_size);
+  query->host_num = host_num;
+  query->request = request;
+  query->request_size = request_size;
+  query->timeout_ms = timeout_ms;
+  return query->slot_id;
+}
+
 slot_id_t rpc_send_query(int host_num, char *request, int request_size, int timeout_ms) {
   net_query_t *query = create_net_query(nq_rpc_send);
   if (query == nullptr) {
@@ -980,17 +1067,32 @@ void script_error() {
   PHPScriptBase::error("script_error called", script_error_t::unclassified_error);
 }
 
-void http_set_result(const char *headers, int headers_len, const char *body, int body_len, int exit_code) {
+void http_set_result(const char *headers, int headers_len, const char *body, int body_len, int exit_code, int content_encoding) {
   script_result res;
   res.exit_code = exit_code;
   res.headers = headers;
   res.headers_len = headers_len;
   res.body = body;
   res.body_len = body_len;
+  res.content_encoding = content_encoding;
 
   PHPScriptBase::current_script->set_script_result(&res);
 }
 
+bool http_flush_result(const char *headers, int headers_len, const char *body, int body_len, int content_encoding) {
+  php_query_http_flush_t q;
+  q.base.type = PHPQ_HTTP_FLUSH;
+  q.headers = headers;
+  q.headers_len = headers_len;
+  q.body = body;
+  q.body_len = body_len;
+  q.content_encoding = content_encoding;
+
+  PHPScriptBase::current_script->ask_query((void *)&q);
+
+  return static_cast<php_query_http_flush_answer_t *>(q.base.ans)->sent;
+}
+
 void rpc_set_result(const char *body, int body_len, int exit_code) {
   script_result res;
   res.exit_code = exit_code;
@@ -998,6 +1100,7 @@ void rpc_set_result(const char *body, int body_len, int exit_code) {
   res.headers_len = 0;
   res.body = body;
   res.body_len = body_len;
+  res.content_encoding = hce_identity;
 
   PHPScriptBase::current_script->set_script_result(&res);
 }
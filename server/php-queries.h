@@ -10,7 +10,10 @@ using slot_id_t = int;
 
 enum net_event_type_t {
   ne_rpc_answer,
-  ne_rpc_error
+  ne_rpc_error,
+  ne_fd_ready,
+  ne_sql_answer,
+  ne_sql_error
 };
 
 struct net_event_t {
@@ -20,27 +23,32 @@ struct net_event_t {
     slot_id_t rpc_id;
   };
   union {
-    struct { //ne_rpc_answer
+    struct { //ne_rpc_answer, ne_sql_answer
       int result_len;
       //allocated via dl_malloc
       char *result;
     };
-    struct { //ne_rpc_error
+    struct { //ne_rpc_error, ne_sql_error
       int error_code;
       const char *error_message;
     };
+    struct { //ne_fd_ready
+      int fd;
+      int fd_ready;
+    };
   };
 };
 
 enum net_query_type_t {
-  nq_rpc_send
+  nq_rpc_send,
+  nq_sql_send
 };
 
 struct net_query_t {
   net_query_type_t type;
   slot_id_t slot_id;
   union {
-    struct { //nq_rpc_send
+    struct { //nq_rpc_send, nq_sql_send
       int host_num;
       char *request;
       int request_size;
@@ -57,6 +65,7 @@ struct net_query_t {
 
 void qmem_init();
 void *qmem_malloc(size_t n);
+void *qmem_malloc0(size_t n);
 void qmem_free_ptrs();
 void qmem_clear();
 
@@ -85,7 +94,9 @@ struct chain_t {
 #define PHPQ_NETQ 0x3d780000
 #define PHPQ_WAIT 0x728a0000
 #define PHPQ_HTTP_LOAD_POST 0x5ac20000
+#define PHPQ_HTTP_FLUSH 0x6b1d0000
 #define NETQ_PACKET 1234
+#define NETQ_PACKETS 1235
 
 #define PNETF_IMMEDIATE 16
 
@@ -150,6 +161,23 @@ struct php_query_http_load_post_t {
   int max_len;
 };
 
+/** send a part of http response body query **/
+struct php_query_http_flush_answer_t {
+  // false if the client can't receive the body in chunks
+  bool sent;
+};
+
+struct php_query_http_flush_t {
+  php_query_base_t base;
+
+  // the headers are sent with the first part only
+  const char *headers;
+  int headers_len;
+  const char *body;
+  int body_len;
+  int content_encoding;
+};
+
 
 /** net query **/
 struct data_reader_t {
@@ -163,6 +191,8 @@ enum nq_state_t {
   nq_ok
 };
 
+struct php_net_query_packets_answer_t;
+
 struct php_net_query_packet_answer_t {
   nq_state_t state;
 
@@ -172,6 +202,11 @@ struct php_net_query_packet_answer_t {
   chain_t *chain;
 
   long long result_id;
+
+  // not null for a part of php_net_query_packets_t
+  php_net_query_packets_answer_t *group;
+  // not 0 for a query sent by db_send_query, the answer becomes a net event of this slot
+  slot_id_t slot_id;
 };
 
 struct php_net_query_packet_t {
@@ -187,6 +222,20 @@ struct php_net_query_packet_t {
   int extra_type;
 };
 
+/** several packets sent at once, the answer is ready when every packet is answered or timed out **/
+struct php_net_query_packets_answer_t {
+  int pending;
+  int answers_n;
+  php_net_query_packet_answer_t **answers;
+};
+
+struct php_net_query_packets_t {
+  php_query_base_t base;
+
+  php_net_query_packet_t *packets;
+  int packets_n;
+};
+
 /** wait query **/
 struct php_net_query_wait_t {
   php_query_base_t base;
@@ -331,6 +380,10 @@ void free_net_query(net_query_t *query);
 
 int create_rpc_error_event(slot_id_t slot_id, int error_code, const char *error_message, net_event_t **res);
 int create_rpc_answer_event(slot_id_t slot_id, int len, net_event_t **res);
+int create_fd_ready_event(int fd, int ready, net_event_t **res);
+// the packets of the chain are joined into one answer, every packet starts with its mysql header
+int create_sql_answer_event(slot_id_t slot_id, chain_t *chain, net_event_t **res);
+int create_sql_error_event(slot_id_t slot_id, const char *error_message, net_event_t **res);
 int net_events_empty();
 
 void php_queries_start();
@@ -340,8 +393,18 @@ void init_drivers();
 
 int mc_connect_to(const char *host_name, int port);
 void mc_run_query(int host_num, const char *request, int request_len, int timeout_ms, int query_type, void (*callback)(const char *result, int result_len));
+
+struct mc_query_part_t {
+  int host_num;
+  const char *request;
+  int request_len;
+  int timeout_ms;
+};
+// sends all the requests in parallel and calls the callback for every answer, the failed parts are skipped
+void mc_run_queries(const mc_query_part_t *parts, int parts_n, void (*callback)(const char *result, int result_len));
 int db_proxy_connect();
-void db_run_query(int host_num, const char *request, int request_len, int timeout_ms, void (*callback)(const char *result, int result_len));
+// the request is allocated via dl::allocate, the answer comes as a ne_sql_answer or ne_sql_error net event
+slot_id_t db_send_query(int host_num, char *request, int request_len, int timeout_ms);
 void set_server_status(const char *status, int status_len);
 void set_server_status_rpc(int port, long long actor_id, double start_time);
 double get_net_time();
@@ -350,7 +413,8 @@ int get_net_queries_count();
 int get_engine_uptime();
 const char *get_engine_version();
 int http_load_long_query(char *buf, int min_len, int max_len);
-void http_set_result(const char *headers, int headers_len, const char *body, int body_len, int exit_code);
+void http_set_result(const char *headers, int headers_len, const char *body, int body_len, int exit_code, int content_encoding);
+bool http_flush_result(const char *headers, int headers_len, const char *body, int body_len, int content_encoding);
 void rpc_answer(const char *res, int res_len);
 void rpc_set_result(const char *body, int body_len, int exit_code);
 void script_error();
@@ -358,6 +422,17 @@ void finish_script(int exit_code);
 int rpc_connect_to(const char *host_name, int port);
 slot_id_t rpc_send_query(int host_num, char *request, int request_len, int timeout_ms);
 void wait_net_events(int timeout_ms);
+
+enum script_fd_flags_t {
+  sfd_read = 1,
+  sfd_write = 2,
+  sfd_error = 4
+};
+
+// the fd of a runtime library is watched by the engine reactor until it becomes ready,
+// then a ne_fd_ready net event is created and the fd has to be watched again to get the next one
+void watch_script_fd(int fd, int flags);
+void unwatch_script_fd(int fd);
 net_event_t *pop_net_event();
 int query_x2(int x);
 
@@ -6,6 +6,7 @@
 
 #include <cassert>
 #include <cerrno>
+#include <csignal>
 #include <cstdlib>
 #include <cstring>
 #include <exception>
@@ -50,7 +51,9 @@ void PHPScriptBase::error(const char *error_message, script_error_t error_type)
   __sanitizer_finish_switch_fiber(nullptr, nullptr, nullptr);
   __sanitizer_start_switch_fiber(nullptr, exit_context.uc_stack.ss_sp, exit_context.uc_stack.ss_size);
 #endif
-  setcontext(&exit_context);
+  // we may get here from a signal handler: unlike setcontext, setcontext_portable doesn't restore the signal mask
+  sigprocmask(SIG_SETMASK, &exit_context_sigmask, nullptr);
+  setcontext_portable(&exit_context);
 }
 
 void PHPScriptBase::check_tl() {
@@ -123,11 +126,8 @@ void PHPScriptBase::init(script_t *script, php_query_data *data_to_set) {
 
   assert (state == run_state_t::before_init);
 
-  getcontext(&run_context);
-  run_context.uc_stack.ss_sp = run_stack;
-  run_context.uc_stack.ss_size = stack_size;
-  run_context.uc_link = nullptr;
-  makecontext(&run_context, &cur_run, 0);
+  makecontext_portable(&run_context, &cur_run, run_stack, stack_size);
+  sigprocmask(SIG_SETMASK, nullptr, &exit_context_sigmask);
 
   run_main = script;
   data = data_to_set;
@@ -147,7 +147,7 @@ void PHPScriptBase::init(script_t *script, php_query_data *data_to_set) {
   PHPScriptBase::ml_flag = false;
 }
 
-int PHPScriptBase::swapcontext_helper(ucontext_t *oucp, const ucontext_t *ucp) {
+void PHPScriptBase::swapcontext_helper(ucontext_t_portable *oucp, const ucontext_t_portable *ucp) {
   stack_end = reinterpret_cast<char *>(ucp->uc_stack.ss_sp) + ucp->uc_stack.ss_size;
 #if ASAN7_ENABLED
   if (fiber_is_started) {
@@ -157,19 +157,20 @@ int PHPScriptBase::swapcontext_helper(ucontext_t *oucp, const ucontext_t *ucp) {
   __sanitizer_start_switch_fiber(nullptr, ucp->uc_stack.ss_sp, ucp->uc_stack.ss_size);
 #endif
 
-  return swapcontext(oucp, ucp);
+  swapcontext_portable(oucp, ucp);
 }
+
 void PHPScriptBase::pause() {
   //fprintf (stderr, "pause: \n");
   is_running = false;
-  assert (swapcontext_helper(&run_context, &exit_context) == 0);
+  swapcontext_helper(&run_context, &exit_context);
   is_running = true;
   check_tl();
   //fprintf (stderr, "pause: ended\n");
 }
 
 void PHPScriptBase::resume() {
-  assert (swapcontext_helper(&exit_context, &run_context) == 0);
+  swapcontext_helper(&exit_context, &run_context);
 }
 
 void dump_query_stats() {
@@ -396,7 +397,8 @@ int PHPScriptBase::get_net_queries_count() const {
 
 
 PHPScriptBase *volatile PHPScriptBase::current_script;
-ucontext_t PHPScriptBase::exit_context;
+ucontext_t_portable PHPScriptBase::exit_context;
+sigset_t PHPScriptBase::exit_context_sigmask;
 volatile bool PHPScriptBase::is_running = false;
 volatile bool PHPScriptBase::tl_flag = false;
 volatile bool PHPScriptBase::ml_flag = false;
@@ -8,6 +8,7 @@
 
 #include "common/dl-utils-lite.h"
 #include "common/sanitizer.h"
+#include "common/ucontext/ucontext-portable.h"
 
 #include "server/php-engine-vars.h"
 #include "server/php-query-data.h"
@@ -110,12 +111,14 @@ private:
 #if ASAN7_ENABLED
   bool fiber_is_started = false;
 #endif
-  int swapcontext_helper(ucontext_t *oucp, const ucontext_t *ucp);
+  void swapcontext_helper(ucontext_t_portable *oucp, const ucontext_t_portable *ucp);
 
 public:
 
   static PHPScriptBase *volatile current_script;
-  static ucontext_t exit_context;
+  static ucontext_t_portable exit_context;
+  // the engine signal mask, restored when the script is aborted from a signal handler
+  static sigset_t exit_context_sigmask;
   volatile static bool is_running;
   volatile static bool tl_flag;
   volatile static bool ml_flag;
@@ -126,7 +129,7 @@ public:
   void *query;
   char *run_stack, *protected_end, *run_stack_end, *run_mem;
   size_t mem_size, stack_size;
-  ucontext_t run_context;
+  ucontext_t_portable run_context;
 
   script_t *run_main;
   php_query_data *data;
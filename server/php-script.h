@@ -23,5 +23,7 @@ struct script_result {
   const char *body;
   int body_len;
   int exit_code;
+  // http_content_encoding the server compresses the body with, the headers miss the Content-Length then
+  int content_encoding;
 };
 
@@ -65,6 +65,14 @@ conn_target_t db_ct = [] {
   return res;
 }();
 
+bool set_mysql_max_connections(int max_connections) {
+  if (max_connections < db_ct.min_connections || max_connections > 100) {
+    return false;
+  }
+  db_ct.max_connections = max_connections;
+  return true;
+}
+
 void command_net_write_run_sql(command_t *base_command, void *data) {
   //fprintf (stderr, "command_net_write [ptr=%p]\n", base_command);
   auto command = (command_net_write_t *)base_command;
@@ -102,24 +110,17 @@ void command_net_write_run_sql(command_t *base_command, void *data) {
   command->len = 0;
 }
 
-void php_worker_run_sql_query_packet(php_worker *worker, php_net_query_packet_t *query) {
-  query_stats.desc = "SQL";
-  query_stats.query = query->data;
-
-  int connection_id = query->connection_id;
-  php_script_query_readed(php_script);
-
-  sql_ansgen_t *ansgen = sql_ansgen_packet_create();
-
+// writes the packet to a ready connection of the sql target or queues it until a connection becomes ready,
+// the queries of the different forks are spread over the connections of the target;
+// returns the error description if the packet can't be sent
+static const char *sql_send_query_packet(php_worker *worker, int connection_id, const char *data, int data_len, double timeout, sql_ansgen_t *ansgen) {
   auto net_ansgen = (net_ansgen_t *)ansgen;
   if (connection_id != sql_target_id) {
-    net_error(net_ansgen, (php_query_base_t *)query, "Invalid connection_id (sql connection expected)");
-    return;
+    return "Invalid connection_id (sql connection expected)";
   }
 
   if (connection_id < 0 || connection_id >= MAX_TARGETS) {
-    net_error(net_ansgen, (php_query_base_t *)query, "Invalid connection_id (1)");
-    return;
+    return "Invalid connection_id (1)";
   }
 
   conn_target_t *target = &Targets[connection_id];
@@ -128,10 +129,10 @@ void php_worker_run_sql_query_packet(php_worker *worker, php_net_query_packet_t
 
   connection *conn = get_target_connection(target, 0);
 
-  double timeout = fix_timeout(query->timeout) + precise_now;
+  double finish_time = fix_timeout(timeout) + precise_now;
   if (conn != nullptr && conn->status == conn_ready) {
-    write_out(&conn->Out, query->data, query->data_len);
-    SQLC_FUNC (conn)->sql_flush_packet(conn, query->data_len - 4);
+    write_out(&conn->Out, data, data_len);
+    SQLC_FUNC (conn)->sql_flush_packet(conn, data_len - 4);
     flush_connection_output(conn);
     conn->last_query_sent_time = precise_now;
     conn->status = conn_wait_answer;
@@ -141,16 +142,29 @@ void php_worker_run_sql_query_packet(php_worker *worker, php_net_query_packet_t
     ansgen->func->set_writer(ansgen, nullptr);
     ansgen->func->ready(ansgen, nullptr);
 
-    create_pnet_query(worker->conn, conn, net_ansgen, timeout);
+    create_pnet_query(worker->conn, conn, net_ansgen, finish_time);
   } else {
     int new_conn_cnt = create_new_connections(target);
     if (new_conn_cnt <= 0 && get_target_connection(target, 1) == nullptr) {
-      net_error(net_ansgen, (php_query_base_t *)query, "Failed to establish connection [probably reconnect timeout is not expired]");
-      return;
+      return "Failed to establish connection [probably reconnect timeout is not expired]";
     }
 
-    ansgen->func->set_writer(ansgen, create_command_net_writer(query->data, query->data_len, &command_net_write_sql_base, -1));
-    create_pnet_delayed_query(worker->conn, target, net_ansgen, timeout);
+    ansgen->func->set_writer(ansgen, create_command_net_writer(data, data_len, &command_net_write_sql_base, -1));
+    create_pnet_delayed_query(worker->conn, target, net_ansgen, finish_time);
+  }
+  return nullptr;
+}
+
+void php_worker_run_sql_query_packet(php_worker *worker, php_net_query_packet_t *query) {
+  query_stats.desc = "SQL";
+  query_stats.query = query->data;
+
+  php_script_query_readed(php_script);
+
+  sql_ansgen_t *ansgen = sql_ansgen_packet_create();
+  if (const char *error = sql_send_query_packet(worker, query->connection_id, query->data, query->data_len, query->timeout, ansgen)) {
+    net_error((net_ansgen_t *)ansgen, (php_query_base_t *)query, error);
+    return;
   }
 
   if (worker->conn != nullptr) {
@@ -158,6 +172,17 @@ void php_worker_run_sql_query_packet(php_worker *worker, php_net_query_packet_t
   }
 }
 
+void php_worker_run_sql_send_query(php_worker *worker, net_query_t *query) {
+  sql_ansgen_t *ansgen = sql_ansgen_packet_create();
+  auto net_ansgen = (net_ansgen_t *)ansgen;
+  // the script isn't waiting for the answer, it is sent back as a net event
+  net_ansgen->ans->slot_id = query->slot_id;
+  if (const char *error = sql_send_query_packet(worker, query->host_num, query->request, query->request_size, query->timeout_ms * 0.001, ansgen)) {
+    on_net_event(create_sql_error_event(query->slot_id, error, nullptr));
+    net_ansgen->func->free(net_ansgen);
+  }
+}
+
 int sql_query_packet(conn_query *q, data_reader_t *reader) {
   auto ansgen = (sql_ansgen_t *)q->extra;
   ansgen->func->packet(ansgen, reader);
@@ -10,5 +10,8 @@
 #include "server/php-worker.h"
 
 void php_worker_run_sql_query_packet(php_worker *worker, php_net_query_packet_t *query);
+void php_worker_run_sql_send_query(php_worker *worker, net_query_t *query);
 bool set_mysql_db_name(const char *db_name);
+// the queries of the forks run in parallel over the connections of a worker, up to this number
+bool set_mysql_max_connections(int max_connections);
 extern conn_target_t db_ct;
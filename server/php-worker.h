@@ -45,5 +45,9 @@ struct php_worker {
 
   long long req_id;
   int target_fd;
+
+  // the http response is being sent in chunks, the headers are already sent
+  bool http_streaming;
+  struct http_compressor *http_compressor;
 };
 
@@ -1,6 +1,8 @@
 prepend(COMPILER_TESTS_SOURCES ${BASE_DIR}/tests/cpp/compiler/
         _compiler-tests-env.cpp
+        hash-table-test.cpp
         phpdoc-test.cpp
-        lexer-test.cpp)
+        lexer-test.cpp
+        tl-combinator-test.cpp)
 
 vk_add_unittest(compiler "${COMPILER_LIBS}" ${COMPILER_TESTS_SOURCES})
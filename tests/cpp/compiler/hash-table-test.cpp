@@ -0,0 +1,67 @@
+#include <gtest/gtest.h>
+
+#include <thread>
+
+#include "compiler/threading/hash-table.h"
+
+TEST(hash_table_test, test_at_and_find) {
+  TSHashTable<int> ht;
+  ASSERT_EQ(ht.find(0), nullptr);
+
+  // zero is a regular hash, the table has no reserved values
+  for (unsigned long long hash = 0; hash < 1000; ++hash) {
+    auto node = ht.at(hash);
+    ASSERT_EQ(node->hash, hash);
+    ASSERT_EQ(node->data, 0);
+    node->data = static_cast<int>(hash) + 1;
+  }
+  for (unsigned long long hash = 0; hash < 1000; ++hash) {
+    ASSERT_EQ(*ht.find(hash), static_cast<int>(hash) + 1);
+    ASSERT_EQ(ht.at(hash)->data, static_cast<int>(hash) + 1);
+  }
+  ASSERT_EQ(ht.find(1000), nullptr);
+
+  auto all = ht.get_all();
+  ASSERT_EQ(all.size(), 1000);
+  for (int i = 0; i < 1000; ++i) {
+    ASSERT_EQ(all[i], i + 1);
+  }
+
+  auto odd = ht.get_all_if([](int x) { return x % 2 == 1; });
+  ASSERT_EQ(odd.size(), 500);
+  ASSERT_TRUE(std::is_sorted(odd.begin(), odd.end()));
+}
+
+TEST(hash_table_test, test_concurrent_stress) {
+  TSHashTable<int> ht;
+  constexpr int threads_count = 8;
+  constexpr unsigned long long keys_count = 20000;
+
+  // every thread inserts all the keys in its own order, the nodes must be the same for all of them
+  std::vector<std::vector<TSHashTable<int>::HTNode *>> nodes(threads_count);
+  std::vector<std::thread> threads;
+  for (int t = 0; t < threads_count; ++t) {
+    threads.emplace_back([&ht, &nodes, t] {
+      nodes[t].resize(keys_count);
+      for (unsigned long long i = 0; i < keys_count; ++i) {
+        const unsigned long long key = (i * 7919 + t * 104729) % keys_count;
+        auto node = ht.at(key * 0x100000001b3ULL);
+        AutoLocker<Lockable *> locker(node);
+        node->data++;
+        nodes[t][key] = node;
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+
+  for (unsigned long long key = 0; key < keys_count; ++key) {
+    for (int t = 1; t < threads_count; ++t) {
+      ASSERT_EQ(nodes[t][key], nodes[0][key]);
+    }
+    ASSERT_EQ(nodes[0][key]->hash, key * 0x100000001b3ULL);
+    ASSERT_EQ(*ht.find(key * 0x100000001b3ULL), threads_count);
+  }
+  ASSERT_EQ(ht.get_all().size(), keys_count);
+}
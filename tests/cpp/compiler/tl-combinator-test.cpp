@@ -0,0 +1,140 @@
+#include <gtest/gtest.h>
+
+#include <functional>
+
+#include "common/tl/constants/common.h"
+#include "common/tl/tls.h"
+#include "common/tlo-parsing/tlo-parser.h"
+
+#include "compiler/code-gen/common.h"
+#include "compiler/code-gen/files/tl2cpp/tl-combinator.h"
+
+namespace {
+
+constexpr int TL_POINT = 0x1a2b3c4d;
+
+// writes the combinators in the tlo format, as tl-compiler does
+class TloWriter {
+public:
+  explicit TloWriter(vk::tl::tlo_parser &parser) :
+    parser_(parser) {
+    parser_.pos = 0;
+    parser_.len = 0;
+  }
+
+  TloWriter &value(int32_t v) {
+    memcpy(parser_.data + parser_.len, &v, sizeof(v));
+    parser_.len += sizeof(v);
+    return *this;
+  }
+
+  TloWriter &str(const std::string &s) {
+    parser_.data[parser_.len++] = static_cast<char>(s.size());
+    memcpy(parser_.data + parser_.len, s.data(), s.size());
+    parser_.len += s.size();
+    while (parser_.len % 4) {
+      parser_.data[parser_.len++] = 0;
+    }
+    return *this;
+  }
+
+  TloWriter &type_expr(int type_id, int flags) {
+    return value(TL_TLS_TYPE_EXPR).value(type_id).value(flags).value(0);
+  }
+
+  // the flags of the tlo scheme v4: 2 means the var_num is set, 4 means the fields mask optional field
+  TloWriter &arg(const std::string &name, int type_id, int var_num = -1, int exist_var_num = -1, int exist_var_bit = 0) {
+    const int flags = (var_num >= 0 ? 2 : 0) | (exist_var_num >= 0 ? 4 : 0);
+    value(TL_TLS_ARG).str(name).value(flags);
+    if (var_num >= 0) {
+      value(var_num);
+    }
+    if (exist_var_num >= 0) {
+      value(exist_var_num).value(exist_var_bit);
+    }
+    return type_expr(type_id, type_id == static_cast<int>(vk::tl::TL_SHARP_ID) ? 0 : vk::tl::FLAG_BARE);
+  }
+
+private:
+  vk::tl::tlo_parser &parser_;
+};
+
+void add_type(vk::tl::tl_scheme &scheme, int id, const std::string &name, const std::string &constructor_name) {
+  auto type = std::make_unique<vk::tl::type>();
+  type->id = id;
+  type->name = name;
+  type->constructors_num = 1;
+  type->constructors.emplace_back(std::make_unique<vk::tl::combinator>());
+  type->constructors.back()->name = constructor_name;
+  type->constructors.back()->type_id = id;
+  scheme.types[id] = std::move(type);
+}
+
+std::string gen_code(const std::function<void(CodeGenerator &)> &gen) {
+  DataStream<WriterData> os{true};
+  CodeGenerator W{os};
+  W << OpenFile("tl-combinator-test.cpp", "", false, false);
+  gen(W);
+  W << CloseFile();
+
+  WriterData data;
+  EXPECT_TRUE(os.get(data));
+  std::string code;
+  data.dump(code);
+  return code;
+}
+
+} // namespace
+
+TEST(tl_combinator_test, test_fetch_args_span) {
+  auto parser = std::make_unique<vk::tl::tlo_parser>();
+  parser->tl_sch = std::make_unique<vk::tl::tl_scheme>();
+  parser->tl_sch->scheme_version = 4;
+  add_type(*parser->tl_sch, static_cast<int>(TL_INT), "Int", "int");
+  add_type(*parser->tl_sch, static_cast<int>(TL_LONG), "Long", "long");
+  add_type(*parser->tl_sch, static_cast<int>(TL_DOUBLE), "Double", "double");
+  add_type(*parser->tl_sch, static_cast<int>(vk::tl::TL_SHARP_ID), "#", "#");
+  add_type(*parser->tl_sch, TL_POINT, "Point", "point");
+
+  // point a:int b:long c:# d:double e:c.0?int = Point
+  TloWriter{*parser}
+    .value(TL_POINT).str("point").value(TL_POINT)
+    .value(TL_TLS_COMBINATOR_LEFT).value(5)
+    .arg("a", TL_INT)
+    .arg("b", TL_LONG)
+    .arg("c", vk::tl::TL_SHARP_ID, 0)
+    .arg("d", TL_DOUBLE)
+    .arg("e", TL_INT, -1, 0, 0)
+    .value(TL_TLS_COMBINATOR_RIGHT).type_expr(TL_POINT, 0)
+    .value(0);
+  const vk::tl::combinator point{parser.get(), vk::tl::combinator::combinator_type::CONSTRUCTOR};
+  tl2cpp::tl = parser->tl_sch.get();
+
+  const tl2cpp::CombinatorFetch typed_fetch{&point, tl2cpp::CombinatorPart::LEFT, true};
+  size_t processed_args = 0;
+  const std::string code = gen_code([&](CodeGenerator &W) { processed_args = typed_fetch.gen_args_span_processing(W, 0); });
+  ASSERT_EQ(processed_args, 4);
+  // the fields are loaded from a single checked span and the fields mask is saved for 'e'
+  ASSERT_EQ(code,
+            "if (const int32_t *tl_span = tl_fetch_fixed_size_span(6)) {\n"
+            "  tl_object->$a = tl_load_from_span<int32_t>(tl_span);\n"
+            "  tl_object->$b = tl_load_from_span<int64_t>(tl_span + 1);\n"
+            "  tl_object->$c = tl_load_from_span<int32_t>(tl_span + 3);\n"
+            "  tl_object->$d = tl_load_from_span<double>(tl_span + 4);\n"
+            "}\n"
+            "c = tl_object->$c;\n"
+            "\n");
+
+  // a single fixed size field and the fields mask optional ones are fetched as usual
+  ASSERT_EQ(gen_code([&](CodeGenerator &W) { processed_args = typed_fetch.gen_args_span_processing(W, 3); }), "\n");
+  ASSERT_EQ(processed_args, 0);
+  ASSERT_EQ(gen_code([&](CodeGenerator &W) { processed_args = typed_fetch.gen_args_span_processing(W, 4); }), "\n");
+  ASSERT_EQ(processed_args, 0);
+
+  // the untyped fetching builds the mixed array by the fields
+  const tl2cpp::CombinatorFetch untyped_fetch{&point, tl2cpp::CombinatorPart::LEFT, false};
+  ASSERT_EQ(gen_code([&](CodeGenerator &W) { processed_args = untyped_fetch.gen_args_span_processing(W, 0); }), "\n");
+  ASSERT_EQ(processed_args, 0);
+
+  tl2cpp::tl = nullptr;
+}
@@ -0,0 +1,30 @@
+#include <array>
+#include <benchmark/benchmark.h>
+
+#include "runtime/interface.h"
+#include "server/php-engine-vars.h"
+
+// The runtime benchmarks work with the script memory, so the environment is set up the same way as for the runtime tests
+int main(int argc, char **argv) {
+  pid = 0;
+  logname_id = 0;
+  workers_n = 1;
+
+  global_init_runtime_libs();
+  global_init_script_allocator();
+
+  static std::array<uint8_t, 512 * 1024 * 1024> memory;
+  init_runtime_environment(nullptr, memory.data(), memory.size());
+
+  php_disable_warnings = true;
+  php_warning_level = 0;
+
+  benchmark::Initialize(&argc, argv);
+  if (benchmark::ReportUnrecognizedArguments(argc, argv)) {
+    return 1;
+  }
+  benchmark::RunSpecifiedBenchmarks();
+
+  free_runtime_environment();
+  return 0;
+}
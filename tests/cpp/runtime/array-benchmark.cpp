@@ -0,0 +1,101 @@
+#include <benchmark/benchmark.h>
+
+#include <random>
+#include <vector>
+
+#include "runtime/kphp_core.h"
+
+namespace {
+
+std::vector<string> make_string_keys(int64_t count, uint32_t seed) {
+  std::mt19937 gen{seed};
+  std::uniform_int_distribution<int> len_dist{6, 32};
+  std::uniform_int_distribution<int> char_dist{'a', 'z'};
+  std::vector<string> keys;
+  keys.reserve(count);
+  for (int64_t i = 0; i < count; ++i) {
+    string key{static_cast<string::size_type>(len_dist(gen)), false};
+    for (string::size_type j = 0; j < key.size(); ++j) {
+      key[j] = static_cast<char>(char_dist(gen));
+    }
+    keys.emplace_back(std::move(key));
+  }
+  return keys;
+}
+
+std::vector<int64_t> make_int_keys(int64_t count, uint32_t seed) {
+  std::mt19937_64 gen{seed};
+  std::vector<int64_t> keys(count);
+  for (auto &key : keys) {
+    key = static_cast<int64_t>(gen() >> 16);
+  }
+  return keys;
+}
+
+template<class Key>
+array<int64_t> make_map(const std::vector<Key> &keys) {
+  array<int64_t> arr;
+  for (size_t i = 0; i < keys.size(); ++i) {
+    arr.set_value(keys[i], static_cast<int64_t>(i));
+  }
+  return arr;
+}
+
+template<class Key>
+void run_lookup_benchmark(benchmark::State &state, const std::vector<Key> &keys, const std::vector<Key> &lookups) {
+  const auto arr = make_map(keys);
+  size_t i = 0;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(arr.find_value(lookups[i]));
+    if (++i == lookups.size()) {
+      i = 0;
+    }
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+
+} // namespace
+
+static void BM_array_string_key_hit(benchmark::State &state) {
+  const auto keys = make_string_keys(state.range(0), 1);
+  run_lookup_benchmark(state, keys, keys);
+}
+BENCHMARK(BM_array_string_key_hit)->Range(1 << 8, 1 << 20);
+
+static void BM_array_string_key_miss(benchmark::State &state) {
+  run_lookup_benchmark(state, make_string_keys(state.range(0), 1), make_string_keys(state.range(0), 2));
+}
+BENCHMARK(BM_array_string_key_miss)->Range(1 << 8, 1 << 20);
+
+static void BM_array_int_key_hit(benchmark::State &state) {
+  const auto keys = make_int_keys(state.range(0), 1);
+  run_lookup_benchmark(state, keys, keys);
+}
+BENCHMARK(BM_array_int_key_hit)->Range(1 << 8, 1 << 20);
+
+static void BM_array_int_key_miss(benchmark::State &state) {
+  run_lookup_benchmark(state, make_int_keys(state.range(0), 1), make_int_keys(state.range(0), 2));
+}
+BENCHMARK(BM_array_int_key_miss)->Range(1 << 8, 1 << 20);
+
+static void BM_array_string_key_insert(benchmark::State &state) {
+  const auto keys = make_string_keys(state.range(0), 1);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(make_map(keys));
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_array_string_key_insert)->Range(1 << 8, 1 << 16);
+
+static void BM_array_string_key_unset(benchmark::State &state) {
+  const auto keys = make_string_keys(state.range(0), 1);
+  for (auto _ : state) {
+    auto arr = make_map(keys);
+    for (const auto &key : keys) {
+      arr.unset(key);
+    }
+    benchmark::DoNotOptimize(arr);
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_array_string_key_unset)->Range(1 << 8, 1 << 16);
@@ -0,0 +1,49 @@
+#include <gtest/gtest.h>
+
+#include "runtime/array_functions.h"
+
+TEST(array_functions_test, test_numeric_vector_search) {
+  auto ints = array<int64_t>::create(5, 7, -3, 7, 0);
+  ASSERT_TRUE(ints.is_vector());
+  ASSERT_TRUE(f$in_array(int64_t{-3}, ints));
+  ASSERT_FALSE(f$in_array(int64_t{4}, ints, true));
+  ASSERT_TRUE(equals(f$array_search(int64_t{7}, ints), mixed{1}));
+  ASSERT_TRUE(equals(f$array_search(int64_t{4}, ints), mixed{false}));
+
+  auto doubles = array<double>::create(0.5, -0.0, 2.5, 0.5);
+  ASSERT_TRUE(doubles.is_vector());
+  ASSERT_TRUE(f$in_array(0.0, doubles));
+  ASSERT_TRUE(equals(f$array_search(0.5, doubles, true), mixed{0}));
+  ASSERT_TRUE(equals(f$array_search(std::numeric_limits<double>::quiet_NaN(), doubles), mixed{false}));
+
+  array<int64_t> map;
+  map.set_value(string{"a"}, 3);
+  map.set_value(10, 7);
+  ASSERT_FALSE(map.is_vector());
+  ASSERT_TRUE(equals(f$array_search(int64_t{7}, map), mixed{10}));
+  ASSERT_TRUE(equals(f$array_search(int64_t{3}, map), mixed{string{"a"}}));
+  ASSERT_FALSE(f$in_array(int64_t{5}, map));
+}
+
+TEST(array_functions_test, test_numeric_vector_reduce) {
+  array<int64_t> ints;
+  for (int64_t i = 0; i < 100; ++i) {
+    ints.push_back((i * 37) % 101 - 50);
+  }
+  ASSERT_TRUE(ints.is_vector());
+  int64_t sum = 0;
+  for (const auto &it : ints) {
+    sum += it.get_value();
+  }
+  ASSERT_EQ(f$array_sum(ints), sum);
+  ASSERT_EQ(f$min(ints), -50);
+  ASSERT_EQ(f$max(ints), 50);
+
+  auto doubles = array<double>::create(3.0, 0.0, 1.0, -0.0, 2.0, 5.0, 4.0, 0.0, 6.0);
+  ASSERT_FALSE(std::signbit(f$min(doubles)));
+  ASSERT_EQ(f$max(doubles), 6.0);
+  // NaN is neither less nor greater, so the result depends on its position
+  const double nan = std::numeric_limits<double>::quiet_NaN();
+  ASSERT_EQ(f$max(array<double>::create(1.0, nan, 2.0, 3.0, 4.0, 5.0)), 5.0);
+  ASSERT_TRUE(std::isnan(f$max(array<double>::create(nan, 1.0, 2.0, 3.0, 4.0, 5.0))));
+}
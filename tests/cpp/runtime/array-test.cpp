@@ -1,3 +1,7 @@
+#include <algorithm>
+#include <random>
+#include <vector>
+
 #include <gtest/gtest.h>
 
 #include "runtime/kphp_core.h"
@@ -132,3 +136,76 @@ TEST(array_test, test_mutate_shared_map) {
   ASSERT_EQ(arr_copy.get_reference_counter(), 1);
   ASSERT_FALSE(arr_copy.is_equal_inner_pointer(arr));
 }
+
+namespace {
+
+template<class Key>
+void check_map_matches(const array<int64_t> &arr, const std::vector<std::pair<Key, int64_t>> &expected) {
+  ASSERT_EQ(arr.count(), expected.size());
+  auto expected_it = expected.begin();
+  for (auto it = arr.begin(); it != arr.end(); ++it, ++expected_it) {
+    ASSERT_TRUE(equals(it.get_key(), mixed{expected_it->first}));
+    ASSERT_EQ(it.get_value(), expected_it->second);
+    const int64_t *found = arr.find_value(expected_it->first);
+    ASSERT_NE(found, nullptr);
+    ASSERT_EQ(*found, expected_it->second);
+  }
+}
+
+template<class Key, class MakeKey>
+void test_random_map_operations(const MakeKey &make_key) {
+  std::mt19937 gen{7};
+  std::vector<std::pair<Key, int64_t>> expected;
+  array<int64_t> arr;
+  for (int64_t i = 0; i < 30000; ++i) {
+    // few distinct keys, so that the tables get both long probe sequences and lots of deletions
+    const Key key = make_key(gen() % 700);
+    auto expected_it = std::find_if(expected.begin(), expected.end(), [&key](const auto &p) { return p.first == key; });
+    if (gen() % 3 == 0) {
+      arr.unset(key);
+      if (expected_it != expected.end()) {
+        expected.erase(expected_it);
+      }
+      ASSERT_EQ(arr.find_value(key), nullptr);
+    } else {
+      arr.set_value(key, i);
+      if (expected_it != expected.end()) {
+        expected_it->second = i;
+      } else {
+        expected.emplace_back(key, i);
+      }
+    }
+    if (i % 1000 == 0) {
+      check_map_matches(arr, expected);
+    }
+  }
+  check_map_matches(arr, expected);
+}
+
+} // namespace
+
+TEST(array_test, test_map_int_keys_match_reference) {
+  // keys sharing the low bits get the same buckets
+  test_random_map_operations<int64_t>([](uint32_t k) { return (static_cast<int64_t>(k) << 20) - 1000; });
+}
+
+TEST(array_test, test_map_string_keys_match_reference) {
+  test_random_map_operations<string>([](uint32_t k) { return string{"key_"}.append(static_cast<int64_t>(k)); });
+}
+
+TEST(array_test, test_tiny_map_unset_and_insert) {
+  array<int64_t> arr;
+  arr.set_value(string{"a"}, 1);
+  arr.set_value(5, 2);
+  for (int64_t i = 0; i < 100; ++i) {
+    arr.unset(string{"a"});
+    ASSERT_EQ(arr.find_value(string{"a"}), nullptr);
+    arr.set_value(string{"a"}, i);
+    arr.unset(5);
+    ASSERT_EQ(arr.find_value(5), nullptr);
+    arr.set_value(5, i + 1);
+    ASSERT_EQ(*arr.find_value(string{"a"}), i);
+    ASSERT_EQ(*arr.find_value(5), i + 1);
+  }
+  ASSERT_EQ(arr.count(), 2);
+}
@@ -128,3 +128,27 @@ TEST(confdata_functions_test, test_confdata_get_values_by_bad_wildcard) {
     ASSERT_EQ(f$confdata_get_values_by_any_wildcard(string{bad_wildcard}).count(), 0);
   }
 }
+
+TEST(confdata_functions_test, test_confdata_section_index) {
+  std::vector<char> buffer(1024 * 1024);
+  memory_resource::unsynchronized_pool_resource resource;
+  resource.init(buffer.data(), buffer.size());
+
+  confdata_sample_storage confdata{confdata_sample_storage::allocator_type{resource}};
+  for (int64_t i = 0; i < 1000; ++i) {
+    confdata.emplace(string{"section_"}.append(i), mixed{i});
+  }
+  ConfdataSectionIndex section_index;
+  section_index.build(confdata, resource);
+  for (int64_t i = 0; i < 1000; ++i) {
+    const auto *section = section_index.find(string{"section_"}.append(i));
+    ASSERT_NE(section, nullptr);
+    ASSERT_TRUE(equals(section->second, i));
+  }
+  for (auto unknown_key : {"", "section_", "section_1000", "section_01"}) {
+    ASSERT_EQ(section_index.find(string{unknown_key}), nullptr);
+  }
+
+  section_index.clear(resource);
+  ASSERT_EQ(section_index.find(string{"section_1"}), nullptr);
+}
@@ -0,0 +1,46 @@
+#include <gtest/gtest.h>
+
+#include "runtime/global_vars_block.h"
+
+namespace {
+
+int64_t first_block_resets = 0;
+int64_t second_block_resets = 0;
+
+int64_t reset_first_block() {
+  ++first_block_resets;
+  return 2;
+}
+
+int64_t reset_second_block() {
+  ++second_block_resets;
+  return 3;
+}
+
+} // namespace
+
+TEST(global_vars_block_test, test_reset_only_dirty) {
+  GlobalVarsBlock *dirty_blocks = nullptr;
+  GlobalVarsBlock first{dirty_blocks, reset_first_block};
+  GlobalVarsBlock second{dirty_blocks, reset_second_block};
+
+  GlobalVarsBlock::clear_reset_vars_count();
+  GlobalVarsBlock::reset_dirty(dirty_blocks);
+  ASSERT_EQ(first_block_resets, 1);
+  ASSERT_EQ(second_block_resets, 1);
+  ASSERT_EQ(GlobalVarsBlock::get_reset_vars_count(), 5);
+  ASSERT_EQ(dirty_blocks, nullptr);
+
+  GlobalVarsBlock::clear_reset_vars_count();
+  GlobalVarsBlock::reset_dirty(dirty_blocks);
+  ASSERT_EQ(GlobalVarsBlock::get_reset_vars_count(), 0);
+
+  second.mark_dirty(dirty_blocks);
+  second.mark_dirty(dirty_blocks);
+  GlobalVarsBlock::clear_reset_vars_count();
+  GlobalVarsBlock::add_reset_vars_count(7);
+  GlobalVarsBlock::reset_dirty(dirty_blocks);
+  ASSERT_EQ(first_block_resets, 1);
+  ASSERT_EQ(second_block_resets, 2);
+  ASSERT_EQ(f$get_global_vars_reset_count(), 10);
+}
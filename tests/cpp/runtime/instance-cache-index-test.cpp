@@ -0,0 +1,223 @@
+#include <gtest/gtest.h>
+#include <memory>
+#include <vector>
+
+#include "runtime/instance_cache_index.h"
+
+namespace {
+
+using namespace ic_impl_;
+
+struct ElementStub {
+  explicit ElementStub(int i) :
+    key(string{"key_"}.append(i)) {
+  }
+
+  void destroy() noexcept {
+    destroyed = true;
+  }
+
+  string key;
+  bool destroyed{false};
+  std::atomic<ElementStub *> next_in_garbage_list{nullptr};
+};
+
+using TableStub = IndexTable<ElementStub>;
+
+// plays the CacheContext role for the index and the allocator role for its tables
+struct IndexEnvironment {
+  void *prepare_raw_memory(size_t size) noexcept {
+    tables_memory.emplace_back(new uint8_t[size]);
+    return tables_memory.back().get();
+  }
+
+  void move_to_garbage(TableStub *table) noexcept {
+    garbage.add(table);
+  }
+
+  void clear_garbage() noexcept {
+    garbage.collect(readers, [this](TableStub *table) {
+      table->~TableStub();
+      ++tables_destroyed;
+    });
+  }
+
+  ElementStub *insert(ElementStub &element) noexcept {
+    ElementStub *replaced = nullptr;
+    EXPECT_TRUE(index.insert_or_replace(hash_of(element), &element, replaced, *this, *this));
+    return replaced;
+  }
+
+  ElementStub *find(const ElementStub &element) const noexcept {
+    return index.find(element.key, hash_of(element));
+  }
+
+  // the removed element goes to the garbage, as ElementHolder::release() does with the last reference
+  bool remove(const ElementStub &element) noexcept {
+    bool removed = false;
+    index.for_each_slot([this, &element, &removed](TableStub::Slot &slot) {
+      if (slot.element.load() == &element) {
+        garbage.add(index.remove(slot));
+        removed = true;
+      }
+    });
+    return removed;
+  }
+
+  static uint64_t hash_of(const ElementStub &element) noexcept {
+    return ElementsIndex<ElementStub>::hash_of(element.key);
+  }
+
+  ReadersEpochs readers;
+  EpochGarbage<ElementStub> garbage;
+  ElementsIndex<ElementStub> index;
+  std::vector<std::unique_ptr<uint8_t[]>> tables_memory;
+  size_t tables_destroyed{0};
+};
+
+// the epochs are announced in the slots of logname_id
+class WorkerGuard {
+public:
+  explicit WorkerGuard(int worker_logname_id) :
+    prev_logname_id_(logname_id) {
+    logname_id = worker_logname_id;
+  }
+
+  ~WorkerGuard() {
+    logname_id = prev_logname_id_;
+  }
+
+private:
+  const int prev_logname_id_;
+};
+
+void enter_as(ReadersEpochs &readers, int worker_logname_id) {
+  WorkerGuard worker{worker_logname_id};
+  readers.enter();
+}
+
+void leave_as(ReadersEpochs &readers, int worker_logname_id) {
+  WorkerGuard worker{worker_logname_id};
+  readers.leave();
+}
+
+} // namespace
+
+TEST(instance_cache_index_test, test_insert_find_remove_while_epoch_is_held) {
+  IndexEnvironment env;
+  std::vector<std::unique_ptr<ElementStub>> elements;
+  for (int i = 0; i != 100; ++i) {
+    elements.emplace_back(new ElementStub{i});
+  }
+
+  enter_as(env.readers, 1);
+  for (auto &element : elements) {
+    ASSERT_EQ(env.insert(*element), nullptr);
+  }
+  ASSERT_FALSE(env.index.empty());
+  for (auto &element : elements) {
+    ASSERT_EQ(env.find(*element), element.get());
+  }
+  ElementStub absent{100};
+  ASSERT_EQ(env.find(absent), nullptr);
+
+  // the index has grown several times, but the reader could be still probing the old tables
+  ASSERT_GT(env.tables_memory.size(), 1u);
+  env.clear_garbage();
+  ASSERT_EQ(env.tables_destroyed, 0u);
+
+  for (size_t i = 0; i < elements.size(); i += 2) {
+    ASSERT_TRUE(env.remove(*elements[i]));
+    ASSERT_FALSE(env.remove(*elements[i]));
+  }
+  for (size_t i = 0; i != elements.size(); ++i) {
+    ASSERT_EQ(env.find(*elements[i]), i % 2 ? elements[i].get() : nullptr);
+  }
+
+  // the removed slots are reused
+  const size_t tables_allocated = env.tables_memory.size();
+  std::vector<std::unique_ptr<ElementStub>> reinserted;
+  for (size_t i = 0; i < elements.size(); i += 2) {
+    reinserted.emplace_back(new ElementStub{static_cast<int>(i)});
+    ASSERT_EQ(env.insert(*reinserted.back()), nullptr);
+    ASSERT_EQ(env.find(*elements[i]), reinserted.back().get());
+  }
+  ASSERT_EQ(env.tables_memory.size(), tables_allocated);
+
+  // the replaced element is returned to the caller
+  ElementStub replacement{1};
+  ASSERT_EQ(env.insert(replacement), elements[1].get());
+  ASSERT_EQ(env.find(*elements[1]), &replacement);
+
+  env.clear_garbage();
+  for (auto &element : elements) {
+    ASSERT_FALSE(element->destroyed);
+  }
+  ASSERT_EQ(env.tables_destroyed, 0u);
+
+  leave_as(env.readers, 1);
+  env.clear_garbage();
+  for (size_t i = 0; i != elements.size(); ++i) {
+    ASSERT_EQ(elements[i]->destroyed, i % 2 == 0);
+  }
+  ASSERT_EQ(env.tables_destroyed, env.tables_memory.size() - 1);
+  ASSERT_TRUE(env.garbage.empty());
+}
+
+TEST(instance_cache_index_test, test_element_is_destroyed_after_all_readers) {
+  IndexEnvironment env;
+  ElementStub element{1};
+  ElementStub other{2};
+  env.insert(element);
+  env.insert(other);
+
+  enter_as(env.readers, 1);
+  enter_as(env.readers, 2);
+  ASSERT_TRUE(env.remove(element));
+  env.clear_garbage();
+  ASSERT_FALSE(element.destroyed);
+  ASSERT_FALSE(env.garbage.empty());
+
+  // the readers entered after the removal don't see the element and don't hold it
+  enter_as(env.readers, 3);
+  ASSERT_EQ(env.find(element), nullptr);
+  ASSERT_EQ(env.find(other), &other);
+
+  leave_as(env.readers, 1);
+  env.clear_garbage();
+  ASSERT_FALSE(element.destroyed);
+
+  // the reader has moved to the next epoch
+  leave_as(env.readers, 2);
+  enter_as(env.readers, 2);
+  env.clear_garbage();
+  ASSERT_TRUE(element.destroyed);
+  ASSERT_FALSE(other.destroyed);
+  ASSERT_TRUE(env.garbage.empty());
+
+  leave_as(env.readers, 2);
+  leave_as(env.readers, 3);
+}
+
+TEST(instance_cache_index_test, test_killed_worker_epoch) {
+  IndexEnvironment env;
+  ElementStub element{1};
+  env.insert(element);
+
+  // the worker is killed inside the lock-free fetch
+  enter_as(env.readers, 5);
+  ASSERT_TRUE(env.remove(element));
+  for (int i = 0; i != 3; ++i) {
+    env.clear_garbage();
+    ASSERT_FALSE(element.destroyed);
+  }
+
+  // the next worker with the same logname_id clears the slot on its start
+  {
+    WorkerGuard worker{5};
+    env.readers.force_leave();
+  }
+  env.clear_garbage();
+  ASSERT_TRUE(element.destroyed);
+  ASSERT_TRUE(env.garbage.empty());
+}
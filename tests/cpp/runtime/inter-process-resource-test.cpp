@@ -1,3 +1,5 @@
+#include <vector>
+
 #include <gtest/gtest.h>
 
 #include "runtime/inter-process-resource.h"
@@ -223,3 +225,66 @@ TEST(inter_process_resource_manager_test, acquire_force_release_clear_scenario)
   ASSERT_EQ(r21->value, 0);
   ASSERT_EQ(r22->value, 0);
 }
+
+TEST(inter_process_resource_manager_test, switch_to_any_clean_resource_scenario) {
+  set_pid_and_user_id(1);
+
+  InterProcessResourceManager<ResourceStub, 3> resource_manager;
+  resource_manager.init(111);
+
+  set_pid_and_user_id(2);
+  auto *r111 = resource_manager.acquire_current_resource();
+  ASSERT_EQ(r111->value, 111);
+
+  set_pid_and_user_id(1);
+  ASSERT_TRUE(resource_manager.has_clean_inactive_resource());
+  ASSERT_TRUE(resource_manager.try_switch_to_any_clean_resource(222));
+  ASSERT_TRUE(resource_manager.try_switch_to_any_clean_resource(333));
+  ASSERT_FALSE(resource_manager.has_clean_inactive_resource());
+  ASSERT_FALSE(resource_manager.try_switch_to_any_clean_resource(444));
+
+  // the resource held by the worker is skipped, the released one is reused
+  resource_manager.clear_dirty_unused_resources();
+  ASSERT_EQ(r111->value, 111);
+  std::vector<int> dirty_values;
+  resource_manager.for_each_dirty_resource([&dirty_values](const ResourceStub &resource) {
+    dirty_values.push_back(resource.value);
+  });
+  ASSERT_EQ(dirty_values, std::vector<int>{111});
+  ASSERT_TRUE(resource_manager.try_switch_to_any_clean_resource(444));
+  ASSERT_EQ(resource_manager.get_current_resource().value, 444);
+  resource_manager.clear_dirty_unused_resources();
+  ASSERT_TRUE(resource_manager.try_switch_to_any_clean_resource(555));
+  ASSERT_EQ(resource_manager.get_current_resource().value, 555);
+  ASSERT_EQ(r111->value, 111);
+
+  set_pid_and_user_id(2);
+  resource_manager.release_resource(r111);
+
+  set_pid_and_user_id(1);
+  resource_manager.clear_dirty_unused_resources();
+  ASSERT_EQ(r111->value, 0);
+}
+
+TEST(inter_process_resource_manager_test, hold_release_clear_scenario) {
+  set_pid_and_user_id(1);
+
+  InterProcessResourceManager<ResourceStub, 3> resource_manager;
+  resource_manager.init(111);
+
+  const auto *held = resource_manager.hold_current_resource();
+  ASSERT_EQ(held->value, 111);
+  ASSERT_TRUE(resource_manager.try_switch_to_any_clean_resource(222));
+
+  // the held resource isn't used by the workers, but it is kept
+  resource_manager.clear_dirty_unused_resources();
+  resource_manager.clear_dirty_unused_resources_in_sequence();
+  ASSERT_EQ(held->value, 111);
+  ASSERT_TRUE(resource_manager.try_switch_to_any_clean_resource(333));
+  ASSERT_FALSE(resource_manager.has_clean_inactive_resource());
+
+  resource_manager.release_held_resource(held);
+  resource_manager.clear_dirty_unused_resources();
+  ASSERT_EQ(held->value, 0);
+  ASSERT_TRUE(resource_manager.has_clean_inactive_resource());
+}
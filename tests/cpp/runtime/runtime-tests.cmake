@@ -1,11 +1,15 @@
 prepend(RUNTIME_TESTS_SOURCES ${BASE_DIR}/tests/cpp/runtime/
+        _runtime-linkage-stubs.cpp
         _runtime-tests-env.cpp
         allocator-malloc-replacement-test.cpp
+        array-functions-test.cpp
         array-test.cpp
         common-php-functions-test.cpp
         confdata-functions-test.cpp
         confdata-key-maker-test.cpp
         confdata-predefined-wildcards-test.cpp
+        global-vars-block-test.cpp
+        instance-cache-index-test.cpp
         inter-process-mutex-test.cpp
         inter-process-resource-test.cpp
         memory_resource/details/memory_chunk_list-test.cpp
@@ -15,3 +19,13 @@ prepend(RUNTIME_TESTS_SOURCES ${BASE_DIR}/tests/cpp/runtime/
         string-test.cpp)
 
 vk_add_unittest(runtime "${RUNTIME_LIBS};${RUNTIME_LINK_TEST_LIBS}" ${RUNTIME_TESTS_SOURCES})
+
+function(vk_add_runtime_benchmark BENCHMARK_NAME)
+    vk_add_benchmark(runtime-${BENCHMARK_NAME} "${RUNTIME_LIBS};${RUNTIME_LINK_TEST_LIBS}"
+                     ${BASE_DIR}/tests/cpp/runtime/_runtime-linkage-stubs.cpp
+                     ${BASE_DIR}/tests/cpp/runtime/_runtime-benchmarks-env.cpp
+                     ${ARGN})
+endfunction()
+
+vk_add_runtime_benchmark(array ${BASE_DIR}/tests/cpp/runtime/array-benchmark.cpp)
+vk_add_runtime_benchmark(tl-fetch ${BASE_DIR}/tests/cpp/runtime/tl-fetch-benchmark.cpp)
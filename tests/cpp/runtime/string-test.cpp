@@ -65,6 +65,57 @@ TEST(string_test, test_copy_and_make_not_shared) {
   ASSERT_EQ(str3.get_reference_counter(), 1);
 }
 
+TEST(string_test, test_hash_after_modifications) {
+  string str{"hello world"};
+  ASSERT_EQ(str.hash(), string_hash("hello world", 11));
+
+  str.append("!!");
+  ASSERT_EQ(str.hash(), string_hash("hello world!!", 13));
+
+  str[0] = 'H';
+  ASSERT_EQ(str.hash(), string_hash("Hello world!!", 13));
+
+  str.buffer()[1] = 'E';
+  ASSERT_EQ(str.hash(), string_hash("HEllo world!!", 13));
+
+  str.shrink(5);
+  ASSERT_EQ(str.hash(), string_hash("HEllo", 5));
+
+  str.reserve_at_least(10).append_unsafe("123", 3).finish_append();
+  ASSERT_EQ(str.hash(), string_hash("HEllo123", 8));
+
+  const string copy = str;
+  str.push_back('4');
+  ASSERT_EQ(copy.hash(), string_hash("HEllo123", 8));
+  ASSERT_EQ(str.hash(), string_hash("HEllo1234", 9));
+
+  char mem[1024];
+  auto const_str = string::make_const_string_on_memory("hello", 5, mem, sizeof(mem));
+  ASSERT_EQ(const_str.hash(), string_hash("hello", 5));
+  ASSERT_EQ(string{}.hash(), string_hash("", 0));
+  ASSERT_EQ(string{"7"}.hash(), string_hash("7", 1));
+}
+
+TEST(string_test, test_short_strings_are_not_allocated) {
+  const char *chars = "ab\xff";
+  for (string::size_type len = 0; len <= 2; ++len) {
+    string str{chars + 1, len};
+    ASSERT_TRUE(str.is_reference_counter(ExtraRefCnt::for_global_const));
+    ASSERT_EQ(str.size(), len);
+    ASSERT_EQ(std::memcmp(str.c_str(), chars + 1, len), 0);
+    ASSERT_EQ(str.c_str()[len], '\0');
+    ASSERT_EQ(str.hash(), string_hash(chars + 1, len));
+    ASSERT_EQ(string(chars + 1, len).c_str(), str.c_str());
+  }
+
+  string str{"ab"};
+  str.append("c");
+  ASSERT_EQ(str, string{"abc"});
+  ASSERT_EQ(str.get_reference_counter(), 1);
+  ASSERT_EQ(string{"ab"}, string{"ab"});
+  ASSERT_STREQ(string{"ab"}.c_str(), "ab");
+}
+
 TEST(string_test, test_hex_to_int) {
   for (size_t c = 0; c != 256; ++c) {
     if (vk::none_of_equal(c,
@@ -0,0 +1,156 @@
+#include <benchmark/benchmark.h>
+
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "runtime/tl/tl_builtins.h"
+// completes the types tl_builtins.h refers to
+#include "runtime/tl/rpc_request.h"
+
+namespace {
+
+using t_Long = tl_Long_impl<true>;
+
+// a typed response of RECORDS constructors like 'point x:int y:int id:long weight:double = Point'
+constexpr int64_t RECORDS = 1000;
+constexpr int32_t RECORD_X4_SIZE = 6;
+
+struct point {
+  int64_t x{0};
+  int64_t y{0};
+  int64_t id{0};
+  double weight{0};
+};
+
+std::vector<int32_t> make_points_response() {
+  std::mt19937 gen{42};
+  std::vector<int32_t> data;
+  for (int64_t i = 0; i < RECORDS; ++i) {
+    const int64_t id = static_cast<int64_t>(gen()) << 20;
+    const double weight = gen() / 1000.0;
+    data.push_back(static_cast<int32_t>(gen()));
+    data.push_back(static_cast<int32_t>(gen()));
+    data.resize(data.size() + 4);
+    std::memcpy(data.data() + data.size() - 4, &id, sizeof(id));
+    std::memcpy(data.data() + data.size() - 2, &weight, sizeof(weight));
+  }
+  return data;
+}
+
+// a response of 'vector n:# elems:n*[T]' with the bare elements
+template<class T>
+std::vector<int32_t> make_vector_response(int64_t n) {
+  std::mt19937 gen{42};
+  std::vector<int32_t> data{static_cast<int32_t>(n)};
+  for (int64_t i = 0; i < n; ++i) {
+    const auto value = static_cast<T>(gen());
+    data.resize(data.size() + sizeof(T) / sizeof(int32_t));
+    std::memcpy(data.data() + data.size() - sizeof(T) / sizeof(int32_t), &value, sizeof(value));
+  }
+  return data;
+}
+
+// the way the generated fetchers worked before: each element is fetched and checked separately
+template<class T>
+void fetch_vector_by_elements(array<typename T::PhpType> &out) {
+  const int32_t n = rpc_fetch_int();
+  out.reserve(n, 0, true);
+  for (int32_t i = 0; i < n; ++i) {
+    typename T::PhpType elem;
+    T().typed_fetch_to(elem);
+    out.push_back(std::move(elem));
+    CHECK_EXCEPTION(return);
+  }
+}
+
+template<class F>
+void run_fetch_benchmark(benchmark::State &state, const std::vector<int32_t> &data, int64_t items, const F &fetch) {
+  rpc_parse(data.data(), static_cast<int32_t>(data.size()));
+  for (auto _ : state) {
+    rpc_set_pos(0);
+    fetch();
+  }
+  rpc_parse_restore_previous();
+  state.SetItemsProcessed(state.iterations() * items);
+  state.SetBytesProcessed(state.iterations() * static_cast<int64_t>(data.size() * sizeof(int32_t)));
+}
+
+template<class T>
+void run_vector_benchmark(benchmark::State &state, bool by_elements) {
+  const auto data = make_vector_response<typename std::conditional<std::is_same<T, t_Int>{}, int32_t,
+    typename std::conditional<std::is_same<T, t_Long>{}, int64_t, double>::type>::type>(state.range(0));
+  run_fetch_benchmark(state, data, state.range(0), [by_elements] {
+    array<typename T::PhpType> out;
+    if (by_elements) {
+      fetch_vector_by_elements<T>(out);
+    } else {
+      t_Vector<T, 0>(T()).typed_fetch_to(out);
+    }
+    benchmark::DoNotOptimize(out);
+  });
+}
+
+} // namespace
+
+static void BM_tl_fetch_fields_one_by_one(benchmark::State &state) {
+  const auto data = make_points_response();
+  std::vector<point> points(RECORDS);
+  run_fetch_benchmark(state, data, RECORDS, [&points] {
+    for (auto &p : points) {
+      t_Int().typed_fetch_to(p.x);
+      t_Int().typed_fetch_to(p.y);
+      t_Long().typed_fetch_to(p.id);
+      t_Double().typed_fetch_to(p.weight);
+    }
+    benchmark::DoNotOptimize(points.data());
+  });
+}
+BENCHMARK(BM_tl_fetch_fields_one_by_one);
+
+static void BM_tl_fetch_fields_span(benchmark::State &state) {
+  const auto data = make_points_response();
+  std::vector<point> points(RECORDS);
+  run_fetch_benchmark(state, data, RECORDS, [&points] {
+    for (auto &p : points) {
+      if (const int32_t *tl_span = tl_fetch_fixed_size_span(RECORD_X4_SIZE)) {
+        p.x = tl_load_from_span<int32_t>(tl_span);
+        p.y = tl_load_from_span<int32_t>(tl_span + 1);
+        p.id = tl_load_from_span<int64_t>(tl_span + 2);
+        p.weight = tl_load_from_span<double>(tl_span + 4);
+      }
+    }
+    benchmark::DoNotOptimize(points.data());
+  });
+}
+BENCHMARK(BM_tl_fetch_fields_span);
+
+static void BM_tl_fetch_vector_int_by_elements(benchmark::State &state) {
+  run_vector_benchmark<t_Int>(state, true);
+}
+BENCHMARK(BM_tl_fetch_vector_int_by_elements)->Arg(16)->Arg(1024)->Arg(65536);
+
+static void BM_tl_fetch_vector_int_raw(benchmark::State &state) {
+  run_vector_benchmark<t_Int>(state, false);
+}
+BENCHMARK(BM_tl_fetch_vector_int_raw)->Arg(16)->Arg(1024)->Arg(65536);
+
+static void BM_tl_fetch_vector_long_by_elements(benchmark::State &state) {
+  run_vector_benchmark<t_Long>(state, true);
+}
+BENCHMARK(BM_tl_fetch_vector_long_by_elements)->Arg(16)->Arg(1024)->Arg(65536);
+
+static void BM_tl_fetch_vector_long_raw(benchmark::State &state) {
+  run_vector_benchmark<t_Long>(state, false);
+}
+BENCHMARK(BM_tl_fetch_vector_long_raw)->Arg(16)->Arg(1024)->Arg(65536);
+
+static void BM_tl_fetch_vector_double_by_elements(benchmark::State &state) {
+  run_vector_benchmark<t_Double>(state, true);
+}
+BENCHMARK(BM_tl_fetch_vector_double_by_elements)->Arg(16)->Arg(1024)->Arg(65536);
+
+static void BM_tl_fetch_vector_double_raw(benchmark::State &state) {
+  run_vector_benchmark<t_Double>(state, false);
+}
+BENCHMARK(BM_tl_fetch_vector_double_raw)->Arg(16)->Arg(1024)->Arg(65536);
@@ -0,0 +1,98 @@
+#include <fstream>
+#include <gtest/gtest.h>
+#include <unistd.h>
+#include <vector>
+
+#include "common/binlog/kdb-binlog-common.h"
+#include "common/kfs/kfs-replica.h"
+#include "common/kfs/kfs-snapshot.h"
+
+#include "runtime/allocator.h"
+#include "runtime/confdata-global-manager.h"
+#include "server/confdata-binlog-replay.h"
+
+namespace {
+
+confdata_sample_storage make_confdata(const confdata_sample_storage &empty_confdata) {
+  auto confdata = empty_confdata;
+  confdata[string{"_key_1"}] = string{"value_1"};
+  confdata[string{"_key_2"}] = array<mixed>{
+    std::make_pair(mixed{string{"x"}}, mixed{1}),
+    std::make_pair(mixed{string{"y"}}, mixed{string{"2"}})
+  };
+  confdata[string{"_key_3"}] = 42;
+  confdata[string{"_one dot."}] = array<mixed>{
+    std::make_pair(mixed{3}, mixed{string{"one_value_3"}}),
+    std::make_pair(mixed{string{"one_1"}}, mixed{string{"one_value_1"}}),
+    std::make_pair(mixed{string{"one_2"}}, mixed{string{"one_value_2"}})
+  };
+  return confdata;
+}
+
+} // namespace
+
+TEST(confdata_snapshot_test, test_write_and_load) {
+  pid = 0;
+  auto &global_manager = ConfdataGlobalManager::get();
+  global_manager.init(1024 * 1024 * 16, std::unordered_set<vk::string_view>{}, nullptr);
+  const auto confdata = make_confdata(global_manager.get_current().get_confdata());
+
+  char dir[] = "/tmp/confdata-snapshot-test.XXXXXX";
+  ASSERT_TRUE(mkdtemp(dir));
+  const std::string snapshot_path = std::string{dir} + "/confdata.000123";
+
+  const ConfdataSnapshotPosition position{123, 1000, 0xdeadbeef};
+  ASSERT_EQ(write_confdata_snapshot(snapshot_path.c_str(), confdata, position), 6);
+
+  kfs_replica_handle_t replica = open_replica((std::string{dir} + "/confdata").c_str(), 0);
+  ASSERT_TRUE(replica);
+  kfs_file_handle_t snapshot = open_recent_snapshot(replica);
+  ASSERT_TRUE(snapshot);
+
+  dl::set_current_script_allocator(global_manager.get_resource(), true);
+  const auto loaded_confdata = load_confdata_snapshot(snapshot);
+  dl::restore_default_script_allocator(true);
+
+  ASSERT_EQ(jump_log_pos, position.log_pos);
+  ASSERT_EQ(jump_log_ts, position.log_timestamp);
+  ASSERT_EQ(jump_log_crc32, position.log_pos_crc32);
+
+  ASSERT_EQ(loaded_confdata.size(), confdata.size());
+  for (auto expected = confdata.begin(), loaded = loaded_confdata.begin(); expected != confdata.end(); ++expected, ++loaded) {
+    ASSERT_EQ(loaded->first, expected->first);
+    ASSERT_TRUE(equals(loaded->second, expected->second)) << expected->first.c_str();
+  }
+
+  close_snapshot(snapshot, true);
+  close_replica(replica);
+  ASSERT_EQ(unlink(snapshot_path.c_str()), 0);
+  ASSERT_EQ(rmdir(dir), 0);
+}
+
+TEST(confdata_snapshot_test, test_remove_stale_snapshots) {
+  char dir[] = "/tmp/confdata-snapshot-test.XXXXXX";
+  ASSERT_TRUE(mkdtemp(dir));
+  const std::string prefix = std::string{dir} + "/confdata";
+  // the written snapshots, the unfinished ones and the files which aren't written by the snapshot writer
+  const std::vector<std::string> stale = {".000123", ".000999", ".0112345", ".000123.tmp", ".032345678.tmp"};
+  const std::vector<std::string> kept = {".031234567", ".bin", ".000100.bin", ".000100.diff"};
+  for (const auto &suffix : stale) {
+    ASSERT_TRUE(std::ofstream{prefix + suffix});
+  }
+  for (const auto &suffix : kept) {
+    ASSERT_TRUE(std::ofstream{prefix + suffix});
+  }
+
+  kfs_replica_handle_t replica = open_replica(prefix.c_str(), 0);
+  ASSERT_TRUE(replica);
+  ASSERT_EQ(remove_stale_confdata_snapshots(replica), prefix + ".031234567");
+  close_replica(replica);
+
+  for (const auto &suffix : stale) {
+    ASSERT_NE(access((prefix + suffix).c_str(), F_OK), 0) << suffix;
+  }
+  for (const auto &suffix : kept) {
+    ASSERT_EQ(unlink((prefix + suffix).c_str()), 0) << suffix;
+  }
+  ASSERT_EQ(rmdir(dir), 0);
+}
@@ -0,0 +1,34 @@
+@ok
+<?php
+require_once 'kphp_tester_include.php';
+
+#ifndef KPHP
+function curl_exec_concurrently($curl_handle) {
+  return curl_exec($curl_handle);
+}
+#endif
+
+/**
+ * @param int $port
+ * @return string
+ */
+function exec_refused($port) {
+  $c = curl_init("http://127.0.0.1:$port/");
+  curl_setopt($c, CURLOPT_RETURNTRANSFER, true);
+  $result = curl_exec_concurrently($c);
+  $errno = curl_errno($c);
+  curl_close($c);
+  return var_export($result, true) . " $errno";
+}
+
+function test_curl_exec_concurrently_in_forks() {
+  $ids = [];
+  foreach ([1, 2, 3] as $port) {
+    $ids[] = fork(exec_refused($port));
+  }
+  foreach ($ids as $id) {
+    var_dump(wait($id));
+  }
+}
+
+test_curl_exec_concurrently_in_forks();
@@ -0,0 +1,47 @@
+@ok
+<?php
+
+class Fetcher {
+  /** @var int */
+  private $port;
+
+  /**
+   * @param int $port
+   */
+  public function __construct($port) {
+    $this->port = $port;
+  }
+
+  /**
+   * @return int
+   */
+  public function fetch() {
+    $c = curl_init("http://127.0.0.1:{$this->port}/");
+    curl_setopt($c, CURLOPT_RETURNTRANSFER, true);
+    $result = curl_exec($c);
+    $errno = $result === false ? curl_errno($c) : 0;
+    curl_close($c);
+    return $errno;
+  }
+}
+
+// curl_exec is not resumable, so it can be called from the callbacks of the array functions
+function test_curl_exec_in_callbacks() {
+  var_dump(array_map(function (int $port) { return (new Fetcher($port))->fetch(); }, [1, 2]));
+
+  $ports = [3, 1, 2];
+  usort($ports, function (int $lhs, int $rhs) {
+    return ((new Fetcher($lhs))->fetch() - (new Fetcher($rhs))->fetch()) ?: $lhs - $rhs;
+  });
+  var_dump($ports);
+}
+
+function test_curl_exec_without_return_transfer() {
+  $c = curl_init("http://127.0.0.1:1/");
+  var_dump(curl_exec($c));
+  var_dump(curl_errno($c));
+  curl_close($c);
+}
+
+test_curl_exec_in_callbacks();
+test_curl_exec_without_return_transfer();
@@ -0,0 +1,82 @@
+@ok
+<?php
+require_once 'kphp_tester_include.php';
+
+#ifndef KPHP
+function curl_exec_concurrently($curl_handle) {
+  return curl_exec($curl_handle);
+}
+#endif
+
+/**
+ * @param int $port
+ * @return string
+ */
+function exec_concurrently_refused($port) {
+  $c = curl_init("http://127.0.0.1:$port/");
+  curl_setopt($c, CURLOPT_RETURNTRANSFER, true);
+  $result = curl_exec_concurrently($c);
+  $errno = curl_errno($c);
+  curl_close($c);
+  return var_export($result, true) . " $errno";
+}
+
+/**
+ * @param int[] $ports
+ * @return int[]
+ */
+function multi_exec_refused($ports) {
+  $mh = curl_multi_init();
+  $handles = [];
+  foreach ($ports as $port) {
+    $c = curl_init("http://127.0.0.1:$port/");
+    curl_setopt($c, CURLOPT_RETURNTRANSFER, true);
+    curl_multi_add_handle($mh, $c);
+    $handles[] = $c;
+  }
+
+  $still_running = 0;
+  do {
+    curl_multi_exec($mh, $still_running);
+    if ($still_running) {
+      curl_multi_select($mh, 0.1);
+    }
+  } while ($still_running);
+
+  $messages = 0;
+  while (curl_multi_info_read($mh) !== false) {
+    $messages++;
+  }
+  $results = [$messages];
+  foreach ($handles as $c) {
+    $results[] = curl_errno($c);
+    curl_multi_remove_handle($mh, $c);
+    curl_close($c);
+  }
+  curl_multi_close($mh);
+  return $results;
+}
+
+// the transfers of curl_exec_concurrently are driven by the socket and timer callbacks of its own multi handle,
+// while the script's multi handle and the synchronous curl_exec are used in the same request
+function test_curl_exec_concurrently_with_multi() {
+  $ids = [];
+  foreach ([1, 2] as $port) {
+    $ids[] = fork(exec_concurrently_refused($port));
+  }
+
+  var_dump(multi_exec_refused([3, 4, 5]));
+
+  $c = curl_init("http://127.0.0.1:6/");
+  curl_setopt($c, CURLOPT_RETURNTRANSFER, true);
+  var_dump(curl_exec($c));
+  var_dump(curl_errno($c));
+  curl_close($c);
+
+  foreach ($ids as $id) {
+    var_dump(wait($id));
+  }
+  var_dump(multi_exec_refused([1]));
+}
+
+test_curl_exec_concurrently_with_multi();
@@ -0,0 +1,50 @@
+@ok
+<?php
+require_once 'kphp_tester_include.php';
+
+/**
+ * @param int $x
+ * @return int
+ */
+function square($x) {
+  sched_yield();
+  return $x * $x;
+}
+
+/**
+ * @param int[] $ids
+ * @param int[] $order
+ * @return int
+ */
+function wait_in_order($ids, $order) {
+  $sum = 0;
+  foreach ($order as $i) {
+    $sum += wait($ids[$i]);
+  }
+  return $sum;
+}
+
+function test_many_forks() {
+  $ids = [];
+  for ($i = 0; $i < 1000; $i++) {
+    $ids[] = fork(square($i));
+  }
+  // the results are gotten out of order, so that the freed slots are scattered
+  $order = [];
+  for ($i = 0; $i < 1000; $i++) {
+    $order[] = $i * 7 % 1000;
+  }
+  var_dump(wait_in_order($ids, array_slice($order, 0, 500)));
+
+  for ($round = 0; $round < 3; $round++) {
+    $more_ids = [];
+    for ($i = 0; $i < 700; $i++) {
+      $more_ids[] = fork(square($i + $round));
+    }
+    var_dump(wait_in_order($more_ids, array_reverse(array_keys($more_ids))));
+  }
+
+  var_dump(wait_in_order($ids, array_slice($order, 500)));
+}
+
+test_many_forks();
@@ -21,12 +21,12 @@ function test_primitive_types() {
 function test_string() {
 #ifndef KPHP
   var_dump(0);
-  var_dump(24);
+  var_dump(32);
   var_dump(0);
-  var_dump(22);
+  var_dump(30);
   var_dump(0);
-  var_dump(22);
-  var_dump(44);
+  var_dump(30);
+  var_dump(60);
   return;
 #endif
   $x = "hello";
@@ -98,9 +98,9 @@ function test_get_global_vars_memory_stats() {
     "\$dynamic_array" => 72,
     "static_vars::\$dynamic_array" => 72,
     "ClassWithStaticVars::\$dynamic_array" => 72,
-    "ClassWithStaticVars::\$dynamic_string" => 19,
-    "\$dynamic_string" => 19,
-    "static_vars::\$dynamic_string" => 19
+    "ClassWithStaticVars::\$dynamic_string" => 27,
+    "\$dynamic_string" => 27,
+    "static_vars::\$dynamic_string" => 27
   ];
 
   $non_empty_vars = $greater_than_16;
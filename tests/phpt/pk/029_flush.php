@@ -0,0 +1,12 @@
+@ok
+<?php
+
+echo "before flush\n";
+flush();
+ob_start();
+echo "buffered\n";
+flush();
+echo ob_get_level() . " " . ob_get_length() . "\n";
+ob_end_flush();
+flush();
+echo "after flush\n";
@@ -10,6 +10,26 @@ if ($_SERVER["PHP_SELF"] === "/ini_get") {
   sleep($sleep_time);
   fwrite(STDERR, "wake up!");
   echo "after sleep";
+} else if ($_SERVER["PHP_SELF"] === "/flush") {
+  if (isset($_GET["gzip"])) {
+    ob_start("ob_gzhandler");
+  }
+  for ($i = 0; $i < 3; $i++) {
+    echo "part $i\n";
+    if (isset($_GET["gzip"])) {
+      ob_flush();
+    }
+    flush();
+  }
+  header("X-After-Flush: 1");
+  echo headers_sent() ? "headers sent" : "headers not sent";
+} else if ($_SERVER["PHP_SELF"] === "/gzip") {
+  ob_start("ob_gzhandler");
+  $body = str_repeat("compressed body\n", 100);
+  if (isset($_GET["content_length"])) {
+    header("Content-Length: " . strlen($body));
+  }
+  echo $body;
 }  else {
   echo "Hello world!";
 }
@@ -0,0 +1,25 @@
+import gzip
+
+from python.lib.testcase import KphpServerAutoTestCase
+
+
+class TestCompression(KphpServerAutoTestCase):
+    BODY = b"compressed body\n" * 100
+
+    def test_compressed_response(self):
+        response = self.kphp_server.http_request_raw([b"GET /gzip HTTP/1.1", b"Accept-Encoding: gzip"])
+        self.assertEqual(response.status_code, 200)
+        self.assertEqual(response.headers["Content-Encoding"], "gzip")
+        self.assertEqual(response.raw_bytes.count(b"\r\nContent-Length: "), 1)
+        self.assertEqual(response.headers["Content-Length"], str(len(response.content)))
+        self.assertEqual(gzip.decompress(response.content), self.BODY)
+        self.assertKphpNoTerminatedRequests()
+
+    def test_response_with_content_length_is_not_compressed(self):
+        response = self.kphp_server.http_request_raw([b"GET /gzip?content_length HTTP/1.1", b"Accept-Encoding: gzip"])
+        self.assertEqual(response.status_code, 200)
+        self.assertNotIn("Content-Encoding", response.headers)
+        self.assertEqual(response.raw_bytes.count(b"\r\nContent-Length: "), 1)
+        self.assertEqual(response.headers["Content-Length"], str(len(self.BODY)))
+        self.assertEqual(response.content, self.BODY)
+        self.assertKphpNoTerminatedRequests()
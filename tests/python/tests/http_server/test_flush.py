@@ -0,0 +1,25 @@
+from python.lib.testcase import KphpServerAutoTestCase
+
+
+class TestFlush(KphpServerAutoTestCase):
+    def test_chunked_response(self):
+        response = self.kphp_server.http_get("/flush")
+        self.assertEqual(response.status_code, 200)
+        self.assertEqual(response.headers["Transfer-Encoding"], "chunked")
+        self.assertNotIn("Content-Length", response.headers)
+        self.assertNotIn("X-After-Flush", response.headers)
+        self.assertEqual(response.text, "part 0\npart 1\npart 2\nheaders sent")
+        self.assertKphpNoTerminatedRequests()
+
+    def test_compressed_chunked_response(self):
+        response = self.kphp_server.http_get("/flush?gzip", headers={"Accept-Encoding": "gzip"})
+        self.assertEqual(response.status_code, 200)
+        self.assertEqual(response.headers["Transfer-Encoding"], "chunked")
+        self.assertEqual(response.headers["Content-Encoding"], "gzip")
+        self.assertEqual(response.text, "part 0\npart 1\npart 2\nheaders sent")
+        self.assertKphpNoTerminatedRequests()
+
+    def test_http10_response_is_not_chunked(self):
+        response = self.kphp_server.http_request_raw([b"GET /flush HTTP/1.0"])
+        self.assertEqual(response.status_code, 200)
+        self.assertEqual(response.content, b"part 0\npart 1\npart 2\nheaders not sent")
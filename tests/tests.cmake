@@ -9,6 +9,18 @@ if(KPHP_TESTS)
         set_target_properties(${TEST_NAME} PROPERTIES FOLDER tests)
     endfunction()
 
+    # the benchmarks are built along with the tests, but they are run by hand: make benchmarks && ./benchmarks-<name>
+    add_custom_target(benchmarks)
+    function(vk_add_benchmark BENCHMARK_NAME SRC_LIBS)
+        set(BENCHMARK_NAME benchmarks-${BENCHMARK_NAME})
+        add_executable(${BENCHMARK_NAME} ${ARGN})
+        target_link_libraries(${BENCHMARK_NAME} PRIVATE benchmark::benchmark ${SRC_LIBS} vk::popular_common)
+        target_link_options(${BENCHMARK_NAME} PRIVATE ${NO_PIE})
+
+        add_dependencies(benchmarks ${BENCHMARK_NAME})
+        set_target_properties(${BENCHMARK_NAME} PROPERTIES FOLDER benchmarks)
+    endfunction()
+
     enable_testing()
     include(common/common-tests.cmake)
     include(net/net-tests.cmake)